@@ -0,0 +1,162 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "bench_window.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "metrics.h"
+#include "renderer.h"
+#include "rewind_buffer.h"
+#include "snek_engine.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Every operator new in snek_bench goes through here and is counted. The
+// count is one relaxed add, so the other benchmarks barely notice.
+static std::atomic<uint64_t> allocations(0);
+
+static void* CountedAlloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    void* p = CountedAlloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+uint64_t GetAllocations() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+// Plays bot games the way the game loop does (rewind recording around each
+// tick, frame metrics, drawing, a rewind now and then, a reset after every
+// game over) and counts heap allocations once two games have warmed
+// everything up. A tick (GameLogic::RunFrame) and a whole frame must both
+// allocate nothing; the engine's Step is checked the same way. Drawing is
+// left out when there is no display to open a window on.
+// Usage: snek_bench alloc [frames]
+int BenchAlloc(int argc, char** argv) {
+    uint64_t frames = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 200000;
+    const float frameTime = 1.0f / 60.0f;
+
+    // The counter has to see this one, or the hook isn't linked in
+    uint64_t probe = GetAllocations();
+    int* volatile probed = new int(0);
+    delete probed;
+    if (GetAllocations() == probe) {
+        std::printf("alloc: operator new isn't being counted\n");
+        return 1;
+    }
+
+    bool drawing = OpenBenchWindow();
+    GameState game;
+    game.rng.Seed(21);
+    game.gameMode = MODE_ACCELERATED;
+    game.Reset();
+    RewindBuffer rewind;
+    game.rewind = &rewind;
+    GreedyBot bot;
+    SnekGame engine;
+    SnekEngine::Reset(engine, MODE_ACCELERATED, 21);
+
+    uint64_t games = 0;
+    uint64_t tickAllocations = 0;
+    uint64_t frameAllocations = 0;
+    uint64_t engineAllocations = 0;
+    uint64_t measured = 0;
+    uint64_t measuredGames = 0;
+    uint64_t rewinds = 0;
+    for (uint64_t f = 0; measured < frames; f++) {
+        bool warm = games >= 2;
+        uint64_t frameStart = GetAllocations();
+        if (f % 500 == 499) {
+            // Hold the rewind key for half a second
+            for (int i = 0; i < 30 && rewind.StepBack(game); i++) {
+            }
+            rewinds++;
+        } else {
+            rewind.BeginFrame(game);
+            uint64_t tickStart = GetAllocations();
+            GameLogic::RunFrame(game, frameTime, bot.NextInput(game));
+            uint64_t tickCount = GetAllocations() - tickStart;
+            rewind.EndFrame(game);
+            Metrics::RecordSeconds(METRIC_FRAME_TIME, frameTime);
+            tickAllocations += warm ? tickCount : 0;
+        }
+        if (drawing) {
+            BeginDrawing();
+            Renderer::DrawGame(game);
+            EndDrawing();
+        }
+        if (game.gameOver) {
+            games++;
+            measuredGames += warm ? 1 : 0;
+            game.Reset();
+            rewind.Clear();
+            bot = GreedyBot();
+        }
+        frameAllocations += warm ? GetAllocations() - frameStart : 0;
+
+        uint64_t engineStart = GetAllocations();
+        SnekEngine::Step(engine, nullptr);
+        if (engine.gameOver) {
+            SnekEngine::Restart(engine, MODE_ACCELERATED);
+        }
+        engineAllocations += warm ? GetAllocations() - engineStart : 0;
+        measured += warm ? 1 : 0;
+    }
+
+    std::printf("alloc: %llu frames after warm-up, %llu games, %llu rewinds%s\n",
+                (unsigned long long)measured, (unsigned long long)measuredGames, (unsigned long long)rewinds,
+                drawing ? "" : " (no display, not drawn)");
+    std::printf("  heap allocations: %llu in ticks, %llu in frames, %llu in engine steps\n",
+                (unsigned long long)tickAllocations, (unsigned long long)frameAllocations,
+                (unsigned long long)engineAllocations);
+    if (tickAllocations != 0 || frameAllocations != 0 || engineAllocations != 0) {
+        std::printf("  the game loop allocates after warm-up\n");
+        return 1;
+    }
+    std::printf("  no allocations after warm-up\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "bench_bot.h"
+#include "game_logic.h"
+#include <algorithm>
+#include <cstdlib>
+
+static const uint8_t DIRECTION_KEYS[] = {FrameInput::UP, FrameInput::DOWN, FrameInput::LEFT, FrameInput::RIGHT};
+static const Direction DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static bool IsSafe(const GameState& game, int col, int row) {
+    if (col < 0 || col >= GameConstants::GRID_WIDTH || row < 0 || row >= GameConstants::GRID_HEIGHT) {
+        return false;
+    }
+    for (const auto& segment : game.snake) {
+        if (segment.col == col && segment.row == row) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t GreedyBot::NextInput(const GameState& game) {
+    if (game.moveCount == lastKeyMove || game.snake.empty()) {
+        return 0;
+    }
+    const Position& head = game.snake[0];
+    int best = -1;
+    int bestDistance = 1 << 30;
+    for (int d = 0; d < 4; d++) {
+        if (DIRECTIONS[d].dx == -game.dx && DIRECTIONS[d].dy == -game.dy && (game.dx || game.dy)) {
+            continue;
+        }
+        int col = head.col + DIRECTIONS[d].dx;
+        int row = head.row + DIRECTIONS[d].dy;
+        if (!IsSafe(game, col, row)) {
+            continue;
+        }
+        int distance = 1000;
+        for (const auto& apple : game.apples) {
+            if (apple.type != POISONOUS) {
+                distance = std::min(distance, std::abs(apple.col - col) + std::abs(apple.row - row));
+            }
+        }
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = d;
+        }
+    }
+    if (best < 0 || (DIRECTIONS[best].dx == game.dx && DIRECTIONS[best].dy == game.dy)) {
+        return 0;
+    }
+    lastKeyMove = game.moveCount;
+    return DIRECTION_KEYS[best];
+}
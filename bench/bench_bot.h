@@ -0,0 +1,14 @@
+#pragma once
+
+#include "game_state.h"
+#include <cstdint>
+
+// Greedy player for headless legacy games: heads for the nearest edible
+// apple along safe cells, pressing at most one key per move, so games last
+// long enough to exercise growth, effects and apple churn
+struct GreedyBot {
+    uint32_t lastKeyMove = UINT32_MAX;
+
+    // FrameInput bits for this frame (0 = no key)
+    uint8_t NextInput(const GameState& game);
+};
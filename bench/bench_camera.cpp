@@ -0,0 +1,140 @@
+#include "benchmarks.h"
+#include "bench_window.h"
+#include "board_camera.h"
+#include "multi_snake.h"
+#include "renderer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Multi-snake boards from 256x256 (already wider than any view) up to
+// `maxSize` cells a side, each viewed through a BoardCamera following one
+// snake. Checks that the view stays on the board, keeps the followed head in
+// sight, holds the point under the pointer while zooming and never shows
+// more cells than the smallest zoom allows. Then times DrawMultiSnakeGame
+// per board size, which must not grow with the board (skipped without a
+// display).
+// Usage: snek_bench camera [frames] [max board size]
+int BenchCamera(int argc, char** argv) {
+    int frames = (argc > 0) ? std::atoi(argv[0]) : 2000;
+    int maxSize = (argc > 1) ? std::atoi(argv[1]) : 2048;
+    bool drawing = OpenBenchWindow();
+    bool ok = true;
+
+    // Largest view in cells, at the smallest zoom, plus a partial cell each side
+    BoardCamera probe;
+    long long maxVisible = (long long)(probe.viewport.width / CameraConstants::MIN_CELL_SIZE + 2) *
+                           (long long)(probe.viewport.height / CameraConstants::MIN_CELL_SIZE + 2);
+
+    std::printf("camera: %d frames per board%s\n", frames, drawing ? "" : " (no display, not drawn)");
+    std::vector<double> frameUs;
+    for (int size = 256; size <= maxSize; size *= 2) {
+        MultiSnakeConfig config;
+        config.gridWidth = size;
+        config.gridHeight = size;
+        config.numSnakes = 64;
+        config.numBots = 64;
+        config.seed = 3;
+        MultiSnakeState state;
+        state.Reset(config);
+        int totalWidth = size + 2 * GameConstants::BORDER_OFFSET;
+        int totalHeight = size + 2 * GameConstants::BORDER_OFFSET;
+
+        BoardCamera camera;
+        BoardLayerCache layers;
+        camera.SetBoard(totalWidth, totalHeight);
+        long long visibleTotal = 0;
+        double drawSeconds = 0.0;
+        for (int f = 0; f < frames; f++) {
+            if (f % 10 == 0) {
+                MultiSnakeLogic::Step(state);
+            }
+            // Zoom in and out around the viewport's middle now and then
+            if (f % 200 == 100) {
+                camera.Zoom((f % 400 == 100) ? -20.0f : 20.0f,
+                            {camera.viewport.x + camera.viewport.width * 0.5f,
+                             camera.viewport.y + camera.viewport.height * 0.5f});
+            }
+            const SnakeEntity* followed = nullptr;
+            for (const auto& snake : state.snakes) {
+                if (snake.alive && !snake.body.empty()) {
+                    followed = &snake;
+                    break;
+                }
+            }
+            if (followed) {
+                Position head = followed->body.front();
+                camera.Follow((float)(head.col + GameConstants::BORDER_OFFSET),
+                              (float)(head.row + GameConstants::BORDER_OFFSET));
+            }
+
+            int minCol, minRow, maxCol, maxRow;
+            camera.GetVisibleCells(minCol, minRow, maxCol, maxRow);
+            long long visible = (long long)(maxCol - minCol) * (maxRow - minRow);
+            visibleTotal += visible;
+            bool onBoard = minCol >= 0 && minRow >= 0 && maxCol <= totalWidth && maxRow <= totalHeight;
+            bool headShown = !followed || (followed->body.front().col + 1 >= minCol &&
+                                           followed->body.front().col + 1 < maxCol &&
+                                           followed->body.front().row + 1 >= minRow &&
+                                           followed->body.front().row + 1 < maxRow);
+            if (!onBoard || !headShown || visible > maxVisible) {
+                std::printf("  %dx%d frame %d: view [%d, %d) x [%d, %d) at %d px\n",
+                            size, size, f, minCol, maxCol, minRow, maxRow, camera.GetCellSize());
+                ok = false;
+                break;
+            }
+
+            if (drawing) {
+                auto start = std::chrono::steady_clock::now();
+                BeginDrawing();
+                Renderer::DrawMultiSnakeGame(state, 0, camera, layers);
+                EndDrawing();
+                drawSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        // Zooming keeps the point under the pointer where it was, to within the
+        // pixel the origin rounds to
+        BoardCamera zoomed;
+        zoomed.SetBoard(totalWidth, totalHeight);
+        zoomed.following = false;
+        Vector2 pointer = {zoomed.viewport.x + 200.0f, zoomed.viewport.y + 300.0f};
+        for (float steps : {1.0f, -1.0f, 3.0f, -2.0f}) {
+            int cellSize = zoomed.GetCellSize();
+            float col = (pointer.x - zoomed.ScreenX(0)) / cellSize;
+            float row = (pointer.y - zoomed.ScreenY(0)) / cellSize;
+            zoomed.Zoom(steps, pointer);
+            float colAfter = (pointer.x - zoomed.ScreenX(0)) / zoomed.GetCellSize();
+            float rowAfter = (pointer.y - zoomed.ScreenY(0)) / zoomed.GetCellSize();
+            float slack = 1.0f / zoomed.GetCellSize() + 1e-4f;
+            if ((std::fabs(col - colAfter) > slack || std::fabs(row - rowAfter) > slack)) {
+                std::printf("  %dx%d: zoom by %.0f moved cell (%.1f, %.1f) to (%.1f, %.1f)\n",
+                            size, size, steps, col, row, colAfter, rowAfter);
+                ok = false;
+            }
+        }
+
+        double us = drawing ? drawSeconds * 1e6 / frames : 0.0;
+        frameUs.push_back(us);
+        std::printf("  %5dx%-5d %7.0f cells in view on average", size, size, (double)visibleTotal / frames);
+        if (drawing) {
+            std::printf(", %.1f us per frame, %llu chunks rendered", us, (unsigned long long)layers.GetChunksRendered());
+        }
+        std::printf("\n");
+        layers.Unload();
+    }
+
+    // Frame time may wobble, but not scale with the board's area
+    if (drawing && frameUs.size() > 1 && frameUs.back() > 3.0 * frameUs.front() + 50.0) {
+        std::printf("  frame time grows with the board\n");
+        ok = false;
+    }
+    if (!ok) {
+        std::printf("  camera views are wrong\n");
+        return 1;
+    }
+    std::printf("  all views ok\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "benchmarks.h"
+#include "video_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// Frame filled with one color, as ReadScreenPixels would hand it over
+static unsigned char* SolidFrame(int width, int height, unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char* rgba = (unsigned char*)std::malloc((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        rgba[4 * i] = r;
+        rgba[4 * i + 1] = g;
+        rgba[4 * i + 2] = b;
+        rgba[4 * i + 3] = 255;
+    }
+    return rgba;
+}
+
+static bool CheckCounts(const char* name, const CaptureStats& stats) {
+    if (stats.written + stats.dropped + stats.failed != stats.captured || stats.failed != 0) {
+        std::printf("  %s: %llu captured, %llu written, %llu dropped, %llu failed\n", name,
+                    (unsigned long long)stats.captured, (unsigned long long)stats.written,
+                    (unsigned long long)stats.dropped, (unsigned long long)stats.failed);
+        return false;
+    }
+    return true;
+}
+
+// Submits synthetic frames the way the game loop does: once per tick, at an
+// odd size so the chroma planes round up. Checks that Submit never waits
+// for encoding, that every frame is either written or counted as dropped,
+// and that the .y4m holds exactly the written frames with the right luma.
+// Then floods a single worker with large frames, which must drop rather
+// than block, and writes a short PNG sequence.
+// Usage: snek_bench capture [frames] [tick ms]
+int BenchCapture(int argc, char** argv) {
+    int frames = (argc > 0) ? std::atoi(argv[0]) : 240;
+    int tickMs = (argc > 1) ? std::atoi(argv[1]) : 4;
+    const int width = 321;
+    const int height = 181;
+    bool ok = true;
+    std::printf("capture: %d frames of %dx%d, one every %d ms\n", frames, width, height, tickMs);
+
+    std::string videoPath = "snek_bench_capture.y4m";
+    VideoCapture capture;
+    if (!capture.Start(videoPath, 30)) {
+        std::printf("  could not start recording to %s\n", videoPath.c_str());
+        return 1;
+    }
+    double maxSubmitUs = 0.0;
+    double totalSubmitUs = 0.0;
+    for (int i = 0; i < frames; i++) {
+        unsigned char* rgba = SolidFrame(width, height, 200, 100, 50);
+        auto start = std::chrono::steady_clock::now();
+        capture.Submit(rgba, width, height);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        maxSubmitUs = std::max(maxSubmitUs, us);
+        totalSubmitUs += us;
+        std::this_thread::sleep_for(std::chrono::milliseconds(tickMs));
+    }
+    capture.Stop();
+    CaptureStats stats = capture.GetStats();
+    ok = CheckCounts("video", stats) && ok;
+    std::printf("  video: %llu written, %llu dropped, submit %.1f us average, %.1f us worst\n",
+                (unsigned long long)stats.written, (unsigned long long)stats.dropped,
+                totalSubmitUs / std::max(frames, 1), maxSubmitUs);
+    // Submit only takes a lock and copies a pointer; anything near a frame's
+    // encode time means it waited on a worker. The worst case is only shown,
+    // since a single core can preempt the caller mid-call.
+    if (totalSubmitUs / std::max(frames, 1) > 500.0) {
+        std::printf("  submit blocked\n");
+        ok = false;
+    }
+
+    // Header, then per frame "FRAME\n", luma and two quarter-size chroma planes
+    char header[64];
+    int headerSize = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F30:1 Ip A1:1 C420jpeg\n", width, height);
+    size_t frameSize = 6 + (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+    struct stat info;
+    size_t expectedSize = headerSize + stats.written * frameSize;
+    if (stat(videoPath.c_str(), &info) != 0 || (size_t)info.st_size != expectedSize) {
+        std::printf("  %s is %lld bytes, expected %zu\n", videoPath.c_str(),
+                    (long long)info.st_size, expectedSize);
+        ok = false;
+    } else if (stats.written > 0) {
+        // (77 * 200 + 150 * 100 + 29 * 50 + 128) >> 8
+        FILE* file = std::fopen(videoPath.c_str(), "rb");
+        char text[64] = {};
+        unsigned char luma[2] = {};
+        bool read = file && std::fread(text, 1, headerSize + 6, file) == (size_t)headerSize + 6 &&
+                    std::fread(luma, 1, 2, file) == 2;
+        if (file) {
+            std::fclose(file);
+        }
+        if (!read || std::memcmp(text, header, headerSize) != 0 || luma[0] != 124 || luma[1] != 124) {
+            std::printf("  first frame's header or luma is wrong (Y = %d)\n", luma[0]);
+            ok = false;
+        }
+    }
+    unlink(videoPath.c_str());
+
+    // One worker against a burst of 720p frames: the queue fills and frames drop
+    std::string burstPath = "snek_bench_capture_burst.y4m";
+    VideoCapture burst;
+    int burstFrames = 64;
+    double burstSubmitUs = 0.0;
+    double burstTotalUs = 0.0;
+    if (burst.Start(burstPath, 60, 1)) {
+        for (int i = 0; i < burstFrames; i++) {
+            unsigned char* rgba = SolidFrame(1280, 720, 10, 20, 30);
+            auto start = std::chrono::steady_clock::now();
+            burst.Submit(rgba, 1280, 720);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            burstSubmitUs = std::max(burstSubmitUs, us);
+            burstTotalUs += us;
+        }
+        burst.Stop();
+        stats = burst.GetStats();
+        ok = CheckCounts("burst", stats) && ok;
+        std::printf("  burst: %llu written, %llu dropped, submit %.1f us average, %.1f us worst\n",
+                    (unsigned long long)stats.written, (unsigned long long)stats.dropped,
+                    burstTotalUs / burstFrames, burstSubmitUs);
+        if (stats.dropped == 0 || burstTotalUs / burstFrames > 500.0) {
+            std::printf("  an overloaded capture should drop frames, not wait\n");
+            ok = false;
+        }
+        unlink(burstPath.c_str());
+    } else {
+        std::printf("  could not start recording to %s\n", burstPath.c_str());
+        ok = false;
+    }
+
+    // PNG sequence into a directory, one numbered file per frame
+    std::string directory = "snek_bench_capture_frames";
+    VideoCapture pngs;
+    int pngFrames = 4;
+    if (pngs.Start(directory, 30)) {
+        for (int i = 0; i < pngFrames; i++) {
+            pngs.Submit(SolidFrame(64, 48, 0, 200, 0), 64, 48);
+        }
+        pngs.Stop();
+        stats = pngs.GetStats();
+        ok = CheckCounts("png", stats) && ok;
+        std::printf("  png: %llu written\n", (unsigned long long)stats.written);
+        for (int i = 0; i < pngFrames; i++) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "/frame-%06d.png", i);
+            unlink((directory + name).c_str());
+        }
+        rmdir(directory.c_str());
+    } else {
+        std::printf("  could not start recording to %s\n", directory.c_str());
+        ok = false;
+    }
+
+    if (!ok) {
+        std::printf("  capture is wrong\n");
+        return 1;
+    }
+    std::printf("  all frames accounted for\n");
+    return 0;
+}
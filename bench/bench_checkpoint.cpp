@@ -0,0 +1,98 @@
+#include "benchmarks.h"
+#include "libsnek.h"
+#include "rng.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RandomActions(SnekBatch* batch, Rng& rng) {
+    uint8_t* actions = snek_batch_actions(batch);
+    for (int env = 0; env < snek_batch_num_envs(batch); env++) {
+        actions[env] = (uint8_t)rng.GetValue(SNEK_ACTION_NONE, SNEK_ACTION_RIGHT);
+    }
+}
+
+// Saves a batch mid-run, loads it back and checks that both copies stay
+// identical for the following steps (so RNG state and timers came back too).
+// Usage: snek_bench checkpoint [games] [warmupSteps] [path]
+int BenchCheckpoint(int argc, char** argv) {
+    int numGames = (argc > 0) ? std::atoi(argv[0]) : 100000;
+    int warmup = (argc > 1) ? std::atoi(argv[1]) : 50;
+    std::string path = (argc > 2) ? argv[2] : "/tmp/snek_checkpoint.bin";
+
+    SnekBatchConfig config = {};
+    config.num_envs = numGames;
+    config.mode = SNEK_MODE_ACCELERATED;
+    config.max_ticks = 1000;
+    config.death_penalty = 1.0f;
+    config.seed = 9;
+    SnekBatch* original = snek_batch_create(&config);
+    if (!original) {
+        std::printf("snek_batch_create failed\n");
+        return 1;
+    }
+
+    Rng rng;
+    rng.Seed(5);
+    for (int step = 0; step < warmup; step++) {
+        RandomActions(original, rng);
+        snek_batch_step(original, nullptr);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool saved = snek_batch_save(original, path.c_str(), 0) == 1;
+    double saveSeconds = SecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    saved = saved && snek_batch_save(original, path.c_str(), 1) == 1;
+    double durableSeconds = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    SnekBatch* restored = saved ? snek_batch_load(path.c_str()) : nullptr;
+    double loadSeconds = SecondsSince(start);
+    if (!restored) {
+        std::printf("checkpoint %s failed\n", saved ? "load" : "save");
+        snek_batch_destroy(original);
+        return 1;
+    }
+
+    long fileSize = 0;
+    if (FILE* file = std::fopen(path.c_str(), "rb")) {
+        std::fseek(file, 0, SEEK_END);
+        fileSize = std::ftell(file);
+        std::fclose(file);
+    }
+
+    // Same actions into both batches; every buffer must match after each step
+    size_t obsBytes = (size_t)numGames * snek_grid_width() * snek_grid_height();
+    bool identical = std::memcmp(snek_batch_observations(original), snek_batch_observations(restored), obsBytes) == 0;
+    for (int step = 0; step < 100 && identical; step++) {
+        RandomActions(original, rng);
+        std::memcpy(snek_batch_actions(restored), snek_batch_actions(original), (size_t)numGames);
+        snek_batch_step(original, nullptr);
+        snek_batch_step(restored, nullptr);
+        identical = std::memcmp(snek_batch_observations(original), snek_batch_observations(restored), obsBytes) == 0 &&
+                    std::memcmp(snek_batch_rewards(original), snek_batch_rewards(restored), numGames * sizeof(float)) == 0 &&
+                    std::memcmp(snek_batch_dones(original), snek_batch_dones(restored), (size_t)numGames) == 0 &&
+                    std::memcmp(snek_batch_scores(original), snek_batch_scores(restored), numGames * sizeof(int32_t)) == 0;
+    }
+
+    // A truncated file must be rejected rather than half-loaded
+    bool rejectsTruncated = truncate(path.c_str(), fileSize / 2) == 0 && snek_batch_load(path.c_str()) == nullptr;
+    unlink(path.c_str());
+    snek_batch_destroy(original);
+    snek_batch_destroy(restored);
+
+    std::printf("checkpoint: %d games, %.1f MB\n", numGames, fileSize / 1e6);
+    std::printf("  save %.1f ms, durable save %.1f ms, load %.1f ms\n",
+                saveSeconds * 1e3, durableSeconds * 1e3, loadSeconds * 1e3);
+    std::printf("  restored run %s, truncated file %s\n",
+                identical ? "identical" : "DIVERGED", rejectsTruncated ? "rejected" : "ACCEPTED");
+    return (identical && rejectsTruncated) ? 0 : 1;
+}
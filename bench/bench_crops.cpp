@@ -0,0 +1,150 @@
+#include "benchmarks.h"
+#include "libsnek.h"
+#include "observation_crop.h"
+#include "rng.h"
+#include "snek_batch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// What the window should show at (r, c), straight from the game's plane
+static uint8_t ExpectedCell(const SnekGame& game, const uint8_t* plane, int size, int r, int c) {
+    int dx = game.dx;
+    int dy = game.dy;
+    if (dx == 0 && dy == 0) {
+        dy = -1;
+    }
+    int ahead = size / 2 - r;
+    int right = c - size / 2;
+    Cell head = game.Segment(0);
+    int col = head.col + ahead * dx - right * dy;
+    int row = head.row + ahead * dy + right * dx;
+    if (game.canPassWalls) {
+        col = (col + GameConstants::GRID_WIDTH) % GameConstants::GRID_WIDTH;
+        row = (row + GameConstants::GRID_HEIGHT) % GameConstants::GRID_HEIGHT;
+    }
+    if (col < 0 || col >= GameConstants::GRID_WIDTH || row < 0 || row >= GameConstants::GRID_HEIGHT) {
+        return SNEK_CELL_WALL;
+    }
+    return plane[SnekGame::CellIndex(col, row)];
+}
+
+static double TimeCrops(bool vectorized, const SnekBatch& batch, int size, int repeats, std::vector<uint8_t>& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        if (vectorized) {
+            ObservationCrop::Extract(batch.games.data(), batch.observations.data(), batch.config.num_envs, size, out.data());
+        } else {
+            ObservationCrop::ExtractScalar(batch.games.data(), batch.observations.data(), batch.config.num_envs,
+                                           size, out.data());
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Steps a batch with random moves and lets every third game pass through
+// walls. For every window size, the vectorized crops must equal the scalar
+// ones byte for byte, and the scalar ones must match each cell worked out
+// from the plane: head in the middle, heading up, walls or wrap past the
+// edge. Then times both versions on the whole batch.
+// Usage: snek_bench crops [envs] [steps] [size]
+int BenchCrops(int argc, char** argv) {
+    int numEnvs = (argc > 0) ? std::atoi(argv[0]) : 4096;
+    int steps = (argc > 1) ? std::atoi(argv[1]) : 50;
+    int timedSize = (argc > 2) ? std::atoi(argv[2]) : 11;
+    if (!ObservationCrop::IsValidSize(timedSize)) {
+        std::printf("crops: size has to be odd, 1 to %d\n", CropConstants::MAX_SIZE);
+        return 1;
+    }
+
+    SnekBatchConfig config = {};
+    config.num_envs = numEnvs;
+    config.mode = SNEK_MODE_ACCELERATED;
+    config.max_ticks = 1000;
+    config.death_penalty = 1.0f;
+    config.seed = 17;
+    SnekBatch* batch = snek_batch_create(&config);
+    if (!batch) {
+        std::printf("snek_batch_create failed\n");
+        return 1;
+    }
+    Rng rng;
+    rng.Seed(4);
+    for (int step = 0; step < steps; step++) {
+        for (int env = 0; env < numEnvs; env++) {
+            batch->actions[env] = (uint8_t)rng.GetValue(SNEK_ACTION_NONE, SNEK_ACTION_RIGHT);
+        }
+        snek_batch_step(batch, nullptr);
+    }
+    for (int env = 0; env < numEnvs; env += 3) {
+        batch->games[env].canPassWalls = true;
+        batch->games[env].wallImmunityTimer = 5.0f;
+    }
+    std::printf("crops: %d envs after %d steps, %s\n", numEnvs, steps,
+                ObservationCrop::HasAvx2() ? "AVX2" : "no AVX2 (both versions are scalar)");
+
+    bool ok = snek_batch_crops(batch, 2, nullptr) == 0 &&
+              snek_batch_crops(batch, CropConstants::MAX_SIZE + 2, nullptr) == 0;
+    std::vector<uint8_t> fast;
+    std::vector<uint8_t> scalar;
+    int checkedSizes = 0;
+    for (int size = 1; size <= CropConstants::MAX_SIZE && ok; size += 2) {
+        size_t area = (size_t)size * size;
+        fast.assign(area * numEnvs, 0xEE);
+        scalar.assign(area * numEnvs, 0xDD);
+        snek_batch_crops(batch, size, fast.data());
+        ObservationCrop::ExtractScalar(batch->games.data(), batch->observations.data(), numEnvs, size, scalar.data());
+        if (fast != scalar) {
+            size_t at = 0;
+            while (fast[at] == scalar[at]) {
+                at++;
+            }
+            std::printf("  size %d: env %zu cell %zu is %d vectorized, %d scalar\n", size, at / area, at % area,
+                        fast[at], scalar[at]);
+            ok = false;
+            break;
+        }
+        for (int env = 0; env < numEnvs && ok; env++) {
+            const SnekGame& game = batch->games[env];
+            const uint8_t* plane = &batch->observations[(size_t)env * SnekEngineConstants::CELLS];
+            const uint8_t* window = &scalar[(size_t)env * area];
+            if (window[area / 2] != SNEK_CELL_HEAD) {
+                std::printf("  size %d: env %d has no head in the middle\n", size, env);
+                ok = false;
+            }
+            for (int r = 0; r < size && ok; r++) {
+                for (int c = 0; c < size && ok; c++) {
+                    uint8_t expected = ExpectedCell(game, plane, size, r, c);
+                    if (window[r * size + c] != expected) {
+                        std::printf("  size %d: env %d (%d, %d) is %d, expected %d\n", size, env, r, c,
+                                    window[r * size + c], expected);
+                        ok = false;
+                    }
+                }
+            }
+        }
+        checkedSizes++;
+    }
+
+    if (ok) {
+        size_t area = (size_t)timedSize * timedSize;
+        fast.assign(area * numEnvs, 0);
+        int repeats = 50;
+        double scalarSeconds = TimeCrops(false, *batch, timedSize, repeats, fast);
+        double fastSeconds = TimeCrops(true, *batch, timedSize, repeats, fast);
+        double crops = (double)numEnvs * repeats;
+        std::printf("  %d sizes match; %dx%d windows: %.1fM/s scalar, %.1fM/s vectorized (%.1fx)\n",
+                    checkedSizes, timedSize, timedSize, crops / scalarSeconds / 1e6, crops / fastSeconds / 1e6,
+                    scalarSeconds / fastSeconds);
+    }
+    snek_batch_destroy(batch);
+
+    if (!ok) {
+        std::printf("  crops are wrong\n");
+        return 1;
+    }
+    std::printf("  all crops ok\n");
+    return 0;
+}
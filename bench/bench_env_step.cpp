@@ -0,0 +1,88 @@
+#include "benchmarks.h"
+#include "libsnek.h"
+#include "rng.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Drives a libsnek batch through the C ABI only, the way a trainer would:
+// buffers fetched once, random actions written in place, one call per step.
+// Usage: snek_bench env_step [envs] [steps] [mode]
+int BenchEnvStep(int argc, char** argv) {
+    int numEnvs = (argc > 0) ? std::atoi(argv[0]) : 4096;
+    int steps = (argc > 1) ? std::atoi(argv[1]) : 500;
+    int mode = (argc > 2) ? std::atoi(argv[2]) : SNEK_MODE_ACCELERATED;
+
+    if (snek_abi_version() != SNEK_ABI_VERSION) {
+        std::printf("ABI version mismatch\n");
+        return 1;
+    }
+
+    SnekBatchConfig config = {};
+    config.num_envs = numEnvs;
+    config.mode = mode;
+    config.max_ticks = 2000;
+    config.death_penalty = 1.0f;
+    config.seed = 42;
+    SnekBatch* batch = snek_batch_create(&config);
+    if (!batch) {
+        std::printf("snek_batch_create failed\n");
+        return 1;
+    }
+
+    uint8_t* actions = snek_batch_actions(batch);
+    const uint8_t* observations = snek_batch_observations(batch);
+    const float* rewards = snek_batch_rewards(batch);
+    const uint8_t* dones = snek_batch_dones(batch);
+    const int32_t* scores = snek_batch_scores(batch);
+    int cells = snek_grid_width() * snek_grid_height();
+
+    Rng rng;
+    rng.Seed(1);
+    long long episodes = 0;
+    long long finalScoreSum = 0;
+    double rewardSum = 0.0;
+    double actionSeconds = 0.0;
+    bool layoutOk = true;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < steps; step++) {
+        auto actionStart = std::chrono::steady_clock::now();
+        for (int env = 0; env < numEnvs; env++) {
+            actions[env] = (uint8_t)rng.GetValue(SNEK_ACTION_NONE, SNEK_ACTION_RIGHT);
+        }
+        actionSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - actionStart).count();
+
+        snek_batch_step(batch, nullptr);
+
+        for (int env = 0; env < numEnvs; env++) {
+            rewardSum += rewards[env];
+            if (dones[env]) {
+                episodes++;
+                finalScoreSum += scores[env];
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    seconds -= actionSeconds;
+
+    // Every observation holds exactly one head
+    for (int env = 0; env < numEnvs && layoutOk; env++) {
+        int heads = 0;
+        for (int c = 0; c < cells; c++) {
+            heads += observations[(size_t)env * cells + c] == SNEK_CELL_HEAD;
+        }
+        layoutOk = heads == 1;
+    }
+    snek_batch_destroy(batch);
+
+    double envSteps = (double)numEnvs * steps;
+    std::printf("env_step: %d envs x %d steps, %s mode\n",
+                numEnvs, steps, mode == SNEK_MODE_ACCELERATED ? "accelerated" : "regular");
+    std::printf("  %.1f ns/env-step, %.2f M env-steps/s (observations included)\n",
+                seconds * 1e9 / envSteps, envSteps / seconds / 1e6);
+    std::printf("  %lld episodes, mean final score %.2f, reward sum %.0f\n",
+                episodes, episodes ? (double)finalScoreSum / episodes : 0.0, rewardSum);
+    std::printf("  observation layout %s\n", layoutOk ? "ok" : "FAILED");
+    return layoutOk ? 0 : 1;
+}
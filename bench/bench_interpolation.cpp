@@ -0,0 +1,143 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "bench_window.h"
+#include "game_logic.h"
+#include "renderer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+    // Where an end of the snake is drawn, in cells
+    struct DrawnPoint {
+        float col;
+        float row;
+    };
+}
+
+static DrawnPoint Drawn(Position cell, int dx, int dy, float fraction) {
+    return {cell.col + dx * fraction, cell.row + dy * fraction};
+}
+
+// Cells between two drawn points, the short way round a wrapped board
+static float Distance(DrawnPoint a, DrawnPoint b) {
+    float dc = std::fabs(a.col - b.col);
+    float dr = std::fabs(a.row - b.row);
+    dc = std::min(dc, GameConstants::GRID_WIDTH - dc);
+    dr = std::min(dr, GameConstants::GRID_HEIGHT - dr);
+    return dc + dr;
+}
+
+// Plays bot games at each refresh rate and follows where the head and tail
+// are drawn. Between frames without a key press, each end may only travel
+// as far as the move timer advanced, across move boundaries and wrapped
+// edges alike; poison reversals, teleports and restarts may jump. Reports
+// how many frames show the snake somewhere new compared with whole-cell
+// drawing, and times DrawGame when a window can be opened.
+// Usage: snek_bench interpolation [seconds]
+int BenchInterpolation(int argc, char** argv) {
+    float seconds = (argc > 0) ? (float)std::atof(argv[0]) : 300.0f;
+    const float rates[] = {60.0f, 144.0f, 240.0f};
+    const GameMode modes[] = {MODE_REGULAR, MODE_ACCELERATED};
+    bool ok = true;
+    std::printf("interpolation: %.0f simulated seconds per mode and rate\n", seconds);
+
+    for (GameMode mode : modes) {
+        for (float hz : rates) {
+            GameState state;
+            state.gameMode = mode;
+            state.rng.Seed(31);
+            state.Reset();
+            GreedyBot bot;
+            float deltaTime = 1.0f / hz;
+            int frames = (int)(seconds * hz);
+            int checked = 0;
+            int jumps = 0;
+            int smoothFrames = 0;
+            int cellFrames = 0;
+            int games = 1;
+            for (int frame = 0; frame < frames && ok; frame++) {
+                if (state.gameOver) {
+                    state.Reset();
+                    bot = GreedyBot();
+                    games++;
+                    continue;
+                }
+                SnakeMotion before = Renderer::GetSnakeMotion(state);
+                Position headBefore = state.snake[0];
+                DrawnPoint head = Drawn(headBefore, before.headDx, before.headDy, before.fraction);
+                DrawnPoint tail = Drawn(state.snake[state.snake.size() - 1], before.tailDx, before.tailDy,
+                                        before.fraction);
+                size_t apples = state.apples.size();
+                bool wasPaused = state.isPaused;
+                uint32_t moves = state.moveCount;
+                uint8_t input = bot.NextInput(state);
+
+                GameLogic::RunFrame(state, deltaTime, input);
+                if (state.gameOver) {
+                    continue;
+                }
+                SnakeMotion after = Renderer::GetSnakeMotion(state);
+                DrawnPoint newHead = Drawn(state.snake[0], after.headDx, after.headDy, after.fraction);
+                DrawnPoint newTail = Drawn(state.snake[state.snake.size() - 1], after.tailDx, after.tailDy,
+                                           after.fraction);
+                float headStep = Distance(head, newHead);
+                float tailStep = Distance(tail, newTail);
+                smoothFrames += (headStep > 1e-4f || tailStep > 1e-4f) ? 1 : 0;
+                cellFrames += (state.moveCount != moves) ? 1 : 0;
+
+                // Frames where a jump is expected: a key turned the head, an
+                // apple came or went next to it, the poison pause started or
+                // ended, or a teleport left the snake standing
+                bool expectJump = input != 0 || state.apples.size() != apples || wasPaused || state.isPaused ||
+                                  (state.dx == 0 && state.dy == 0);
+                if (expectJump) {
+                    continue;
+                }
+                checked++;
+                float limit = deltaTime / MoveIntervalAt(state.GetRules(), state.score) + 1e-3f;
+                if (headStep > limit || tailStep > limit) {
+                    jumps++;
+                    if (jumps <= 3) {
+                        std::printf("  %.0f Hz frame %d: head moved %.3f, tail %.3f cells (limit %.3f)\n", hz, frame,
+                                    headStep, tailStep, limit);
+                    }
+                }
+            }
+            std::printf("  %-11s %3.0f Hz: %d games, %d frames checked, %d jumps; snake redrawn on %.0f%% of frames "
+                        "(whole cells: %.0f%%)\n", mode == MODE_REGULAR ? "regular" : "accelerated", hz, games,
+                        checked, jumps, 100.0 * smoothFrames / frames, 100.0 * cellFrames / frames);
+            ok = ok && jumps == 0 && checked > frames / 2;
+        }
+    }
+
+    if (OpenBenchWindow()) {
+        GameState state;
+        state.rng.Seed(4);
+        state.Reset();
+        GreedyBot bot;
+        int frames = 2000;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            if (state.gameOver) {
+                state.Reset();
+            }
+            GameLogic::RunFrame(state, 1.0f / 240.0f, bot.NextInput(state));
+            BeginDrawing();
+            Renderer::DrawGame(state);
+            EndDrawing();
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+        std::printf("  DrawGame with interpolation: %.1f us per frame\n", us);
+    } else {
+        std::printf("  no window, DrawGame not timed\n");
+    }
+
+    if (!ok) {
+        std::printf("  interpolated motion jumps\n");
+        return 1;
+    }
+    std::printf("  all motion smooth\n");
+    return 0;
+}
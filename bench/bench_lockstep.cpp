@@ -0,0 +1,506 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "replay.h"
+#include "rng.h"
+#include "snek_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Differential check of SnekEngine against GameLogic. Both run the same
+// seeded start state and the same frames (delta time plus at most one
+// direction key) in lockstep, and every field the rules touch is compared
+// after every frame. A divergence is shrunk to the shortest frame list that
+// still diverges and written out as a replay of the legacy game.
+
+namespace {
+    enum Scenario {
+        SCENARIO_FRESH,     // GameState::Reset from the seed
+        SCENARIO_CROWDED,   // board almost full, so SpawnApple keeps giving up
+        SCENARIO_EFFECTS,   // poison, teleport or Pomme Supreme just ahead of the head
+        SCENARIO_COUNT
+    };
+    const char* const SCENARIO_NAMES[] = {"fresh", "crowded", "effects"};
+
+    const Direction DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    const uint8_t DIRECTION_KEYS[] = {FrameInput::UP, FrameInput::DOWN, FrameInput::LEFT, FrameInput::RIGHT};
+    const float FRAME_TIMES[] = {1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 144.0f, 1.0f / 240.0f};
+
+    struct Step {
+        float deltaTime;
+        int8_t key;         // index into DIRECTIONS, -1 for none
+    };
+
+    struct Case {
+        uint64_t seed;
+        GameMode mode;
+        Scenario scenario;
+        std::vector<Step> steps;
+    };
+
+    // Edge cases seen on the legacy side, so a run can show it covered them
+    struct Coverage {
+        uint64_t poisonReversals = 0;
+        uint64_t teleports = 0;
+        uint64_t clampedTeleports = 0;
+        uint64_t wallWraps = 0;
+        uint64_t rejectedSpawns = 0;
+        uint64_t deaths = 0;
+    };
+
+    // The parts of the previous frame's legacy state that Observe needs
+    struct Glance {
+        bool gameOver;
+        bool canPassWalls;
+        uint32_t moveCount;
+        size_t appleCount;
+        Position head;
+
+        explicit Glance(const GameState& state)
+            : gameOver(state.gameOver), canPassWalls(state.canPassWalls), moveCount(state.moveCount),
+              appleCount(state.apples.size()), head(state.snake.empty() ? Position{0, 0} : state.snake[0]) {}
+    };
+
+    struct Divergence {
+        size_t frame;
+        const char* field;
+    };
+
+    bool SameBits(float a, float b) {
+        return std::memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    // Name of the first field that differs, or nullptr. High scores and the
+    // user pause only exist on the legacy side.
+    const char* FindDifference(const GameState& legacy, const SnekGame& fast) {
+        if (legacy.gameOver != fast.gameOver) return "gameOver";
+        if (legacy.score != fast.score) return "score";
+        if (legacy.dx != fast.dx || legacy.dy != fast.dy) return "direction";
+        if (legacy.moveCount != fast.moveCount) return "moveCount";
+        if (legacy.rng.state != fast.rng.state) return "rng";
+        if (!SameBits(legacy.moveTimer, fast.moveTimer)) return "moveTimer";
+        if (!SameBits(legacy.gameTime, fast.gameTime)) return "gameTime";
+        if (legacy.canIntersectSelf != fast.canIntersectSelf) return "canIntersectSelf";
+        if (!SameBits(legacy.immunityTimer, fast.immunityTimer)) return "immunityTimer";
+        if (legacy.canPassWalls != fast.canPassWalls) return "canPassWalls";
+        if (!SameBits(legacy.wallImmunityTimer, fast.wallImmunityTimer)) return "wallImmunityTimer";
+        if (legacy.cannotEatApples != fast.cannotEatApples) return "cannotEatApples";
+        if (!SameBits(legacy.cannotEatTimer, fast.cannotEatTimer)) return "cannotEatTimer";
+        if (!SameBits(legacy.poisonSoundTimer, fast.poisonSoundTimer)) return "poisonSoundTimer";
+        if (legacy.isPaused != fast.isPaused) return "isPaused";
+        if (!SameBits(legacy.pauseTimer, fast.pauseTimer)) return "pauseTimer";
+
+        if (legacy.snake.size() != (size_t)fast.length) return "snake length";
+        for (int i = 0; i < fast.length; i++) {
+            Cell cell = fast.Segment(i);
+            if (legacy.snake[i].col != cell.col || legacy.snake[i].row != cell.row) return "snake";
+        }
+        if (legacy.directionQueue.size() != (size_t)fast.queueCount) return "queue length";
+        for (int i = 0; i < fast.queueCount; i++) {
+            const Direction& dir = fast.queue[(fast.queueHead + i) % SnekEngineConstants::DIRECTION_QUEUE_CAPACITY];
+            if (legacy.directionQueue[i].dx != dir.dx || legacy.directionQueue[i].dy != dir.dy) return "queue";
+        }
+        if (legacy.apples.size() != (size_t)fast.appleCount) return "apple count";
+        for (int i = 0; i < fast.appleCount; i++) {
+            const Apple& a = legacy.apples[i];
+            const Apple& b = fast.apples[i];
+            if (a.col != b.col || a.row != b.row || a.type != b.type ||
+                !SameBits(a.spawnTime, b.spawnTime) || !SameBits(a.despawnTime, b.despawnTime)) {
+                return "apples";
+            }
+        }
+        return nullptr;
+    }
+
+    bool IsFree(const GameState& state, int col, int row) {
+        if (col < 0 || col >= GameConstants::GRID_WIDTH || row < 0 || row >= GameConstants::GRID_HEIGHT) {
+            return false;
+        }
+        for (const auto& segment : state.snake) {
+            if (segment.col == col && segment.row == row) return false;
+        }
+        for (const auto& apple : state.apples) {
+            if (apple.col == col && apple.row == row) return false;
+        }
+        return true;
+    }
+
+    void AddApple(GameState& state, Rng& rng, int col, int row, FoodType type) {
+        float spawnTime = state.gameTime * rng.GetValue(0, 100) / 100.0f;
+        float despawnTime = (float)rng.GetValue(GameConstants::DESPAWN_TIME_MIN, GameConstants::DESPAWN_TIME_MAX);
+        state.apples.push_back({col, row, type, spawnTime, despawnTime});
+    }
+
+    // Start state for a case; the generator Rng and the game's Rng both come
+    // from the seed, so the same case always starts the same way
+    void BuildStart(const Case& c, GameState& state) {
+        state = GameState();
+        state.gameMode = c.mode;
+        state.showModeSelection = false;
+        state.rng.Seed(c.seed);
+        if (c.scenario == SCENARIO_FRESH) {
+            state.Reset();
+            return;
+        }
+
+        Rng rng;
+        rng.Seed(c.seed ^ 0x5EED5EED5EEDull);
+        state.gameTime = rng.GetValue(0, 2000) / 100.0f;
+        state.moveTimer = rng.GetValue(0, 19) / 100.0f;
+
+        if (c.scenario == SCENARIO_CROWDED) {
+            // Serpentine path; the snake covers all but a few cells of it,
+            // head last, heading on along the path
+            std::vector<Position> path;
+            for (int row = 0; row < GameConstants::GRID_HEIGHT; row++) {
+                for (int i = 0; i < GameConstants::GRID_WIDTH; i++) {
+                    path.push_back({(row % 2 == 0) ? i : GameConstants::GRID_WIDTH - 1 - i, row});
+                }
+            }
+            int length = (int)path.size() - rng.GetValue(3, 30);
+            for (int i = length - 1; i >= 0; i--) {
+                state.snake.push_back(path[i]);
+            }
+            Position next = path[length];
+            state.dx = next.col - path[length - 1].col;
+            state.dy = next.row - path[length - 1].row;
+            int apples = rng.GetValue(1, 3);
+            for (int i = length + 1; i < (int)path.size() && apples > 0; i++) {
+                if (rng.GetValue(0, 3) == 0) {
+                    AddApple(state, rng, path[i].col, path[i].row, (FoodType)rng.GetValue(0, 4));
+                    apples--;
+                }
+            }
+            state.canIntersectSelf = rng.GetValue(0, 1) == 0;
+            state.immunityTimer = state.canIntersectSelf ? rng.GetValue(1, 1000) / 100.0f : 0.0f;
+            return;
+        }
+
+        // Random self-avoiding body behind a random head
+        Position head = {rng.GetValue(0, GameConstants::GRID_WIDTH - 1), rng.GetValue(0, GameConstants::GRID_HEIGHT - 1)};
+        state.snake.push_back(head);
+        int length = rng.GetValue(2, 60);
+        while ((int)state.snake.size() < length) {
+            const Position& tail = state.snake.back();
+            int start = rng.GetValue(0, 3);
+            bool grown = false;
+            for (int k = 0; k < 4 && !grown; k++) {
+                const Direction& d = DIRECTIONS[(start + k) % 4];
+                if (IsFree(state, tail.col + d.dx, tail.row + d.dy)) {
+                    state.snake.push_back({tail.col + d.dx, tail.row + d.dy});
+                    grown = true;
+                }
+            }
+            if (!grown) {
+                break;
+            }
+        }
+        if (state.snake.size() > 1) {
+            state.dx = head.col - state.snake[1].col;
+            state.dy = head.row - state.snake[1].row;
+        } else {
+            const Direction& d = DIRECTIONS[rng.GetValue(0, 3)];
+            state.dx = d.dx;
+            state.dy = d.dy;
+        }
+
+        // The special apple a step or two ahead; Pomme Supreme also turns the
+        // walls off so the snake can run off the edge
+        const FoodType specials[] = {POISONOUS, TELEPORT, POMME_SUPREME, POMME_PLUS};
+        FoodType special = specials[rng.GetValue(0, 3)];
+        int distance = rng.GetValue(1, 2);
+        int col = head.col + state.dx * distance;
+        int row = head.row + state.dy * distance;
+        if (IsFree(state, col, row)) {
+            AddApple(state, rng, col, row, special);
+        }
+        if (special == POMME_SUPREME || rng.GetValue(0, 3) == 0) {
+            state.canPassWalls = true;
+            state.wallImmunityTimer = rng.GetValue(1, 1000) / 100.0f;
+        }
+        if (rng.GetValue(0, 3) == 0) {
+            state.cannotEatApples = true;
+            state.cannotEatTimer = rng.GetValue(1, 1000) / 100.0f;
+            state.poisonSoundTimer = rng.GetValue(1, 100) / 100.0f;
+        }
+        if (rng.GetValue(0, 3) == 0) {
+            state.canIntersectSelf = true;
+            state.immunityTimer = rng.GetValue(1, 1000) / 100.0f;
+        }
+        int extra = rng.GetValue(0, 4);
+        for (int i = 0; i < extra && (int)state.apples.size() < GameConstants::MAX_APPLES; i++) {
+            int ac = rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+            int ar = rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
+            if (IsFree(state, ac, ar)) {
+                AddApple(state, rng, ac, ar, (FoodType)rng.GetValue(0, 4));
+            }
+        }
+    }
+
+    void Advance(GameState& legacy, SnekGame& fast, const Step& step) {
+        uint8_t input = (step.key >= 0) ? DIRECTION_KEYS[step.key] : 0;
+        GameLogic::RunFrame(legacy, step.deltaTime, input);
+        SnekEngine::Frame(fast, step.deltaTime, (step.key >= 0) ? &DIRECTIONS[step.key] : nullptr);
+    }
+
+    void Observe(const Glance& before, const GameState& after, Coverage& coverage) {
+        if (after.gameOver && !before.gameOver) {
+            coverage.deaths++;
+        }
+        if (after.moveCount == before.moveCount || after.gameOver) {
+            // Spawn retries after a despawn still count
+            if (after.gameMode == MODE_ACCELERATED && after.apples.size() < (size_t)GameConstants::MIN_APPLES &&
+                before.appleCount >= after.apples.size() && !after.gameOver) {
+                coverage.rejectedSpawns++;
+            }
+            return;
+        }
+        if (after.isPaused && after.pauseTimer == GameConstants::PAUSE_DURATION) {
+            coverage.poisonReversals++;
+        } else if (after.dx == 0 && after.dy == 0) {
+            coverage.teleports++;
+            for (size_t i = 1; i < after.snake.size(); i++) {
+                if (after.snake[i].col == after.snake[i - 1].col && after.snake[i].row == after.snake[i - 1].row) {
+                    coverage.clampedTeleports++;
+                    break;
+                }
+            }
+        } else if (before.canPassWalls &&
+                   (std::abs(after.snake[0].col - before.head.col) > 1 ||
+                    std::abs(after.snake[0].row - before.head.row) > 1)) {
+            coverage.wallWraps++;
+        }
+        bool rejected = (after.gameMode == MODE_REGULAR)
+            ? after.apples.size() < before.appleCount
+            : after.apples.size() < (size_t)GameConstants::MIN_APPLES;
+        if (rejected) {
+            coverage.rejectedSpawns++;
+        }
+    }
+
+    // Replays a case; the first divergence, if any. `inject` plants a bug in
+    // the fast side (score off by one after a Pomme Supreme) to exercise the
+    // shrinker.
+    bool Run(const Case& c, bool inject, Divergence& divergence) {
+        GameState legacy;
+        BuildStart(c, legacy);
+        SnekGame fast;
+        if (!SnekEngine::FromGameState(legacy, fast)) {
+            divergence = {0, "start state does not fit the engine"};
+            return true;
+        }
+        for (size_t i = 0; i < c.steps.size(); i++) {
+            bool hadWalls = fast.canPassWalls;
+            Advance(legacy, fast, c.steps[i]);
+            if (inject && fast.canPassWalls && !hadWalls) {
+                fast.score++;
+            }
+            const char* field = FindDifference(legacy, fast);
+            if (field) {
+                divergence = {i, field};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Cuts the frame list down to a minimal one that still diverges: drop
+    // chunks (halving their size), then clear keys and even out frame times,
+    // until nothing changes
+    Case Shrink(Case c, bool inject, size_t& runs) {
+        Divergence divergence;
+        auto fails = [&](const Case& candidate) {
+            runs++;
+            return Run(candidate, inject, divergence);
+        };
+        if (fails(c)) {
+            c.steps.resize(divergence.frame + 1);
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t chunk = std::max(c.steps.size() / 2, (size_t)1); chunk >= 1; chunk /= 2) {
+                for (size_t start = 0; start < c.steps.size() && c.steps.size() > 1;) {
+                    Case candidate = c;
+                    size_t end = std::min(start + chunk, candidate.steps.size());
+                    candidate.steps.erase(candidate.steps.begin() + start, candidate.steps.begin() + end);
+                    if (fails(candidate)) {
+                        c.steps.assign(candidate.steps.begin(), candidate.steps.begin() + divergence.frame + 1);
+                        changed = true;
+                    } else {
+                        start += chunk;
+                    }
+                }
+                if (chunk == 1) {
+                    break;
+                }
+            }
+            for (size_t i = 0; i < c.steps.size(); i++) {
+                Case candidate = c;
+                if (candidate.steps[i].key >= 0) {
+                    candidate.steps[i].key = -1;
+                    if (fails(candidate)) {
+                        c = candidate;
+                        changed = true;
+                    }
+                }
+                // A full move interval per frame lets later passes drop more frames
+                for (float deltaTime : {GameConstants::MOVE_INTERVAL_REGULAR, 1.0f / 60.0f}) {
+                    candidate = c;
+                    if (!SameBits(candidate.steps[i].deltaTime, deltaTime)) {
+                        candidate.steps[i].deltaTime = deltaTime;
+                        if (fails(candidate)) {
+                            c = candidate;
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        return c;
+    }
+
+    void Report(const Case& c, bool inject, const char* path) {
+        Divergence divergence = {0, "none"};
+        Run(c, inject, divergence);
+        std::printf("  seed %llu, %s mode, %s start, %zu frames, first difference: %s at frame %zu\n",
+                    (unsigned long long)c.seed, c.mode == MODE_ACCELERATED ? "accelerated" : "regular",
+                    SCENARIO_NAMES[c.scenario], c.steps.size(), divergence.field, divergence.frame);
+        for (size_t i = 0; i < c.steps.size() && i < 40; i++) {
+            std::printf("    %zu: dt %.6f key %d\n", i, c.steps[i].deltaTime, c.steps[i].key);
+        }
+
+        GameState legacy;
+        BuildStart(c, legacy);
+        ReplayWriter writer;
+        if (writer.Begin(path, legacy)) {
+            for (const auto& step : c.steps) {
+                uint8_t input = (step.key >= 0) ? DIRECTION_KEYS[step.key] : 0;
+                GameLogic::RunFrame(legacy, step.deltaTime, input);
+                writer.RecordFrame(step.deltaTime, input, legacy);
+            }
+            writer.Finish();
+            std::printf("  legacy replay written to %s (snake --replay)\n", path);
+        }
+    }
+}
+
+// Fuzzes cases across every scenario, mode, frame-time profile and input
+// profile, with a greedy bot steering half of them so games run long enough
+// for effects to stack. Fails on any divergence (after shrinking it) or if
+// an edge case was never reached.
+// Usage: snek_bench lockstep [frames] [seed] [inject]
+int BenchLockstep(int argc, char** argv) {
+    uint64_t frames = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 2000000;
+    uint64_t seed = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1;
+    bool inject = (argc > 2) && std::atoi(argv[2]) != 0;
+    const size_t maxCaseFrames = 4000;
+
+    Rng rng;
+    rng.Seed(seed);
+    Coverage coverage;
+    uint64_t total = 0;
+    uint64_t cases = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (total < frames) {
+        Case c;
+        c.seed = ((uint64_t)rng.NextU32() << 32) | rng.NextU32();
+        c.mode = (GameMode)rng.GetValue(0, 1);
+        c.scenario = (Scenario)rng.GetValue(0, SCENARIO_COUNT - 1);
+        int timeProfile = rng.GetValue(0, 3);
+        int keyPercent = rng.GetValue(0, 3) == 0 ? rng.GetValue(20, 90) : rng.GetValue(1, 10);
+        bool steered = rng.GetValue(0, 1) == 0;
+        cases++;
+
+        GameState legacy;
+        BuildStart(c, legacy);
+        SnekGame fast;
+        if (!SnekEngine::FromGameState(legacy, fast)) {
+            std::printf("case %llu: start state does not fit the engine\n", (unsigned long long)cases);
+            return 1;
+        }
+        GreedyBot bot;
+        size_t afterOver = 0;
+        bool diverged = false;
+        while (c.steps.size() < maxCaseFrames && afterOver < 30) {
+            Step step;
+            switch (timeProfile) {
+                case 0: step.deltaTime = 1.0f / 60.0f; break;
+                case 1: step.deltaTime = FRAME_TIMES[rng.GetValue(0, 3)]; break;
+                case 2: step.deltaTime = rng.GetValue(1, 300) / 1000.0f; break;
+                default: step.deltaTime = SnekEngine::GetMoveInterval(fast); break;
+            }
+            step.key = -1;
+            if (steered) {
+                uint8_t key = bot.NextInput(legacy);
+                for (int d = 0; d < 4; d++) {
+                    if (key == DIRECTION_KEYS[d]) {
+                        step.key = (int8_t)d;
+                    }
+                }
+            }
+            if (rng.GetValue(1, 100) <= keyPercent) {
+                step.key = (int8_t)rng.GetValue(0, 3);
+            }
+            c.steps.push_back(step);
+
+            Glance before(legacy);
+            bool hadWalls = fast.canPassWalls;
+            Advance(legacy, fast, step);
+            if (inject && fast.canPassWalls && !hadWalls) {
+                fast.score++;
+            }
+            Observe(before, legacy, coverage);
+            afterOver += legacy.gameOver ? 1 : 0;
+            if (FindDifference(legacy, fast)) {
+                diverged = true;
+                break;
+            }
+        }
+        total += c.steps.size();
+
+        if (diverged) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("lockstep: divergence after %llu frames (%.1f s), case %llu\n",
+                        (unsigned long long)total, seconds, (unsigned long long)cases);
+            Report(c, inject, "lockstep-original.replay");
+            size_t runs = 0;
+            auto shrinkStart = std::chrono::steady_clock::now();
+            Case minimal = Shrink(c, inject, runs);
+            double shrinkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - shrinkStart).count();
+            std::printf("shrunk from %zu to %zu frames in %zu runs (%.2f s):\n",
+                        c.steps.size(), minimal.steps.size(), runs, shrinkSeconds);
+            Report(minimal, inject, "lockstep-minimal.replay");
+            // With a planted bug, finding and shrinking it is the pass condition
+            return inject ? 0 : 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("lockstep: %llu frames over %llu cases in %.2f s, %.1fM frames/minute, no divergence\n",
+                (unsigned long long)total, (unsigned long long)cases, seconds, total / seconds * 60.0 / 1e6);
+    std::printf("  poison reversals %llu, teleports %llu (clamped %llu), wall wraps %llu, "
+                "rejected spawns %llu, deaths %llu\n",
+                (unsigned long long)coverage.poisonReversals, (unsigned long long)coverage.teleports,
+                (unsigned long long)coverage.clampedTeleports, (unsigned long long)coverage.wallWraps,
+                (unsigned long long)coverage.rejectedSpawns, (unsigned long long)coverage.deaths);
+    if (inject) {
+        std::printf("  the planted bug was never reached\n");
+        return 1;
+    }
+    bool covered = coverage.poisonReversals && coverage.clampedTeleports && coverage.wallWraps &&
+                   coverage.rejectedSpawns;
+    if (!covered) {
+        std::printf("  some edge cases were never reached; run more frames\n");
+    }
+    return covered ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstring>
+
+struct BenchmarkEntry {
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+static const BenchmarkEntry BENCHMARKS[] = {
+    {"multi_snake", BenchMultiSnake},
+    {"server_load", BenchServerLoad},
+    {"state_stream", BenchStateStream},
+    {"score_store", BenchScoreStore},
+    {"env_step", BenchEnvStep},
+    {"checkpoint", BenchCheckpoint},
+    {"replay_seek", BenchReplaySeek},
+    {"rewind", BenchRewind},
+    {"lockstep", BenchLockstep},
+    {"packed_body", BenchPackedBody},
+    {"zobrist", BenchZobrist},
+    {"mcts", BenchMcts},
+    {"metrics", BenchMetrics},
+    {"alloc", BenchAlloc},
+    {"camera", BenchCamera},
+    {"capture", BenchCapture},
+    {"scenario", BenchScenario},
+    {"crops", BenchCrops},
+    {"trajectory", BenchTrajectory},
+    {"tick_rate", BenchTickRate},
+    {"interpolation", BenchInterpolation},
+    {"startup", BenchStartup},
+    {"sim_thread", BenchSimThread},
+    {"soft_render", BenchSoftRender},
+};
+
+int main(int argc, char** argv) {
+    // snek_bench [name] [args...]; no name runs every benchmark with defaults
+    if (argc < 2) {
+        int failures = 0;
+        for (const auto& bench : BENCHMARKS) {
+            std::printf("== %s\n", bench.name);
+            if (bench.run(0, nullptr) != 0) {
+                failures++;
+            }
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    for (const auto& bench : BENCHMARKS) {
+        if (std::strcmp(argv[1], bench.name) == 0) {
+            return bench.run(argc - 2, argv + 2);
+        }
+    }
+
+    std::fprintf(stderr, "Unknown benchmark '%s'. Available:\n", argv[1]);
+    for (const auto& bench : BENCHMARKS) {
+        std::fprintf(stderr, "  %s\n", bench.name);
+    }
+    return 1;
+}
@@ -0,0 +1,126 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "libsnek.h"
+#include "mcts_planner.h"
+#include "snek_engine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+static const int MAX_MOVES = 600;
+
+// A game from `seed` steered by the planner, one plan per move. Returns the
+// score; bad is set if a plan failed on a live game or picked a reversal.
+static int PlayPlanner(MctsPlanner& planner, uint64_t seed, bool& bad, double& planSeconds, int& plans) {
+    SnekGame game;
+    SnekEngine::Reset(game, MODE_ACCELERATED, seed);
+    for (int move = 0; move < MAX_MOVES && !game.gameOver; move++) {
+        Direction dir;
+        if (!planner.Plan(game, dir)) {
+            bad = true;
+            break;
+        }
+        if ((game.dx || game.dy) && dir.dx == -game.dx && dir.dy == -game.dy) {
+            bad = true;
+        }
+        planSeconds += planner.GetLastStats().seconds;
+        plans++;
+        SnekEngine::Step(game, &dir);
+    }
+    return game.score;
+}
+
+// The same start steered by GreedyBot through the legacy state
+static int PlayGreedy(uint64_t seed) {
+    static const Direction KEY_DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    SnekGame game;
+    SnekEngine::Reset(game, MODE_ACCELERATED, seed);
+    GreedyBot bot;
+    GameState state;
+    for (int move = 0; move < MAX_MOVES && !game.gameOver; move++) {
+        SnekEngine::ToGameState(game, state);
+        uint8_t keys = bot.NextInput(state);
+        const Direction* input = nullptr;
+        for (int k = 0; k < 4; k++) {
+            if (keys & (1 << k)) {
+                input = &KEY_DIRECTIONS[k];
+            }
+        }
+        SnekEngine::Step(game, input);
+    }
+    return game.score;
+}
+
+// Simulations per second on one position at 1, 2, 4... threads up to the
+// given count, then games played by the planner against GreedyBot from the
+// same seeds, then one plan through libsnek's C ABI.
+// Usage: snek_bench mcts [threads] [games] [iterations per move]
+int BenchMcts(int argc, char** argv) {
+    int maxThreads = (argc > 0) ? std::atoi(argv[0]) : 4;
+    int games = (argc > 1) ? std::atoi(argv[1]) : 4;
+    uint32_t iterations = (argc > 2) ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 300;
+
+    SnekGame position;
+    SnekEngine::Reset(position, MODE_ACCELERATED, 5);
+    for (int i = 0; i < 30; i++) {
+        SnekEngine::Step(position, nullptr);
+    }
+    std::printf("mcts: %u hardware threads\n", std::thread::hardware_concurrency());
+    double baseRate = 0.0;
+    bool bad = false;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        PlannerConfig config;
+        config.threads = threads;
+        config.timeBudget = 0.25f;
+        MctsPlanner planner(config);
+        Direction dir;
+        bad |= !planner.Plan(position, dir);
+        const PlannerStats& stats = planner.GetLastStats();
+        double rate = stats.iterations / stats.seconds;
+        baseRate = (threads == 1) ? rate : baseRate;
+        std::printf("  %2d threads: %9.0f simulations/s (x%.2f), %u nodes, depth %d\n",
+                    threads, rate, rate / baseRate, stats.nodes, stats.maxDepth);
+    }
+
+    PlannerConfig config;
+    config.threads = maxThreads;
+    config.iterations = iterations;
+    config.timeBudget = 0.0f;
+    MctsPlanner planner(config);
+    long long plannerTotal = 0;
+    long long greedyTotal = 0;
+    double planSeconds = 0.0;
+    int plans = 0;
+    for (int g = 0; g < games; g++) {
+        plannerTotal += PlayPlanner(planner, 100 + g, bad, planSeconds, plans);
+        greedyTotal += PlayGreedy(100 + g);
+    }
+    if (games > 0) {
+        std::printf("  %d games of up to %d moves, %u simulations per move: average score %.1f, greedy bot %.1f\n",
+                    games, MAX_MOVES, iterations, (double)plannerTotal / games, (double)greedyTotal / games);
+        std::printf("  %.2f ms per plan\n", plans > 0 ? planSeconds * 1e3 / plans : 0.0);
+    }
+
+    SnekBatchConfig batchConfig = {};
+    batchConfig.num_envs = 2;
+    batchConfig.mode = SNEK_MODE_ACCELERATED;
+    batchConfig.death_penalty = 1.0f;
+    batchConfig.seed = 9;
+    SnekBatch* batch = snek_batch_create(&batchConfig);
+    int32_t action = batch ? snek_batch_plan(batch, 1, 200, 0.0f, maxThreads) : SNEK_ACTION_NONE;
+    snek_batch_destroy(batch);
+    if (action < SNEK_ACTION_UP || action > SNEK_ACTION_RIGHT) {
+        std::printf("  snek_batch_plan returned %d\n", action);
+        bad = true;
+    }
+
+    if (bad) {
+        std::printf("  a plan failed or reversed the snake\n");
+        return 1;
+    }
+    std::printf("  all plans legal\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "benchmarks.h"
+#include "libsnek.h"
+#include "metrics.h"
+#include "rng.h"
+#include "snek_engine.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string ReadFile(const char* path) {
+    std::string text;
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return text;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    std::fclose(file);
+    return text;
+}
+
+// Value on the exposition line starting with `name ` (-1 if missing)
+static long long ReadSample(const std::string& text, const std::string& name) {
+    size_t at = text.find("\n" + name + " ");
+    return (at == std::string::npos) ? -1 : std::atoll(text.c_str() + at + name.size() + 2);
+}
+
+// Times the recording calls, then checks the totals: threads that come and
+// go (their shards get reused) must add up exactly, engine deaths must match
+// the games that ended, and HDR percentiles must land within a bucket of the
+// true values. Last, exports through MetricsExporter and libsnek and reads
+// the files back.
+// Usage: snek_bench metrics [ops per thread] [threads]
+int BenchMetrics(int argc, char** argv) {
+    uint64_t ops = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 20000000;
+    int threadCount = (argc > 1) ? std::atoi(argv[1]) : 4;
+    bool ok = true;
+    std::unique_ptr<MetricsSnapshot> before(new MetricsSnapshot());
+    std::unique_ptr<MetricsSnapshot> after(new MetricsSnapshot());
+
+    // Recording cost on this thread
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        Metrics::Add(METRIC_SPAWN_RETRIES);
+    }
+    double addNs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / ops;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        Metrics::Record(METRIC_TICK_TIME, i & 0xFFFFF);
+    }
+    double recordNs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / ops;
+
+    // Two rounds of short-lived threads; the second reuses the first's shards
+    Metrics::Collect(*before);
+    const uint64_t perThread = 1000000;
+    for (int round = 0; round < 2; round++) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([perThread]() {
+                for (uint64_t i = 0; i < perThread; i++) {
+                    Metrics::Add(METRIC_SPAWN_RETRIES, 3);
+                    Metrics::Record(METRIC_INPUT_LATENCY, 1000 + (i & 1023));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    Metrics::Collect(*after);
+    uint64_t expected = 2ull * threadCount * perThread;
+    uint64_t added = after->counters[METRIC_SPAWN_RETRIES] - before->counters[METRIC_SPAWN_RETRIES];
+    uint64_t recorded = after->GetCount(METRIC_INPUT_LATENCY) - before->GetCount(METRIC_INPUT_LATENCY);
+    if (added != 3 * expected || recorded != expected) {
+        std::printf("  threads: %llu added, %llu recorded, expected %llu and %llu\n",
+                    (unsigned long long)added, (unsigned long long)recorded,
+                    (unsigned long long)(3 * expected), (unsigned long long)expected);
+        ok = false;
+    }
+
+    // Engine games: every ended game is one episode and one death
+    Metrics::Collect(*before);
+    SnekGame game;
+    SnekEngine::Reset(game, MODE_ACCELERATED, 3);
+    Rng rng;
+    rng.Seed(4);
+    static const Direction DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    uint64_t frames = 0;
+    uint64_t games = 0;
+    while (games < 2000) {
+        SnekEngine::Step(game, (rng.GetValue(0, 3) == 0) ? &DIRECTIONS[rng.GetValue(0, 3)] : nullptr);
+        frames++;
+        if (game.gameOver) {
+            games++;
+            SnekEngine::Restart(game, MODE_ACCELERATED);
+        }
+    }
+    Metrics::Collect(*after);
+    uint64_t deaths = 0;
+    for (int c = METRIC_DEATHS_WALL; c <= METRIC_DEATHS_OTHER; c++) {
+        deaths += after->counters[c] - before->counters[c];
+    }
+    uint64_t ticks = after->counters[METRIC_TICKS] - before->counters[METRIC_TICKS];
+    uint64_t episodes = after->counters[METRIC_EPISODES] - before->counters[METRIC_EPISODES];
+    if (ticks != frames || episodes != games || deaths != games) {
+        std::printf("  engine: %llu ticks, %llu episodes, %llu deaths for %llu frames and %llu games\n",
+                    (unsigned long long)ticks, (unsigned long long)episodes, (unsigned long long)deaths,
+                    (unsigned long long)frames, (unsigned long long)games);
+        ok = false;
+    }
+    {
+        // Muted threads leave no trace
+        MetricsMute mute;
+        Metrics::Collect(*before);
+        SnekEngine::Step(game, nullptr);
+        Metrics::Collect(*after);
+        ok = ok && after->counters[METRIC_TICKS] == before->counters[METRIC_TICKS];
+    }
+
+    // Percentiles of a uniform spread from 1 us to 10 ms
+    Metrics::Collect(*before);
+    const uint64_t lowNs = 1000;
+    const uint64_t highNs = 10000000;
+    for (uint64_t v = lowNs; v < highNs; v += 97) {
+        Metrics::Record(METRIC_FRAME_TIME, v);
+    }
+    Metrics::Collect(*after);
+    for (int b = 0; b < MetricsConstants::BUCKETS; b++) {
+        after->buckets[METRIC_FRAME_TIME][b] -= before->buckets[METRIC_FRAME_TIME][b];
+    }
+    double worstError = 0.0;
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        double truth = lowNs + q * (highNs - lowNs);
+        double got = (double)after->GetPercentile(METRIC_FRAME_TIME, q);
+        double error = std::abs(got - truth) / truth;
+        worstError = (error > worstError) ? error : worstError;
+    }
+    if (worstError > 1.0 / MetricsConstants::SUB_BUCKETS) {
+        ok = false;
+    }
+
+    // Exports
+    const char* path = "metrics-bench.prom";
+    MetricsExporter exporter;
+    ok = exporter.Start(path, 0.05f) && ok;
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    exporter.Stop();
+    std::string text = ReadFile(path);
+    Metrics::Collect(*after);
+    if (ReadSample(text, "snek_ticks_total") != (long long)after->counters[METRIC_TICKS] ||
+        text.find("snek_ticks_per_second ") == std::string::npos ||
+        text.find("snek_deaths_total{cause=\"wall\"}") == std::string::npos ||
+        text.find("snek_frame_seconds_bucket{le=\"+Inf\"}") == std::string::npos) {
+        std::printf("  exporter file is missing samples\n");
+        ok = false;
+    }
+    std::remove(path);
+
+    SnekBatchConfig config = {};
+    config.num_envs = 64;
+    config.mode = SNEK_MODE_ACCELERATED;
+    config.max_ticks = 100;
+    config.seed = 2;
+    SnekBatch* batch = snek_batch_create(&config);
+    for (int step = 0; batch && step < 300; step++) {
+        snek_batch_step(batch, nullptr);
+    }
+    snek_batch_destroy(batch);
+    ok = snek_metrics_export(path) == 1 && ok;
+    text = ReadFile(path);
+    long long libTicks = ReadSample(text, "snek_ticks_total");
+    long long libSteps = ReadSample(text, "snek_tick_seconds_count");
+    if (libTicks < 64 * 300 || libSteps < 300) {
+        std::printf("  libsnek export: %lld ticks, %lld steps timed\n", libTicks, libSteps);
+        ok = false;
+    }
+    std::remove(path);
+
+    std::printf("metrics: %.2f ns per counter add, %.2f ns per histogram record\n", addNs, recordNs);
+    std::printf("  %d threads x 2 rounds, %llu engine games, percentiles within %.1f%%, %zu byte export\n",
+                threadCount, (unsigned long long)games, worstError * 100.0, text.size());
+    if (!ok) {
+        std::printf("  metrics totals or exports are wrong\n");
+        return 1;
+    }
+    std::printf("  all totals match\n");
+    return 0;
+}
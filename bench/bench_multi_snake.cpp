@@ -0,0 +1,92 @@
+#include "benchmarks.h"
+#include "multi_snake.h"
+#include "rng.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// Updates with frame times that jitter by up to 10% around 60 Hz: while a
+// game is on, its tick count must stay within one of the time played over
+// the move interval, so no leftover time is lost between updates
+static bool CheckFrameTimes(const MultiSnakeConfig& base) {
+    MultiSnakeConfig config = base;
+    Rng rng;
+    rng.Seed(9);
+    MultiSnakeState state;
+    state.Reset(config);
+    const float interval = state.GetMoveInterval();
+    double played = 0.0;
+    int checked = 0;
+    int off = 0;
+    for (int frame = 0; frame < 60 * 600; frame++) {
+        float deltaTime = (1.0f / 60.0f) * (0.9f + 0.2f * rng.GetValue(0, 1000) / 1000.0f);
+        MultiSnakeLogic::Update(state, deltaTime);
+        played += deltaTime;
+        if (state.gameOver) {
+            config.seed++;
+            state.Reset(config);
+            played = 0.0;
+            continue;
+        }
+        off += (std::fabs(state.tick - played / interval) > 1.0) ? 1 : 0;
+        checked++;
+    }
+    std::printf("  variable frame times: %d of %d updates on the move clock\n", checked - off, checked);
+    return off == 0;
+}
+
+// 64 bot snakes on a 256x256 board, one full move interval per update so
+// every call runs a tick. Then checks updates with uneven frame times.
+// Usage: snek_bench multi_snake [ticks] [snakes] [size]
+int BenchMultiSnake(int argc, char** argv) {
+    int ticks = (argc > 0) ? std::atoi(argv[0]) : 200000;
+    int numSnakes = (argc > 1) ? std::atoi(argv[1]) : 64;
+    int boardSize = (argc > 2) ? std::atoi(argv[2]) : 256;
+
+    MultiSnakeConfig config;
+    config.gridWidth = boardSize;
+    config.gridHeight = boardSize;
+    config.numSnakes = numSnakes;
+    config.numBots = numSnakes;
+    config.gameMode = MODE_ACCELERATED;
+    config.maxApples = 128;
+    config.minApples = 32;
+
+    MultiSnakeState state;
+    state.Reset(config);
+    const float tickDelta = state.GetMoveInterval();
+
+    long long games = 1;
+    long long deaths = 0;
+    size_t longestSnake = 0;
+    long long snakeTicks = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        int aliveBefore = state.aliveCount;
+        MultiSnakeLogic::Update(state, tickDelta);
+        deaths += aliveBefore - state.aliveCount;
+        snakeTicks += state.aliveCount;
+        for (const auto& snake : state.snakes) {
+            if (snake.body.size() > longestSnake) {
+                longestSnake = snake.body.size();
+            }
+        }
+        if (state.gameOver) {
+            config.seed++;
+            state.Reset(config);
+            games++;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::printf("multi_snake: %d snakes on %dx%d, %d ticks in %.3f s\n",
+                config.numSnakes, boardSize, boardSize, ticks, seconds);
+    std::printf("  %.0f ns/tick, %.0f ticks/s, %.1f ns per snake-move\n",
+                seconds * 1e9 / ticks, ticks / seconds,
+                snakeTicks > 0 ? seconds * 1e9 / snakeTicks : 0.0);
+    std::printf("  games %lld, deaths %lld, longest snake %zu\n", games, deaths, longestSnake);
+    return CheckFrameTimes(config) ? 0 : 1;
+}
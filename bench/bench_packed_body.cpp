@@ -0,0 +1,206 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "byte_buffer.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "packed_body.h"
+#include "rng.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static bool SameBody(const std::vector<Position>& a, const std::vector<Position>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].col != b[i].col || a[i].row != b[i].row) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Back and forth across the board, a row at a time
+static std::vector<Position> Serpentine(int length) {
+    std::vector<Position> body;
+    for (int i = 0; i < length; i++) {
+        int row = i / GameConstants::GRID_WIDTH;
+        int col = i % GameConstants::GRID_WIDTH;
+        body.push_back({(row % 2 == 0) ? col : GameConstants::GRID_WIDTH - 1 - col, row % GameConstants::GRID_HEIGHT});
+    }
+    return body;
+}
+
+// Random walk with wall wraps, stacked segments and the odd jump
+static std::vector<Position> RandomBody(Rng& rng, int length) {
+    std::vector<Position> body;
+    Position cell = {rng.GetValue(0, GameConstants::GRID_WIDTH - 1), rng.GetValue(0, GameConstants::GRID_HEIGHT - 1)};
+    for (int i = 0; i < length; i++) {
+        body.push_back(cell);
+        int roll = rng.GetValue(0, 99);
+        if (roll < 5) {
+            continue;
+        } else if (roll < 7) {
+            cell = {rng.GetValue(0, GameConstants::GRID_WIDTH - 1), rng.GetValue(0, GameConstants::GRID_HEIGHT - 1)};
+            continue;
+        }
+        int code = rng.GetValue(0, 3);
+        cell.col = (cell.col + PackedBodySteps::DX[code] + GameConstants::GRID_WIDTH) % GameConstants::GRID_WIDTH;
+        cell.row = (cell.row + PackedBodySteps::DY[code] + GameConstants::GRID_HEIGHT) % GameConstants::GRID_HEIGHT;
+    }
+    return body;
+}
+
+// Round-trips bodies from bot games and synthetic ones (long, wrapping,
+// stacked after teleport clamping) through PackedBody, directly and through
+// Write/Read, and checks every truncation of the bytes is rejected. Then
+// times encoding, decoding and ForEach on long bodies.
+// Usage: snek_bench packed_body [frames] [length]
+int BenchPackedBody(int argc, char** argv) {
+    uint64_t frames = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 200000;
+    int length = (argc > 1) ? std::atoi(argv[1]) : 500;
+    const float frameTime = 1.0f / 60.0f;
+
+    std::vector<std::vector<Position>> bodies;
+    GameState game;
+    game.rng.Seed(11);
+    game.gameMode = MODE_ACCELERATED;
+    game.Reset();
+    GreedyBot bot;
+    for (uint64_t f = 0; f < frames; f++) {
+        GameLogic::RunFrame(game, frameTime, bot.NextInput(game));
+        if (f % 97 == 0) {
+            bodies.push_back(std::vector<Position>(game.snake.begin(), game.snake.end()));
+        }
+        if (game.gameOver) {
+            game.Reset();
+            bot = GreedyBot();
+        }
+    }
+    size_t botBodies = bodies.size();
+
+    Rng rng;
+    rng.Seed(4);
+    bodies.push_back(Serpentine(length));
+    for (int i = 0; i < 2000; i++) {
+        bodies.push_back(RandomBody(rng, rng.GetValue(0, 2 * length)));
+    }
+    // Teleport clamping: a straight line squashed against the left wall
+    std::vector<Position> clamped;
+    for (int i = 0; i < 40; i++) {
+        clamped.push_back({std::max(5 - i, 0), 7});
+    }
+    bodies.push_back(clamped);
+
+    PackedBody packed;
+    std::vector<Position> decoded;
+    std::vector<uint8_t> bytes;
+    int failures = 0;
+    double packedBytes = 0.0;
+    double plainBytes = 0.0;
+    uint64_t truncations = 0;
+    for (size_t b = 0; b < bodies.size(); b++) {
+        const auto& body = bodies[b];
+        if (!packed.Encode(body)) {
+            std::printf("  body %zu: encode failed\n", b);
+            failures++;
+            continue;
+        }
+        packed.Decode(decoded);
+        bool ok = SameBody(body, decoded);
+
+        bytes.clear();
+        ByteWriter writer(bytes);
+        packed.Write(writer);
+        PackedBody read;
+        ByteReader reader(bytes.data(), bytes.size());
+        ok = ok && read.Read(reader) && reader.Remaining() == 0;
+        read.Decode(decoded);
+        ok = ok && SameBody(body, decoded);
+
+        // A cut-short buffer must fail, never read past its end
+        if (b % 16 == 0) {
+            for (size_t cut = 0; cut < bytes.size(); cut++) {
+                ByteReader truncated(bytes.data(), cut);
+                if (read.Read(truncated)) {
+                    ok = false;
+                }
+                truncations++;
+            }
+        }
+        if (!ok) {
+            std::printf("  body %zu (length %zu): round trip mismatch\n", b, body.size());
+            failures++;
+        }
+        if (b < botBodies) {
+            packedBytes += (double)bytes.size();
+            plainBytes += (double)(body.size() * sizeof(Position));
+        }
+    }
+
+    // A fixed-capacity body refuses one longer than it holds
+    SnakeBody fixedBody;
+    packed.Encode(Serpentine(GameConstants::MAX_SNAKE_LENGTH));
+    if (!packed.Decode(fixedBody) || fixedBody.size() != (size_t)GameConstants::MAX_SNAKE_LENGTH) {
+        std::printf("  a full SnakeBody didn't decode\n");
+        failures++;
+    }
+    packed.Encode(Serpentine(GameConstants::MAX_SNAKE_LENGTH + 1));
+    if (packed.Decode(fixedBody)) {
+        std::printf("  an oversized body decoded into a SnakeBody\n");
+        failures++;
+    }
+
+    std::vector<Position> longBody = Serpentine(length);
+    packed.Encode(longBody);
+    size_t longBytes = packed.GetBytes();
+
+    const int rounds = 20000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        packed.Encode(longBody);
+    }
+    double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        packed.Decode(decoded);
+    }
+    double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    long checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        packed.ForEach([&checksum](Position segment) { checksum += segment.col * 31 + segment.row; });
+    }
+    double forEachNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    long plainChecksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (const auto& segment : longBody) {
+            plainChecksum += segment.col * 31 + segment.row;
+        }
+    }
+    double plainNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (checksum != plainChecksum) {
+        std::printf("  ForEach checksum mismatch\n");
+        failures++;
+    }
+
+    double perSegment = (double)rounds * length;
+    std::printf("packed_body: %zu bodies (%zu from bot games), %llu truncated reads\n",
+                bodies.size(), botBodies, (unsigned long long)truncations);
+    std::printf("  %d-segment snake: %zu bytes packed, %zu as Positions\n",
+                length, longBytes, length * sizeof(Position));
+    std::printf("  bot game bodies: %.1f%% of their Position size on the wire\n",
+                plainBytes > 0.0 ? 100.0 * packedBytes / plainBytes : 0.0);
+    std::printf("  per segment: encode %.2f ns, decode %.2f ns, ForEach %.2f ns (vector %.2f ns)\n",
+                encodeNs / perSegment, decodeNs / perSegment, forEachNs / perSegment, plainNs / perSegment);
+    if (failures > 0) {
+        std::printf("  %d failures\n", failures);
+        return 1;
+    }
+    std::printf("  all bodies match\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "byte_buffer.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "replay.h"
+#include "rng.h"
+#include "state_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static std::vector<uint8_t> Encode(const GameState& state) {
+    std::vector<uint8_t> bytes;
+    ByteWriter writer(bytes);
+    StateCodec::Write(writer, state);
+    return bytes;
+}
+
+struct Checkpoint {
+    uint32_t frame;
+    std::vector<uint8_t> state;
+};
+
+// Records games played by a greedy bot at mixed frame rates with pauses, then
+// seeks to random frames (compared with states captured live), plays each
+// replay straight through, and reads it again with the footer cut off.
+// Usage: snek_bench replay_seek [games] [keyframeInterval]
+int BenchReplaySeek(int argc, char** argv) {
+    int games = (argc > 0) ? std::atoi(argv[0]) : 20;
+    uint32_t interval = (argc > 1) ? (uint32_t)std::atoi(argv[1]) : ReplayConstants::DEFAULT_KEYFRAME_INTERVAL;
+    const float frameTimes[] = {1.0f / 60.0f, 1.0f / 144.0f, 1.0f / 30.0f};
+    const uint32_t maxFrames = 200000;
+    std::string path = "/tmp/snek_bench.replay";
+
+    Rng rng;
+    rng.Seed(11);
+    GameState game;
+    game.rng.Seed(2);
+    game.gameMode = MODE_ACCELERATED;
+
+    uint64_t totalFrames = 0;
+    uint64_t totalBytes = 0;
+    uint64_t seeks = 0;
+    uint32_t maxSeekCost = 0;
+    double seekSeconds = 0.0;
+    int failures = 0;
+
+    for (int g = 0; g < games; g++) {
+        game.Reset();
+        ReplayWriter writer;
+        if (!writer.Begin(path, game, interval)) {
+            std::printf("could not write %s\n", path.c_str());
+            return 1;
+        }
+
+        std::vector<Checkpoint> checkpoints;
+        GreedyBot bot;
+        uint32_t frame = 0;
+        float frameTime = frameTimes[0];
+        while (!game.gameOver) {
+            if (rng.GetValue(0, 499) == 0) {
+                frameTime = frameTimes[rng.GetValue(0, 2)];
+            }
+            uint8_t input = bot.NextInput(game);
+            if (rng.GetValue(0, 19999) == 0 || (game.isUserPaused && rng.GetValue(0, 59) == 0)) {
+                input |= FrameInput::PAUSE;
+            }
+            if (frame + 1 >= maxFrames) {
+                input |= FrameInput::QUIT;
+            }
+            GameLogic::RunFrame(game, frameTime, input);
+            writer.RecordFrame(frameTime, input, game);
+            frame++;
+            if (rng.GetValue(0, 199) == 0) {
+                checkpoints.push_back({frame, Encode(game)});
+            }
+        }
+        checkpoints.push_back({frame, Encode(game)});
+        writer.Finish();
+
+        ReplayReader reader;
+        if (!reader.Open(path) || reader.GetFrameCount() != frame) {
+            std::printf("game %d: replay did not open\n", g);
+            return 1;
+        }
+        totalFrames += frame;
+
+        // Random-order seeks against the live captures
+        for (size_t i = 0; i < checkpoints.size(); i++) {
+            std::swap(checkpoints[i], checkpoints[rng.GetValue((int)i, (int)checkpoints.size() - 1)]);
+        }
+        for (const auto& checkpoint : checkpoints) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = reader.Seek(checkpoint.frame);
+            seekSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            seeks++;
+            maxSeekCost = std::max(maxSeekCost, reader.GetLastSeekCost());
+            if (!ok || Encode(reader.GetState()) != checkpoint.state) {
+                if (++failures <= 5) {
+                    std::printf("game %d: seek to frame %u does not match\n", g, checkpoint.frame);
+                }
+            }
+        }
+
+        // Straight playback ends in the live final state
+        reader.Seek(0);
+        while (reader.StepForward()) {
+        }
+        if (Encode(reader.GetState()) != Encode(game) && ++failures <= 5) {
+            std::printf("game %d: playback end state does not match\n", g);
+        }
+
+        // Without the footer the index is rebuilt by scanning
+        FILE* file = std::fopen(path.c_str(), "rb");
+        std::vector<uint8_t> bytes;
+        if (file) {
+            std::fseek(file, 0, SEEK_END);
+            bytes.resize((size_t)std::ftell(file));
+            std::fseek(file, 0, SEEK_SET);
+            bytes.resize(std::fread(bytes.data(), 1, bytes.size(), file));
+            std::fclose(file);
+        }
+        totalBytes += bytes.size();
+        size_t keyframes = reader.GetKeyframeCount();
+        bytes.resize(bytes.size() - 16 - 9 * keyframes);
+        ReplayReader scanned;
+        if (!scanned.Load(bytes) || scanned.GetKeyframeCount() != keyframes ||
+            !scanned.Seek(frame) || Encode(scanned.GetState()) != Encode(game)) {
+            if (++failures <= 5) {
+                std::printf("game %d: footerless replay does not match\n", g);
+            }
+        }
+    }
+    unlink(path.c_str());
+
+    std::printf("replay_seek: %d games, %llu frames, keyframe every %u frames\n",
+                games, (unsigned long long)totalFrames, interval);
+    std::printf("  %.2f bytes/frame on disk\n", (double)totalBytes / totalFrames);
+    std::printf("  %llu seeks, %.1f us average, at most %u frames re-simulated\n",
+                (unsigned long long)seeks, seekSeconds * 1e6 / seeks, maxSeekCost);
+    std::printf("  %s\n", failures == 0 ? "all states match" : "MISMATCHES");
+    return (failures == 0 && maxSeekCost <= interval) ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "byte_buffer.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "rewind_buffer.h"
+#include "rng.h"
+#include "state_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> Encode(const GameState& state) {
+    std::vector<uint8_t> bytes;
+    ByteWriter writer(bytes);
+    StateCodec::Write(writer, state);
+    return bytes;
+}
+
+namespace {
+    struct RewindRun {
+        uint64_t stepsBack = 0;
+        uint64_t rewinds = 0;
+        uint64_t games = 1;
+        uint64_t multiMoveFrames = 0;   // frames that made more than one move
+        double stepSeconds = 0.0;
+        double fullBytes = 0.0;
+        double deltaBytes = 0.0;
+        uint64_t samples = 0;
+        size_t peakBytes = 0;
+        int failures = 0;
+    };
+}
+
+// Rules for the turbo case: the fastest speed a rules file allows, so a
+// 120 Hz tick makes two or three moves
+static GameRules TurboRules() {
+    GameRules rules = GameRules::From<RegularRules>("Turbo rewind");
+    rules.moveInterval = 0.004f;
+    rules.minMoveInterval = 0.004f;
+    std::string error;
+    rules.Finalize(error);
+    return rules;
+}
+
+// Plays `frames` frames of bot games on `game` with a rewind buffer attached,
+// keeping a full encoded copy of the state before every frame. Every so often
+// (and at most game overs) it rewinds a random number of frames, checking
+// each restored state against the copy, then plays on from there. Without
+// custom rules finished games alternate between the built-in modes.
+static RewindRun PlayAndRewind(GameState& game, RewindBuffer& rewind, uint64_t frames, float frameTime) {
+    RewindRun run;
+    Rng rng;
+    rng.Seed(5);
+    game.rewind = &rewind;
+    GreedyBot bot;
+    std::deque<std::vector<uint8_t>> history;
+
+    for (uint64_t f = 0; f < frames; f++) {
+        uint8_t input = bot.NextInput(game);
+        if (rng.GetValue(0, 99) == 0) {
+            input |= (uint8_t)(1 << rng.GetValue(0, 3));   // a stray key now and then
+        }
+        if (rng.GetValue(0, 19999) == 0 || (game.isUserPaused && rng.GetValue(0, 59) == 0)) {
+            input |= FrameInput::PAUSE;
+        }
+
+        history.push_back(Encode(game));
+        uint32_t movesBefore = game.moveCount;
+        rewind.BeginFrame(game);
+        GameLogic::RunFrame(game, frameTime, input);
+        rewind.EndFrame(game);
+        run.multiMoveFrames += (game.moveCount > movesBefore + 1) ? 1 : 0;
+        while (history.size() > rewind.GetFrameCount()) {
+            history.pop_front();
+        }
+        run.peakBytes = std::max(run.peakBytes, rewind.GetBytesUsed());
+        if (f % 1000 == 999 && rewind.GetFrameCount() > 0) {
+            run.fullBytes += history.back().size();
+            run.deltaBytes += (double)rewind.GetBytesUsed() / rewind.GetFrameCount();
+            run.samples++;
+        }
+
+        // A resume countdown never finishes (status effects don't tick while
+        // resuming), so those games are rewound to before the pause
+        bool gameOver = game.gameOver;
+        bool stuck = game.isResuming && rng.GetValue(0, 199) == 0;
+        if ((gameOver && rng.GetValue(0, 1) == 0) || stuck || rng.GetValue(0, 1999) == 0) {
+            uint32_t count = (uint32_t)rng.GetValue(1, (int)std::max(rewind.GetFrameCount(), 1u));
+            run.rewinds++;
+            for (uint32_t i = 0; i < count && rewind.GetFrameCount() > 0; i++) {
+                auto start = std::chrono::steady_clock::now();
+                bool ok = rewind.StepBack(game);
+                run.stepSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                run.stepsBack++;
+                if (!ok || Encode(game) != history.back() || game.hash != game.ComputeHash()) {
+                    if (++run.failures <= 5) {
+                        std::printf("game %llu: state %u frames back does not match\n",
+                                    (unsigned long long)run.games, i + 1);
+                    }
+                    break;
+                }
+                history.pop_back();
+            }
+            bot.lastKeyMove = UINT32_MAX;
+        } else if (gameOver) {
+            if (game.gameMode != MODE_CUSTOM) {
+                game.gameMode = (game.gameMode == MODE_REGULAR) ? MODE_ACCELERATED : MODE_REGULAR;
+            }
+            game.Reset();
+            rewind.Clear();
+            history.clear();
+            bot = GreedyBot();
+            run.games++;
+        }
+        if (run.failures > 0) {
+            break;
+        }
+    }
+    return run;
+}
+
+// Rewinds bot games at 60 fps in the built-in modes, then a turbo game
+// (4 ms a move) on the simulation thread's 120 Hz tick, where most frames
+// make more than one move, and checks every restored state is exact.
+// Usage: snek_bench rewind [frames] [maxFrames]
+int BenchRewind(int argc, char** argv) {
+    uint64_t frames = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 500000;
+    uint32_t maxFrames = (argc > 1) ? (uint32_t)std::atoi(argv[1]) : RewindConstants::DEFAULT_MAX_FRAMES;
+
+    RewindBuffer rewind(maxFrames);
+    GameState game;
+    game.rng.Seed(3);
+    game.gameMode = MODE_ACCELERATED;
+    game.Reset();
+    RewindRun run = PlayAndRewind(game, rewind, frames, 1.0f / 60.0f);
+
+    std::printf("rewind: %llu frames over %llu games, ring of %u frames / %zu bytes\n",
+                (unsigned long long)frames, (unsigned long long)run.games, maxFrames, rewind.GetCapacity());
+    std::printf("  %.1f bytes per frame held (full state copy: %.1f), peak %zu bytes\n",
+                run.deltaBytes / std::max(run.samples, (uint64_t)1),
+                run.fullBytes / std::max(run.samples, (uint64_t)1), run.peakBytes);
+    std::printf("  %llu rewinds, %llu frames stepped back, %.0f ns per step\n",
+                (unsigned long long)run.rewinds, (unsigned long long)run.stepsBack,
+                run.stepSeconds * 1e9 / std::max(run.stepsBack, (uint64_t)1));
+
+    RewindBuffer turboRewind(maxFrames);
+    GameState turbo;
+    turbo.rng.Seed(4);
+    turbo.gameMode = MODE_CUSTOM;
+    turbo.customRules = TurboRules();
+    turbo.Reset();
+    uint64_t turboFrames = std::max(frames / 5, (uint64_t)1);
+    RewindRun turboRun = PlayAndRewind(turbo, turboRewind, turboFrames, 1.0f / 120.0f);
+    std::printf("  turbo at 120 Hz: %llu frames over %llu games, %llu with several moves, %llu frames stepped back\n",
+                (unsigned long long)turboFrames, (unsigned long long)turboRun.games,
+                (unsigned long long)turboRun.multiMoveFrames, (unsigned long long)turboRun.stepsBack);
+
+    bool ok = run.failures == 0 && turboRun.failures == 0 && turboRun.multiMoveFrames > 0;
+    std::printf("  %s\n", ok ? "all restored states match" : "MISMATCHES");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "byte_buffer.h"
+#include "game_logic.h"
+#include "scenario.h"
+#include "snek_engine.h"
+#include "state_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    // One tick from a poison apple, with self-intersection still running
+    const char* const POISON_FIXTURE =
+        "# Poison one move ahead while immune\n"
+        "mode = regular\n"
+        "seed = 11\n"
+        "score = 6\n"
+        "moves = 57\n"
+        "direction = right\n"
+        "body = 8 10 L4 U2 R2 D\n"
+        "apple = 9 10 poison 3.5 17\n"
+        "apple = 2 2 regular 1 14.5\n"
+        "immunity = 4.5\n"
+        "move_timer = 0.24\n"
+        "game_time = 14.25\n";
+
+    const float FRAME_TIME = 1.0f / 60.0f;
+}
+
+static void Encode(const GameState& state, std::vector<uint8_t>& out) {
+    out.clear();
+    ByteWriter writer(out);
+    StateCodec::Write(writer, state);
+}
+
+// 480 segments along a cycle through every cell: row by row from the top,
+// back up the first column, so the head ends up beside the tail's row
+static std::string CoilFixture() {
+    GameState state;
+    std::vector<Position> cycle;
+    for (int row = 0; row < GameConstants::GRID_HEIGHT; row++) {
+        for (int i = 1; i < GameConstants::GRID_WIDTH; i++) {
+            int col = (row % 2 == 0) ? i : GameConstants::GRID_WIDTH - i;
+            cycle.push_back({col, row});
+        }
+    }
+    for (int row = GameConstants::GRID_HEIGHT - 1; row >= 0; row--) {
+        cycle.push_back({0, row});
+    }
+    // Head first: the last cell of the stretch, heading on along the cycle
+    int length = 480;
+    for (int i = length - 1; i >= 0; i--) {
+        state.snake.push_back(cycle[i]);
+    }
+    Position next = cycle[length];
+    state.dx = next.col - cycle[length - 1].col;
+    state.dy = next.row - cycle[length - 1].row;
+    state.apples.push_back({cycle[length + 1].col, cycle[length + 1].row, REGULAR, 0.0f, 15.0f});
+    state.score = length - 1;
+    state.moveCount = 2000;
+    state.rng.Seed(5);
+    state.gameTime = 500.0f;
+    std::string text;
+    Scenario::FormatText(state, text);
+    return text;
+}
+
+// MAX_APPLES apples of every type, keys queued, wall wrap running
+static std::string ApplesFixture() {
+    GameState state;
+    state.gameMode = MODE_ACCELERATED;
+    state.snake.push_back({3, 12});
+    state.snake.push_back({2, 12});
+    state.snake.push_back({1, 12});
+    state.dx = 1;
+    state.directionQueue.push_back({0, -1});
+    state.directionQueue.push_back({1, 0});
+    for (int i = 0; i < GameConstants::MAX_APPLES; i++) {
+        float spawn = 2.0f + i * 0.75f;
+        state.apples.push_back({5 + i, (i * 7) % GameConstants::GRID_HEIGHT, (FoodType)(i % FOOD_TYPE_COUNT),
+                                spawn, spawn + 13.0f + (i % 6)});
+    }
+    state.canPassWalls = true;
+    state.wallImmunityTimer = 7.5f;
+    state.cannotEatApples = true;
+    state.cannotEatTimer = 2.25f;
+    state.poisonSoundTimer = 0.5f;
+    state.gameTime = 11.0f;
+    state.moveTimer = 0.05f;
+    state.rng.Seed(9);
+    std::string text;
+    Scenario::FormatText(state, text);
+    return text;
+}
+
+// Bot keys as the engine's Direction, for playing both sides the same way
+static const Direction* EngineKey(uint8_t input) {
+    static const Direction DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    const uint8_t keys[] = {FrameInput::UP, FrameInput::DOWN, FrameInput::LEFT, FrameInput::RIGHT};
+    for (int i = 0; i < 4; i++) {
+        if (input & keys[i]) {
+            return &DIRECTIONS[i];
+        }
+    }
+    return nullptr;
+}
+
+// Loads each fixture from text, checks that nothing was allocated for it,
+// that text and binary saves load back to the same state bit for bit, and
+// that GameLogic and SnekEngine play on from it identically. The poison
+// fixture must reverse on its first move. Then times loads of each form.
+// Usage: snek_bench scenario [loads] [frames]
+int BenchScenario(int argc, char** argv) {
+    int loads = (argc > 0) ? std::atoi(argv[0]) : 20000;
+    int frames = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    struct Fixture {
+        const char* name;
+        std::string text;
+    };
+    Fixture fixtures[] = {
+        {"poison", POISON_FIXTURE},
+        {"coil", CoilFixture()},
+        {"apples", ApplesFixture()},
+    };
+    bool ok = true;
+    std::printf("scenario: %d loads, %d frames of play per fixture\n", loads, frames);
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> got;
+    std::string error;
+    std::string text;
+    for (const auto& fixture : fixtures) {
+        GameState state;
+        uint64_t before = GetAllocations();
+        bool parsed = Scenario::Parse(fixture.text.data(), fixture.text.size(), state, error);
+        uint64_t allocations = GetAllocations() - before;
+        if (!parsed) {
+            std::printf("  %s: %s\n", fixture.name, error.c_str());
+            ok = false;
+            continue;
+        }
+        if (allocations != 0 || state.hash != state.ComputeHash()) {
+            std::printf("  %s: %llu allocations, hash %s\n", fixture.name,
+                        (unsigned long long)allocations, state.hash == state.ComputeHash() ? "ok" : "stale");
+            ok = false;
+        }
+        Encode(state, expected);
+
+        // Text from memory, then both file forms, all to the same bytes
+        GameState copy;
+        bool same = Scenario::FormatText(state, text) &&
+                    Scenario::Parse(text.data(), text.size(), copy, error);
+        Encode(copy, got);
+        same = same && got == expected;
+        const char* paths[] = {"snek_bench_scenario.txt", "snek_bench_scenario.bin"};
+        for (const char* path : paths) {
+            GameState loaded;
+            bool saved = (path == paths[0]) ? Scenario::SaveText(path, state) : Scenario::SaveBinary(path, state);
+            bool read = saved && Scenario::Load(path, loaded, error);
+            Encode(loaded, got);
+            same = same && read && got == expected;
+            unlink(path);
+        }
+        if (!same) {
+            std::printf("  %s: a saved copy loads back differently%s%s\n", fixture.name,
+                        error.empty() ? "" : ": ", error.c_str());
+            ok = false;
+        }
+
+        // Both implementations on from the fixture, compared by hash and moves
+        SnekGame engine;
+        if (!SnekEngine::FromGameState(state, engine)) {
+            std::printf("  %s: doesn't fit the engine\n", fixture.name);
+            ok = false;
+            continue;
+        }
+        GreedyBot bot;
+        GameState fromEngine;
+        int played = 0;
+        for (; played < frames && !state.gameOver; played++) {
+            // The first move is the fixture's own, with no key pressed
+            uint8_t input = (played == 0) ? 0 : bot.NextInput(state);
+            GameLogic::RunFrame(state, FRAME_TIME, input);
+            SnekEngine::Frame(engine, FRAME_TIME, EngineKey(input));
+            if (played == 0 && fixture.text == POISON_FIXTURE &&
+                !(state.isPaused && state.cannotEatApples && state.canIntersectSelf)) {
+                std::printf("  poison: the first move didn't eat the poison apple\n");
+                ok = false;
+            }
+            SnekEngine::ToGameState(engine, fromEngine);
+            if (fromEngine.ComputeHash() != state.hash || engine.moveCount != state.moveCount ||
+                engine.gameOver != state.gameOver) {
+                std::printf("  %s: engine and GameLogic part at frame %d\n", fixture.name, played);
+                ok = false;
+                break;
+            }
+        }
+        std::printf("  %-7s %4zu bytes of text, %3zu segments, %2zu apples, %d frames played\n",
+                    fixture.name, fixture.text.size(), copy.snake.size(), copy.apples.size(), played);
+    }
+
+    // Load throughput of the largest fixture, from memory and from both files
+    const Fixture& coil = fixtures[1];
+    GameState state;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loads; i++) {
+        ok = Scenario::Parse(coil.text.data(), coil.text.size(), state, error) && ok;
+    }
+    double parseUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / loads;
+    const char* path = "snek_bench_scenario.bin";
+    Scenario::SaveBinary(path, state);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loads; i++) {
+        ok = Scenario::Load(path, state, error) && ok;
+    }
+    double binaryUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / loads;
+    unlink(path);
+    std::printf("  coil: %.2f us to parse the text, %.2f us to load the binary file\n", parseUs, binaryUs);
+
+    if (!ok) {
+        std::printf("  scenarios are wrong\n");
+        return 1;
+    }
+    std::printf("  all scenarios load exactly\n");
+    return 0;
+}
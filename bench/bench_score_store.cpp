@@ -0,0 +1,162 @@
+#include "benchmarks.h"
+#include "rng.h"
+#include "score_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compares the store's top-K for every mode with a full sort of `expected`
+static bool CheckTopScores(const ScoreStore& store, const std::vector<GameResult>& expected, int topK) {
+    std::vector<LeaderboardEntry> got(topK);
+    for (int mode = 0; mode < 2; mode++) {
+        std::vector<std::pair<int, uint64_t>> all;
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (expected[i].mode == (GameMode)mode) {
+                all.push_back({expected[i].score, i});
+            }
+        }
+        std::stable_sort(all.begin(), all.end(),
+            [](const std::pair<int, uint64_t>& a, const std::pair<int, uint64_t>& b) { return a.first > b.first; });
+        int count = store.GetTopScores((GameMode)mode, got.data(), topK);
+        if (count != std::min((int)all.size(), topK)) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            if (got[i].score != all[i].first || got[i].resultIndex != all[i].second) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Appends results from a simulated tournament, times top-K and per-player
+// queries, then reopens after cutting the log mid-record to check recovery.
+// Usage: snek_bench score_store [results] [players] [topK]
+int BenchScoreStore(int argc, char** argv) {
+    int numResults = (argc > 0) ? std::atoi(argv[0]) : 1000000;
+    int numPlayers = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    int topK = (argc > 2) ? std::atoi(argv[2]) : ScoreStoreConstants::DEFAULT_TOP_K;
+
+    char dirTemplate[] = "/tmp/snek_scores_XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::printf("could not create a temp directory\n");
+        return 1;
+    }
+    std::string directory = dirTemplate;
+    ScoreStoreConfig config;
+    config.topK = topK;
+
+    ScoreStore store;
+    if (!store.Open(directory, config)) {
+        std::printf("could not open %s\n", directory.c_str());
+        return 1;
+    }
+
+    Rng rng;
+    rng.Seed(3);
+    std::vector<GameResult> expected;
+    expected.reserve(numResults);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numResults; i++) {
+        GameResult result;
+        result.mode = (GameMode)rng.GetValue(0, 1);
+        result.score = rng.GetValue(0, 2000);
+        result.length = result.score / 10 + 1;
+        result.ticks = (uint32_t)rng.GetValue(10, 5000);
+        result.seed = (uint64_t)i + 1;
+        result.timestampMs = 1700000000000ll + i;
+        result.playerId = (uint32_t)rng.GetValue(0, numPlayers - 1);
+        result.isBot = (result.playerId & 1) != 0;
+        if (!store.Append(result)) {
+            std::printf("append failed at %d\n", i);
+            return 1;
+        }
+        expected.push_back(result);
+    }
+    double appendSeconds = SecondsSince(start);
+
+    // Queries
+    const int queries = 200000;
+    std::vector<LeaderboardEntry> top(topK);
+    long long checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++) {
+        checksum += store.GetTopScores((GameMode)(i & 1), top.data(), topK);
+    }
+    double topSeconds = SecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++) {
+        int best = 0;
+        if (store.GetPlayerBest((uint32_t)(i % numPlayers), (GameMode)(i & 1), best)) {
+            checksum += best;
+        }
+    }
+    double playerSeconds = SecondsSince(start);
+
+    bool ok = CheckTopScores(store, expected, topK);
+    int best = 0;
+    std::vector<int> playerBest(numPlayers, -1);
+    for (const auto& result : expected) {
+        if (result.mode == MODE_ACCELERATED) {
+            playerBest[result.playerId] = std::max(playerBest[result.playerId], result.score);
+        }
+    }
+    for (int p = 0; p < numPlayers && ok; p++) {
+        bool found = store.GetPlayerBest((uint32_t)p, MODE_ACCELERATED, best);
+        ok = (found == (playerBest[p] >= 0)) && (!found || best == playerBest[p]);
+    }
+    GameResult readBack;
+    ok = ok && store.ReadResult(expected.size() / 2, readBack) &&
+         readBack.score == expected[expected.size() / 2].score;
+    store.Close();
+
+    // Crash in the middle of an append: half a record at the end of the log,
+    // and an index that claims more results than the log now holds
+    std::string logPath = directory + "/results.log";
+    FILE* log = std::fopen(logPath.c_str(), "rb+");
+    std::fseek(log, 0, SEEK_END);
+    long size = std::ftell(log);
+    std::fclose(log);
+    if (truncate(logPath.c_str(), size - 20) != 0) {
+        std::printf("could not truncate the log\n");
+        return 1;
+    }
+    expected.pop_back();
+
+    start = std::chrono::steady_clock::now();
+    bool reopened = store.Open(directory, config);
+    double rebuildSeconds = SecondsSince(start);
+    bool recovered = reopened && store.GetResultCount() == expected.size() &&
+                     CheckTopScores(store, expected, topK);
+    store.Close();
+
+    // A clean reopen only maps the index
+    start = std::chrono::steady_clock::now();
+    reopened = store.Open(directory, config);
+    double reopenSeconds = SecondsSince(start);
+    recovered = recovered && reopened && CheckTopScores(store, expected, topK);
+    store.Close();
+
+    std::remove((directory + "/results.idx").c_str());
+    std::remove(logPath.c_str());
+    rmdir(directory.c_str());
+
+    std::printf("score_store: %d results, %d players, top %d\n", numResults, numPlayers, topK);
+    std::printf("  append:      %.3f us/result\n", appendSeconds * 1e6 / numResults);
+    std::printf("  top-%d:     %.3f us/query\n", topK, topSeconds * 1e6 / queries);
+    std::printf("  player best: %.3f us/query\n", playerSeconds * 1e6 / queries);
+    std::printf("  rebuild after torn append: %.1f ms, clean reopen: %.3f ms\n",
+                rebuildSeconds * 1e3, reopenSeconds * 1e3);
+    std::printf("  queries %s, recovery %s (checksum %lld)\n",
+                ok ? "ok" : "FAILED", recovered ? "ok" : "FAILED", checksum);
+    return (ok && recovered) ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include "benchmarks.h"
+#include "match_server.h"
+#include "net_client.h"
+#include "rng.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct FakePlayer {
+    int socketIndex;
+    uint16_t matchId;
+    uint32_t nonce;
+    bool joined = false;
+    uint8_t slot = 0;
+    uint32_t seq = 0;
+};
+
+const int LOADGEN_SOCKETS = 8;
+const float LOAD_TICK_INTERVAL = 0.02f;
+
+double Seconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+// One phase: `numMatches` matches, every slot but one per match driven over
+// loopback by fake players, plus one real NetClient in match 0 that checks
+// prediction and acknowledgement end to end
+bool RunPhase(int numMatches, int players, double seconds) {
+    MatchServerConfig config;
+    config.port = 0;
+    config.loopbackOnly = true;
+    config.numMatches = numMatches;
+    config.match.numSnakes = players;
+    config.match.seed = 42;
+    // Faster wall-clock ticks than real play so each phase gathers plenty of samples
+    config.tickInterval = LOAD_TICK_INTERVAL;
+    config.restartDelay = 0.5f;
+
+    MatchServer server;
+    if (!server.Start(config)) {
+        std::printf("  could not open server socket\n");
+        return false;
+    }
+    NetAddress serverAddress;
+    serverAddress.ip = 0x7F000001;
+    serverAddress.port = server.GetPort();
+    std::thread serverThread([&server]() { server.Run(); });
+
+    UdpSocket sockets[LOADGEN_SOCKETS];
+    for (auto& socket : sockets) {
+        socket.Open(0, true);
+    }
+
+    std::vector<FakePlayer> fakes;
+    for (int m = 0; m < numMatches; m++) {
+        for (int p = 0; p < players - 1; p++) {
+            FakePlayer fake;
+            fake.socketIndex = (int)(fakes.size() % LOADGEN_SOCKETS);
+            fake.matchId = (uint16_t)m;
+            fake.nonce = (uint32_t)fakes.size() + 1;
+            fakes.push_back(fake);
+        }
+    }
+
+    NetClient client;
+    client.Connect("127.0.0.1", serverAddress.port, 0);
+
+    std::vector<uint8_t> packet;
+    std::vector<uint8_t> recvBuffer(NetConstants::MAX_PACKET_SIZE);
+    uint64_t snapshots = 0;
+    Rng rng;
+    rng.Seed(7);
+    static const Direction DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastFrame = start;
+    double nextSend = 0.0;
+    double nextClientTurn = 0.5;
+    double settleTime = seconds + 0.3;   // stop steering, let the last acks arrive
+    while (Seconds(start) < settleTime) {
+        double now = Seconds(start);
+        if (now >= nextSend) {
+            nextSend = now + LOAD_TICK_INTERVAL;
+            for (auto& fake : fakes) {
+                UdpSocket& socket = sockets[fake.socketIndex];
+                if (!fake.joined) {
+                    NetProtocol::WriteJoin(packet, fake.matchId, fake.nonce);
+                } else {
+                    InputMessage input;
+                    input.matchId = fake.matchId;
+                    input.slot = fake.slot;
+                    input.clientTimeMs = (uint32_t)(now * 1000.0) + 1;
+                    input.count = 1;
+                    input.inputs[0].seq = ++fake.seq;
+                    input.inputs[0].targetTick = 0;
+                    Direction dir = DIRECTIONS[rng.GetValue(0, 3)];
+                    input.inputs[0].dx = (int8_t)dir.dx;
+                    input.inputs[0].dy = (int8_t)dir.dy;
+                    NetProtocol::WriteInput(packet, input);
+                }
+                socket.Send(serverAddress, packet.data(), packet.size());
+            }
+        }
+
+        for (auto& socket : sockets) {
+            NetAddress from;
+            int received;
+            while ((received = socket.Receive(from, recvBuffer.data(), recvBuffer.size())) > 0) {
+                uint8_t type = NetProtocol::PeekType(recvBuffer.data(), received);
+                if (type == PACKET_SNAPSHOT) {
+                    snapshots++;
+                } else if (type == PACKET_WELCOME) {
+                    WelcomeMessage welcome;
+                    if (NetProtocol::ReadWelcome(recvBuffer.data(), received, welcome) &&
+                        welcome.nonce >= 1 && welcome.nonce <= fakes.size()) {
+                        fakes[welcome.nonce - 1].joined = true;
+                        fakes[welcome.nonce - 1].slot = welcome.slot;
+                    }
+                }
+            }
+        }
+
+        auto frame = std::chrono::steady_clock::now();
+        client.Update(std::chrono::duration<float>(frame - lastFrame).count());
+        lastFrame = frame;
+        if (now >= nextClientTurn && now < seconds && client.HasState()) {
+            client.SendDirection(DIRECTIONS[rng.GetValue(0, 3)]);
+            nextClientTurn += 0.25;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+
+    server.Stop();
+    serverThread.join();
+
+    const MatchServerStats& stats = server.GetStats();
+    int joinedFakes = 0;
+    for (const auto& fake : fakes) {
+        joinedFakes += fake.joined ? 1 : 0;
+    }
+    double busyPerTick = stats.ticks > 0 ? stats.busySeconds / stats.ticks : 0.0;
+    double perMatch = busyPerTick / numMatches;
+    float realInterval = server.GetMatches()[0].state.GetMoveInterval();
+    double expectedSnapshots = (double)stats.ticks * joinedFakes;
+
+    std::printf("  %4d matches x %d players: %llu ticks, %.1f us busy/tick (%.2f us/match), "
+                "snapshots %.1f%% delivered\n",
+                numMatches, players, (unsigned long long)stats.ticks, busyPerTick * 1e6, perMatch * 1e6,
+                expectedSnapshots > 0 ? 100.0 * snapshots / expectedSnapshots : 0.0);
+    std::printf("       one core hosts ~%.0f matches at the %.0f ms move interval; "
+                "%.1f KB/s out at this load\n",
+                perMatch > 0 ? realInterval / perMatch : 0.0, realInterval * 1000.0f,
+                stats.bytesOut / seconds / 1024.0);
+
+    const NetClientStats& clientStats = client.GetStats();
+    bool clientOk = client.IsJoined() && clientStats.snapshotsReceived > 0 &&
+                    client.GetAckedSeq() == client.GetLastSentSeq();
+    std::printf("       client: %s, %llu snapshots, acked %u/%u inputs, rtt %.2f ms, %llu mispredicted ticks\n",
+                clientOk ? "ok" : "FAILED", (unsigned long long)clientStats.snapshotsReceived,
+                client.GetAckedSeq(), client.GetLastSentSeq(), clientStats.roundTripMs,
+                (unsigned long long)clientStats.mispredictions);
+    client.Disconnect();
+    return clientOk && joinedFakes == (int)fakes.size();
+}
+
+} // namespace
+
+// Usage: snek_bench server_load [players] [seconds] [matches...]
+int BenchServerLoad(int argc, char** argv) {
+    int players = (argc > 0) ? std::atoi(argv[0]) : 4;
+    double seconds = (argc > 1) ? std::atof(argv[1]) : 2.0;
+    std::vector<int> matchCounts;
+    for (int i = 2; i < argc; i++) {
+        matchCounts.push_back(std::atoi(argv[i]));
+    }
+    if (matchCounts.empty()) {
+        matchCounts = {16, 64, 256};
+    }
+
+    std::printf("server_load: loopback UDP, server ticking every %.0f ms\n", LOAD_TICK_INTERVAL * 1000.0f);
+    bool ok = true;
+    for (int numMatches : matchCounts) {
+        ok = RunPhase(numMatches, players, seconds) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "game_logic.h"
+#include "metrics.h"
+#include "sim_thread.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+namespace {
+    const int FRAME_MS = 16;
+    // Every STALL_EVERY-th frame takes STALL_MS, like a vsync miss or a GPU hiccup
+    const int STALL_EVERY = 20;
+    const int STALL_MS = 150;
+    // The bot rarely dies in a few seconds; every QUIT_EVERY-th frame ends its game
+    const int QUIT_EVERY = 60;
+
+    // Enough to notice a torn read, small enough to copy quickly
+    struct Payload {
+        uint64_t words[64];
+    };
+}
+
+// Pushes increasing numbers through the queue from one thread and checks
+// another pops every one of them, in order
+static bool CheckQueue(uint64_t count) {
+    static SpscQueue<uint64_t, 64> queue;
+    std::thread producer([count]() {
+        for (uint64_t i = 1; i <= count; i++) {
+            while (!queue.Push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t expected = 1;
+    bool ordered = true;
+    auto start = std::chrono::steady_clock::now();
+    while (expected <= count) {
+        uint64_t value;
+        if (!queue.Pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered = ordered && value == expected;
+        expected++;
+    }
+    producer.join();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+    std::printf("  queue: %llu items in order%s, %.0f ns each\n", (unsigned long long)count, ordered ? "" : " (no)", ns);
+    return ordered;
+}
+
+// Publishes numbered payloads from one thread while another reads: every
+// read must be one whole payload, and never older than the last one read
+static bool CheckTripleBuffer(uint64_t count) {
+    static TripleBuffer<Payload> buffer;
+    std::atomic<bool> finished{false};
+    std::thread writer([count, &finished]() {
+        for (uint64_t i = 1; i <= count; i++) {
+            Payload& payload = buffer.Back();
+            for (uint64_t& word : payload.words) {
+                word = i;
+            }
+            buffer.Publish();
+            // Lets the reader in between publishes on a single core
+            std::this_thread::yield();
+        }
+        finished.store(true, std::memory_order_release);
+    });
+    uint64_t last = 0;
+    uint64_t reads = 0;
+    bool whole = true;
+    bool ordered = true;
+    for (;;) {
+        bool writerDone = finished.load(std::memory_order_acquire);
+        if (!buffer.Update()) {
+            if (writerDone) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        const Payload& payload = buffer.Front();
+        for (uint64_t word : payload.words) {
+            whole = whole && word == payload.words[0];
+        }
+        ordered = ordered && payload.words[0] > last;
+        last = payload.words[0];
+        reads++;
+    }
+    writer.join();
+    bool latest = last == count;
+    std::printf("  triple buffer: %llu published, %llu read, %s, %s, %s\n", (unsigned long long)count,
+                (unsigned long long)reads, whole ? "none torn" : "torn reads", ordered ? "in order" : "out of order",
+                latest ? "latest seen" : "latest missed");
+    return whole && ordered && latest;
+}
+
+// The planner drives a game for `seconds` while this thread draws at 60 Hz:
+// searching must not hold ticks up, so tick start p99 stays under a period
+static bool CheckAutopilot(double seconds) {
+    GameState initial;
+    initial.rng.Seed(23);
+    initial.gameMode = MODE_REGULAR;
+    initial.Reset();
+    std::unique_ptr<MetricsSnapshot> before(new MetricsSnapshot());
+    std::unique_ptr<MetricsSnapshot> after(new MetricsSnapshot());
+    Metrics::Collect(*before);
+
+    SimThread sim(initial, SimConfig(), nullptr);
+    auto start = std::chrono::steady_clock::now();
+    sim.Start();
+    SimInput toggle;
+    toggle.commands = SimCommand::AUTOPILOT;
+    sim.Post(toggle);
+    uint32_t moves = 0;
+    uint32_t lastMoveCount = 0;
+    int bestScore = 0;
+    GameResult result;
+    while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds)) {
+        const SimSnapshot& snapshot = sim.Latest();
+        moves += (snapshot.state.moveCount > lastMoveCount) ? snapshot.state.moveCount - lastMoveCount : 0;
+        lastMoveCount = snapshot.state.moveCount;
+        bestScore = std::max(bestScore, snapshot.state.score);
+        if (snapshot.state.gameOver) {
+            SimInput input;
+            input.commands = SimCommand::RESTART;
+            sim.Post(input);
+        }
+        while (sim.PopResult(result)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_MS));
+    }
+    sim.Stop();
+    Metrics::Collect(*after);
+    for (int b = 0; b < MetricsConstants::BUCKETS; b++) {
+        after->buckets[METRIC_TICK_JITTER][b] -= before->buckets[METRIC_TICK_JITTER][b];
+    }
+    double p99 = after->GetPercentile(METRIC_TICK_JITTER, 0.99) * 1e-9;
+    double period = 1.0 / SimConstants::TICK_RATE;
+    std::printf("  autopilot: %u moves, best score %d; tick start jitter p99 %.3f ms (period %.3f ms)\n",
+                moves, bestScore, p99 * 1e3, period * 1e3);
+    return p99 < period && moves > 0;
+}
+
+// Checks the input queue and the snapshot buffer under two threads, then
+// runs a bot game on a SimThread while this thread plays a 60 Hz render
+// loop whose every 20th frame stalls for 150 ms. Ticks must keep to
+// TICK_RATE overall and through each stall; reports how late ticks start
+// and how far frames stray from 16 ms. Each finished game must report
+// exactly one result. Last, the autopilot plays with ticks still on time.
+// Usage: snek_bench sim_thread [seconds]
+int BenchSimThread(int argc, char** argv) {
+    double seconds = (argc > 0) ? std::atof(argv[0]) : 5.0;
+    std::printf("sim_thread: %.0f seconds at %d ticks a second\n", seconds, SimConstants::TICK_RATE);
+    bool ok = CheckQueue(2000000);
+    ok = CheckTripleBuffer(200000) && ok;
+
+    GameState initial;
+    initial.rng.Seed(17);
+    initial.gameMode = MODE_REGULAR;
+    initial.Reset();
+    std::unique_ptr<MetricsSnapshot> before(new MetricsSnapshot());
+    std::unique_ptr<MetricsSnapshot> after(new MetricsSnapshot());
+    Metrics::Collect(*before);
+
+    SimThread sim(initial, SimConfig(), nullptr);
+    GreedyBot bot;
+    auto start = std::chrono::steady_clock::now();
+    sim.Start();
+    uint64_t firstTick = sim.Latest().tick;
+    int stalls = 0;
+    int offStalls = 0;
+    uint64_t results = 0;
+    GameResult result;
+    auto lastFrame = start;
+    for (int frame = 1; std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds); frame++) {
+        const SimSnapshot& snapshot = sim.Latest();
+        SimInput input;
+        input.frame = snapshot.state.gameOver ? 0 : bot.NextInput(snapshot.state);
+        if (frame % QUIT_EVERY == 0 && !snapshot.state.gameOver) {
+            input.frame |= FrameInput::QUIT;
+        }
+        if (snapshot.state.gameOver) {
+            input.commands = SimCommand::RESTART;
+            bot = GreedyBot();
+        }
+        while (sim.PopResult(result)) {
+            results++;
+        }
+        input.pressed = std::chrono::steady_clock::now();
+        if (input.frame || input.commands) {
+            sim.Post(input);
+        }
+        if (frame % STALL_EVERY == 0) {
+            uint64_t ticksBefore = sim.Latest().tick;
+            std::this_thread::sleep_for(std::chrono::milliseconds(STALL_MS));
+            uint64_t ticked = sim.Latest().tick - ticksBefore;
+            double expected = STALL_MS * 1e-3 * SimConstants::TICK_RATE;
+            offStalls += (std::fabs(ticked - expected) > 3.0) ? 1 : 0;
+            stalls++;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_MS));
+        }
+        auto now = std::chrono::steady_clock::now();
+        double frameTime = std::chrono::duration<double>(now - lastFrame).count();
+        Metrics::RecordSeconds(METRIC_FRAME_JITTER, std::fabs(frameTime - FRAME_MS * 1e-3));
+        lastFrame = now;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t ticks = sim.Latest().tick - firstTick;
+    sim.Stop();
+    while (sim.PopResult(result)) {
+        results++;
+    }
+    Metrics::Collect(*after);
+
+    // Only this run's jitter
+    for (int h : {METRIC_TICK_JITTER, METRIC_FRAME_JITTER}) {
+        for (int b = 0; b < MetricsConstants::BUCKETS; b++) {
+            after->buckets[h][b] -= before->buckets[h][b];
+        }
+    }
+    double expectedTicks = elapsed * SimConstants::TICK_RATE;
+    bool onSchedule = std::fabs(ticks - expectedTicks) <= expectedTicks * 0.01 + 2.0 && sim.GetResyncs() == 0;
+    std::printf("  %llu ticks in %.2f s (%.0f expected), %llu resyncs; %d of %d render stalls kept ticking\n",
+                (unsigned long long)ticks, elapsed, expectedTicks, (unsigned long long)sim.GetResyncs(),
+                stalls - offStalls, stalls);
+    std::printf("  tick start jitter: p50 %.3f ms, p99 %.3f ms; frame jitter: p50 %.3f ms, p99 %.3f ms\n",
+                after->GetPercentile(METRIC_TICK_JITTER, 0.5) * 1e-6,
+                after->GetPercentile(METRIC_TICK_JITTER, 0.99) * 1e-6,
+                after->GetPercentile(METRIC_FRAME_JITTER, 0.5) * 1e-6,
+                after->GetPercentile(METRIC_FRAME_JITTER, 0.99) * 1e-6);
+    // Every game over here ends its game (no rewinds), restarted or settled by Stop
+    uint64_t games = after->counters[METRIC_EPISODES] - before->counters[METRIC_EPISODES];
+    std::printf("  %llu games over, %llu results reported\n", (unsigned long long)games,
+                (unsigned long long)results);
+    ok = ok && onSchedule && offStalls == 0 && results == games;
+    ok = CheckAutopilot(seconds) && ok;
+
+    if (!ok) {
+        std::printf("  simulation fell off schedule\n");
+        return 1;
+    }
+    std::printf("  simulation on schedule\n");
+    return 0;
+}
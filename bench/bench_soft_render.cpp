@@ -0,0 +1,203 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "bench_window.h"
+#include "game_logic.h"
+#include "renderer.h"
+#include "rlgl.h"
+#include "rng.h"
+#include "soft_renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using GameConstants::SCORE_AREA_HEIGHT;
+using GameConstants::SCREEN_HEIGHT;
+using GameConstants::SCREEN_WIDTH;
+
+namespace {
+    // Downscaled sizes checked against the full frame: half, a small square
+    // for pixel agents, and one that doesn't divide the cells evenly
+    const int SIZES[][2] = {{360, 400}, {84, 84}, {250, 333}};
+}
+
+// Bot games sampled every few frames, so the set has snakes mid-move,
+// every apple type, effects and a few wrapped walls
+static std::vector<GameState> CollectStates(int count) {
+    std::vector<GameState> states;
+    GameState state;
+    state.rng.Seed(29);
+    state.Reset();
+    GreedyBot bot;
+    Rng rng;
+    rng.Seed(30);
+    while ((int)states.size() < count) {
+        if (state.gameOver) {
+            state.Reset();
+            bot = GreedyBot();
+        }
+        GameLogic::RunFrame(state, 1.0f / 60.0f, bot.NextInput(state));
+        if (rng.GetValue(0, 6) == 0 && !state.gameOver) {
+            states.push_back(state);
+        }
+    }
+    return states;
+}
+
+// Pixels of `frame` (width x height) that differ from the full-size frame
+// sampled at their centres
+static int CountSampleMismatches(const uint8_t* full, const uint8_t* frame, int width, int height) {
+    int mismatches = 0;
+    for (int y = 0; y < height; y++) {
+        int fy = (int)((y + 0.5f) * SCREEN_HEIGHT / height);
+        for (int x = 0; x < width; x++) {
+            int fx = (int)((x + 0.5f) * SCREEN_WIDTH / width);
+            mismatches += std::memcmp(&frame[((size_t)y * width + x) * 3],
+                                      &full[((size_t)fy * SCREEN_WIDTH + fx) * 3], 3) != 0;
+        }
+    }
+    return mismatches;
+}
+
+// Checks the AVX2 span fill against the scalar one, then renders bot game
+// states on the CPU and, when a window draws, compares each pixel below the
+// score area with a screenshot of Renderer::DrawGame. Downscaled frames of
+// states between moves (whole cells only) must equal the full frame sampled
+// at their pixel centres, and batches must match single renders for any
+// thread count. Times full frames and batches of small ones.
+// Usage: snek_bench soft_render [states] [batch] [size]
+int BenchSoftRender(int argc, char** argv) {
+    int stateCount = (argc > 0) ? std::atoi(argv[0]) : 256;
+    int batch = (argc > 1) ? std::atoi(argv[1]) : 256;
+    int size = (argc > 2) ? std::atoi(argv[2]) : 84;
+    bool ok = true;
+    std::printf("soft_render: %d states, batches of %d at %dx%d, AVX2 %s\n", stateCount, batch, size, size,
+                SoftRenderer::HasAvx2() ? "on" : "off");
+
+    // Span fills
+    Rng rng;
+    rng.Seed(2);
+    std::vector<uint8_t> simd(300 * 3 + 3);
+    std::vector<uint8_t> scalar(simd.size());
+    bool spansMatch = true;
+    for (int i = 0; i < 20000 && spansMatch; i++) {
+        int offset = rng.GetValue(0, 1);
+        int count = rng.GetValue(0, 299);
+        Color color = {(unsigned char)rng.GetValue(0, 255), (unsigned char)rng.GetValue(0, 255),
+                       (unsigned char)rng.GetValue(0, 255), 255};
+        std::fill(simd.begin(), simd.end(), 7);
+        std::fill(scalar.begin(), scalar.end(), 7);
+        SoftRenderer::FillSpan(&simd[offset * 3], count, color);
+        SoftRenderer::FillSpanScalar(&scalar[offset * 3], count, color);
+        spansMatch = simd == scalar;
+    }
+    std::printf("  span fills %s the scalar ones\n", spansMatch ? "match" : "differ from");
+    ok = ok && spansMatch;
+
+    std::vector<GameState> states = CollectStates(stateCount);
+    size_t fullBytes = (size_t)SCREEN_WIDTH * SCREEN_HEIGHT * 3;
+    std::vector<uint8_t> full(fullBytes);
+
+    // Against the GPU
+    int compared = 0;
+    int differing = 0;
+    if (OpenBenchWindow() && GetScreenWidth() == SCREEN_WIDTH && GetScreenHeight() == SCREEN_HEIGHT) {
+        for (const GameState& state : states) {
+            BeginDrawing();
+            Renderer::DrawGame(state);
+            unsigned char* shot = rlReadScreenPixels(SCREEN_WIDTH, SCREEN_HEIGHT);
+            EndDrawing();
+            // A screen without the white border wasn't really drawn (no GL)
+            const unsigned char* corner = shot + (size_t)SCORE_AREA_HEIGHT * SCREEN_WIDTH * 4;
+            if (corner[0] != 255) {
+                std::free(shot);
+                break;
+            }
+            SoftRenderer::Render(state, SCREEN_WIDTH, SCREEN_HEIGHT, full.data());
+            int mismatches = 0;
+            for (size_t p = (size_t)SCORE_AREA_HEIGHT * SCREEN_WIDTH; p < (size_t)SCREEN_WIDTH * SCREEN_HEIGHT; p++) {
+                mismatches += std::memcmp(&shot[p * 4], &full[p * 3], 3) != 0;
+            }
+            std::free(shot);
+            if (mismatches > 0 && differing++ < 3) {
+                std::printf("  state %d: %d pixels differ from DrawGame\n", compared, mismatches);
+            }
+            compared++;
+        }
+    }
+    if (compared > 0) {
+        std::printf("  %d of %d frames match DrawGame below the score area\n", compared - differing, compared);
+        ok = ok && differing == 0;
+    } else {
+        std::printf("  no window draws here, DrawGame comparison skipped\n");
+    }
+
+    // Downscaled between moves
+    int sampled = 0;
+    int sampleMismatches = 0;
+    std::vector<uint8_t> small;
+    for (GameState state : states) {
+        state.moveTimer = 0.0f;
+        SoftRenderer::Render(state, SCREEN_WIDTH, SCREEN_HEIGHT, full.data());
+        for (const auto& dims : SIZES) {
+            small.resize((size_t)dims[0] * dims[1] * 3);
+            SoftRenderer::Render(state, dims[0], dims[1], small.data());
+            sampleMismatches += CountSampleMismatches(full.data(), small.data(), dims[0], dims[1]);
+            sampled++;
+        }
+    }
+    std::printf("  %d downscaled frames, %d pixels off the sampled full frame\n", sampled, sampleMismatches);
+    ok = ok && sampleMismatches == 0;
+
+    // Batches against single renders
+    int count = std::min(batch, (int)states.size());
+    size_t frameBytes = (size_t)size * size * 3;
+    std::vector<uint8_t> singles(frameBytes * count);
+    std::vector<uint8_t> batched(frameBytes * count);
+    for (int i = 0; i < count; i++) {
+        SoftRenderer::Render(states[i], size, size, &singles[frameBytes * i]);
+    }
+    bool batchesMatch = true;
+    for (int threads : {1, 3, 8}) {
+        std::fill(batched.begin(), batched.end(), 0);
+        SoftRenderer::RenderBatch(states.data(), count, size, size, batched.data(), threads);
+        batchesMatch = batchesMatch && batched == singles;
+    }
+    std::printf("  batches of %d %s single renders on 1, 3 and 8 threads\n", count,
+                batchesMatch ? "match" : "differ from");
+    ok = ok && batchesMatch;
+
+    // Timing
+    int repeats = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        SoftRenderer::Render(states[i % states.size()], SCREEN_WIDTH, SCREEN_HEIGHT, full.data());
+    }
+    double fullUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+                    repeats;
+    std::printf("  %dx%d: %.0f us per frame\n", SCREEN_WIDTH, SCREEN_HEIGHT, fullUs);
+    int hardware = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int threads : {1, hardware}) {
+        int rounds = 20;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            SoftRenderer::RenderBatch(states.data(), count, size, size, batched.data(), threads);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("  %dx%d batch of %d on %d thread%s: %.0f frames/s\n", size, size, count, threads,
+                    threads == 1 ? "" : "s", rounds * count / seconds);
+        if (hardware == 1) {
+            break;
+        }
+    }
+
+    if (!ok) {
+        std::printf("  software frames are wrong\n");
+        return 1;
+    }
+    std::printf("  all software frames match\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "benchmarks.h"
+#include "bench_window.h"
+#include "game_state.h"
+#include "renderer.h"
+#include "sound_loader.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace {
+    const char* const SOUND_NAMES[SoundLoaderConstants::SOUND_COUNT] = {
+        "apple.mp3", "poison.mp3", "golden.mp3", "purple.mp3", "gameover.mp3", "pause.mp3",
+    };
+    // How long to wait for the sounds before giving up
+    const double TIMEOUT_MS = 10000.0;
+}
+
+static double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Decodes the game's sounds one after another, as startup used to before
+// the first frame, then starts a SoundLoader the way the game does and
+// draws the mode menu (when a window can be opened) until every sound is
+// uploaded. Reports the serial decode time against time to first frame and
+// to fully loaded. Fails if the loader never finishes or loses a sound that
+// decodes on its own; sounds are looked up from the working directory, so
+// run it from the repository to time real files.
+// Usage: snek_bench startup
+int BenchStartup(int, char**) {
+    std::string soundsPath = SoundLoader::FindSoundsPath();
+    std::printf("startup: sounds from %s\n", soundsPath.c_str());
+
+    auto serialStart = std::chrono::steady_clock::now();
+    int decodable = 0;
+    for (const char* name : SOUND_NAMES) {
+        Wave wave = LoadWave((soundsPath + name).c_str());
+        decodable += (wave.frameCount > 0) ? 1 : 0;
+        UnloadWave(wave);
+    }
+    double serialMs = MsSince(serialStart);
+    std::printf("  serial: %d of %d sounds decoded in %.1f ms before the first frame could be drawn\n", decodable,
+                SoundLoaderConstants::SOUND_COUNT, serialMs);
+
+    GameState state;
+    state.Initialize();
+    auto start = std::chrono::steady_clock::now();
+    SoundLoader sounds;
+    sounds.Start();
+    bool window = OpenBenchWindow();
+    double firstFrameMs = -1.0;
+    int frames = 0;
+    while (MsSince(start) < TIMEOUT_MS) {
+        if (window) {
+            BeginDrawing();
+            Renderer::DrawModeSelectionScreen(state);
+            EndDrawing();
+            // The loader's threads get the core on a single-core machine
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        frames++;
+        if (firstFrameMs < 0.0) {
+            firstFrameMs = MsSince(start);
+        }
+        if (sounds.Upload(state)) {
+            break;
+        }
+    }
+    double loadedMs = MsSince(start);
+    sounds.Wait();
+    SoundLoadStats stats = sounds.GetStats();
+    bool audio = IsAudioDeviceReady();
+    state.Cleanup();
+    CloseAudioDevice();
+
+    std::printf("  threaded: first %s after %.1f ms, fully loaded after %.1f ms (%d frames); audio device %.1f ms, "
+                "%d sounds uploaded, %d missing, %.1f ms of decoding\n", window ? "frame" : "poll", firstFrameMs,
+                loadedMs, frames, stats.audioSeconds * 1000.0, stats.loaded, stats.failed,
+                stats.decodeSeconds * 1000.0);
+    bool ok = sounds.IsDone() && stats.loaded + stats.failed == SoundLoaderConstants::SOUND_COUNT &&
+              (!audio || stats.loaded == decodable);
+    if (!ok) {
+        std::printf("  sounds didn't all load\n");
+        return 1;
+    }
+    if (!audio) {
+        std::printf("  no audio device, so no sounds were uploaded\n");
+    }
+    std::printf("  startup ok\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "benchmarks.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "rng.h"
+#include "state_stream.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static const Direction INPUT_DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+// Headless single-player games driven by random key presses in the same
+// order as main.cpp's loop. Every frame is encoded, decoded and compared with
+// the live state; a spectator also joins mid-stream at the latest keyframe.
+// Usage: snek_bench state_stream [frames] [keyframeInterval] [mode]
+int BenchStateStream(int argc, char** argv) {
+    int frames = (argc > 0) ? std::atoi(argv[0]) : 200000;
+    int keyframeInterval = (argc > 1) ? std::atoi(argv[1]) : 256;
+    GameMode mode = (argc > 2 && std::atoi(argv[2]) == 0) ? MODE_REGULAR : MODE_ACCELERATED;
+
+    Rng input;
+    input.Seed(7);
+
+    GameState game;
+    game.rng.Seed(1);
+    game.gameMode = mode;
+    game.Reset();
+
+    StateStreamLog log((uint32_t)keyframeInterval);
+    StateDeltaDecoder decoder;
+    StreamState expected;
+    size_t readOffset = 0;
+    int games = 1;
+    int mismatches = 0;
+    const float deltaTime = 1.0f / 60.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        GameLogic::UpdateTimers(game, deltaTime);
+        if (game.gameOver) {
+            game.Reset();
+            games++;
+        } else if (input.GetValue(0, 7) == 0) {
+            GameLogic::QueueDirection(game, INPUT_DIRECTIONS[input.GetValue(0, 3)]);
+        }
+        GameLogic::ProcessMovement(game, deltaTime);
+
+        log.Append(game);
+        const auto& bytes = log.GetBytes();
+        ByteReader reader(bytes.data() + readOffset, bytes.size() - readOffset);
+        if (!decoder.Decode(reader)) {
+            std::printf("decode failed at frame %d\n", frame);
+            return 1;
+        }
+        readOffset += reader.Offset();
+
+        StateDeltaEncoder::Capture(game, (uint32_t)frame, expected);
+        if (decoder.GetState() != expected && ++mismatches <= 5) {
+            std::printf("state mismatch at frame %d\n", frame);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    // A spectator joining now only needs the bytes since the latest keyframe
+    const auto& bytes = log.GetBytes();
+    size_t joinOffset = log.GetLatestKeyframeOffset();
+    ByteReader tail(bytes.data() + joinOffset, bytes.size() - joinOffset);
+    StateDeltaDecoder spectator;
+    while (tail.Remaining() > 0) {
+        if (!spectator.Decode(tail)) {
+            std::printf("spectator decode failed at offset %zu\n", joinOffset + tail.Offset());
+            return 1;
+        }
+    }
+    bool spectatorOk = spectator.HasState() && spectator.GetState() == decoder.GetState();
+
+    std::printf("state_stream: %d frames, %d games, %s mode, keyframe every %d\n",
+                frames, games, mode == MODE_ACCELERATED ? "accelerated" : "regular", keyframeInterval);
+    std::printf("  %zu bytes total, %.3f bytes/tick, %zu keyframes\n",
+                bytes.size(), (double)bytes.size() / frames, log.GetKeyframeCount());
+    std::printf("  spectator join: %zu bytes to replay (%s)\n",
+                bytes.size() - joinOffset, spectatorOk ? "ok" : "FAILED");
+    std::printf("  %.3f us/frame (sim + encode + decode + compare)\n", seconds * 1e6 / frames);
+    if (mismatches > 0) {
+        std::printf("  %d mismatched frames\n", mismatches);
+    }
+    return (mismatches == 0 && spectatorOk) ? 0 : 1;
+}
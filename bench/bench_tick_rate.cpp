@@ -0,0 +1,137 @@
+#include "benchmarks.h"
+#include "game_logic.h"
+#include "metrics.h"
+#include "rng.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace {
+    const float REFRESH_RATES[] = {60.0f, 144.0f, 240.0f};
+    // Fixed speeds from the built-in modes' down to turbo, then ramped ones
+    // at a few scores
+    struct SpeedCase {
+        const char* name;
+        float moveInterval;
+        float speedRamp;
+        int score;
+    };
+    const SpeedCase SPEEDS[] = {
+        {"regular", GameConstants::MOVE_INTERVAL_REGULAR, 0.0f, 0},
+        {"accelerated", GameConstants::MOVE_INTERVAL_ACCELERATED, 0.0f, 0},
+        {"turbo 10ms", 0.010f, 0.0f, 0},
+        {"turbo 4ms", 0.004f, 0.0f, 0},
+        {"ramp, score 10", 0.1f, 0.04f, 10},
+        {"ramp, score 60", 0.1f, 0.04f, 60},
+        {"ramp, floor", 0.1f, 0.04f, 500},
+    };
+}
+
+// A custom-mode game that moves in a straight line forever: walls wrap,
+// the body can cross itself and nothing gets eaten, so the score (and the
+// ramped speed) stays where it was put
+static void StartGame(GameState& state, const SpeedCase& speed) {
+    GameRules rules = GameRules::From<RegularRules>("Tick rate");
+    rules.moveInterval = speed.moveInterval;
+    rules.speedRamp = speed.speedRamp;
+    rules.minMoveInterval = 0.004f;
+    std::string error;
+    rules.Finalize(error);
+    state = GameState();
+    state.gameMode = MODE_CUSTOM;
+    state.customRules = rules;
+    state.rng.Seed(5);
+    state.Reset();
+    state.score = speed.score;
+    state.canPassWalls = true;
+    state.wallImmunityTimer = 1e9f;
+    state.canIntersectSelf = true;
+    state.immunityTimer = 1e9f;
+    state.cannotEatApples = true;
+    state.cannotEatTimer = 1e9f;
+    state.SetDirection(1, 0);
+}
+
+// For each speed at 60, 144 and 240 Hz, plays a simulated minute of frames
+// whose lengths jitter by up to 10% and checks that moves per second match
+// the rules' interval (MoveIntervalAt for ramped speeds) to within one move.
+// Then checks that a key lands on the first move of the frame it was
+// pressed in, even with several moves per frame, and that a frame far too
+// long makes only MAX_MOVES_PER_FRAME moves and drops the rest.
+// Usage: snek_bench tick_rate [seconds]
+int BenchTickRate(int argc, char** argv) {
+    float seconds = (argc > 0) ? (float)std::atof(argv[0]) : 60.0f;
+    bool ok = true;
+    std::printf("tick_rate: %.0f simulated seconds per case\n", seconds);
+
+    Rng jitter;
+    jitter.Seed(12);
+    GameState state;
+    for (const SpeedCase& speed : SPEEDS) {
+        StartGame(state, speed);
+        float interval = MoveIntervalAt(state.customRules, speed.score);
+        std::printf("  %-15s %7.2f moves/s configured:", speed.name, 1.0f / interval);
+        for (float hz : REFRESH_RATES) {
+            StartGame(state, speed);
+            double elapsed = 0.0;
+            while (elapsed < seconds) {
+                float deltaTime = (1.0f / hz) * (0.9f + 0.2f * (float)jitter.NextU32() / 4294967296.0f);
+                GameLogic::RunFrame(state, deltaTime, 0);
+                elapsed += deltaTime;
+            }
+            double expected = elapsed / interval;
+            double rate = state.moveCount / elapsed;
+            bool matches = !state.gameOver && std::fabs(state.moveCount - expected) <= 1.0;
+            std::printf(" %.2f at %.0f Hz%s", rate, hz, matches ? "" : " (off)");
+            ok = ok && matches;
+        }
+        std::printf("\n");
+    }
+
+    // Keys at 60 Hz with 4 moves per frame: the whole frame goes the new way
+    SpeedCase turbo = {"keys", 0.004f, 0.0f, 0};
+    StartGame(state, turbo);
+    const uint8_t keys[] = {FrameInput::UP, FrameInput::LEFT, FrameInput::DOWN, FrameInput::RIGHT};
+    const int steps[][2] = {{0, -1}, {-1, 0}, {0, 1}, {1, 0}};
+    bool keysOk = true;
+    for (int frame = 0; frame < 400; frame++) {
+        int key = frame % 4;
+        Position before = state.snake[0];
+        int movesBefore = state.moveCount;
+        GameLogic::RunFrame(state, 1.0f / 60.0f, keys[key]);
+        int moved = state.moveCount - movesBefore;
+        int col = ((before.col + steps[key][0] * moved) % GameConstants::GRID_WIDTH + GameConstants::GRID_WIDTH) %
+                  GameConstants::GRID_WIDTH;
+        int row = ((before.row + steps[key][1] * moved) % GameConstants::GRID_HEIGHT + GameConstants::GRID_HEIGHT) %
+                  GameConstants::GRID_HEIGHT;
+        if (moved < 4 || state.snake[0].col != col || state.snake[0].row != row) {
+            std::printf("  frame %d: %d moves, the key wasn't applied from the first one\n", frame, moved);
+            keysOk = false;
+            break;
+        }
+    }
+    ok = ok && keysOk;
+
+    // A two-second hitch at 4 ms per move
+    StartGame(state, turbo);
+    std::unique_ptr<MetricsSnapshot> before(new MetricsSnapshot());
+    std::unique_ptr<MetricsSnapshot> after(new MetricsSnapshot());
+    Metrics::Collect(*before);
+    GameLogic::RunFrame(state, 2.0f, 0);
+    Metrics::Collect(*after);
+    uint64_t dropped = after->counters[METRIC_DROPPED_MOVES] - before->counters[METRIC_DROPPED_MOVES];
+    bool capped = state.moveCount == GameConstants::MAX_MOVES_PER_FRAME && dropped >= 400 &&
+                  state.moveTimer >= 0.0f && state.moveTimer < 0.004f;
+    std::printf("  keys apply from the first move of their frame%s; a 2 s frame made %d moves and dropped %llu\n",
+                keysOk ? "" : " (no)", state.moveCount, (unsigned long long)dropped);
+    ok = ok && capped;
+
+    if (!ok) {
+        std::printf("  tick rates are off\n");
+        return 1;
+    }
+    std::printf("  all tick rates match\n");
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include "benchmarks.h"
+#include "libsnek.h"
+#include "rng.h"
+#include "snek_batch.h"
+#include "trajectory.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    const char* const DIRECTORY = "snek_bench_trajectories";
+
+    // What the batch reported for one row
+    struct ExpectedRow {
+        uint64_t observationHash;
+        uint8_t action;
+        float reward;
+        uint8_t done;
+        int32_t score;
+        uint32_t tick;
+    };
+}
+
+static uint64_t HashBytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void RemoveDirectory(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            unlink((std::string(path) + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static SnekBatch* MakeBatch(int numEnvs) {
+    SnekBatchConfig config = {};
+    config.num_envs = numEnvs;
+    config.mode = SNEK_MODE_REGULAR;
+    config.max_ticks = 300;
+    config.death_penalty = 1.0f;
+    config.seed = 23;
+    return snek_batch_create(&config);
+}
+
+// Steps the same batch twice with the same random moves, once recording
+// into small chunks and once not, and times the steps of each. Then maps
+// the chunks and checks every row against what the batch reported: the
+// observation acted on, action, reward, done, score, tick, and that food and
+// death events line up with score changes and episode ends. Finally draws
+// samples, checks they spread over the chunks in proportion to their rows
+// (the last chunk is partial), and times draws.
+// Usage: snek_bench trajectory [envs] [steps] [chunk rows] [samples]
+int BenchTrajectory(int argc, char** argv) {
+    int numEnvs = (argc > 0) ? std::atoi(argv[0]) : 256;
+    int steps = (argc > 1) ? std::atoi(argv[1]) : 400;
+    uint32_t chunkRows = (argc > 2) ? (uint32_t)std::atoi(argv[2]) : 16384;
+    int samples = (argc > 3) ? std::atoi(argv[3]) : 1000000;
+    const size_t cells = SnekEngineConstants::CELLS;
+    RemoveDirectory(DIRECTORY);
+
+    SnekBatch* recorded = MakeBatch(numEnvs);
+    SnekBatch* plain = MakeBatch(numEnvs);
+    if (!recorded || !plain || !recorded->Record(DIRECTORY, chunkRows)) {
+        std::printf("trajectory: couldn't make the batches or start recording\n");
+        snek_batch_destroy(recorded);
+        snek_batch_destroy(plain);
+        return 1;
+    }
+    std::printf("trajectory: %d envs, %d steps, %u rows per chunk\n", numEnvs, steps, chunkRows);
+
+    std::vector<ExpectedRow> expected((size_t)numEnvs * steps);
+    std::vector<uint8_t> actions(numEnvs);
+    Rng rng;
+    rng.Seed(8);
+    double recordedSeconds = 0.0;
+    double plainSeconds = 0.0;
+    for (int step = 0; step < steps; step++) {
+        for (int env = 0; env < numEnvs; env++) {
+            actions[env] = (uint8_t)rng.GetValue(SNEK_ACTION_NONE, SNEK_ACTION_RIGHT);
+            ExpectedRow& row = expected[(size_t)step * numEnvs + env];
+            row.observationHash = HashBytes(&recorded->observations[env * cells], cells);
+            row.action = actions[env];
+            row.tick = recorded->ticks[env];
+        }
+        auto start = std::chrono::steady_clock::now();
+        snek_batch_step(recorded, actions.data());
+        auto middle = std::chrono::steady_clock::now();
+        snek_batch_step(plain, actions.data());
+        auto end = std::chrono::steady_clock::now();
+        recordedSeconds += std::chrono::duration<double>(middle - start).count();
+        plainSeconds += std::chrono::duration<double>(end - middle).count();
+        for (int env = 0; env < numEnvs; env++) {
+            ExpectedRow& row = expected[(size_t)step * numEnvs + env];
+            row.reward = recorded->rewards[env];
+            row.done = recorded->dones[env];
+            row.score = recorded->scores[env];
+        }
+    }
+    TrajectoryStats stats = recorded->recorder->GetStats();
+    bool ok = snek_batch_record(recorded, nullptr) == 1;
+    std::printf("  steps: %.1f us recording, %.1f us not; %llu rows, %llu stalls waiting for a chunk\n",
+                recordedSeconds / steps * 1e6, plainSeconds / steps * 1e6, (unsigned long long)stats.rows,
+                (unsigned long long)stats.stalls);
+
+    // Every row back, in order
+    TrajectoryReader reader;
+    std::string error;
+    if (!reader.Open(DIRECTORY, error)) {
+        std::printf("  %s\n", error.c_str());
+        ok = false;
+    }
+    size_t expectedChunks = (expected.size() + chunkRows - 1) / chunkRows;
+    if (reader.GetRowCount() != expected.size() || reader.GetChunkCount() != expectedChunks) {
+        std::printf("  read %llu rows in %zu chunks, expected %zu in %zu\n", (unsigned long long)reader.GetRowCount(),
+                    reader.GetChunkCount(), expected.size(), expectedChunks);
+        ok = false;
+    }
+    std::vector<int32_t> lastScore(numEnvs, 0);
+    uint64_t foods = 0;
+    uint64_t deaths = 0;
+    size_t index = 0;
+    Transition row;
+    for (size_t chunk = 0; chunk < reader.GetChunkCount() && ok; chunk++) {
+        for (uint32_t r = 0; reader.Read(chunk, r, row) && ok; r++, index++) {
+            const ExpectedRow& want = expected[index];
+            int env = (int)(index % numEnvs);
+            int32_t scored = row.score - lastScore[env];
+            bool truncated = want.done && want.tick + 1 >= (uint32_t)recorded->config.max_ticks;
+            bool same = HashBytes(row.observation, cells) == want.observationHash && row.action == want.action &&
+                        row.reward == want.reward && row.done == want.done && row.score == want.score &&
+                        row.tick == want.tick && row.env == (uint32_t)env;
+            // Food moves the score, and only finished games without a
+            // timeout have a cause of death
+            bool events = (row.food != 0 || scored == 0) && ((row.death != 0) == (want.done && !truncated));
+            if (!same || !events) {
+                std::printf("  row %zu (chunk %zu, env %d, tick %u) %s\n", index, chunk, env, want.tick,
+                            same ? "has events that don't match its score or end" : "differs from the batch");
+                ok = false;
+            }
+            foods += row.food ? 1 : 0;
+            deaths += row.death ? 1 : 0;
+            lastScore[env] = row.done ? 0 : row.score;
+        }
+    }
+    if (ok) {
+        std::printf("  %zu rows read back exactly (%llu apples eaten, %llu deaths)\n", index,
+                    (unsigned long long)foods, (unsigned long long)deaths);
+    }
+
+    // Samples per chunk against each chunk's share of the rows
+    if (ok && reader.GetRowCount() > 0) {
+        size_t chunkCount = reader.GetChunkCount();
+        std::vector<uint64_t> hits(chunkCount, 0);
+        std::vector<uint32_t> rows(chunkCount, 0);
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            while (reader.Read(chunk, rows[chunk], row)) {
+                rows[chunk]++;
+            }
+        }
+        Rng sampler;
+        sampler.Seed(3);
+        std::vector<const uint8_t*> drawn(samples);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < samples; i++) {
+            reader.Sample(sampler, row);
+            drawn[i] = row.observation;
+        }
+        double sampleNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                          samples;
+        // A row's observation lies in its chunk's observation column
+        std::vector<const uint8_t*> columns(chunkCount);
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            reader.Read(chunk, 0, row);
+            columns[chunk] = row.observation;
+        }
+        for (const uint8_t* observation : drawn) {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                if (observation >= columns[chunk] && observation < columns[chunk] + (size_t)rows[chunk] * cells) {
+                    hits[chunk]++;
+                    break;
+                }
+            }
+        }
+        double chiSquare = 0.0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            double want = (double)samples * rows[chunk] / reader.GetRowCount();
+            chiSquare += (hits[chunk] - want) * (hits[chunk] - want) / want;
+        }
+        double freedom = (double)chunkCount - 1.0;
+        bool uniform = chiSquare < freedom + 6.0 * std::sqrt(2.0 * freedom + 1.0);
+        std::printf("  %d samples: %.0f ns each, chi-square %.1f over %zu chunks (%s; last has %u rows)\n", samples,
+                    sampleNs, chiSquare, chunkCount, uniform ? "uniform" : "skewed", rows[chunkCount - 1]);
+        ok = ok && uniform;
+
+        SnekTrajectories* trajectories = snek_trajectories_open(DIRECTORY);
+        std::vector<uint8_t> observations(256 * cells);
+        std::vector<float> rewards(256);
+        bool sampled = trajectories && snek_trajectories_count(trajectories) == (int64_t)expected.size() &&
+                       snek_trajectories_sample(trajectories, 256, 1, observations.data(), nullptr, rewards.data(),
+                                                nullptr, nullptr) == 256;
+        snek_trajectories_close(trajectories);
+        if (!sampled) {
+            std::printf("  libsnek couldn't sample the chunks\n");
+            ok = false;
+        }
+    }
+    reader.Close();
+    RemoveDirectory(DIRECTORY);
+    snek_batch_destroy(recorded);
+    snek_batch_destroy(plain);
+
+    if (!ok) {
+        std::printf("  trajectories are wrong\n");
+        return 1;
+    }
+    std::printf("  all trajectories ok\n");
+    return 0;
+}
@@ -0,0 +1,18 @@
+#include "bench_window.h"
+#include "game_types.h"
+#include "raylib.h"
+#include <cstdlib>
+
+bool OpenBenchWindow() {
+    static bool tried = false;
+    if (!tried) {
+        tried = true;
+        SetTraceLogLevel(LOG_WARNING);
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(GameConstants::SCREEN_WIDTH, GameConstants::SCREEN_HEIGHT, "snek_bench");
+        if (IsWindowReady()) {
+            std::atexit(CloseWindow);
+        }
+    }
+    return IsWindowReady();
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Hidden window for benchmarks that draw with raylib. Opened once and
+// closed at exit; false without a display, in which case nothing may be drawn.
+bool OpenBenchWindow();
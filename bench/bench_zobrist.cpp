@@ -0,0 +1,164 @@
+#include "benchmarks.h"
+#include "bench_bot.h"
+#include "game_logic.h"
+#include "game_state.h"
+#include "rng.h"
+#include "transposition_table.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Everything the hash covers, as bytes, to tell real collisions from repeats
+static std::string PositionKey(const GameState& game) {
+    std::string key;
+    key.push_back((char)(game.dx + 1));
+    key.push_back((char)(game.dy + 1));
+    key.push_back((char)game.GetEffectMask());
+    for (const auto& segment : game.snake) {
+        key.push_back((char)segment.col);
+        key.push_back((char)segment.row);
+    }
+    key.push_back('|');
+    for (const auto& apple : game.apples) {
+        key.push_back((char)apple.col);
+        key.push_back((char)apple.row);
+        key.push_back((char)apple.type);
+    }
+    return key;
+}
+
+// Data derived from the key, so a probe can tell a torn slot from a real hit
+static TTData DataFor(uint64_t key) {
+    TTData data;
+    data.value = (int32_t)(key >> 32);
+    data.depth = (uint16_t)(key >> 16);
+    data.move = (uint8_t)(key >> 8);
+    data.flags = (uint8_t)key;
+    return data;
+}
+
+// Plays bot games (with stray keys) checking the incremental hash against a
+// full recompute after every frame, and that equal hashes mean equal
+// positions. A transposition table counts how often positions repeat. Then
+// several threads hammer one small table with stores and probes of keys whose
+// data is derived from the key, so any torn read that got through would show.
+// Usage: snek_bench zobrist [frames] [threads]
+int BenchZobrist(int argc, char** argv) {
+    uint64_t frames = (argc > 0) ? std::strtoull(argv[0], nullptr, 10) : 300000;
+    int threadCount = (argc > 1) ? std::atoi(argv[1]) : 4;
+    const float frameTime = 1.0f / 60.0f;
+
+    Rng rng;
+    rng.Seed(8);
+    GameState game;
+    game.rng.Seed(12);
+    game.gameMode = MODE_ACCELERATED;
+    game.Reset();
+    GreedyBot bot;
+    TranspositionTable table(1 << 20);
+    std::unordered_map<uint64_t, std::string> seen;
+
+    uint64_t mismatches = 0;
+    uint64_t collisions = 0;
+    uint64_t repeats = 0;
+    uint64_t games = 1;
+    double frameSeconds = 0.0;
+    for (uint64_t f = 0; f < frames; f++) {
+        uint8_t input = bot.NextInput(game);
+        if (rng.GetValue(0, 29) == 0) {
+            input |= (uint8_t)(1 << rng.GetValue(0, 3));
+        }
+        auto start = std::chrono::steady_clock::now();
+        GameLogic::RunFrame(game, frameTime, input);
+        frameSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (game.hash != game.ComputeHash()) {
+            if (mismatches++ < 5) {
+                std::printf("  frame %llu: incremental hash differs from a recompute\n", (unsigned long long)f);
+            }
+            game.hash = game.ComputeHash();
+        }
+        if (seen.size() < 500000 || seen.count(game.hash)) {
+            std::string key = PositionKey(game);
+            auto inserted = seen.emplace(game.hash, key);
+            if (!inserted.second && inserted.first->second != key) {
+                collisions++;
+            }
+        }
+        TTData data;
+        if (table.Probe(game.hash, data)) {
+            repeats++;
+        }
+        table.Store(game.hash, {0, 0, 0, 0});
+
+        if (game.gameOver) {
+            game.gameMode = (games % 2 == 0) ? MODE_ACCELERATED : MODE_REGULAR;
+            game.Reset();
+            bot = GreedyBot();
+            games++;
+        }
+    }
+
+    // Concurrent stores and probes into a table much smaller than the key set
+    TranspositionTable shared(1 << 12);
+    std::vector<uint64_t> keys(1 << 16);
+    for (auto& key : keys) {
+        key = ((uint64_t)rng.NextU32() << 32) | rng.NextU32();
+    }
+    const int opsPerThread = 2000000;
+    std::atomic<uint64_t> hits(0);
+    std::atomic<uint64_t> torn(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            Rng local;
+            local.Seed(100 + t);
+            uint64_t localHits = 0;
+            uint64_t localTorn = 0;
+            for (int i = 0; i < opsPerThread; i++) {
+                uint64_t key = keys[local.NextU32() & (keys.size() - 1)];
+                if (i & 1) {
+                    shared.Store(key, DataFor(key));
+                    continue;
+                }
+                TTData data;
+                if (shared.Probe(key, data)) {
+                    TTData expected = DataFor(key);
+                    localHits++;
+                    if (data.value != expected.value || data.depth != expected.depth ||
+                        data.move != expected.move || data.flags != expected.flags) {
+                        localTorn++;
+                    }
+                }
+            }
+            hits += localHits;
+            torn += localTorn;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double tableSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double totalOps = (double)opsPerThread * threadCount;
+
+    std::printf("zobrist: %llu frames over %llu games, %zu distinct positions hashed\n",
+                (unsigned long long)frames, (unsigned long long)games, seen.size());
+    std::printf("  %.1f ns per frame with hashing, %.1f%% of frames on a position seen before\n",
+                frameSeconds * 1e9 / frames, 100.0 * repeats / frames);
+    std::printf("  transposition table: %d threads, %.1f M ops/s, %llu hits, %llu bad reads\n",
+                threadCount, totalOps / tableSeconds / 1e6, (unsigned long long)hits.load(),
+                (unsigned long long)torn.load());
+    if (mismatches > 0 || collisions > 0 || torn > 0) {
+        std::printf("  %llu hash mismatches, %llu collisions\n",
+                    (unsigned long long)mismatches, (unsigned long long)collisions);
+        return 1;
+    }
+    std::printf("  all hashes match\n");
+    return 0;
+}
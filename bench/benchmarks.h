@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Each benchmark parses its own arguments and returns a process exit code
+int BenchMultiSnake(int argc, char** argv);
+int BenchServerLoad(int argc, char** argv);
+int BenchStateStream(int argc, char** argv);
+int BenchScoreStore(int argc, char** argv);
+int BenchEnvStep(int argc, char** argv);
+int BenchCheckpoint(int argc, char** argv);
+int BenchReplaySeek(int argc, char** argv);
+int BenchRewind(int argc, char** argv);
+int BenchLockstep(int argc, char** argv);
+int BenchPackedBody(int argc, char** argv);
+int BenchZobrist(int argc, char** argv);
+int BenchMcts(int argc, char** argv);
+int BenchMetrics(int argc, char** argv);
+int BenchAlloc(int argc, char** argv);
+int BenchCamera(int argc, char** argv);
+int BenchCapture(int argc, char** argv);
+int BenchScenario(int argc, char** argv);
+int BenchCrops(int argc, char** argv);
+int BenchTrajectory(int argc, char** argv);
+int BenchTickRate(int argc, char** argv);
+int BenchInterpolation(int argc, char** argv);
+int BenchStartup(int argc, char** argv);
+int BenchSimThread(int argc, char** argv);
+int BenchSoftRender(int argc, char** argv);
+
+// Heap allocations in snek_bench so far (bench_alloc.cpp counts operator new)
+uint64_t GetAllocations();
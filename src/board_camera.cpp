@@ -0,0 +1,184 @@
+#include "board_camera.h"
+#include <algorithm>
+#include <cmath>
+
+using CameraConstants::CHUNK_CELLS;
+
+void BoardCamera::SetBoard(int totalWidth, int totalHeight) {
+    if (totalWidth == boardWidth && totalHeight == boardHeight) {
+        return;
+    }
+    boardWidth = totalWidth;
+    boardHeight = totalHeight;
+    int fit = (int)std::min(viewport.width / std::max(totalWidth, 1), viewport.height / std::max(totalHeight, 1));
+    cellSize = (fit >= CameraConstants::FOLLOW_CELL_SIZE) ? std::min(fit, CameraConstants::MAX_CELL_SIZE)
+                                                          : CameraConstants::FOLLOW_CELL_SIZE;
+    centerCol = totalWidth * 0.5f;
+    centerRow = totalHeight * 0.5f;
+    following = true;
+    Clamp();
+}
+
+void BoardCamera::Follow(float col, float row) {
+    if (following) {
+        centerCol = col + 0.5f;
+        centerRow = row + 0.5f;
+        Clamp();
+    }
+}
+
+void BoardCamera::Pan(Vector2 pixels) {
+    following = false;
+    centerCol -= pixels.x / cellSize;
+    centerRow -= pixels.y / cellSize;
+    Clamp();
+}
+
+void BoardCamera::Zoom(float steps, Vector2 anchor) {
+    if (steps == 0.0f) {
+        return;
+    }
+    float anchorCol = (anchor.x - originX) / cellSize;
+    float anchorRow = (anchor.y - originY) / cellSize;
+    int newSize = (int)std::lround(cellSize * std::pow(CameraConstants::ZOOM_STEP, steps));
+    // Small sizes round back to themselves; step at least one pixel
+    if (newSize == cellSize) {
+        newSize += (steps > 0.0f) ? 1 : -1;
+    }
+    cellSize = std::max(CameraConstants::MIN_CELL_SIZE, std::min(newSize, CameraConstants::MAX_CELL_SIZE));
+    centerCol = anchorCol - (anchor.x - viewport.x - viewport.width * 0.5f) / cellSize;
+    centerRow = anchorRow - (anchor.y - viewport.y - viewport.height * 0.5f) / cellSize;
+    Clamp();
+}
+
+void BoardCamera::Clamp() {
+    // A board that fits sits in the top-left corner, like the fixed layout did
+    float halfCols = viewport.width * 0.5f / cellSize;
+    float halfRows = viewport.height * 0.5f / cellSize;
+    if (boardWidth * cellSize <= viewport.width) {
+        centerCol = halfCols;
+    } else {
+        centerCol = std::max(halfCols, std::min(centerCol, boardWidth - halfCols));
+    }
+    if (boardHeight * cellSize <= viewport.height) {
+        centerRow = halfRows;
+    } else {
+        centerRow = std::max(halfRows, std::min(centerRow, boardHeight - halfRows));
+    }
+    originX = (int)std::lround(viewport.x + viewport.width * 0.5f - centerCol * cellSize);
+    originY = (int)std::lround(viewport.y + viewport.height * 0.5f - centerRow * cellSize);
+}
+
+void BoardCamera::GetVisibleCells(int& minCol, int& minRow, int& maxCol, int& maxRow) const {
+    minCol = std::max(0, (int)std::floor((viewport.x - originX) / cellSize));
+    minRow = std::max(0, (int)std::floor((viewport.y - originY) / cellSize));
+    maxCol = std::min(boardWidth, (int)std::ceil((viewport.x + viewport.width - originX) / cellSize));
+    maxRow = std::min(boardHeight, (int)std::ceil((viewport.y + viewport.height - originY) / cellSize));
+}
+
+void BoardLayerCache::Draw(const BoardCamera& camera, int totalWidth, int totalHeight) {
+    if (totalWidth != boardWidth || totalHeight != boardHeight) {
+        boardWidth = totalWidth;
+        boardHeight = totalHeight;
+        for (auto& slot : slots) {
+            slot.chunkCol = -1;
+            slot.chunkRow = -1;
+        }
+    }
+    frame++;
+
+    int minCol, minRow, maxCol, maxRow;
+    camera.GetVisibleCells(minCol, minRow, maxCol, maxRow);
+    if (minCol >= maxCol || minRow >= maxRow) {
+        return;
+    }
+
+    // Render missing chunks first: texture mode can't run inside the scissor
+    Slot* visible[CameraConstants::MAX_CHUNKS];
+    int visibleCount = 0;
+    for (int chunkRow = minRow / CHUNK_CELLS; chunkRow <= (maxRow - 1) / CHUNK_CELLS; chunkRow++) {
+        for (int chunkCol = minCol / CHUNK_CELLS; chunkCol <= (maxCol - 1) / CHUNK_CELLS; chunkCol++) {
+            if (visibleCount == CameraConstants::MAX_CHUNKS) {
+                break;
+            }
+            Slot& slot = Find(chunkCol, chunkRow);
+            if (slot.chunkCol != chunkCol || slot.chunkRow != chunkRow) {
+                Render(slot, chunkCol, chunkRow);
+            }
+            slot.lastUsed = frame;
+            visible[visibleCount++] = &slot;
+        }
+    }
+
+    const Rectangle& viewport = camera.viewport;
+    BeginScissorMode((int)viewport.x, (int)viewport.y, (int)viewport.width, (int)viewport.height);
+    float size = (float)(CHUNK_CELLS * camera.GetCellSize());
+    for (int i = 0; i < visibleCount; i++) {
+        const Slot& slot = *visible[i];
+        // Render textures are stored upside down
+        Rectangle source = {0.0f, 0.0f, (float)CHUNK_CELLS, -(float)CHUNK_CELLS};
+        Rectangle dest = {(float)camera.ScreenX(slot.chunkCol * CHUNK_CELLS),
+                          (float)camera.ScreenY(slot.chunkRow * CHUNK_CELLS), size, size};
+        DrawTexturePro(slot.target.texture, source, dest, {0.0f, 0.0f}, 0.0f, WHITE);
+    }
+    EndScissorMode();
+}
+
+BoardLayerCache::Slot& BoardLayerCache::Find(int chunkCol, int chunkRow) {
+    Slot* oldest = &slots[0];
+    for (auto& slot : slots) {
+        if (slot.chunkCol == chunkCol && slot.chunkRow == chunkRow) {
+            return slot;
+        }
+        if (slot.lastUsed < oldest->lastUsed) {
+            oldest = &slot;
+        }
+    }
+    return *oldest;
+}
+
+void BoardLayerCache::Render(Slot& slot, int chunkCol, int chunkRow) {
+    if (!slot.loaded) {
+        slot.target = LoadRenderTexture(CHUNK_CELLS, CHUNK_CELLS);
+        slot.loaded = true;
+    }
+    slot.chunkCol = chunkCol;
+    slot.chunkRow = chunkRow;
+    int firstCol = chunkCol * CHUNK_CELLS;
+    int firstRow = chunkRow * CHUNK_CELLS;
+    int cols = std::min(CHUNK_CELLS, boardWidth - firstCol);
+    int rows = std::min(CHUNK_CELLS, boardHeight - firstRow);
+
+    // One texel per cell: white border, black and GRAY_COLOR checkerboard
+    BeginTextureMode(slot.target);
+    ClearBackground(BLANK);
+    DrawRectangle(0, 0, cols, rows, BLACK);
+    for (int y = 0; y < rows; y++) {
+        int row = firstRow + y;
+        if (row == 0 || row == boardHeight - 1) {
+            DrawRectangle(0, y, cols, 1, WHITE);
+            continue;
+        }
+        for (int x = 0; x < cols; x++) {
+            int col = firstCol + x;
+            if (col == 0 || col == boardWidth - 1) {
+                DrawRectangle(x, y, 1, 1, WHITE);
+            } else if ((col + row) % 2 == 1) {
+                DrawRectangle(x, y, 1, 1, GameConstants::GRAY_COLOR);
+            }
+        }
+    }
+    EndTextureMode();
+    chunksRendered++;
+}
+
+void BoardLayerCache::Unload() {
+    for (auto& slot : slots) {
+        if (slot.loaded) {
+            UnloadRenderTexture(slot.target);
+        }
+        slot = Slot();
+    }
+    boardWidth = 0;
+    boardHeight = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "game_types.h"
+#include "raylib.h"
+#include <cstdint>
+
+namespace CameraConstants {
+    // Pixels per cell. The smallest zoom bounds how many cells a frame can
+    // show, so drawing costs the same on any board size.
+    const int MIN_CELL_SIZE = 3;
+    const int MAX_CELL_SIZE = 60;
+    // Zoom for boards too big to show whole at this size or more
+    const int FOLLOW_CELL_SIZE = 12;
+    const float ZOOM_STEP = 1.25f;      // per mouse wheel notch
+    // Board cells per side of a cached static chunk, and chunks kept. At the
+    // smallest zoom a frame shows at most 5x5 chunks.
+    const int CHUNK_CELLS = 64;
+    const int MAX_CHUNKS = 64;
+}
+
+// View onto a board drawn into a viewport. Coordinates are board cells with
+// the border included: (0, 0) is the top-left border cell and grid cell
+// (col, row) is (col + BORDER_OFFSET, row + BORDER_OFFSET). Cell sizes are
+// whole pixels so cached chunks and single cells line up exactly.
+class BoardCamera {
+public:
+    Rectangle viewport = {0.0f, (float)GameConstants::BOARD_START_Y,
+                          (float)GameConstants::BOARD_SIZE, (float)GameConstants::BOARD_SIZE};
+    bool following = true;
+
+    // Board size in cells, border included. A new size resets the view: the
+    // whole board when it fits at FOLLOW_CELL_SIZE or more, else that zoom.
+    void SetBoard(int totalWidth, int totalHeight);
+    // Centers on a board cell while following
+    void Follow(float col, float row);
+    // Drags the view by a mouse delta and stops following
+    void Pan(Vector2 pixels);
+    // Zooms by `steps` wheel notches, keeping the cell under `anchor` in place
+    void Zoom(float steps, Vector2 anchor);
+
+    int GetCellSize() const { return cellSize; }
+    // Screen position of a board cell's top-left corner
+    int ScreenX(int col) const { return originX + col * cellSize; }
+    int ScreenY(int row) const { return originY + row * cellSize; }
+    // Board cells [minCol, maxCol) x [minRow, maxRow) that overlap the
+    // viewport, clipped to the board
+    void GetVisibleCells(int& minCol, int& minRow, int& maxCol, int& maxRow) const;
+
+private:
+    // Keeps the board on screen (centered if it is smaller than the viewport)
+    // and recomputes the origin
+    void Clamp();
+
+    int boardWidth = 0;
+    int boardHeight = 0;
+    float centerCol = 0.0f;     // board cell at the viewport's center
+    float centerRow = 0.0f;
+    int cellSize = GameConstants::CELL_SIZE;
+    int originX = 0;            // screen position of board cell (0, 0)
+    int originY = 0;
+};
+
+// The static layer (white border and checkerboard) of a board, cached in
+// render textures of CHUNK_CELLS x CHUNK_CELLS cells at one texel per cell
+// and scaled up when drawn, so zooming never redraws them. Chunks are drawn
+// on demand and the least recently used one is reused when all are taken.
+// Unload before the window closes.
+class BoardLayerCache {
+public:
+    // Draws the chunks under the camera's view (rendering any that are missing)
+    void Draw(const BoardCamera& camera, int totalWidth, int totalHeight);
+    void Unload();
+
+    uint64_t GetChunksRendered() const { return chunksRendered; }
+
+private:
+    struct Slot {
+        int chunkCol = -1;
+        int chunkRow = -1;
+        uint64_t lastUsed = 0;
+        bool loaded = false;
+        RenderTexture2D target = {};
+    };
+
+    Slot& Find(int chunkCol, int chunkRow);
+    void Render(Slot& slot, int chunkCol, int chunkRow);
+
+    Slot slots[CameraConstants::MAX_CHUNKS];
+    int boardWidth = 0;
+    int boardHeight = 0;
+    uint64_t frame = 0;
+    uint64_t chunksRendered = 0;
+};
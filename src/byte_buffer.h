@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Little-endian serialization helpers for network packets and files.
+// The writer appends to a caller-owned vector so buffers can be reused.
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<uint8_t>& out) : buffer(out) {}
+
+    void U8(uint8_t v) { buffer.push_back(v); }
+    void I8(int8_t v) { buffer.push_back((uint8_t)v); }
+    void U16(uint16_t v) {
+        buffer.push_back((uint8_t)v);
+        buffer.push_back((uint8_t)(v >> 8));
+    }
+    void U32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            buffer.push_back((uint8_t)(v >> (8 * i)));
+        }
+    }
+    void U64(uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            buffer.push_back((uint8_t)(v >> (8 * i)));
+        }
+    }
+    void I32(int32_t v) { U32((uint32_t)v); }
+    void F32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        U32(bits);
+    }
+    void Bytes(const void* data, size_t size) {
+        const uint8_t* p = (const uint8_t*)data;
+        buffer.insert(buffer.end(), p, p + size);
+    }
+    // LEB128 varint, for counts and small deltas
+    void VarU32(uint32_t v) {
+        while (v >= 0x80) {
+            buffer.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back((uint8_t)v);
+    }
+    void VarI32(int32_t v) { VarU32(((uint32_t)v << 1) ^ (uint32_t)(v >> 31)); }
+
+    size_t Size() const { return buffer.size(); }
+
+private:
+    std::vector<uint8_t>& buffer;
+};
+
+// Bounds-checked reader: reads past the end return 0 and clear Ok()
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t U8() { return Need(1) ? data[pos++] : 0; }
+    int8_t I8() { return (int8_t)U8(); }
+    uint16_t U16() {
+        if (!Need(2)) return 0;
+        uint16_t v = (uint16_t)(data[pos] | (data[pos + 1] << 8));
+        pos += 2;
+        return v;
+    }
+    uint32_t U32() {
+        if (!Need(4)) return 0;
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            v |= (uint32_t)data[pos + i] << (8 * i);
+        }
+        pos += 4;
+        return v;
+    }
+    uint64_t U64() {
+        if (!Need(8)) return 0;
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            v |= (uint64_t)data[pos + i] << (8 * i);
+        }
+        pos += 8;
+        return v;
+    }
+    int32_t I32() { return (int32_t)U32(); }
+    float F32() {
+        uint32_t bits = U32();
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    bool Bytes(void* out, size_t count) {
+        if (!Need(count)) return false;
+        std::memcpy(out, data + pos, count);
+        pos += count;
+        return true;
+    }
+    uint32_t VarU32() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = U8();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    int32_t VarI32() {
+        uint32_t v = VarU32();
+        return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }
+
+    bool Ok() const { return ok; }
+    size_t Offset() const { return pos; }
+    size_t Remaining() const { return size - pos; }
+
+private:
+    bool Need(size_t count) {
+        if (!ok || size - pos < count) {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+};
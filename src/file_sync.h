@@ -0,0 +1,19 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Flushes a file's data to the disk itself, for the logs and checkpoints
+// that must survive a power cut. macOS has no fdatasync, and its fsync only
+// reaches the drive's cache; F_FULLFSYNC goes through, falling back to
+// fsync on filesystems that don't support it. 0 on success, like fdatasync.
+inline int SyncFileData(int fd) {
+#ifdef __APPLE__
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return 0;
+    }
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// Vector with its elements inline and a capacity fixed at compile time, so a
+// game's containers never touch the heap. The subset of std::vector that the
+// game code uses. Adding to a full vector does nothing and returns false;
+// callers that can fill one (the snake body) check IsFull first.
+template <class T, size_t N>
+class FixedVector {
+    static_assert(std::is_trivially_copyable<T>::value, "FixedVector holds plain data");
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    FixedVector() = default;
+    FixedVector(const FixedVector& other) : count(other.count) {
+        std::memcpy(items, other.items, count * sizeof(T));
+    }
+    FixedVector& operator=(const FixedVector& other) {
+        count = other.count;
+        std::memmove(items, other.items, count * sizeof(T));
+        return *this;
+    }
+
+    static constexpr size_t capacity() { return N; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool IsFull() const { return count == N; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T& front() { return items[0]; }
+    const T& front() const { return items[0]; }
+    T& back() { return items[count - 1]; }
+    const T& back() const { return items[count - 1]; }
+    T* data() { return items; }
+    const T* data() const { return items; }
+
+    iterator begin() { return items; }
+    iterator end() { return items + count; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + count; }
+
+    void clear() { count = 0; }
+
+    bool push_back(const T& value) {
+        if (count == N) {
+            return false;
+        }
+        items[count++] = value;
+        return true;
+    }
+
+    void pop_back() { count--; }
+
+    // Shifts the tail up by one; nothing happens when full
+    iterator insert(const_iterator pos, const T& value) {
+        size_t at = (size_t)(pos - items);
+        if (count == N) {
+            return items + at;
+        }
+        T copy = value;
+        std::memmove(items + at + 1, items + at, (count - at) * sizeof(T));
+        items[at] = copy;
+        count++;
+        return items + at;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        size_t at = (size_t)(first - items);
+        size_t removed = (size_t)(last - first);
+        std::memmove(items + at, items + at + removed, (count - at - removed) * sizeof(T));
+        count -= removed;
+        return items + at;
+    }
+
+    // Sizes past the capacity are clamped; new elements are value-initialized
+    void resize(size_t n) {
+        n = (n < N) ? n : N;
+        for (size_t i = count; i < n; i++) {
+            items[i] = T();
+        }
+        count = n;
+    }
+
+    template <class It>
+    void assign(It first, It last) {
+        count = 0;
+        for (; first != last && count < N; ++first) {
+            items[count++] = *first;
+        }
+    }
+
+    bool operator==(const FixedVector& other) const {
+        return count == other.count && std::memcmp(items, other.items, count * sizeof(T)) == 0;
+    }
+    bool operator!=(const FixedVector& other) const { return !(*this == other); }
+
+private:
+    T items[N];
+    size_t count = 0;
+};
+
+// Fixed-size FIFO ring (N a power of two) for queued inputs. A push onto a
+// full ring drops the new element and returns false: the oldest keys are
+// the ones the player pressed first, so they keep their place.
+template <class T, size_t N>
+class FixedRing {
+    static_assert((N & (N - 1)) == 0, "FixedRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "FixedRing holds plain data");
+
+public:
+    class const_iterator {
+    public:
+        const_iterator(const FixedRing* ring, size_t i) : ring(ring), i(i) {}
+        const T& operator*() const { return (*ring)[i]; }
+        const T* operator->() const { return &(*ring)[i]; }
+        const_iterator& operator++() { i++; return *this; }
+        bool operator==(const const_iterator& other) const { return i == other.i; }
+        bool operator!=(const const_iterator& other) const { return i != other.i; }
+
+    private:
+        const FixedRing* ring;
+        size_t i;
+    };
+
+    static constexpr size_t capacity() { return N; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool IsFull() const { return count == N; }
+
+    // i = 0 is the oldest element
+    T& operator[](size_t i) { return items[(head + i) & (N - 1)]; }
+    const T& operator[](size_t i) const { return items[(head + i) & (N - 1)]; }
+    T& front() { return items[head]; }
+    const T& front() const { return items[head]; }
+    T& back() { return (*this)[count - 1]; }
+    const T& back() const { return (*this)[count - 1]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    bool push_back(const T& value) {
+        if (count == N) {
+            return false;
+        }
+        (*this)[count++] = value;
+        return true;
+    }
+
+    void pop_front() {
+        head = (head + 1) & (N - 1);
+        count--;
+    }
+
+private:
+    T items[N];
+    size_t head = 0;
+    size_t count = 0;
+};
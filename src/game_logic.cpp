@@ -1,67 +1,177 @@
 #include "game_logic.h"
 #include "game_types.h"
+#include "metrics.h"
+#include "rewind_buffer.h"
+#include "zobrist.h"
 #include "raylib.h"
 #include <algorithm>
+#include <cmath>
+
+void GameLogic::RunFrame(GameState& state, float deltaTime, uint8_t input) {
+    WithRules(state.gameMode, state.customRules, [&](const auto& rules) {
+        RunFrame(state, rules, deltaTime, input);
+    });
+}
+
+void GameLogic::UpdateTimers(GameState& state, float deltaTime) {
+    WithRules(state.gameMode, state.customRules, [&](const auto& rules) {
+        UpdateTimers(state, rules, deltaTime);
+    });
+}
 
 void GameLogic::ProcessMovement(GameState& state, float deltaTime) {
+    WithRules(state.gameMode, state.customRules, [&](const auto& rules) {
+        ProcessMovement(state, rules, deltaTime);
+    });
+}
+
+template <class Rules>
+void GameLogic::RunFrame(GameState& state, const Rules& rules, float deltaTime, uint8_t input) {
+    Metrics::Add(METRIC_TICKS);
+
+    // Update game time, status effects and apple despawn
+    UpdateTimers(state, rules, deltaTime);
+    
+    if ((input & FrameInput::QUIT) && !state.gameOver) {
+        state.gameOver = true;
+        Metrics::Add(METRIC_DEATHS_OTHER);
+        Metrics::Add(METRIC_EPISODES);
+    }
+    
+    if (!state.gameOver && (input & FrameInput::PAUSE)) {
+        if (state.isUserPaused) {
+            state.isResuming = true;
+            state.resumeDelayTimer = GameConstants::RESUME_DELAY_DURATION;
+            state.pauseSoundTimer = 1.0f;
+            state.isUserPaused = false;
+        } else if (!state.isResuming) {
+            state.isUserPaused = true;
+        }
+    }
+    
+    // Handle movement input
+    if (!state.gameOver && !state.isUserPaused && !state.isResuming) {
+        if (input & FrameInput::UP) {
+            QueueDirection(state, {0, -1});
+        }
+        if (input & FrameInput::DOWN) {
+            QueueDirection(state, {0, 1});
+        }
+        if (input & FrameInput::LEFT) {
+            QueueDirection(state, {-1, 0});
+        }
+        if (input & FrameInput::RIGHT) {
+            QueueDirection(state, {1, 0});
+        }
+    }
+    
+    ProcessMovement(state, rules, deltaTime);
+}
+
+template <class Rules>
+void GameLogic::UpdateTimers(GameState& state, const Rules& rules, float deltaTime) {
+    // Update game time
+    if (!state.isUserPaused && !state.isResuming) {
+        state.gameTime += deltaTime;
+    }
+    
+    // Update status effects and apple despawn
+    if (!state.isUserPaused && !state.isResuming) {
+        state.UpdateStatusEffects(deltaTime);
+    }
+    state.UpdateAppleDespawn(rules, deltaTime);
+}
+
+void GameLogic::QueueDirection(GameState& state, Direction newDir) {
+    bool reversing = newDir.dx == -state.dx && newDir.dy == -state.dy;
+    if (((state.dx == 0 && state.dy == 0) || !reversing) && 
+        (state.directionQueue.empty() || 
+         state.directionQueue.back().dx != newDir.dx || 
+         state.directionQueue.back().dy != newDir.dy)) {
+        // Dropped when the queue is full
+        state.directionQueue.push_back(newDir);
+    }
+}
+
+template <class Rules>
+void GameLogic::ProcessMovement(GameState& state, const Rules& rules, float deltaTime) {
     if (state.gameOver || state.isUserPaused || state.isResuming) {
         return;
     }
     
     // Update movement timer
-    if (!state.isPaused && !state.isUserPaused && !state.isResuming) {
+    if (!state.isPaused) {
         state.moveTimer += deltaTime;
     }
     
-    // Get move interval based on game mode
-    float moveInterval = (state.gameMode == MODE_ACCELERATED) 
-        ? GameConstants::MOVE_INTERVAL_ACCELERATED 
-        : GameConstants::MOVE_INTERVAL_REGULAR;
+    // One move per elapsed interval, keeping the remainder for the next
+    // frame. Keys of this frame are already queued, so the first of these
+    // moves takes the first key, the next one the next key, and so on.
+    int moves = 0;
+    float interval = MoveIntervalAt(rules, state.score);
+    while (!state.isPaused && !state.gameOver && state.moveTimer >= interval) {
+        if (moves == GameConstants::MAX_MOVES_PER_FRAME) {
+            Metrics::Add(METRIC_DROPPED_MOVES, (uint64_t)(state.moveTimer / interval));
+            state.moveTimer = std::fmod(state.moveTimer, interval);
+            break;
+        }
+        state.moveTimer -= interval;
+        Move(state, rules);
+        moves++;
+        interval = MoveIntervalAt(rules, state.score);
+    }
+}
+
+template <class Rules>
+void GameLogic::Move(GameState& state, const Rules& rules) {
+    if (state.rewind) {
+        state.rewind->BeginMove(state);
+    }
+
+    // Process direction queue
+    ProcessDirectionQueue(state);
     
-    // Process movement when timer elapses
-    if (!state.isPaused && !state.isUserPaused && !state.isResuming && 
-        state.moveTimer >= moveInterval) {
-        state.moveTimer = 0.0f;
+    // Move if we have a direction
+    if (state.dx != 0 || state.dy != 0) {
+        state.moveCount++;
+        Position newHead = {state.snake[0].col + state.dx, state.snake[0].row + state.dy};
         
-        // Process direction queue
-        ProcessDirectionQueue(state);
-        
-        // Move if we have a direction
-        if (state.dx != 0 || state.dy != 0) {
-            Position newHead = {state.snake[0].col + state.dx, state.snake[0].row + state.dy};
-            
-            // Check wall collision
-            if (state.canPassWalls) {
-                // Wrap around
-                if (newHead.col < 0) {
-                    newHead.col = GameConstants::GRID_WIDTH - 1;
-                } else if (newHead.col >= GameConstants::GRID_WIDTH) {
-                    newHead.col = 0;
-                }
-                if (newHead.row < 0) {
-                    newHead.row = GameConstants::GRID_HEIGHT - 1;
-                } else if (newHead.row >= GameConstants::GRID_HEIGHT) {
-                    newHead.row = 0;
-                }
-            } else {
-                // Normal wall collision
-                if (newHead.col < 0 || newHead.col >= GameConstants::GRID_WIDTH || 
-                    newHead.row < 0 || newHead.row >= GameConstants::GRID_HEIGHT) {
-                    state.UpdateHighScore();
-                    state.gameOver = true;
-                    if (!state.gameOverSoundPlayed) {
-                        PlaySound(state.gameOverSound);
-                        state.gameOverSoundPlayed = true;
-                    }
-                    return;
-                }
+        // Check wall collision
+        if (state.canPassWalls) {
+            // Wrap around
+            if (newHead.col < 0) {
+                newHead.col = GameConstants::GRID_WIDTH - 1;
+            } else if (newHead.col >= GameConstants::GRID_WIDTH) {
+                newHead.col = 0;
             }
-            
-            if (!state.gameOver) {
-                CheckCollisions(state, newHead);
+            if (newHead.row < 0) {
+                newHead.row = GameConstants::GRID_HEIGHT - 1;
+            } else if (newHead.row >= GameConstants::GRID_HEIGHT) {
+                newHead.row = 0;
             }
+        } else {
+            // Normal wall collision
+            if (newHead.col < 0 || newHead.col >= GameConstants::GRID_WIDTH || 
+                newHead.row < 0 || newHead.row >= GameConstants::GRID_HEIGHT) {
+                state.UpdateHighScore();
+                state.gameOver = true;
+                Metrics::Add(METRIC_DEATHS_WALL);
+                Metrics::Add(METRIC_EPISODES);
+                if (!state.gameOverSoundPlayed) {
+                    PlaySound(state.gameOverSound);
+                    state.gameOverSoundPlayed = true;
+                }
+            }
+        }
+        
+        if (!state.gameOver) {
+            CheckCollisions(state, rules, newHead);
         }
     }
+
+    if (state.rewind) {
+        state.rewind->EndMove(state);
+    }
 }
 
 void GameLogic::ProcessDirectionQueue(GameState& state) {
@@ -70,14 +180,27 @@ void GameLogic::ProcessDirectionQueue(GameState& state) {
         // Only apply if not reversing current direction (or snake is stationary)
         if ((state.dx == 0 && state.dy == 0) || 
             (nextDir.dx != -state.dx || nextDir.dy != -state.dy)) {
-            state.dx = nextDir.dx;
-            state.dy = nextDir.dy;
+            state.SetDirection(nextDir.dx, nextDir.dy);
         }
         state.directionQueue.pop_front();
     }
 }
 
-void GameLogic::CheckCollisions(GameState& state, Position newHead) {
+template <class Rules>
+void GameLogic::CheckCollisions(GameState& state, const Rules& rules, Position newHead) {
+    // Room for the new head plus a grown tail; a full body ends the game
+    if (state.snake.size() + 2 > state.snake.capacity()) {
+        state.UpdateHighScore();
+        state.gameOver = true;
+        Metrics::Add(METRIC_DEATHS_OTHER);
+        Metrics::Add(METRIC_EPISODES);
+        if (!state.gameOverSoundPlayed) {
+            PlaySound(state.gameOverSound);
+            state.gameOverSoundPlayed = true;
+        }
+        return;
+    }
+    
     // Check self collision
     bool hitSelf = false;
     if (!state.canIntersectSelf) {
@@ -90,9 +213,11 @@ void GameLogic::CheckCollisions(GameState& state, Position newHead) {
     }
     
     if (hitSelf) {
-        state.snake.insert(state.snake.begin(), newHead);
+        state.PushHead(newHead);
         state.UpdateHighScore();
         state.gameOver = true;
+        Metrics::Add(METRIC_DEATHS_SELF);
+        Metrics::Add(METRIC_EPISODES);
         if (!state.gameOverSoundPlayed) {
             PlaySound(state.gameOverSound);
             state.gameOverSoundPlayed = true;
@@ -112,25 +237,31 @@ void GameLogic::CheckCollisions(GameState& state, Position newHead) {
     }
     
     // Move snake
-    state.snake.insert(state.snake.begin(), newHead);
+    state.PushHead(newHead);
     
     if (eatenAppleIndex >= 0) {
-        HandleAppleConsumption(state, eatenAppleIndex);
+        HandleAppleConsumption(state, rules, eatenAppleIndex);
     } else {
         // Remove tail (snake didn't grow)
-        state.snake.pop_back();
+        state.PopTail();
     }
 }
 
-void GameLogic::HandleAppleConsumption(GameState& state, int eatenAppleIndex) {
+template <class Rules>
+void GameLogic::HandleAppleConsumption(GameState& state, const Rules& rules, int eatenAppleIndex) {
     // Remove the eaten apple
     FoodType eatenFoodType = state.apples[eatenAppleIndex].type;
-    state.apples.erase(state.apples.begin() + eatenAppleIndex);
+    state.RemoveApple(eatenAppleIndex);
+    int effects = state.GetEffectMask();
+    bool rebuilt = false;   // poison and teleport redo the body; rehash it all
     
     if (eatenFoodType == POISONOUS) {
         // Poisonous apple - pause movement and reverse
+        if (state.rewind) {
+            state.rewind->SaveBody(state.snake);
+        }
         state.isPaused = true;
-        state.pauseTimer = GameConstants::PAUSE_DURATION;
+        state.pauseTimer = rules.poisonPauseDuration;
         state.directionQueue.clear();
         
         std::reverse(state.snake.begin(), state.snake.end());
@@ -140,23 +271,27 @@ void GameLogic::HandleAppleConsumption(GameState& state, int eatenAppleIndex) {
         state.dy = -state.dy;
         
         state.cannotEatApples = true;
-        state.cannotEatTimer = GameConstants::CANNOT_EAT_DURATION;
+        state.cannotEatTimer = rules.cannotEatDuration;
         state.poisonSoundTimer = 1.0f;
+        rebuilt = true;
     } else if (eatenFoodType == TELEPORT) {
         if (!state.cannotEatApples) {
             // Purple apple - teleport
+            if (state.rewind) {
+                state.rewind->SaveBody(state.snake);
+            }
             state.snake.erase(state.snake.begin());
             int snakeLength = state.snake.size();
             
             int newHeadCol, newHeadRow;
             bool validTeleportPos = false;
             do {
-                newHeadCol = GetRandomValue(0, GameConstants::GRID_WIDTH - 1);
-                newHeadRow = GetRandomValue(0, GameConstants::GRID_HEIGHT - 1);
+                newHeadCol = state.rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+                newHeadRow = state.rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
                 validTeleportPos = state.IsValidPosition(newHeadCol, newHeadRow);
             } while (!validTeleportPos);
             
-            int dirRoll = GetRandomValue(0, 3);
+            int dirRoll = state.rng.GetValue(0, 3);
             switch (dirRoll) {
                 case 0: state.dx = 0; state.dy = -1; break;
                 case 1: state.dx = 0; state.dy = 1; break;
@@ -183,23 +318,24 @@ void GameLogic::HandleAppleConsumption(GameState& state, int eatenAppleIndex) {
             state.dx = 0;
             state.dy = 0;
             state.moveTimer = 0.0f;
+            rebuilt = true;
             
             PlaySound(state.purpleSound);
         } else {
-            state.snake.pop_back();
+            state.PopTail();
         }
     } else if (eatenFoodType == POMME_PLUS || eatenFoodType == POMME_SUPREME) {
         // Pomme Plus or Pomme Supreme
         state.score += 2;
         state.UpdateHighScore();
         
-        state.snake.push_back(state.snake.back());
+        state.GrowTail();
         state.canIntersectSelf = true;
-        state.immunityTimer = GameConstants::IMMUNITY_DURATION;
+        state.immunityTimer = rules.immunityDuration;
         
         if (eatenFoodType == POMME_SUPREME) {
             state.canPassWalls = true;
-            state.wallImmunityTimer = GameConstants::WALL_IMMUNITY_DURATION;
+            state.wallImmunityTimer = rules.wallImmunityDuration;
         }
         
         PlaySound(state.goldenSound);
@@ -208,20 +344,29 @@ void GameLogic::HandleAppleConsumption(GameState& state, int eatenAppleIndex) {
         if (!state.cannotEatApples) {
             state.score++;
             state.UpdateHighScore();
-            state.snake.push_back(state.snake.back());
+            state.GrowTail();
             PlaySound(state.appleSound);
         } else {
-            state.snake.pop_back();
+            state.PopTail();
         }
     }
     
-    // Spawn new apples
-    if (state.gameMode == MODE_ACCELERATED) {
-        for (int i = 0; i < 3 && state.apples.size() < GameConstants::MAX_APPLES; i++) {
-            state.SpawnApple(state.gameTime);
-        }
+    if (rebuilt) {
+        state.hash = state.ComputeHash();
     } else {
-        state.SpawnApple(state.gameTime);
+        state.hash ^= Zobrist::EffectsKey(effects) ^ Zobrist::EffectsKey(state.GetEffectMask());
+    }
+    
+    // Spawn new apples
+    for (int i = 0; i < rules.applesPerEat && (int)state.apples.size() < rules.maxApples; i++) {
+        state.SpawnApple(rules, state.gameTime);
     }
 }
 
+#define INSTANTIATE(RULES) \
+    template void GameLogic::RunFrame(GameState&, const RULES&, float, uint8_t); \
+    template void GameLogic::UpdateTimers(GameState&, const RULES&, float); \
+    template void GameLogic::ProcessMovement(GameState&, const RULES&, float);
+SNEK_FOR_EACH_RULES(INSTANTIATE)
+#undef INSTANTIATE
+
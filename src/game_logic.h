@@ -1,12 +1,46 @@
 #pragma once
 
 #include "game_state.h"
+#include <cstdint>
+
+// Keys pressed during one frame of play, as recorded in replays
+namespace FrameInput {
+    const uint8_t UP = 1 << 0;
+    const uint8_t DOWN = 1 << 1;
+    const uint8_t LEFT = 1 << 2;
+    const uint8_t RIGHT = 1 << 3;
+    const uint8_t PAUSE = 1 << 4;
+    const uint8_t QUIT = 1 << 5;
+    const uint8_t ALL = (1 << 6) - 1;
+}
 
 class GameLogic {
 public:
+    // One frame of play: timers, quit/pause keys, direction keys, movement
+    static void RunFrame(GameState& state, float deltaTime, uint8_t input);
+    // Per-frame clock, status effect and despawn updates (before input and movement)
+    static void UpdateTimers(GameState& state, float deltaTime);
+    // Queues a direction key press, ignoring reversals and repeats
+    static void QueueDirection(GameState& state, Direction newDir);
+    // Adds deltaTime to the move timer and makes every move that has come
+    // due (at most MAX_MOVES_PER_FRAME), keeping the remainder
     static void ProcessMovement(GameState& state, float deltaTime);
-    static void HandleAppleConsumption(GameState& state, int eatenAppleIndex);
-    static void CheckCollisions(GameState& state, Position newHead);
     static void ProcessDirectionQueue(GameState& state);
-};
 
+    // The same for one mode's rules. The entry points above look at gameMode
+    // once and call these; they are instantiated for each built-in mode's
+    // compile-time rules and for a loaded GameRules.
+    template <class Rules>
+    static void RunFrame(GameState& state, const Rules& rules, float deltaTime, uint8_t input);
+    template <class Rules>
+    static void UpdateTimers(GameState& state, const Rules& rules, float deltaTime);
+    template <class Rules>
+    static void ProcessMovement(GameState& state, const Rules& rules, float deltaTime);
+    // One move: next queued direction, then the step and its collisions
+    template <class Rules>
+    static void Move(GameState& state, const Rules& rules);
+    template <class Rules>
+    static void CheckCollisions(GameState& state, const Rules& rules, Position newHead);
+    template <class Rules>
+    static void HandleAppleConsumption(GameState& state, const Rules& rules, int eatenAppleIndex);
+};
@@ -0,0 +1,194 @@
+#include "game_rules.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const GameRules& GameRules::ForMode(GameMode mode, const GameRules& custom) {
+    static const GameRules regular = From<RegularRules>("Regular");
+    static const GameRules accelerated = From<AcceleratedRules>("Accelerated");
+    switch (mode) {
+        case MODE_ACCELERATED:
+            return accelerated;
+        case MODE_CUSTOM:
+            return custom;
+        default:
+            return regular;
+    }
+}
+
+static std::string Trim(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        begin++;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) {
+        end--;
+    }
+    return std::string(begin, end);
+}
+
+static bool ParseInt(const std::string& text, int& out) {
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || value < -1000000000L || value > 1000000000L) {
+        return false;
+    }
+    out = (int)value;
+    return true;
+}
+
+static bool ParseFloat(const std::string& text, float& out) {
+    char* end = nullptr;
+    out = std::strtof(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+bool GameRules::Load(const std::string& path, GameRules& out, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    GameRules rules = From<RegularRules>("Custom");
+    bool anyKey = false;
+    char line[256];
+    int lineNumber = 0;
+    error.clear();
+    while (error.empty() && std::fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        char* comment = std::strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char* equals = std::strchr(line, '=');
+        std::string key = Trim(line, equals ? equals : line + std::strlen(line));
+        if (key.empty() && !equals) {
+            continue;
+        }
+        std::string value = equals ? Trim(equals + 1, equals + std::strlen(equals)) : "";
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (!equals || key.empty() || value.empty()) {
+            error = where + "expected key = value";
+            break;
+        }
+
+        static const char* const FOOD_KEYS[FOOD_TYPE_COUNT] = {
+            "food_regular", "food_poison", "food_pomme_plus", "food_pomme_supreme", "food_teleport",
+        };
+        bool ok = true;
+        if (key == "base") {
+            if (anyKey) {
+                error = where + "base has to come before the other keys";
+            } else if (value == "regular" || value == "accelerated") {
+                rules = (value == "regular") ? From<RegularRules>("Custom") : From<AcceleratedRules>("Custom");
+            } else {
+                error = where + "base is regular or accelerated";
+            }
+        } else if (key == "name") {
+            rules.name = value;
+        } else if (key == "move_interval") {
+            ok = ParseFloat(value, rules.moveInterval);
+        } else if (key == "speed_ramp") {
+            ok = ParseFloat(value, rules.speedRamp);
+        } else if (key == "min_move_interval") {
+            ok = ParseFloat(value, rules.minMoveInterval);
+        } else if (key == "start_apples") {
+            ok = ParseInt(value, rules.startApples);
+        } else if (key == "apples_per_eat") {
+            ok = ParseInt(value, rules.applesPerEat);
+        } else if (key == "min_apples") {
+            ok = ParseInt(value, rules.minApples);
+        } else if (key == "max_apples") {
+            ok = ParseInt(value, rules.maxApples);
+        } else if (key == "despawn") {
+            // "off", or the window in whole seconds: "13 18"
+            int low = 0;
+            int high = 0;
+            if (value == "off") {
+                rules.despawns = false;
+            } else if (std::sscanf(value.c_str(), "%d %d", &low, &high) == 2) {
+                rules.despawns = true;
+                rules.despawnMin = low;
+                rules.despawnMax = high;
+            } else {
+                ok = false;
+            }
+        } else if (key == "immunity") {
+            ok = ParseFloat(value, rules.immunityDuration);
+        } else if (key == "wall_immunity") {
+            ok = ParseFloat(value, rules.wallImmunityDuration);
+        } else if (key == "cannot_eat") {
+            ok = ParseFloat(value, rules.cannotEatDuration);
+        } else if (key == "poison_pause") {
+            ok = ParseFloat(value, rules.poisonPauseDuration);
+        } else {
+            int food = -1;
+            for (int i = 0; i < FOOD_TYPE_COUNT; i++) {
+                if (key == FOOD_KEYS[i]) {
+                    food = i;
+                }
+            }
+            if (food < 0) {
+                error = where + "unknown key " + key;
+            } else {
+                ok = ParseInt(value, rules.foodWeights[food]);
+            }
+        }
+        if (!ok) {
+            error = where + "bad value for " + key;
+        }
+        anyKey = true;
+    }
+    std::fclose(file);
+
+    if (!error.empty() || !rules.Finalize(error)) {
+        if (error.compare(0, path.size(), path) != 0) {
+            error = path + ": " + error;
+        }
+        return false;
+    }
+    out = rules;
+    return true;
+}
+
+bool GameRules::Finalize(std::string& error) {
+    int total = 0;
+    for (int i = 0; i < FOOD_TYPE_COUNT; i++) {
+        if (foodWeights[i] < 0 || foodWeights[i] > RuleDefaults::MAX_FOOD_WEIGHT_TOTAL) {
+            error = "food weights must be between 0 and " + std::to_string(RuleDefaults::MAX_FOOD_WEIGHT_TOTAL);
+            return false;
+        }
+        total += foodWeights[i];
+    }
+    if (name.empty()) {
+        error = "name is empty";
+    } else if (!(moveInterval > 0.0f && moveInterval <= 10.0f)) {
+        error = "move_interval must be above 0 and at most 10 seconds";
+    } else if (!(speedRamp >= 0.0f && speedRamp < 1.0f)) {
+        error = "speed_ramp must be at least 0 and below 1";
+    } else if (speedRamp > 0.0f && !(minMoveInterval >= GameConstants::MIN_MOVE_INTERVAL &&
+                                     minMoveInterval <= moveInterval)) {
+        error = "min_move_interval must be between " + std::to_string(GameConstants::MIN_MOVE_INTERVAL) +
+                " and move_interval";
+    } else if (maxApples < 1 || maxApples > GameConstants::MAX_APPLES) {
+        error = "max_apples must be between 1 and " + std::to_string(GameConstants::MAX_APPLES);
+    } else if (minApples < 0 || minApples > maxApples) {
+        error = "min_apples must be between 0 and max_apples";
+    } else if (startApples < 0 || startApples > maxApples) {
+        error = "start_apples must be between 0 and max_apples";
+    } else if (applesPerEat < 0 || applesPerEat > maxApples) {
+        error = "apples_per_eat must be between 0 and max_apples";
+    } else if (despawnMin < 1 || despawnMax < despawnMin || despawnMax > 3600) {
+        error = "despawn window must be 1 to 3600 seconds, low then high";
+    } else if (!(immunityDuration >= 0.0f && wallImmunityDuration >= 0.0f &&
+                 cannotEatDuration >= 0.0f && poisonPauseDuration >= 0.0f)) {
+        error = "effect durations can't be negative";
+    } else if (total <= 0 || total > RuleDefaults::MAX_FOOD_WEIGHT_TOTAL) {
+        error = "food weights must add up to between 1 and " + std::to_string(RuleDefaults::MAX_FOOD_WEIGHT_TOTAL);
+    }
+    if (!error.empty()) {
+        return false;
+    }
+    foods = FoodTable::Build(foodWeights);
+    return true;
+}
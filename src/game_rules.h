@@ -0,0 +1,195 @@
+#pragma once
+
+#include "game_types.h"
+#include "rng.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+const int FOOD_TYPE_COUNT = TELEPORT + 1;
+
+// Food odds as an alias table over integer weights (indexed by FoodType).
+// Column i keeps `threshold[i]` of its `total` slots and hands the rest to
+// `alias[i]`, so one draw picks a column and a slot: O(1) for any table, and
+// the odds are exactly weight / total.
+struct FoodTable {
+    int total = 0;
+    int threshold[FOOD_TYPE_COUNT] = {};
+    uint8_t alias[FOOD_TYPE_COUNT] = {};
+
+    static constexpr FoodTable Build(const int (&weights)[FOOD_TYPE_COUNT]) {
+        FoodTable table;
+        for (int i = 0; i < FOOD_TYPE_COUNT; i++) {
+            table.total += weights[i];
+        }
+        if (table.total <= 0) {
+            return table;
+        }
+
+        // Scaled so every column holds exactly `total`
+        int scaled[FOOD_TYPE_COUNT] = {};
+        int small[FOOD_TYPE_COUNT] = {};
+        int large[FOOD_TYPE_COUNT] = {};
+        int smallCount = 0;
+        int largeCount = 0;
+        for (int i = 0; i < FOOD_TYPE_COUNT; i++) {
+            scaled[i] = weights[i] * FOOD_TYPE_COUNT;
+            table.alias[i] = (uint8_t)i;
+            if (scaled[i] < table.total) {
+                small[smallCount++] = i;
+            } else {
+                large[largeCount++] = i;
+            }
+        }
+        while (smallCount > 0 && largeCount > 0) {
+            int s = small[--smallCount];
+            int l = large[largeCount - 1];
+            table.threshold[s] = scaled[s];
+            table.alias[s] = (uint8_t)l;
+            scaled[l] -= table.total - scaled[s];
+            if (scaled[l] < table.total) {
+                largeCount--;
+                small[smallCount++] = l;
+            }
+        }
+        while (largeCount > 0) {
+            table.threshold[large[--largeCount]] = table.total;
+        }
+        return table;
+    }
+
+    // One Rng draw, like the if-chain it replaces
+    FoodType Sample(Rng& rng) const {
+        int slot = rng.GetValue(0, FOOD_TYPE_COUNT * total - 1);
+        int column = slot / total;
+        return (FoodType)((slot - column * total < threshold[column]) ? column : alias[column]);
+    }
+};
+
+namespace RuleDefaults {
+    // REGULAR, POISONOUS, POMME_PLUS, POMME_SUPREME, TELEPORT
+    constexpr int FOOD_WEIGHTS[FOOD_TYPE_COUNT] = {82, 10, 4, 1, 3};
+    // Keeps FOOD_TYPE_COUNT * total inside Rng::GetValue's int range
+    const int MAX_FOOD_WEIGHT_TOTAL = 1 << 24;
+}
+
+// Built-in modes. Every field is a compile-time constant, so code
+// instantiated with one of these has no mode checks left in it.
+struct RegularRules {
+    static constexpr float moveInterval = GameConstants::MOVE_INTERVAL_REGULAR;
+    // Each point of score makes moves this fraction faster, down to
+    // minMoveInterval; 0 keeps the speed fixed
+    static constexpr float speedRamp = 0.0f;
+    static constexpr float minMoveInterval = GameConstants::MIN_MOVE_INTERVAL;
+    static constexpr int startApples = 1;
+    static constexpr int applesPerEat = 1;
+    static constexpr int minApples = 0;         // topped up to this after despawns
+    static constexpr int maxApples = GameConstants::MAX_APPLES;
+    static constexpr bool despawns = false;
+    // Drawn for every apple even when they never despawn
+    static constexpr int despawnMin = GameConstants::DESPAWN_TIME_MIN;
+    static constexpr int despawnMax = GameConstants::DESPAWN_TIME_MAX;
+    static constexpr float immunityDuration = GameConstants::IMMUNITY_DURATION;
+    static constexpr float wallImmunityDuration = GameConstants::WALL_IMMUNITY_DURATION;
+    static constexpr float cannotEatDuration = GameConstants::CANNOT_EAT_DURATION;
+    static constexpr float poisonPauseDuration = GameConstants::PAUSE_DURATION;
+    static constexpr FoodTable foods = FoodTable::Build(RuleDefaults::FOOD_WEIGHTS);
+};
+
+struct AcceleratedRules : RegularRules {
+    static constexpr float moveInterval = GameConstants::MOVE_INTERVAL_ACCELERATED;
+    static constexpr int startApples = 3;
+    static constexpr int applesPerEat = 3;
+    static constexpr int minApples = GameConstants::MIN_APPLES;
+    static constexpr bool despawns = true;
+};
+
+// A mode loaded from a config file: the same fields, read at runtime
+struct GameRules {
+    std::string name;
+    float moveInterval = RegularRules::moveInterval;
+    float speedRamp = RegularRules::speedRamp;
+    float minMoveInterval = RegularRules::minMoveInterval;
+    int startApples = RegularRules::startApples;
+    int applesPerEat = RegularRules::applesPerEat;
+    int minApples = RegularRules::minApples;
+    int maxApples = RegularRules::maxApples;
+    bool despawns = RegularRules::despawns;
+    int despawnMin = RegularRules::despawnMin;
+    int despawnMax = RegularRules::despawnMax;
+    float immunityDuration = RegularRules::immunityDuration;
+    float wallImmunityDuration = RegularRules::wallImmunityDuration;
+    float cannotEatDuration = RegularRules::cannotEatDuration;
+    float poisonPauseDuration = RegularRules::poisonPauseDuration;
+    int foodWeights[FOOD_TYPE_COUNT] = {};
+    FoodTable foods;
+
+    template <class Rules>
+    static GameRules From(const char* name);
+    // The built-in mode's values, or `custom` for MODE_CUSTOM
+    static const GameRules& ForMode(GameMode mode, const GameRules& custom);
+
+    // "key = value" lines, '#' starts a comment. Unset keys keep the values of
+    // `base = regular|accelerated` (regular by default). On failure `error`
+    // names the line or field at fault.
+    static bool Load(const std::string& path, GameRules& out, std::string& error);
+    // Range checks, then rebuilds the food table from the weights
+    bool Finalize(std::string& error);
+};
+
+template <class Rules>
+GameRules GameRules::From(const char* name) {
+    GameRules rules;
+    rules.name = name;
+    rules.moveInterval = Rules::moveInterval;
+    rules.speedRamp = Rules::speedRamp;
+    rules.minMoveInterval = Rules::minMoveInterval;
+    rules.startApples = Rules::startApples;
+    rules.applesPerEat = Rules::applesPerEat;
+    rules.minApples = Rules::minApples;
+    rules.maxApples = Rules::maxApples;
+    rules.despawns = Rules::despawns;
+    rules.despawnMin = Rules::despawnMin;
+    rules.despawnMax = Rules::despawnMax;
+    rules.immunityDuration = Rules::immunityDuration;
+    rules.wallImmunityDuration = Rules::wallImmunityDuration;
+    rules.cannotEatDuration = Rules::cannotEatDuration;
+    rules.poisonPauseDuration = Rules::poisonPauseDuration;
+    for (int i = 0; i < FOOD_TYPE_COUNT; i++) {
+        rules.foodWeights[i] = RuleDefaults::FOOD_WEIGHTS[i];
+    }
+    rules.foods = Rules::foods;
+    return rules;
+}
+
+// Seconds per move at this score. Built-in modes have no ramp, so this
+// folds to their constant interval.
+template <class Rules>
+float MoveIntervalAt(const Rules& rules, int score) {
+    if (!(rules.speedRamp > 0.0f) || score <= 0) {
+        return rules.moveInterval;
+    }
+    return std::max(rules.minMoveInterval, rules.moveInterval * std::pow(1.0f - rules.speedRamp, (float)score));
+}
+
+// Calls fn with the mode's rules: a compile-time type for the built-in
+// modes, the loaded descriptor for MODE_CUSTOM. Per-tick code is written
+// once as a template and this is the only place the mode is looked at.
+template <class Fn>
+auto WithRules(GameMode mode, const GameRules& custom, Fn&& fn) {
+    switch (mode) {
+        case MODE_ACCELERATED:
+            return fn(AcceleratedRules());
+        case MODE_CUSTOM:
+            return fn(custom);
+        default:
+            return fn(RegularRules());
+    }
+}
+
+// Explicit instantiations of a rules template for every rules type
+#define SNEK_FOR_EACH_RULES(MACRO) \
+    MACRO(RegularRules)            \
+    MACRO(AcceleratedRules)        \
+    MACRO(GameRules)
@@ -1,4 +1,6 @@
 #include "game_state.h"
+#include "metrics.h"
+#include "zobrist.h"
 #include "raylib.h"
 #include <ctime>
 #include <algorithm>
@@ -6,55 +8,10 @@
 #include <cstdio>
 
 void GameState::Initialize() {
-    // Try to find sounds directory (check multiple possible paths)
-    // This handles different deployment scenarios
-    std::string soundsPath = "sounds/";
-    
-    #ifdef PLATFORM_WEB
-    // On web, preloaded files are at /sounds/
-    soundsPath = "/sounds/";
-    #else
-    // Helper function to check if a path exists (simple check)
-    auto fileExists = [](const char* path) -> bool {
-        FILE* file = fopen(path, "r");
-        if (file) {
-            fclose(file);
-            return true;
-        }
-        return false;
-    };
-    
-    // Try different paths
-    const char* testPaths[] = {
-        "sounds/apple.mp3",           // Same directory as executable
-        "../sounds/apple.mp3",        // Parent directory
-        "../Resources/sounds/apple.mp3", // macOS app bundle
-        "./sounds/apple.mp3",         // Current directory
-    };
-    
-    for (const char* testPath : testPaths) {
-        if (fileExists(testPath)) {
-            // Extract directory path
-            std::string path = testPath;
-            size_t lastSlash = path.find_last_of("/\\");
-            if (lastSlash != std::string::npos) {
-                soundsPath = path.substr(0, lastSlash + 1);
-            }
-            break;
-        }
-    }
-    #endif
-    
-    // Load sound effects (with error checking for web)
-    appleSound = LoadSound((soundsPath + "apple.mp3").c_str());
-    poisonSound = LoadSound((soundsPath + "poison.mp3").c_str());
-    goldenSound = LoadSound((soundsPath + "golden.mp3").c_str());
-    purpleSound = LoadSound((soundsPath + "purple.mp3").c_str());
-    gameOverSound = LoadSound((soundsPath + "gameover.mp3").c_str());
-    pauseSound = LoadSound((soundsPath + "pause.mp3").c_str());
+    // Sounds come from SoundLoader, which fills them in once decoded
     
     // Initialize random seed
-    SetRandomSeed((unsigned int)std::time(nullptr));
+    rng.Seed((uint64_t)std::time(nullptr));
     
     // Don't call Reset() here - we want to show mode selection screen at startup
     // Initialize only what's needed for first startup
@@ -67,8 +24,8 @@ void GameState::Initialize() {
     
     // Initialize snake (will be reset when mode is selected)
     snake.clear();
-    snake.push_back({GetRandomValue(0, GameConstants::GRID_WIDTH - 1), 
-                     GetRandomValue(0, GameConstants::GRID_HEIGHT - 1)});
+    snake.push_back({rng.GetValue(0, GameConstants::GRID_WIDTH - 1), 
+                     rng.GetValue(0, GameConstants::GRID_HEIGHT - 1)});
     
     // Don't initialize apples yet - will be done when mode is selected
     apples.clear();
@@ -78,6 +35,7 @@ void GameState::Initialize() {
     dy = 0;
     directionQueue.clear();
     moveTimer = 0.0f;
+    moveCount = 0;
     
     // Reset all timers and effects
     canIntersectSelf = false;
@@ -94,6 +52,7 @@ void GameState::Initialize() {
     poisonSoundTimer = 0.0f;
     pauseSoundTimer = 0.0f;
     gameOverSoundPlayed = false;
+    hash = ComputeHash();
 }
 
 void GameState::Cleanup() {
@@ -106,6 +65,34 @@ void GameState::Cleanup() {
 }
 
 void GameState::Reset() {
+    WithRules(gameMode, customRules, [this](const auto& rules) { Reset(rules); });
+}
+
+void GameState::NewGame() {
+    uint64_t next = ((uint64_t)rng.NextU32() << 32) | rng.NextU32();
+    seed = (next != 0) ? next : 1;
+    rng.Seed(seed);
+    Reset();
+}
+
+FoodType GameState::GetRandomFoodType() {
+    return WithRules(gameMode, customRules, [this](const auto& rules) { return GetRandomFoodType(rules); });
+}
+
+bool GameState::SpawnApple(float currentTime) {
+    return WithRules(gameMode, customRules, [&](const auto& rules) { return SpawnApple(rules, currentTime); });
+}
+
+void GameState::SpawnStartingApples() {
+    WithRules(gameMode, customRules, [this](const auto& rules) { SpawnStartingApples(rules); });
+}
+
+void GameState::UpdateAppleDespawn(float deltaTime) {
+    WithRules(gameMode, customRules, [&](const auto& rules) { UpdateAppleDespawn(rules, deltaTime); });
+}
+
+template <class Rules>
+void GameState::Reset(const Rules& rules) {
     score = 0;
     gameOver = false;
     showModeSelection = false;
@@ -114,24 +101,18 @@ void GameState::Reset() {
     
     // Reset snake
     snake.clear();
-    snake.push_back({GetRandomValue(0, GameConstants::GRID_WIDTH - 1), 
-                     GetRandomValue(0, GameConstants::GRID_HEIGHT - 1)});
+    snake.push_back({rng.GetValue(0, GameConstants::GRID_WIDTH - 1), 
+                     rng.GetValue(0, GameConstants::GRID_HEIGHT - 1)});
     
     // Reset apples
-    apples.clear();
-    if (gameMode == MODE_ACCELERATED) {
-        for (int i = 0; i < 3; i++) {
-            SpawnApple(0.0f);
-        }
-    } else {
-        SpawnApple(0.0f);
-    }
+    SpawnStartingApples(rules);
     
     // Reset direction and movement
     dx = 0;
     dy = 0;
     directionQueue.clear();
     moveTimer = 0.0f;
+    moveCount = 0;
     
     // Reset all timers and effects
     canIntersectSelf = false;
@@ -148,6 +129,7 @@ void GameState::Reset() {
     poisonSoundTimer = 0.0f;
     pauseSoundTimer = 0.0f;
     gameOverSoundPlayed = false;
+    hash = ComputeHash();
 }
 
 bool GameState::IsValidPosition(int col, int row) const {
@@ -166,23 +148,14 @@ bool GameState::IsValidPosition(int col, int row) const {
     return true;
 }
 
-FoodType GameState::GetRandomFoodType() const {
-    int foodRoll = GetRandomValue(1, 100);
-    if (foodRoll <= 4) {
-        return POMME_PLUS;
-    } else if (foodRoll <= 5) {
-        return POMME_SUPREME;
-    } else if (foodRoll <= 15) {
-        return POISONOUS;
-    } else if (foodRoll <= 18) {
-        return TELEPORT;
-    } else {
-        return REGULAR;
-    }
+template <class Rules>
+FoodType GameState::GetRandomFoodType(const Rules& rules) {
+    return rules.foods.Sample(rng);
 }
 
-bool GameState::SpawnApple(float currentTime) {
-    if (apples.size() >= GameConstants::MAX_APPLES) {
+template <class Rules>
+bool GameState::SpawnApple(const Rules& rules, float currentTime) {
+    if ((int)apples.size() >= rules.maxApples) {
         return false;
     }
     
@@ -190,10 +163,13 @@ bool GameState::SpawnApple(float currentTime) {
     int attempts = 0;
     int col, row;
     do {
-        col = GetRandomValue(0, GameConstants::GRID_WIDTH - 1);
-        row = GetRandomValue(0, GameConstants::GRID_HEIGHT - 1);
+        col = rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+        row = rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
         attempts++;
     } while (!IsValidPosition(col, row) && attempts < 100);
+    if (attempts > 1) {
+        Metrics::Add(METRIC_SPAWN_RETRIES, (uint64_t)(attempts - 1));
+    }
     
     if (attempts >= 100) {
         return false;
@@ -202,15 +178,25 @@ bool GameState::SpawnApple(float currentTime) {
     Apple newApple;
     newApple.col = col;
     newApple.row = row;
-    newApple.type = GetRandomFoodType();
+    newApple.type = GetRandomFoodType(rules);
     newApple.spawnTime = currentTime;
-    newApple.despawnTime = GetRandomValue(GameConstants::DESPAWN_TIME_MIN, 
-                                          GameConstants::DESPAWN_TIME_MAX);
+    newApple.despawnTime = rng.GetValue(rules.despawnMin, rules.despawnMax);
     apples.push_back(newApple);
+    hash ^= Zobrist::AppleKey(newApple);
     return true;
 }
 
+template <class Rules>
+void GameState::SpawnStartingApples(const Rules& rules) {
+    apples.clear();
+    hash = ComputeHash();
+    for (int i = 0; i < rules.startApples; i++) {
+        SpawnApple(rules, 0.0f);
+    }
+}
+
 void GameState::UpdateStatusEffects(float deltaTime) {
+    int effects = GetEffectMask();
     if (canIntersectSelf) {
         immunityTimer -= deltaTime;
         if (immunityTimer <= 0.0f) {
@@ -270,29 +256,87 @@ void GameState::UpdateStatusEffects(float deltaTime) {
     } else {
         pauseSoundTimer = 0.0f;
     }
+    
+    hash ^= Zobrist::EffectsKey(effects) ^ Zobrist::EffectsKey(GetEffectMask());
 }
 
-void GameState::UpdateAppleDespawn(float deltaTime) {
-    if (gameMode != MODE_ACCELERATED) {
-        return;
+void GameState::RemoveApple(int index) {
+    hash ^= Zobrist::AppleKey(apples[index]);
+    apples.erase(apples.begin() + index);
+}
+
+void GameState::PushHead(Position cell) {
+    uint32_t length = (uint32_t)snake.size();
+    hash ^= Zobrist::LengthKey(length) ^ Zobrist::LengthKey(length + 1) ^ Zobrist::HeadKey(cell);
+    if (length == 0) {
+        hash ^= Zobrist::SegmentKey(cell, Zobrist::LINK_TAIL);
+    } else {
+        hash ^= Zobrist::HeadKey(snake[0]) ^ Zobrist::SegmentKey(cell, Zobrist::Link(cell, snake[0]));
     }
-    
+    snake.insert(snake.begin(), cell);
+}
+
+void GameState::PopTail() {
+    uint32_t length = (uint32_t)snake.size();
+    Position tail = snake.back();
+    hash ^= Zobrist::LengthKey(length) ^ Zobrist::LengthKey(length - 1) ^ Zobrist::SegmentKey(tail, Zobrist::LINK_TAIL);
+    if (length == 1) {
+        hash ^= Zobrist::HeadKey(tail);
+    } else {
+        // The segment before becomes the tail
+        Position last = snake[length - 2];
+        hash ^= Zobrist::SegmentKey(last, Zobrist::Link(last, tail)) ^ Zobrist::SegmentKey(last, Zobrist::LINK_TAIL);
+    }
+    snake.pop_back();
+}
+
+void GameState::GrowTail() {
+    uint32_t length = (uint32_t)snake.size();
+    Position tail = snake.back();
+    // The old tail now links to a copy stacked on it
+    hash ^= Zobrist::LengthKey(length) ^ Zobrist::LengthKey(length + 1) ^ Zobrist::SegmentKey(tail, Zobrist::LINK_STACKED);
+    snake.push_back(tail);
+}
+
+void GameState::SetDirection(int newDx, int newDy) {
+    hash ^= Zobrist::DirectionKey(dx, dy) ^ Zobrist::DirectionKey(newDx, newDy);
+    dx = newDx;
+    dy = newDy;
+}
+
+uint64_t GameState::ComputeHash() const {
+    return Zobrist::Hash(*this);
+}
+
+template <class Rules>
+void GameState::UpdateAppleDespawn(const Rules& rules, float deltaTime) {
     // Remove apples that have exceeded their despawn time
-    auto it = apples.begin();
-    while (it != apples.end()) {
-        float elapsed = gameTime - it->spawnTime;
-        if (elapsed >= it->despawnTime) {
-            it = apples.erase(it);
-        } else {
-            ++it;
+    if (rules.despawns) {
+        size_t i = 0;
+        while (i < apples.size()) {
+            float elapsed = gameTime - apples[i].spawnTime;
+            if (elapsed >= apples[i].despawnTime) {
+                RemoveApple((int)i);
+            } else {
+                i++;
+            }
         }
     }
     
-    // Ensure at least MIN_APPLES apples are on the board
-    while (apples.size() < GameConstants::MIN_APPLES) {
-        if (!SpawnApple(gameTime)) {
+    // Ensure at least minApples apples are on the board
+    while ((int)apples.size() < rules.minApples) {
+        if (!SpawnApple(rules, gameTime)) {
             break;
         }
     }
 }
 
+#define INSTANTIATE(RULES) \
+    template void GameState::Reset(const RULES&); \
+    template FoodType GameState::GetRandomFoodType(const RULES&); \
+    template bool GameState::SpawnApple(const RULES&, float); \
+    template void GameState::SpawnStartingApples(const RULES&); \
+    template void GameState::UpdateAppleDespawn(const RULES&, float);
+SNEK_FOR_EACH_RULES(INSTANTIATE)
+#undef INSTANTIATE
+
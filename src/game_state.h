@@ -1,9 +1,12 @@
 #pragma once
 
+#include "game_rules.h"
 #include "game_types.h"
 #include "raylib.h"
-#include <vector>
-#include <deque>
+#include "rng.h"
+#include <cstdint>
+
+class RewindBuffer;
 
 class GameState {
 public:
@@ -18,15 +21,23 @@ public:
     int score = 0;
     int highScoreRegular = 0;
     int highScoreAccelerated = 0;
+    int highScoreCustom = 0;
     
     // Helper to get current mode's high score
     int GetCurrentHighScore() const {
+        if (gameMode == MODE_CUSTOM) {
+            return highScoreCustom;
+        }
         return (gameMode == MODE_ACCELERATED) ? highScoreAccelerated : highScoreRegular;
     }
     
     // Helper to update current mode's high score
     void UpdateHighScore() {
-        if (gameMode == MODE_ACCELERATED) {
+        if (gameMode == MODE_CUSTOM) {
+            if (score > highScoreCustom) {
+                highScoreCustom = score;
+            }
+        } else if (gameMode == MODE_ACCELERATED) {
             if (score > highScoreAccelerated) {
                 highScoreAccelerated = score;
             }
@@ -37,17 +48,36 @@ public:
         }
     }
     
+    // Rules for MODE_CUSTOM (loaded from a config file); built-in modes
+    // use their compile-time rules
+    GameRules customRules;
+    const GameRules& GetRules() const { return GameRules::ForMode(gameMode, customRules); }
+    
     // Snake
-    std::vector<Position> snake;
+    SnakeBody snake;
     int dx = 0;
     int dy = 0;
-    std::deque<Direction> directionQueue;
+    DirectionQueue directionQueue;
     float moveTimer = 0.0f;
+    uint32_t moveCount = 0;     // moves made this game
     
     // Apples
-    std::vector<Apple> apples;
+    AppleList apples;
     float gameTime = 0.0f;
     
+    // Seeded per session so a game can be replayed from its recorded state
+    Rng rng;
+    // What rng was seeded with when this game started (NewGame), so the
+    // mode and seed rebuild it; 0 for a game loaded from a scenario
+    uint64_t seed = 0;
+    
+    // Zobrist hash of the position (see zobrist.h), kept current by the
+    // helpers below; code that edits the fields directly calls ComputeHash
+    uint64_t hash = 0;
+    
+    // Undo history being recorded, if any (gets the body before a rebuild)
+    RewindBuffer* rewind = nullptr;
+    
     // Status effects
     bool canIntersectSelf = false;
     float immunityTimer = 0.0f;
@@ -68,26 +98,50 @@ public:
     float pauseSoundTimer = 0.0f;
     bool gameOverSoundPlayed = false;
     
-    // Sounds
-    Sound appleSound;
-    Sound poisonSound;
-    Sound goldenSound;
-    Sound purpleSound;
-    Sound gameOverSound;
-    Sound pauseSound;
+    // Sounds (zeroed so a headless GameState can play them as no-ops)
+    Sound appleSound = {};
+    Sound poisonSound = {};
+    Sound goldenSound = {};
+    Sound purpleSound = {};
+    Sound gameOverSound = {};
+    Sound pauseSound = {};
     
     // Initialization
     void Initialize();
     void Cleanup();
     void Reset();
+    // Reseeds rng with a seed drawn from it, keeps that in `seed`, then Reset
+    void NewGame();
     
     // Apple management
     bool IsValidPosition(int col, int row) const;
-    FoodType GetRandomFoodType() const;
+    FoodType GetRandomFoodType();
     bool SpawnApple(float currentTime);
+    // The mode's opening apples on a cleared board (Reset does this too)
+    void SpawnStartingApples();
+    
+    void RemoveApple(int index);
+    
+    // Body and direction changes that keep the hash current
+    void PushHead(Position cell);
+    void PopTail();
+    void GrowTail();            // duplicates the tail cell
+    void SetDirection(int newDx, int newDy);
+    // Bit per active effect (immunity, wall wrap, no eating, poison pause)
+    int GetEffectMask() const {
+        return (canIntersectSelf ? 1 : 0) | (canPassWalls ? 2 : 0) | (cannotEatApples ? 4 : 0) | (isPaused ? 8 : 0);
+    }
+    uint64_t ComputeHash() const;
     
     // Status effect updates
     void UpdateStatusEffects(float deltaTime);
     void UpdateAppleDespawn(float deltaTime);
+    
+    // Per-mode versions (see WithRules); the ones above pick the rules from gameMode
+    template <class Rules> void Reset(const Rules& rules);
+    template <class Rules> FoodType GetRandomFoodType(const Rules& rules);
+    template <class Rules> bool SpawnApple(const Rules& rules, float currentTime);
+    template <class Rules> void SpawnStartingApples(const Rules& rules);
+    template <class Rules> void UpdateAppleDespawn(const Rules& rules, float deltaTime);
 };
 
@@ -1,7 +1,7 @@
 #pragma once
 
+#include "fixed_containers.h"
 #include "raylib.h"
-#include <vector>
 
 struct Position {
     int col;
@@ -14,7 +14,7 @@ struct Direction {
 };
 
 enum FoodType { REGULAR, POISONOUS, POMME_PLUS, POMME_SUPREME, TELEPORT };
-enum GameMode { MODE_REGULAR, MODE_ACCELERATED };
+enum GameMode { MODE_REGULAR, MODE_ACCELERATED, MODE_CUSTOM };
 
 struct Apple {
     int col;
@@ -48,18 +48,33 @@ namespace GameConstants {
     const Color PURPLE_COLOR = {186, 85, 211, 255};
     
     // Game timing
-    const float MOVE_INTERVAL_REGULAR = 0.25f;
-    const float MOVE_INTERVAL_ACCELERATED = 0.20f;
-    const float IMMUNITY_DURATION = 10.0f;
-    const float WALL_IMMUNITY_DURATION = 10.0f;
-    const float CANNOT_EAT_DURATION = 10.0f;
-    const float PAUSE_DURATION = 0.5f;
-    const float RESUME_DELAY_DURATION = 2.0f;
+    constexpr float MOVE_INTERVAL_REGULAR = 0.25f;
+    constexpr float MOVE_INTERVAL_ACCELERATED = 0.20f;
+    constexpr float IMMUNITY_DURATION = 10.0f;
+    constexpr float WALL_IMMUNITY_DURATION = 10.0f;
+    constexpr float CANNOT_EAT_DURATION = 10.0f;
+    constexpr float PAUSE_DURATION = 0.5f;
+    constexpr float RESUME_DELAY_DURATION = 2.0f;
+    // Fastest a score-scaled mode may go
+    constexpr float MIN_MOVE_INTERVAL = 0.002f;
+    // Moves one frame may catch up on; time past that is dropped so a long
+    // stall doesn't turn into a burst of moves (or a spiral of slow frames)
+    const int MAX_MOVES_PER_FRAME = 32;
     
     // Apple settings
     const int MAX_APPLES = 12;
     const int MIN_APPLES = 2;
     const int DESPAWN_TIME_MIN = 13;
     const int DESPAWN_TIME_MAX = 18;
+    
+    // Fixed capacities of a game's containers. Only immunity overlaps can
+    // push a snake past the cell count; a game that fills the body ends.
+    const int MAX_SNAKE_LENGTH = 512;
+    // Keys queued past this are dropped
+    const int DIRECTION_QUEUE_CAPACITY = 16;
 }
 
+using SnakeBody = FixedVector<Position, GameConstants::MAX_SNAKE_LENGTH>;
+using AppleList = FixedVector<Apple, GameConstants::MAX_APPLES>;
+using DirectionQueue = FixedRing<Direction, GameConstants::DIRECTION_QUEUE_CAPACITY>;
+
@@ -0,0 +1,217 @@
+#include "libsnek.h"
+#include "observation_crop.h"
+#include "snek_batch.h"
+#include "snek_checkpoint.h"
+#include "metrics.h"
+#include "trajectory.h"
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+
+uint32_t snek_abi_version(void) {
+    return SNEK_ABI_VERSION;
+}
+
+int32_t snek_grid_width(void) {
+    return GameConstants::GRID_WIDTH;
+}
+
+int32_t snek_grid_height(void) {
+    return GameConstants::GRID_HEIGHT;
+}
+
+SnekBatch* snek_batch_create(const SnekBatchConfig* config) {
+    if (!config || !SnekBatch::IsValidConfig(*config)) {
+        return nullptr;
+    }
+    SnekBatch* batch = new (std::nothrow) SnekBatch();
+    if (!batch) {
+        return nullptr;
+    }
+    try {
+        batch->Allocate(*config);
+    } catch (const std::bad_alloc&) {
+        delete batch;
+        return nullptr;
+    }
+    batch->Reset(config->seed);
+    return batch;
+}
+
+void snek_batch_destroy(SnekBatch* batch) {
+    delete batch;
+}
+
+int32_t snek_batch_num_envs(const SnekBatch* batch) {
+    return batch ? batch->config.num_envs : 0;
+}
+
+void snek_batch_reset(SnekBatch* batch, uint64_t seed) {
+    if (batch) {
+        batch->Reset(seed);
+    }
+}
+
+void snek_batch_reset_env(SnekBatch* batch, int32_t env, uint64_t seed) {
+    if (batch && env >= 0 && env < batch->config.num_envs) {
+        batch->ResetEnv(env, seed);
+    }
+}
+
+void snek_batch_step(SnekBatch* batch, const uint8_t* actions) {
+    if (batch) {
+        batch->Step(actions);
+    }
+}
+
+int32_t snek_batch_plan(SnekBatch* batch, int32_t env, int32_t iterations, float time_budget, int32_t threads) {
+    if (!batch || env < 0 || env >= batch->config.num_envs) {
+        return SNEK_ACTION_NONE;
+    }
+    try {
+        return batch->Plan(env, (iterations > 0) ? (uint32_t)iterations : 0, time_budget, threads);
+    } catch (const std::exception&) {
+        return SNEK_ACTION_NONE;
+    }
+}
+
+int32_t snek_batch_crops(const SnekBatch* batch, int32_t size, uint8_t* out) {
+    if (!batch || !out || !ObservationCrop::IsValidSize(size)) {
+        return 0;
+    }
+    ObservationCrop::Extract(batch->games.data(), batch->observations.data(), batch->config.num_envs, size, out);
+    return 1;
+}
+
+int32_t snek_batch_save(const SnekBatch* batch, const char* path, int32_t durable) {
+    return (batch && path && SnekCheckpoint::Save(*batch, path, durable != 0)) ? 1 : 0;
+}
+
+SnekBatch* snek_batch_load(const char* path) {
+    if (!path) {
+        return nullptr;
+    }
+    SnekBatch* batch = new (std::nothrow) SnekBatch();
+    if (!batch) {
+        return nullptr;
+    }
+    bool loaded = false;
+    try {
+        loaded = SnekCheckpoint::Load(path, *batch);
+    } catch (const std::bad_alloc&) {
+    }
+    if (!loaded) {
+        delete batch;
+        return nullptr;
+    }
+    return batch;
+}
+
+int32_t snek_batch_record(SnekBatch* batch, const char* directory) {
+    if (!batch) {
+        return 0;
+    }
+    try {
+        return batch->Record(directory) ? 1 : 0;
+    } catch (const std::exception&) {
+        batch->recorder.reset();
+        return 0;
+    }
+}
+
+struct SnekTrajectories {
+    TrajectoryReader reader;
+};
+
+SnekTrajectories* snek_trajectories_open(const char* directory) {
+    if (!directory) {
+        return nullptr;
+    }
+    try {
+        std::unique_ptr<SnekTrajectories> trajectories(new SnekTrajectories());
+        std::string error;
+        if (!trajectories->reader.Open(directory, error) ||
+            (trajectories->reader.GetRowCount() > 0 &&
+             trajectories->reader.GetObservationSize() != SnekEngineConstants::CELLS)) {
+            return nullptr;
+        }
+        return trajectories.release();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void snek_trajectories_close(SnekTrajectories* trajectories) {
+    delete trajectories;
+}
+
+int64_t snek_trajectories_count(const SnekTrajectories* trajectories) {
+    return trajectories ? (int64_t)trajectories->reader.GetRowCount() : 0;
+}
+
+int32_t snek_trajectories_sample(SnekTrajectories* trajectories, int32_t count, uint64_t seed,
+                                 uint8_t* observations, uint8_t* actions, float* rewards,
+                                 uint8_t* dones, uint8_t* events) {
+    if (!trajectories || count <= 0 || trajectories->reader.GetRowCount() == 0) {
+        return 0;
+    }
+    Rng rng;
+    rng.Seed(seed);
+    Transition row;
+    for (int32_t i = 0; i < count; i++) {
+        trajectories->reader.Sample(rng, row);
+        if (observations) {
+            std::memcpy(observations + (size_t)i * SnekEngineConstants::CELLS, row.observation,
+                        SnekEngineConstants::CELLS);
+        }
+        if (actions) {
+            actions[i] = row.action;
+        }
+        if (rewards) {
+            rewards[i] = row.reward;
+        }
+        if (dones) {
+            dones[i] = row.done;
+        }
+        if (events) {
+            events[i * 3] = row.food;
+            events[i * 3 + 1] = row.death;
+            events[i * 3 + 2] = row.effects;
+        }
+    }
+    return count;
+}
+
+int32_t snek_metrics_export(const char* path) {
+    if (!path) {
+        return 0;
+    }
+    try {
+        std::unique_ptr<MetricsSnapshot> snapshot(new MetricsSnapshot());
+        Metrics::Collect(*snapshot);
+        return Metrics::WriteFile(path, Metrics::FormatPrometheus(*snapshot, -1.0, -1.0)) ? 1 : 0;
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+uint8_t* snek_batch_actions(SnekBatch* batch) {
+    return batch ? batch->actions.data() : nullptr;
+}
+
+uint8_t* snek_batch_observations(SnekBatch* batch) {
+    return batch ? batch->observations.data() : nullptr;
+}
+
+float* snek_batch_rewards(SnekBatch* batch) {
+    return batch ? batch->rewards.data() : nullptr;
+}
+
+uint8_t* snek_batch_dones(SnekBatch* batch) {
+    return batch ? batch->dones.data() : nullptr;
+}
+
+int32_t* snek_batch_scores(SnekBatch* batch) {
+    return batch ? batch->scores.data() : nullptr;
+}
@@ -0,0 +1,156 @@
+/* libsnek: C ABI for driving batches of single-player games from trainers
+ * (ctypes, cffi, other FFIs). Plain C, fixed-width types, no exceptions.
+ *
+ * A batch owns its action, observation, reward, done and score buffers.
+ * Get the pointers once after create; they stay valid until destroy, so a
+ * trainer can wrap them as arrays and never copy. snek_batch_step advances
+ * every game by one move and writes all buffers in place. Finished games
+ * restart on their own (done is set for that step, and the observation is
+ * already the new game's first one).
+ *
+ * Batches share nothing, so separate batches can be stepped from separate
+ * threads. */
+#ifndef LIBSNEK_H
+#define LIBSNEK_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define SNEK_API __declspec(dllexport)
+#else
+#define SNEK_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on any incompatible change to the functions or buffer layouts */
+#define SNEK_ABI_VERSION 1
+
+enum SnekAction {
+    SNEK_ACTION_NONE = 0,   /* keep going */
+    SNEK_ACTION_UP = 1,
+    SNEK_ACTION_DOWN = 2,
+    SNEK_ACTION_LEFT = 3,
+    SNEK_ACTION_RIGHT = 4
+};
+
+/* Observation cells, one byte each, row-major */
+enum SnekCell {
+    SNEK_CELL_EMPTY = 0,
+    SNEK_CELL_BODY = 1,
+    SNEK_CELL_HEAD = 2,
+    SNEK_CELL_APPLE = 3,            /* regular */
+    SNEK_CELL_POISON = 4,
+    SNEK_CELL_POMME_PLUS = 5,
+    SNEK_CELL_POMME_SUPREME = 6,
+    SNEK_CELL_TELEPORT = 7,
+    SNEK_CELL_WALL = 8              /* outside the board, in crops only */
+};
+
+/* Why a recorded game ended */
+enum SnekDeath {
+    SNEK_DEATH_NONE = 0,
+    SNEK_DEATH_WALL = 1,
+    SNEK_DEATH_SELF = 2,
+    SNEK_DEATH_OTHER = 3            /* failed teleport, full body */
+};
+
+enum SnekMode {
+    SNEK_MODE_REGULAR = 0,
+    SNEK_MODE_ACCELERATED = 1
+};
+
+typedef struct SnekBatchConfig {
+    int32_t num_envs;
+    int32_t mode;           /* SnekMode */
+    int32_t max_ticks;      /* end an episode after this many steps, 0 = never */
+    float death_penalty;    /* subtracted from the reward on the step a game ends */
+    uint64_t seed;
+} SnekBatchConfig;
+
+typedef struct SnekBatch SnekBatch;
+
+SNEK_API uint32_t snek_abi_version(void);
+SNEK_API int32_t snek_grid_width(void);
+SNEK_API int32_t snek_grid_height(void);
+
+/* Returns NULL on invalid config or allocation failure */
+SNEK_API SnekBatch* snek_batch_create(const SnekBatchConfig* config);
+SNEK_API void snek_batch_destroy(SnekBatch* batch);
+SNEK_API int32_t snek_batch_num_envs(const SnekBatch* batch);
+
+/* Every function taking a batch does nothing for a NULL one: getters return
+ * NULL or 0, snek_batch_plan SNEK_ACTION_NONE. */
+
+/* Restarts every game; game i is seeded from (seed, i) */
+SNEK_API void snek_batch_reset(SnekBatch* batch, uint64_t seed);
+SNEK_API void snek_batch_reset_env(SnekBatch* batch, int32_t env, uint64_t seed);
+
+/* Checkpoints: every game's full state (RNG and timers included) and all
+ * buffers go to one versioned file, written to path.tmp and renamed into
+ * place. durable = 1 also syncs it to disk first. Returns 1 on success.
+ * Load returns a new batch, or NULL if the file is missing, truncated, or
+ * from a build with a different layout. */
+SNEK_API int32_t snek_batch_save(const SnekBatch* batch, const char* path, int32_t durable);
+SNEK_API SnekBatch* snek_batch_load(const char* path);
+
+/* actions: num_envs SnekAction bytes, or NULL to use the batch's own buffer */
+SNEK_API void snek_batch_step(SnekBatch* batch, const uint8_t* actions);
+
+/* Searches env's game with Monte Carlo tree search on `threads` threads
+ * (at least 1) and returns the SnekAction it would play next, without
+ * stepping anything. iterations and time_budget (seconds) bound the search,
+ * 0 = no limit; with neither set it runs 1000 simulations. Returns
+ * SNEK_ACTION_NONE for a bad env. */
+SNEK_API int32_t snek_batch_plan(SnekBatch* batch, int32_t env, int32_t iterations, float time_budget, int32_t threads);
+
+/* Egocentric views: a size x size window around each game's head, turned so
+ * the heading points up (row 0 is furthest ahead, the head in the middle).
+ * Cells past a wall are SNEK_CELL_WALL, or wrap around while the game passes
+ * through walls. Written straight into out, [num_envs][size][size], from the
+ * current observations (vectorized with AVX2 where the CPU has it). size is
+ * odd, 1 to 2 * min(width, height) + 1. Returns 1, or 0 for a bad size. */
+SNEK_API int32_t snek_batch_crops(const SnekBatch* batch, int32_t size, uint8_t* out);
+
+/* Trajectory datasets. While recording, every step appends one row per env
+ * to chunk files in directory: the observation acted on, the action, reward,
+ * done, the food eaten (a SnekCell, 0 for none), the SnekDeath, effect bits
+ * (1 immune, 2 through walls, 4 can't eat, 8 paused), score, env and tick.
+ * Each column is a plain array at an offset given in the chunk's header.
+ * Chunks are filled through memory maps and swapped on a background thread,
+ * so steps don't wait on the disk. NULL stops recording and finishes the
+ * last chunk. Returns 1, or 0 if the directory or a chunk couldn't be made. */
+SNEK_API int32_t snek_batch_record(SnekBatch* batch, const char* directory);
+
+typedef struct SnekTrajectories SnekTrajectories;
+
+/* Maps every finished chunk in directory read-only, or NULL if one is bad */
+SNEK_API SnekTrajectories* snek_trajectories_open(const char* directory);
+SNEK_API void snek_trajectories_close(SnekTrajectories* trajectories);
+SNEK_API int64_t snek_trajectories_count(const SnekTrajectories* trajectories);
+/* Draws count rows uniformly (with replacement) from every chunk, straight
+ * from the maps. Any output may be NULL: observations [count][height][width],
+ * actions, rewards, dones [count], events [count][3] (food, death, effects).
+ * Returns the rows written, 0 if there are none. */
+SNEK_API int32_t snek_trajectories_sample(SnekTrajectories* trajectories, int32_t count, uint64_t seed,
+                                          uint8_t* observations, uint8_t* actions, float* rewards,
+                                          uint8_t* dones, uint8_t* events);
+
+/* Writes every counter and latency histogram this library has recorded
+ * (ticks, episodes, deaths by cause, spawn retries, step times) to path in
+ * Prometheus text format, via path.tmp and a rename. Returns 1 on success. */
+SNEK_API int32_t snek_metrics_export(const char* path);
+
+SNEK_API uint8_t* snek_batch_actions(SnekBatch* batch);        /* [num_envs] */
+SNEK_API uint8_t* snek_batch_observations(SnekBatch* batch);   /* [num_envs][height][width] */
+SNEK_API float* snek_batch_rewards(SnekBatch* batch);          /* [num_envs] */
+SNEK_API uint8_t* snek_batch_dones(SnekBatch* batch);          /* [num_envs] */
+SNEK_API int32_t* snek_batch_scores(SnekBatch* batch);         /* [num_envs], final score when done */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
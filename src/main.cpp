@@ -1,11 +1,274 @@
 #include "raylib.h"
+#include "board_camera.h"
 #include "game_state.h"
 #include "game_logic.h"
 #include "renderer.h"
 #include "game_types.h"
+#include "net_client.h"
+#include "score_store.h"
+#include "replay.h"
+#include "scenario.h"
+#include "metrics.h"
+#include "sim_thread.h"
+#include "sound_loader.h"
+#include "video_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <deque>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
 
-int main() {
+// Camera on the shared board: follows our snake, the mouse wheel zooms
+// around the pointer, right-drag pans and F goes back to following
+static void UpdateBoardCamera(BoardCamera& camera, const MultiSnakeState& state, int localSnake) {
+    camera.SetBoard(state.config.gridWidth + 2 * GameConstants::BORDER_OFFSET,
+                    state.config.gridHeight + 2 * GameConstants::BORDER_OFFSET);
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f) {
+        camera.Zoom(wheel, GetMousePosition());
+    }
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+        Vector2 delta = GetMouseDelta();
+        if (delta.x != 0.0f || delta.y != 0.0f) {
+            camera.Pan(delta);
+        }
+    }
+    if (IsKeyPressed(KEY_F)) {
+        camera.following = true;
+    }
+    if (localSnake >= 0 && localSnake < (int)state.snakes.size() && !state.snakes[localSnake].body.empty()) {
+        const Position& head = state.snakes[localSnake].body.front();
+        camera.Follow((float)(head.col + GameConstants::BORDER_OFFSET), (float)(head.row + GameConstants::BORDER_OFFSET));
+    }
+}
+
+// Networked play against snek_server: inputs are predicted locally and the
+// match is drawn from the client's predicted state
+static void RunNetworkClient(const std::string& address) {
+    std::string host = address;
+    uint16_t port = NetConstants::DEFAULT_PORT;
+    size_t colon = address.find_last_of(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = (uint16_t)std::atoi(address.c_str() + colon + 1);
+    }
+
+    NetClient client;
+    if (!client.Connect(host.c_str(), port)) {
+        return;
+    }
+    BoardCamera camera;
+    BoardLayerCache layers;
+
+    while (!WindowShouldClose()) {
+        if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_Q)) {
+            break;
+        }
+        if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
+            client.SendDirection({0, -1});
+        }
+        if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
+            client.SendDirection({0, 1});
+        }
+        if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A)) {
+            client.SendDirection({-1, 0});
+        }
+        if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D)) {
+            client.SendDirection({1, 0});
+        }
+
+        client.Update(GetFrameTime());
+
+        BeginDrawing();
+        if (client.HasState()) {
+            UpdateBoardCamera(camera, client.GetPredictedState(), client.GetSlot());
+            Renderer::DrawMultiSnakeGame(client.GetPredictedState(), client.GetSlot(), camera, layers);
+            std::string pingText = "Ping: " + std::to_string((int)client.GetStats().roundTripMs) + " ms";
+            DrawText(pingText.c_str(), 20, 20, 20, LIGHTGRAY);
+        } else {
+            ClearBackground(BLACK);
+            const char* status = client.IsRejected() ? "Server is full" : "Connecting...";
+            DrawText(status, 20, 20, 30, WHITE);
+        }
+        EndDrawing();
+    }
+
+    layers.Unload();
+    client.Disconnect();
+}
+
+// Keys pressed this frame, in the form replays record
+static uint8_t ReadFrameInput() {
+    uint8_t input = 0;
+    if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) input |= FrameInput::UP;
+    if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) input |= FrameInput::DOWN;
+    if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A)) input |= FrameInput::LEFT;
+    if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D)) input |= FrameInput::RIGHT;
+    if (IsKeyPressed(KEY_P)) input |= FrameInput::PAUSE;
+    if (IsKeyPressed(KEY_Q)) input |= FrameInput::QUIT;
+    return input;
+}
+
+// Keys pressed this frame for the simulation thread
+static SimInput ReadSimInput() {
+    SimInput input;
+    input.frame = ReadFrameInput();
+    if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) input.commands |= SimCommand::SELECT;
+    if (IsKeyPressed(KEY_R) || IsKeyPressed(KEY_SPACE)) input.commands |= SimCommand::RESTART;
+    if (IsKeyPressed(KEY_M)) input.commands |= SimCommand::MENU;
+    if (IsKeyPressed(KEY_TAB)) input.commands |= SimCommand::AUTOPILOT;
+    if (IsKeyDown(KEY_BACKSPACE)) input.commands |= SimCommand::REWIND;
+    input.pressed = std::chrono::steady_clock::now();
+    return input;
+}
+
+// Replay viewer: SPACE play/pause, LEFT/RIGHT step one frame while paused or
+// jump 5 seconds while playing, UP/DOWN change speed (1x-256x), HOME/END,
+// click or drag the bar to scrub. Only the latest state is drawn each frame.
+static void RunReplayViewer(const std::string& path) {
+    ReplayReader reader;
+    if (!reader.Open(path)) {
+        return;
+    }
+    const uint32_t jumpFrames = 300;
+    int speed = 1;
+    bool paused = false;
+    float pending = 0.0f;
+
+    while (!WindowShouldClose()) {
+        if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_Q)) {
+            break;
+        }
+        if (IsKeyPressed(KEY_SPACE)) {
+            paused = !paused;
+            pending = 0.0f;
+        }
+        if (IsKeyPressed(KEY_UP)) {
+            speed = std::min(speed * 2, ReplayConstants::MAX_SPEED);
+        }
+        if (IsKeyPressed(KEY_DOWN)) {
+            speed = std::max(speed / 2, ReplayConstants::MIN_SPEED);
+        }
+
+        uint32_t frame = reader.GetFrame();
+        uint32_t target = frame;
+        if (IsKeyPressed(KEY_RIGHT)) {
+            target = paused ? frame + 1 : frame + jumpFrames;
+        }
+        if (IsKeyPressed(KEY_LEFT)) {
+            uint32_t back = paused ? 1 : jumpFrames;
+            target = (frame > back) ? frame - back : 0;
+        }
+        if (IsKeyPressed(KEY_HOME)) {
+            target = 0;
+        }
+        if (IsKeyPressed(KEY_END)) {
+            target = reader.GetFrameCount();
+        }
+        Rectangle bar = Renderer::GetReplayBarBounds();
+        Vector2 mouse = GetMousePosition();
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mouse, bar)) {
+            target = (uint32_t)((mouse.x - bar.x) / bar.width * reader.GetFrameCount());
+        }
+        if (target != frame) {
+            reader.Seek(target);
+            pending = 0.0f;
+        } else if (!paused) {
+            // Run every recorded frame that fits in this display frame at the
+            // current speed, then draw once
+            pending += GetFrameTime() * speed;
+            float delta = reader.GetNextFrameDelta();
+            while (delta > 0.0f && pending >= delta) {
+                pending -= delta;
+                reader.StepForward();
+                delta = reader.GetNextFrameDelta();
+            }
+            if (delta <= 0.0f) {
+                pending = 0.0f;
+            }
+        }
+
+        const GameState& state = reader.GetState();
+        BeginDrawing();
+        Renderer::DrawGame(state);
+        if (state.isUserPaused && !state.gameOver) {
+            Renderer::DrawPauseScreen(state);
+        }
+        if (state.isResuming && !state.gameOver) {
+            Renderer::DrawResumeCountdown(state);
+        }
+        Renderer::DrawReplayOverlay(reader.GetFrame(), reader.GetFrameCount(), speed, paused);
+        EndDrawing();
+    }
+}
+
+// Time to first frame is what the player waits on; the sounds arrive a
+// few frames later while the mode menu is already up
+static void ReportStartup(double firstFrameSeconds, double loadedSeconds, const SoundLoadStats& stats) {
+    std::printf("Startup: first frame after %.0f ms, fully loaded after %.0f ms "
+                "(audio device %.0f ms, %d sounds decoded in %.0f ms of work, %d missing)\n",
+                firstFrameSeconds * 1000.0, loadedSeconds * 1000.0, stats.audioSeconds * 1000.0, stats.loaded,
+                stats.decodeSeconds * 1000.0, stats.failed);
+}
+
+int main(int argc, char** argv) {
+    auto launched = std::chrono::steady_clock::now();
+    // --connect host[:port] plays on a snek_server instead of locally,
+    // --record DIR saves a replay of every game, --replay FILE opens the viewer,
+    // --rules FILE adds a custom mode to the menu, --metrics FILE exports
+    // Prometheus metrics every few seconds, --video PATH records gameplay
+    // (a .y4m file, or otherwise a directory of PNG frames), --scenario FILE
+    // starts from a saved position (R starts it over)
+    std::string connectAddress;
+    std::string metricsPath;
+    std::string recordDirectory;
+    std::string replayPath;
+    std::string rulesPath;
+    std::string scenarioPath;
+    std::string videoPath;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--connect") == 0) {
+            connectAddress = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--record") == 0) {
+            recordDirectory = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--replay") == 0) {
+            replayPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--rules") == 0) {
+            rulesPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--metrics") == 0) {
+            metricsPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--scenario") == 0) {
+            scenarioPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--video") == 0) {
+            videoPath = argv[i + 1];
+        }
+    }
+    
+    GameRules customRules;
+    if (!rulesPath.empty()) {
+        std::string error;
+        if (!GameRules::Load(rulesPath, customRules, error)) {
+            std::fprintf(stderr, "Failed to load rules: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    MetricsExporter exporter;
+    if (!metricsPath.empty() && !exporter.Start(metricsPath, MetricsConstants::DEFAULT_EXPORT_INTERVAL)) {
+        std::fprintf(stderr, "Could not write metrics to %s\n", metricsPath.c_str());
+        return 1;
+    }
+
+    // The audio device and sound decoding start on their own threads and
+    // run while the window opens
+    SoundLoader sounds;
+    #ifndef PLATFORM_WEB
+    sounds.Start();
+    #endif
+    
     // Initialize window first (required for web)
     InitWindow(GameConstants::SCREEN_WIDTH, GameConstants::SCREEN_HEIGHT, "Snake Game");
     
@@ -13,178 +276,126 @@ int main() {
     // GL context initialization is handled by gl_init_post.js
     // Just poll events to let GLFW finish setup
     PollInputEvents();
-    #endif
     
-    // Initialize audio after window
-    InitAudioDevice();
+    // No threads on web: initialize audio after window, all at once
+    sounds.Start();
+    #endif
     SetTargetFPS(60);
     
+    if (!connectAddress.empty() || !replayPath.empty()) {
+        if (!replayPath.empty()) {
+            RunReplayViewer(replayPath);
+        } else {
+            RunNetworkClient(connectAddress);
+        }
+        sounds.Wait();
+        CloseAudioDevice();
+        CloseWindow();
+        return 0;
+    }
+    
     // Initialize game state
     GameState state;
     state.Initialize();
+    state.customRules = customRules;
+    int modeCount = rulesPath.empty() ? 2 : 3;
+    if (!scenarioPath.empty()) {
+        // Straight into play, past the menu and instructions
+        std::string error;
+        if (!Scenario::Load(scenarioPath, state, error)) {
+            std::fprintf(stderr, "Failed to load scenario: %s\n", error.c_str());
+            sounds.Wait();
+            state.Cleanup();
+            CloseAudioDevice();
+            CloseWindow();
+            return 1;
+        }
+    }
+    
+    // Results persist across runs; the game still plays if the store can't open
+    ScoreStore scores;
+    scores.Open("scores");
+    state.highScoreRegular = scores.GetBestScore(MODE_REGULAR);
+    state.highScoreAccelerated = scores.GetBestScore(MODE_ACCELERATED);
+    
+    // The game runs on its own thread from here; this one reads keys and
+    // draws the newest snapshot
+    SimConfig simConfig;
+    simConfig.recordDirectory = recordDirectory;
+    simConfig.scenarioPath = scenarioPath;
+    simConfig.modeCount = modeCount;
+    SimThread sim(state, simConfig, &sounds);
+    sim.Start();
+    bool rewindSent = false;
     
-    // Main game loop
+    // One captured frame per tick; encoding happens on the capture's own threads
+    VideoCapture video;
+    uint32_t capturedMove = UINT32_MAX;
+    
+    // Main render loop
+    double firstFrameSeconds = -1.0;
+    bool drewFrame = false;
+    bool startupReported = false;
     while (!WindowShouldClose()) {
+        // Sounds arrive on the simulation thread as they finish decoding;
+        // until then playing one does nothing
+        if (drewFrame && firstFrameSeconds < 0.0) {
+            firstFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - launched).count();
+        }
+        drewFrame = true;
+        if (firstFrameSeconds >= 0.0 && !startupReported && sounds.IsDone()) {
+            ReportStartup(firstFrameSeconds,
+                          std::chrono::duration<double>(std::chrono::steady_clock::now() - launched).count(),
+                          sounds.GetStats());
+            startupReported = true;
+        }
+        
         // Handle ESC (always exits)
         if (IsKeyPressed(KEY_ESCAPE)) {
             break;
         }
         
-        // Handle mode selection screen
+        // Keys go to the simulation when there are any, and whenever
+        // BACKSPACE is pressed or let go
+        SimInput input = ReadSimInput();
+        bool rewindHeld = (input.commands & SimCommand::REWIND) != 0;
+        if ((input.frame || (input.commands & ~SimCommand::REWIND) || rewindHeld != rewindSent) && sim.Post(input)) {
+            rewindSent = rewindHeld;
+        }
+        #ifdef PLATFORM_WEB
+        sim.RunDueTicks();
+        #endif
+        
+        float frameTime = GetFrameTime();
+        Metrics::RecordSeconds(METRIC_FRAME_TIME, frameTime);
+        Metrics::RecordSeconds(METRIC_FRAME_JITTER, std::fabs(frameTime - 1.0f / 60.0f));
+        const SimSnapshot& snapshot = sim.Latest();
+        const GameState& state = snapshot.state;
+        
+        // Finished games, each once, as the simulation settles them
+        GameResult result;
+        while (sim.PopResult(result)) {
+            scores.Append(result);
+        }
+        
         if (state.showModeSelection) {
-            if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
-                state.selectedModeIndex = 0;
-            }
-            if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
-                state.selectedModeIndex = 1;
-            }
-            if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) {
-                state.gameMode = (state.selectedModeIndex == 0) ? MODE_REGULAR : MODE_ACCELERATED;
-                state.showModeSelection = false;
-                state.showInstructions = true;
-                
-                // Initialize apples based on game mode
-                state.apples.clear();
-                if (state.gameMode == MODE_ACCELERATED) {
-                    for (int i = 0; i < 3; i++) {
-                        state.SpawnApple(0.0f);
-                    }
-                } else {
-                    state.SpawnApple(0.0f);
-                }
-            }
-            
             BeginDrawing();
             Renderer::DrawModeSelectionScreen(state);
             EndDrawing();
             continue;
         }
         
-        // Handle instructions screen
         if (state.showInstructions) {
-            if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) {
-                state.showInstructions = false;
-                state.gameTime = 0.0f;
-            }
-            
             BeginDrawing();
             Renderer::DrawInstructionsScreen();
             EndDrawing();
             continue;
         }
         
-        float deltaTime = GetFrameTime();
-        
-        // Update game time
-        if (!state.isUserPaused && !state.isResuming) {
-            state.gameTime += deltaTime;
-        }
-        
-        // Update status effects and apple despawn
-        if (!state.isUserPaused && !state.isResuming) {
-            state.UpdateStatusEffects(deltaTime);
-        }
-        state.UpdateAppleDespawn(deltaTime);
-        
-        // Handle input
-        if (IsKeyPressed(KEY_Q)) {
-            if (!state.gameOver) {
-                state.gameOver = true;
-            } else {
-                break;
-            }
-        }
-        
-        if (!state.gameOver && IsKeyPressed(KEY_P)) {
-            if (state.isUserPaused) {
-                state.isResuming = true;
-                state.resumeDelayTimer = GameConstants::RESUME_DELAY_DURATION;
-                state.pauseSoundTimer = 1.0f;
-                state.isUserPaused = false;
-            } else if (!state.isResuming) {
-                state.isUserPaused = true;
-            }
-        }
-        
-        // Handle game over restart and menu
-        if (state.gameOver) {
-            if (IsKeyPressed(KEY_R) || IsKeyPressed(KEY_SPACE)) {
-                state.Reset();
-            }
-            if (IsKeyPressed(KEY_M)) {
-                // Return to mode selection menu
-                state.gameOver = false;
-                state.showModeSelection = true;
-                state.showInstructions = false;
-                state.score = 0;
-                // Reset game state but keep high scores
-                state.snake.clear();
-                state.apples.clear();
-                state.dx = 0;
-                state.dy = 0;
-                state.directionQueue.clear();
-                state.moveTimer = 0.0f;
-                state.gameTime = 0.0f;
-                state.canIntersectSelf = false;
-                state.immunityTimer = 0.0f;
-                state.canPassWalls = false;
-                state.wallImmunityTimer = 0.0f;
-                state.cannotEatApples = false;
-                state.cannotEatTimer = 0.0f;
-                state.isPaused = false;
-                state.pauseTimer = 0.0f;
-                state.isUserPaused = false;
-                state.isResuming = false;
-                state.resumeDelayTimer = 0.0f;
-                state.poisonSoundTimer = 0.0f;
-                state.pauseSoundTimer = 0.0f;
-                state.gameOverSoundPlayed = false;
-            }
-        }
-        
-        // Handle movement input
-        if (!state.gameOver && !state.isUserPaused && !state.isResuming) {
-            if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
-                Direction newDir = {0, -1};
-                if (((state.dx == 0 && state.dy == 0) || state.dy != 1) && 
-                    (state.directionQueue.empty() || 
-                     state.directionQueue.back().dx != newDir.dx || 
-                     state.directionQueue.back().dy != newDir.dy)) {
-                    state.directionQueue.push_back(newDir);
-                }
-            }
-            if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
-                Direction newDir = {0, 1};
-                if (((state.dx == 0 && state.dy == 0) || state.dy != -1) && 
-                    (state.directionQueue.empty() || 
-                     state.directionQueue.back().dx != newDir.dx || 
-                     state.directionQueue.back().dy != newDir.dy)) {
-                    state.directionQueue.push_back(newDir);
-                }
-            }
-            if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A)) {
-                Direction newDir = {-1, 0};
-                if (((state.dx == 0 && state.dy == 0) || state.dx != 1) && 
-                    (state.directionQueue.empty() || 
-                     state.directionQueue.back().dx != newDir.dx || 
-                     state.directionQueue.back().dy != newDir.dy)) {
-                    state.directionQueue.push_back(newDir);
-                }
-            }
-            if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D)) {
-                Direction newDir = {1, 0};
-                if (((state.dx == 0 && state.dy == 0) || state.dx != -1) && 
-                    (state.directionQueue.empty() || 
-                     state.directionQueue.back().dx != newDir.dx || 
-                     state.directionQueue.back().dy != newDir.dy)) {
-                    state.directionQueue.push_back(newDir);
-                }
-            }
+        if (state.gameOver && IsKeyPressed(KEY_Q)) {
+            break;
         }
         
-        // Process game logic
-        GameLogic::ProcessMovement(state, deltaTime);
-        
         // Draw everything
         BeginDrawing();
         Renderer::DrawGame(state);
@@ -198,14 +409,42 @@ int main() {
         }
         
         if (state.gameOver) {
-            Renderer::DrawGameOverScreen(state);
+            Renderer::DrawGameOverScreen(state, scores);
+        }
+        
+        if (snapshot.rewinding) {
+            Renderer::DrawRewindIndicator();
+        } else if (snapshot.autopilot && !state.gameOver) {
+            Renderer::DrawAutopilotIndicator(state.gameMode != MODE_CUSTOM);
+        }
+        
+        if (!videoPath.empty() && state.moveCount != capturedMove) {
+            if (!video.IsRecording() &&
+                !video.Start(videoPath, (int)std::lround(1.0f / state.GetRules().moveInterval))) {
+                std::fprintf(stderr, "Could not record video to %s\n", videoPath.c_str());
+                videoPath.clear();
+            }
+            video.Capture();
+            capturedMove = state.moveCount;
         }
         
         EndDrawing();
     }
     
-    // Cleanup
-    state.Cleanup();
+    // Cleanup; quitting settles the game being played
+    sim.Stop();
+    GameResult result;
+    while (sim.PopResult(result)) {
+        scores.Append(result);
+    }
+    if (video.IsRecording()) {
+        video.Stop();
+        CaptureStats captured = video.GetStats();
+        std::printf("Video: %llu frames written, %llu dropped\n",
+                    (unsigned long long)captured.written, (unsigned long long)captured.dropped);
+    }
+    sounds.Wait();
+    sim.GetState().Cleanup();
     CloseAudioDevice();
     CloseWindow();
     
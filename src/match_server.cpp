@@ -0,0 +1,344 @@
+#include "match_server.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+bool MatchServer::Start(const MatchServerConfig& newConfig) {
+    config = newConfig;
+    if (!socket.Open(config.port, config.loopbackOnly)) {
+        return false;
+    }
+    if (!config.resultsDirectory.empty() && !results.Open(config.resultsDirectory)) {
+        socket.Close();
+        return false;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    stats = MatchServerStats();
+    recvBuffer.resize(NetConstants::MAX_PACKET_SIZE);
+    sendBuffer.reserve(NetConstants::MAX_PACKET_SIZE);
+
+    matches.clear();
+    matches.resize(std::max(1, config.numMatches));
+    for (size_t i = 0; i < matches.size(); i++) {
+        Match& match = matches[i];
+        MultiSnakeConfig matchConfig = config.match;
+        matchConfig.numBots = matchConfig.numSnakes;
+        matchConfig.seed = config.match.seed + i * 1000003ull;
+        match.nextSeed = matchConfig.seed + 1;
+        match.state.Reset(matchConfig);
+        match.slots.resize(match.state.snakes.size());
+    }
+
+    tickInterval = (config.tickInterval > 0.0f) ? config.tickInterval : matches[0].state.GetMoveInterval();
+    return true;
+}
+
+double MatchServer::Now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void MatchServer::Run() {
+    running = true;
+    double nextTick = Now() + tickInterval;
+    double nextReport = Now() + config.reportInterval;
+    MatchServerStats lastReport = stats;
+
+    while (running) {
+        double now = Now();
+        if (config.reportInterval > 0.0f && now >= nextReport) {
+            PrintReport(lastReport, config.reportInterval);
+            lastReport = stats;
+            nextReport = now + config.reportInterval;
+        }
+        if (now < nextTick) {
+            int waitMs = (int)std::ceil((nextTick - now) * 1000.0);
+            if (socket.WaitReadable(std::min(waitMs, 50))) {
+                PollNetwork();
+            }
+            continue;
+        }
+
+        RunTick();
+
+        // Don't try to catch up after a long stall, just resume the cadence
+        nextTick += tickInterval;
+        if (Now() - nextTick > tickInterval) {
+            stats.lateTicks++;
+            nextTick = Now() + tickInterval;
+        }
+    }
+}
+
+void MatchServer::PrintReport(const MatchServerStats& since, double seconds) const {
+    std::printf("ticks %llu, busy %.1f%%, in %llu pkts, out %llu pkts (%.1f KB/s), late %llu\n",
+                (unsigned long long)(stats.ticks - since.ticks),
+                100.0 * (stats.busySeconds - since.busySeconds) / seconds,
+                (unsigned long long)(stats.packetsIn - since.packetsIn),
+                (unsigned long long)(stats.packetsOut - since.packetsOut),
+                (stats.bytesOut - since.bytesOut) / seconds / 1024.0,
+                (unsigned long long)(stats.lateTicks - since.lateTicks));
+    std::fflush(stdout);
+}
+
+void MatchServer::PollNetwork() {
+    double start = Now();
+    NetAddress from;
+    int received;
+    // Bounded so a flood can't starve the tick
+    for (int i = 0; i < MAX_PACKETS_PER_POLL; i++) {
+        received = socket.Receive(from, recvBuffer.data(), recvBuffer.size());
+        if (received <= 0) {
+            break;
+        }
+        stats.packetsIn++;
+        const uint8_t* data = recvBuffer.data();
+        switch (NetProtocol::PeekType(data, received)) {
+            case PACKET_JOIN: HandleJoin(from, data, received); break;
+            case PACKET_INPUT: HandleInput(from, data, received); break;
+            case PACKET_LEAVE: HandleLeave(from, data, received); break;
+            default: break;
+        }
+    }
+    stats.busySeconds += Now() - start;
+}
+
+void MatchServer::RecordResults(const Match& match) {
+    if (!results.IsOpen()) {
+        return;
+    }
+    const MultiSnakeState& state = match.state;
+    GameResult result;
+    result.mode = state.config.gameMode;
+    result.seed = state.config.seed;
+    result.timestampMs = ScoreStore::NowMs();
+    for (size_t i = 0; i < state.snakes.size(); i++) {
+        const SnakeEntity& snake = state.snakes[i];
+        result.score = snake.score;
+        result.length = (int)snake.body.size();
+        result.ticks = (uint32_t)(snake.alive ? state.tick : snake.deathTick);
+        result.isBot = !match.slots[i].connected;
+        result.playerId = result.isBot ? ScoreStoreConstants::BOT_PLAYER_ID_BASE + (uint32_t)i
+                                       : match.slots[i].nonce;
+        results.Append(result);
+    }
+}
+
+void MatchServer::RunTick() {
+    PollNetwork();
+
+    double start = Now();
+    for (auto& match : matches) {
+        MultiSnakeState& state = match.state;
+
+        // Drop clients that went silent and let a bot take over
+        for (size_t i = 0; i < match.slots.size(); i++) {
+            ClientSlot& slot = match.slots[i];
+            if (slot.connected && start - slot.lastHeard > NetConstants::CLIENT_TIMEOUT) {
+                slot.connected = false;
+                slot.pending.clear();
+                state.snakes[i].isBot = true;
+            }
+        }
+
+        if (state.gameOver) {
+            match.restartTimer += tickInterval;
+            if (match.restartTimer >= config.restartDelay) {
+                MultiSnakeConfig matchConfig = state.config;
+                matchConfig.seed = match.nextSeed++;
+                state.Reset(matchConfig);
+                for (size_t i = 0; i < match.slots.size(); i++) {
+                    state.snakes[i].isBot = !match.slots[i].connected;
+                }
+                match.restartTimer = 0.0f;
+            }
+        } else {
+            ApplyInputs(match);
+            // One full move interval per tick, whatever the wall-clock rate
+            MultiSnakeLogic::Update(state, state.GetMoveInterval());
+            if (state.gameOver) {
+                RecordResults(match);
+            }
+        }
+
+        Broadcast(match);
+    }
+    stats.ticks++;
+    stats.busySeconds += Now() - start;
+    Metrics::RecordSeconds(METRIC_TICK_TIME, Now() - start);
+}
+
+void MatchServer::ApplyInputs(Match& match) {
+    MultiSnakeState& state = match.state;
+    uint32_t nextTick = (uint32_t)state.tick + 1;
+    for (size_t i = 0; i < match.slots.size(); i++) {
+        ClientSlot& slot = match.slots[i];
+        if (!slot.connected || slot.pending.empty()) {
+            continue;
+        }
+
+        // Inputs due this tick (or late) apply now; early ones wait their turn
+        // unless they are too far ahead to be anything but a stale clock
+        size_t applied = 0;
+        while (applied < slot.pending.size() &&
+               (slot.pending[applied].targetTick <= nextTick ||
+                slot.pending[applied].targetTick > nextTick + NetConstants::MAX_PREDICTION_TICKS)) {
+            const InputCommand& input = slot.pending[applied];
+            MultiSnakeLogic::QueueDirection(state.snakes[i], {input.dx, input.dy});
+            slot.lastSeq = input.seq;
+            applied++;
+        }
+        slot.pending.erase(slot.pending.begin(), slot.pending.begin() + applied);
+        if (applied > 0) {
+            // The move that takes them runs right after this
+            Metrics::RecordSeconds(METRIC_INPUT_LATENCY, Now() - slot.lastInputArrival);
+        }
+    }
+}
+
+void MatchServer::Broadcast(Match& match) {
+    bool anyConnected = false;
+    for (const auto& slot : match.slots) {
+        anyConnected = anyConnected || slot.connected;
+    }
+    if (!anyConnected) {
+        return;
+    }
+
+    NetProtocol::WriteSnapshot(sendBuffer, match.state);
+    if (sendBuffer.size() > NetConstants::MAX_PACKET_SIZE) {
+        // Too big for one datagram; these boards need a delta stream instead
+        return;
+    }
+
+    double now = Now();
+    for (const auto& slot : match.slots) {
+        if (!slot.connected) {
+            continue;
+        }
+        SnapshotHeader header;
+        header.ackSeq = slot.lastSeq;
+        header.echoTimeMs = slot.lastClientTimeMs;
+        header.holdMs = (uint16_t)std::min(65535.0, (now - slot.lastInputArrival) * 1000.0);
+        NetProtocol::PatchSnapshotHeader(sendBuffer, header);
+        Send(slot.address, sendBuffer);
+    }
+}
+
+void MatchServer::Send(const NetAddress& to, const std::vector<uint8_t>& packet) {
+    if (socket.Send(to, packet.data(), packet.size())) {
+        stats.packetsOut++;
+        stats.bytesOut += packet.size();
+    }
+}
+
+void MatchServer::HandleJoin(const NetAddress& from, const uint8_t* data, size_t size) {
+    uint16_t matchId;
+    uint32_t nonce;
+    if (!NetProtocol::ReadJoin(data, size, matchId, nonce)) {
+        return;
+    }
+
+    std::vector<uint8_t> reply;
+    for (size_t m = 0; m < matches.size(); m++) {
+        if (matchId != NetConstants::ANY_MATCH && matchId != m) {
+            continue;
+        }
+        Match& match = matches[m];
+
+        // A repeated JOIN (lost WELCOME) gets the same slot back
+        int freeSlot = -1;
+        for (size_t i = 0; i < match.slots.size(); i++) {
+            ClientSlot& slot = match.slots[i];
+            if (slot.connected && slot.address == from && slot.nonce == nonce) {
+                freeSlot = (int)i;
+                break;
+            }
+            if (!slot.connected && freeSlot < 0) {
+                freeSlot = (int)i;
+            }
+        }
+        if (freeSlot < 0) {
+            continue;
+        }
+
+        ClientSlot& slot = match.slots[freeSlot];
+        if (!slot.connected) {
+            slot = ClientSlot();
+            slot.connected = true;
+            slot.address = from;
+            slot.nonce = nonce;
+            match.state.snakes[freeSlot].isBot = false;
+            match.state.snakes[freeSlot].directionQueue.clear();
+        }
+        slot.lastHeard = Now();
+
+        WelcomeMessage welcome;
+        welcome.matchId = (uint16_t)m;
+        welcome.slot = (uint8_t)freeSlot;
+        welcome.nonce = nonce;
+        welcome.tick = (uint32_t)match.state.tick;
+        welcome.tickInterval = tickInterval;
+        NetProtocol::WriteWelcome(reply, welcome);
+        Send(from, reply);
+        return;
+    }
+
+    NetProtocol::WriteReject(reply, nonce);
+    Send(from, reply);
+}
+
+void MatchServer::HandleInput(const NetAddress& from, const uint8_t* data, size_t size) {
+    InputMessage input;
+    if (!NetProtocol::ReadInput(data, size, input) || input.matchId >= matches.size()) {
+        return;
+    }
+    Match& match = matches[input.matchId];
+    if (input.slot >= match.slots.size()) {
+        return;
+    }
+    ClientSlot& slot = match.slots[input.slot];
+    if (!slot.connected || slot.address != from) {
+        return;
+    }
+
+    double now = Now();
+    slot.lastHeard = now;
+    if (input.clientTimeMs >= slot.lastClientTimeMs) {
+        slot.lastClientTimeMs = input.clientTimeMs;
+        slot.lastInputArrival = now;
+    }
+
+    // Redundant copies of inputs we already have are dropped by seq
+    for (int i = 0; i < input.count; i++) {
+        const InputCommand& command = input.inputs[i];
+        if (command.seq <= slot.lastSeq) {
+            continue;
+        }
+        auto it = std::lower_bound(slot.pending.begin(), slot.pending.end(), command.seq,
+            [](const InputCommand& a, uint32_t seq) { return a.seq < seq; });
+        if (it == slot.pending.end() || it->seq != command.seq) {
+            slot.pending.insert(it, command);
+        }
+    }
+    if (slot.pending.size() > NetConstants::MAX_PENDING_INPUTS) {
+        slot.pending.erase(slot.pending.begin(),
+                           slot.pending.end() - NetConstants::MAX_PENDING_INPUTS);
+    }
+}
+
+void MatchServer::HandleLeave(const NetAddress& from, const uint8_t* data, size_t size) {
+    uint16_t matchId;
+    uint8_t slotIndex;
+    if (!NetProtocol::ReadLeave(data, size, matchId, slotIndex) || matchId >= matches.size()) {
+        return;
+    }
+    Match& match = matches[matchId];
+    if (slotIndex >= match.slots.size() || match.slots[slotIndex].address != from) {
+        return;
+    }
+    match.slots[slotIndex].connected = false;
+    match.slots[slotIndex].pending.clear();
+    match.state.snakes[slotIndex].isBot = true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "multi_snake.h"
+#include "net_protocol.h"
+#include "score_store.h"
+#include "udp_socket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MatchServerConfig {
+    uint16_t port = NetConstants::DEFAULT_PORT;
+    bool loopbackOnly = false;
+    int numMatches = 1;
+    MultiSnakeConfig match;       // every slot starts as a bot until a client joins
+    float tickInterval = 0.0f;    // wall-clock seconds per tick, 0 = the mode's move interval
+    float restartDelay = 3.0f;    // seconds between game over and the next round
+    float reportInterval = 0.0f;  // print load stats to stdout this often, 0 = never
+    std::string resultsDirectory; // ScoreStore for every snake's result, empty = off
+};
+
+struct MatchServerStats {
+    uint64_t ticks = 0;
+    uint64_t packetsIn = 0;
+    uint64_t packetsOut = 0;
+    uint64_t bytesOut = 0;
+    uint64_t lateTicks = 0;       // ticks that started more than one interval late
+    double busySeconds = 0.0;     // time spent handling packets and ticking
+};
+
+struct ClientSlot {
+    bool connected = false;
+    NetAddress address;
+    uint32_t nonce = 0;
+    uint32_t lastSeq = 0;
+    uint32_t lastClientTimeMs = 0;
+    double lastHeard = 0.0;
+    double lastInputArrival = 0.0;
+    std::vector<InputCommand> pending;   // sorted by seq
+};
+
+struct Match {
+    MultiSnakeState state;
+    std::vector<ClientSlot> slots;
+    uint64_t nextSeed = 0;
+    float restartTimer = 0.0f;
+};
+
+// Authoritative server: owns every match, ticks them at a fixed rate and
+// broadcasts full snapshots to connected clients after each tick.
+class MatchServer {
+public:
+    bool Start(const MatchServerConfig& newConfig);
+    // Blocks until Stop() is called from another thread
+    void Run();
+    void Stop() { running = false; }
+
+    // Single steps, for embedding the server in another loop
+    void PollNetwork();
+    void RunTick();
+
+    uint16_t GetPort() const { return socket.LocalPort(); }
+    float GetTickInterval() const { return tickInterval; }
+    const MatchServerStats& GetStats() const { return stats; }
+    const std::vector<Match>& GetMatches() const { return matches; }
+
+private:
+    double Now() const;
+    void HandleJoin(const NetAddress& from, const uint8_t* data, size_t size);
+    void HandleInput(const NetAddress& from, const uint8_t* data, size_t size);
+    void HandleLeave(const NetAddress& from, const uint8_t* data, size_t size);
+    void ApplyInputs(Match& match);
+    void Broadcast(Match& match);
+    void RecordResults(const Match& match);
+    void Send(const NetAddress& to, const std::vector<uint8_t>& packet);
+    void PrintReport(const MatchServerStats& since, double seconds) const;
+
+    static const int MAX_PACKETS_PER_POLL = 16384;
+
+    MatchServerConfig config;
+    UdpSocket socket;
+    std::vector<Match> matches;
+    float tickInterval = 0.0f;
+    std::atomic<bool> running{false};
+    MatchServerStats stats;
+    std::chrono::steady_clock::time_point startTime;
+    std::vector<uint8_t> recvBuffer;
+    std::vector<uint8_t> sendBuffer;
+    ScoreStore results;
+};
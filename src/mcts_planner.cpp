@@ -0,0 +1,308 @@
+#include "mcts_planner.h"
+#include "metrics.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using PlannerConstants::ACTION_COUNT;
+using PlannerConstants::ACTIONS;
+using PlannerConstants::VALUE_SCALE;
+
+// Neither limit set would search forever
+static const uint32_t DEFAULT_ITERATIONS = 1000;
+// Threads look at the clock once per this many simulations
+static const uint32_t CLOCK_INTERVAL = 16;
+
+static bool IsReversal(const SnekGame& game, int action) {
+    return ACTIONS[action].dx == -game.dx && ACTIONS[action].dy == -game.dy && (game.dx || game.dy);
+}
+
+// Where the head would go; false if that's a wall or body the snake can't cross
+static bool IsSafe(const SnekGame& game, int action) {
+    Cell head = game.Segment(0);
+    int col = head.col + ACTIONS[action].dx;
+    int row = head.row + ACTIONS[action].dy;
+    if (col < 0 || col >= GameConstants::GRID_WIDTH || row < 0 || row >= GameConstants::GRID_HEIGHT) {
+        if (!game.canPassWalls) {
+            return false;
+        }
+        col = (col + GameConstants::GRID_WIDTH) % GameConstants::GRID_WIDTH;
+        row = (row + GameConstants::GRID_HEIGHT) % GameConstants::GRID_HEIGHT;
+    }
+    return game.canIntersectSelf || game.cellCount[SnekGame::CellIndex(col, row)] == 0;
+}
+
+static int AppleDistance(const SnekGame& game, int action) {
+    Cell head = game.Segment(0);
+    int col = head.col + ACTIONS[action].dx;
+    int row = head.row + ACTIONS[action].dy;
+    int best = 1 << 30;
+    for (int i = 0; i < game.appleCount; i++) {
+        const Apple& apple = game.apples[i];
+        if (apple.type != POISONOUS) {
+            int distance = std::abs(apple.col - col) + std::abs(apple.row - row);
+            best = (distance < best) ? distance : best;
+        }
+    }
+    return best;
+}
+
+// Simulation policy below the tree: a safe move, towards the nearest apple
+// half the time and at random otherwise
+static int RolloutAction(const SnekGame& game, Rng& rng) {
+    int safe[ACTION_COUNT];
+    int safeCount = 0;
+    int greedy = -1;
+    int greedyDistance = 1 << 30;
+    for (int a = 0; a < ACTION_COUNT; a++) {
+        if (IsReversal(game, a) || !IsSafe(game, a)) {
+            continue;
+        }
+        safe[safeCount++] = a;
+        int distance = AppleDistance(game, a);
+        if (distance < greedyDistance) {
+            greedyDistance = distance;
+            greedy = a;
+        }
+    }
+    if (safeCount == 0) {
+        return -1;
+    }
+    if (!game.cannotEatApples && (rng.NextU32() & 1)) {
+        return greedy;
+    }
+    return safe[rng.GetValue(0, safeCount - 1)];
+}
+
+MctsPlanner::MctsPlanner(const PlannerConfig& config)
+    : config(config), arena(new Node[config.arenaNodes > 1 ? config.arenaNodes : 2]),
+      arenaUsed(0), iterationsStarted(0), iterationsDone(0), maxDepth(0), stop(false) {
+    if (this->config.arenaNodes < 2) {
+        this->config.arenaNodes = 2;
+    }
+    SetBudget(config.iterations, config.timeBudget, config.threads);
+    for (size_t i = 0; i < this->config.arenaNodes; i++) {
+        arena[i].visits.store(0, std::memory_order_relaxed);
+        arena[i].valueSum.store(0, std::memory_order_relaxed);
+        for (int a = 0; a < ACTION_COUNT; a++) {
+            arena[i].children[a].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MctsPlanner::SetBudget(uint32_t iterations, float timeBudget, int threads) {
+    config.iterations = (iterations == 0 && timeBudget <= 0.0f) ? DEFAULT_ITERATIONS : iterations;
+    config.timeBudget = (timeBudget > 0.0f) ? timeBudget : 0.0f;
+    config.threads = (threads > 1) ? threads : 1;
+}
+
+uint32_t MctsPlanner::NewNode() {
+    uint32_t index = arenaUsed.fetch_add(1, std::memory_order_relaxed);
+    return (index < config.arenaNodes) ? index : 0;
+}
+
+int MctsPlanner::SelectAction(const Node& node, const SnekGame& game) const {
+    double parentVisits = (double)node.visits.load(std::memory_order_relaxed);
+    double logParent = std::log(parentVisits > 1.0 ? parentVisits : 1.0);
+    int best = -1;
+    double bestScore = -1e300;
+    for (int a = 0; a < ACTION_COUNT; a++) {
+        uint32_t child = node.children[a].load(std::memory_order_acquire);
+        if (child == 0 || IsReversal(game, a)) {
+            continue;
+        }
+        const Node& c = arena[child];
+        uint32_t visits = c.visits.load(std::memory_order_relaxed);
+        if (visits == 0) {
+            return a;
+        }
+        double mean = (double)c.valueSum.load(std::memory_order_relaxed) / VALUE_SCALE / visits;
+        double score = mean + config.exploration * std::sqrt(logParent / visits);
+        if (score > bestScore) {
+            bestScore = score;
+            best = a;
+        }
+    }
+    return best;
+}
+
+void MctsPlanner::Worker(const SnekGame& root, uint64_t seed) {
+    // Simulated games aren't played ones
+    MetricsMute mute;
+    Rng rng;
+    rng.Seed(seed);
+    const int64_t virtualLoss = (int64_t)(config.virtualLoss * VALUE_SCALE);
+    uint32_t path[256];
+    auto start = std::chrono::steady_clock::now();
+    uint32_t done = 0;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (config.iterations > 0 &&
+            iterationsStarted.fetch_add(1, std::memory_order_relaxed) >= config.iterations) {
+            break;
+        }
+        if (config.timeBudget > 0.0f && done % CLOCK_INTERVAL == 0 &&
+            std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >= config.timeBudget) {
+            stop.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        SnekGame game = root;
+        game.rng.Seed(((uint64_t)rng.NextU32() << 32) | rng.NextU32());
+        double reward = 0.0;
+        double weight = 1.0;
+        int moves = 0;
+        int depth = 0;
+
+        // Selection and expansion: walk the tree, charging virtual loss, and
+        // add at most one node
+        uint32_t current = 0;
+        path[depth++] = current;
+        arena[current].visits.fetch_add(1, std::memory_order_relaxed);
+        arena[current].valueSum.fetch_sub(virtualLoss, std::memory_order_relaxed);
+        bool expanded = false;
+        while (!game.gameOver && moves < config.horizon && depth < 256 && !expanded) {
+            Node& node = arena[current];
+            int action = -1;
+            for (int a = 0; a < ACTION_COUNT && action < 0; a++) {
+                if (!IsReversal(game, a) && node.children[a].load(std::memory_order_acquire) == 0) {
+                    action = a;
+                }
+            }
+            uint32_t next = 0;
+            if (action >= 0) {
+                uint32_t fresh = NewNode();
+                if (fresh != 0) {
+                    uint32_t expected = 0;
+                    // Losing the race wastes the fresh node; the winner's is used
+                    if (node.children[action].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+                        next = fresh;
+                        expanded = true;
+                    } else {
+                        next = expected;
+                    }
+                } else {
+                    action = -1;
+                }
+            }
+            if (action < 0) {
+                action = SelectAction(node, game);
+                if (action < 0) {
+                    break;
+                }
+                next = node.children[action].load(std::memory_order_acquire);
+            }
+
+            int32_t before = game.score;
+            SnekEngine::Step(game, &ACTIONS[action]);
+            moves++;
+            reward += weight * (game.score - before);
+            weight *= config.discount;
+
+            current = next;
+            path[depth++] = current;
+            arena[current].visits.fetch_add(1, std::memory_order_relaxed);
+            arena[current].valueSum.fetch_sub(virtualLoss, std::memory_order_relaxed);
+        }
+
+        // Rollout to the horizon
+        while (!game.gameOver && moves < config.horizon) {
+            int action = RolloutAction(game, rng);
+            int32_t before = game.score;
+            SnekEngine::Step(game, (action >= 0) ? &ACTIONS[action] : nullptr);
+            moves++;
+            reward += weight * (game.score - before);
+            weight *= config.discount;
+        }
+        if (game.gameOver) {
+            reward -= weight * config.deathPenalty;
+        }
+
+        // Backpropagation: give back the virtual loss along with the result
+        int64_t value = (int64_t)(reward * VALUE_SCALE) + virtualLoss;
+        for (int i = 0; i < depth; i++) {
+            arena[path[i]].valueSum.fetch_add(value, std::memory_order_relaxed);
+        }
+        int seen = maxDepth.load(std::memory_order_relaxed);
+        while (depth - 1 > seen && !maxDepth.compare_exchange_weak(seen, depth - 1, std::memory_order_relaxed)) {
+        }
+        iterationsDone.fetch_add(1, std::memory_order_relaxed);
+        done++;
+    }
+}
+
+bool MctsPlanner::Plan(const SnekGame& game, Direction& best) {
+    stats = PlannerStats();
+    if (game.gameOver) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // Clear what the last plan used; the rest of the arena is still zero
+    uint32_t used = arenaUsed.load(std::memory_order_relaxed);
+    if (used > config.arenaNodes) {
+        used = (uint32_t)config.arenaNodes;
+    }
+    for (uint32_t i = 0; i < used; i++) {
+        arena[i].visits.store(0, std::memory_order_relaxed);
+        arena[i].valueSum.store(0, std::memory_order_relaxed);
+        for (int a = 0; a < ACTION_COUNT; a++) {
+            arena[i].children[a].store(0, std::memory_order_relaxed);
+        }
+    }
+    arenaUsed.store(1, std::memory_order_relaxed);
+    iterationsStarted.store(0, std::memory_order_relaxed);
+    iterationsDone.store(0, std::memory_order_relaxed);
+    maxDepth.store(0, std::memory_order_relaxed);
+    stop.store(false, std::memory_order_relaxed);
+
+    uint64_t planSeed = config.seed + (uint64_t)planCount++ * 0x9E3779B97F4A7C15ull;
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < config.threads; t++) {
+        try {
+            helpers.emplace_back(&MctsPlanner::Worker, this, std::cref(game), planSeed + t);
+        } catch (const std::system_error&) {
+            break;      // search with the threads we got
+        }
+    }
+    Worker(game, planSeed);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    // Most visited move; the rollout policy if the tree never grew
+    const Node& root = arena[0];
+    int bestAction = -1;
+    uint32_t bestVisits = 0;
+    for (int a = 0; a < ACTION_COUNT; a++) {
+        uint32_t child = root.children[a].load(std::memory_order_relaxed);
+        uint32_t visits = (child != 0 && !IsReversal(game, a)) ? arena[child].visits.load(std::memory_order_relaxed) : 0;
+        stats.rootVisits[a] = visits;
+        if (visits > bestVisits) {
+            bestVisits = visits;
+            bestAction = a;
+        }
+    }
+    if (bestAction < 0) {
+        Rng rng;
+        rng.Seed(planSeed);
+        bestAction = RolloutAction(game, rng);
+    }
+    if (bestAction < 0) {
+        bestAction = 0;
+        while (IsReversal(game, bestAction)) {
+            bestAction++;
+        }
+    }
+    best = ACTIONS[bestAction];
+
+    used = arenaUsed.load(std::memory_order_relaxed);
+    stats.iterations = iterationsDone.load(std::memory_order_relaxed);
+    stats.nodes = (used < config.arenaNodes) ? used : (uint32_t)config.arenaNodes;
+    stats.maxDepth = maxDepth.load(std::memory_order_relaxed);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
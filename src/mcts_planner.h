@@ -0,0 +1,83 @@
+#pragma once
+
+#include "snek_engine.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace PlannerConstants {
+    // Up, down, left, right: the same order as SnekAction 1-4
+    const int ACTION_COUNT = 4;
+    const Direction ACTIONS[ACTION_COUNT] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    // Node values are summed as fixed point so they can be atomic integers
+    const int64_t VALUE_SCALE = 1 << 16;
+}
+
+struct PlannerConfig {
+    int threads = 1;
+    // Simulations and seconds per plan, 0 = no limit; whichever runs out
+    // first ends the search (with neither set, 1000 simulations)
+    uint32_t iterations = 0;
+    float timeBudget = 0.01f;
+    int horizon = 40;               // moves per simulation, tree and rollout together
+    float exploration = 1.0f;       // UCB constant
+    float deathPenalty = 2.0f;      // in apples
+    float discount = 0.97f;         // per move, so sooner apples count for more
+    float virtualLoss = 1.0f;       // charged to a node while a thread is below it
+    size_t arenaNodes = 1 << 18;    // tree stops growing when these run out
+    uint64_t seed = 1;
+};
+
+struct PlannerStats {
+    uint32_t iterations = 0;
+    uint32_t nodes = 0;
+    int maxDepth = 0;
+    double seconds = 0.0;
+    uint32_t rootVisits[PlannerConstants::ACTION_COUNT] = {};
+};
+
+// Monte Carlo tree search over SnekEngine games. Apples, spawn spots and
+// teleport targets are random, so the tree is open loop: a node is a
+// sequence of moves, and every simulation reseeds its copy of the game, so
+// the search plans against the odds rather than the game's own Rng stream.
+//
+// Threads share one tree. Nodes come from a preallocated arena (a bump
+// index) and are linked in with a compare-and-swap, so nothing locks.
+// Visits and value sums are atomics; a thread passing through a node adds a
+// visit and a virtual loss up front, which steers the other threads to
+// other branches until its result comes back. Simulations below the tree
+// play a quick policy: safe moves, leaning towards the nearest apple.
+class MctsPlanner {
+public:
+    explicit MctsPlanner(const PlannerConfig& config = PlannerConfig());
+
+    // Best direction for the next move; false when the game is over. Leaves
+    // `game` alone.
+    bool Plan(const SnekGame& game, Direction& best);
+    // Changes the limits for later plans; the tree arena stays
+    void SetBudget(uint32_t iterations, float timeBudget, int threads);
+    const PlannerStats& GetLastStats() const { return stats; }
+    const PlannerConfig& GetConfig() const { return config; }
+
+private:
+    struct Node {
+        std::atomic<uint32_t> visits;
+        std::atomic<int64_t> valueSum;
+        std::atomic<uint32_t> children[PlannerConstants::ACTION_COUNT];   // arena index, 0 = none
+    };
+
+    void Worker(const SnekGame& root, uint64_t seed);
+    uint32_t NewNode();
+    int SelectAction(const Node& node, const SnekGame& game) const;
+
+    PlannerConfig config;
+    std::unique_ptr<Node[]> arena;
+    std::atomic<uint32_t> arenaUsed;
+    std::atomic<uint32_t> iterationsStarted;
+    std::atomic<uint32_t> iterationsDone;
+    std::atomic<int> maxDepth;
+    std::atomic<bool> stop;
+    uint32_t planCount = 0;
+    PlannerStats stats;
+};
@@ -0,0 +1,286 @@
+#include "metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using MetricsConstants::BUCKETS;
+using MetricsConstants::MAX_BITS;
+using MetricsConstants::SUB_BITS;
+using MetricsConstants::SUB_BUCKETS;
+
+namespace {
+    // Every shard ever handed out, and the ones whose threads have finished.
+    // Never freed: threads can still be exiting during static destruction.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<MetricsShard>> shards;
+        std::vector<MetricsShard*> released;
+    };
+
+    Registry& GetRegistry() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // Muted threads write here; nobody reads it
+    MetricsShard& GetDiscardShard() {
+        static MetricsShard* discard = new MetricsShard();
+        return *discard;
+    }
+
+    void ClearShard(MetricsShard& shard) {
+        for (auto& counter : shard.counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& histogram : shard.buckets) {
+            for (auto& bucket : histogram) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto& sum : shard.sums) {
+            sum.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Hands the thread's shard back when the thread exits
+    struct ShardLease {
+        MetricsShard* shard = nullptr;
+        ~ShardLease() {
+            if (shard) {
+                Registry& registry = GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.released.push_back(shard);
+            }
+        }
+    };
+    thread_local ShardLease lease;
+
+    const char* const COUNTER_NAMES[] = {"ticks", "episodes", "spawn_retries", "dropped_moves"};
+    const char* const DEATH_CAUSES[] = {"wall", "self", "body", "head_to_head", "other"};
+    const char* const HISTOGRAM_NAMES[] = {"frame_seconds", "tick_seconds", "input_latency_seconds",
+                                           "tick_jitter_seconds", "frame_jitter_seconds"};
+    const char* const HISTOGRAM_HELP[] = {
+        "Time between displayed frames",
+        "Work per server tick or batch step",
+        "Key press or input packet to the move that applies it",
+        "How late a simulation thread tick started",
+        "Displayed frame interval away from the target rate",
+    };
+    // Exported bucket edges: powers of two from about a microsecond to a minute
+    const int EXPORT_MIN_BITS = 10;
+    const int EXPORT_MAX_BITS = 36;
+}
+
+int Metrics::GetBucket(uint64_t nanoseconds) {
+    if (nanoseconds < (uint64_t)SUB_BUCKETS) {
+        return (int)nanoseconds;
+    }
+    int bits = 63 - __builtin_clzll(nanoseconds);
+    if (bits >= MAX_BITS) {
+        return BUCKETS - 1;
+    }
+    int shift = bits - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + (int)((nanoseconds >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Metrics::GetBucketStart(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t mantissa = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS);
+    return mantissa << shift;
+}
+
+MetricsShard& Metrics::Attach() {
+    Registry& registry = GetRegistry();
+    MetricsShard* shard;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.released.empty()) {
+            shard = registry.released.back();
+            registry.released.pop_back();
+        } else {
+            registry.shards.emplace_back(new MetricsShard());
+            shard = registry.shards.back().get();
+            ClearShard(*shard);
+        }
+    }
+    lease.shard = shard;
+    threadShard = shard;
+    return *shard;
+}
+
+void Metrics::Collect(MetricsSnapshot& out) {
+    out = MetricsSnapshot();
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& shard : registry.shards) {
+        for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+            out.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+            for (int b = 0; b < BUCKETS; b++) {
+                out.buckets[h][b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+            }
+            out.sums[h] += shard->sums[h].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t MetricsSnapshot::GetCount(MetricHistogram histogram) const {
+    uint64_t count = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        count += buckets[histogram][b];
+    }
+    return count;
+}
+
+uint64_t MetricsSnapshot::GetPercentile(MetricHistogram histogram, double q) const {
+    uint64_t count = GetCount(histogram);
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (count - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += buckets[histogram][b];
+        if (seen > rank) {
+            return Metrics::GetBucketStart(b);
+        }
+    }
+    return Metrics::GetBucketStart(BUCKETS - 1);
+}
+
+std::string Metrics::FormatPrometheus(const MetricsSnapshot& snapshot, double ticksPerSecond, double episodesPerSecond) {
+    std::string out;
+    char line[256];
+    auto append = [&](const char* format, auto... args) {
+        std::snprintf(line, sizeof(line), format, args...);
+        out += line;
+    };
+
+    const char* const counterHelp[] = {
+        "Game frames, engine frames and match ticks",
+        "Games and matches that ended",
+        "Apple placements that hit an occupied cell",
+        "Moves dropped because a frame was too long to catch up on",
+    };
+    for (int c = METRIC_TICKS; c <= METRIC_DROPPED_MOVES; c++) {
+        append("# HELP snek_%s_total %s\n# TYPE snek_%s_total counter\nsnek_%s_total %llu\n",
+               COUNTER_NAMES[c], counterHelp[c], COUNTER_NAMES[c], COUNTER_NAMES[c],
+               (unsigned long long)snapshot.counters[c]);
+    }
+    append("# HELP snek_deaths_total Snakes that died, by cause\n# TYPE snek_deaths_total counter\n");
+    for (int c = METRIC_DEATHS_WALL; c <= METRIC_DEATHS_OTHER; c++) {
+        append("snek_deaths_total{cause=\"%s\"} %llu\n", DEATH_CAUSES[c - METRIC_DEATHS_WALL],
+               (unsigned long long)snapshot.counters[c]);
+    }
+    if (ticksPerSecond >= 0.0) {
+        append("# HELP snek_ticks_per_second Ticks per second over the last export interval\n"
+               "# TYPE snek_ticks_per_second gauge\nsnek_ticks_per_second %.3f\n", ticksPerSecond);
+    }
+    if (episodesPerSecond >= 0.0) {
+        append("# HELP snek_episodes_per_second Episodes per second over the last export interval\n"
+               "# TYPE snek_episodes_per_second gauge\nsnek_episodes_per_second %.3f\n", episodesPerSecond);
+    }
+
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        const char* name = HISTOGRAM_NAMES[h];
+        append("# HELP snek_%s %s\n# TYPE snek_%s histogram\n", name, HISTOGRAM_HELP[h], name);
+        // Powers of two are bucket edges, so these counts are exact
+        uint64_t cumulative = 0;
+        int bucket = 0;
+        for (int bits = EXPORT_MIN_BITS; bits <= EXPORT_MAX_BITS; bits++) {
+            int end = GetBucket(1ull << bits);
+            for (; bucket < end; bucket++) {
+                cumulative += snapshot.buckets[h][bucket];
+            }
+            append("snek_%s_bucket{le=\"%.9g\"} %llu\n", name, (double)(1ull << bits) * 1e-9,
+                   (unsigned long long)cumulative);
+        }
+        uint64_t count = snapshot.GetCount((MetricHistogram)h);
+        append("snek_%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+        append("snek_%s_sum %.9f\n", name, snapshot.sums[h] * 1e-9);
+        append("snek_%s_count %llu\n", name, (unsigned long long)count);
+    }
+    return out;
+}
+
+bool Metrics::WriteFile(const std::string& path, const std::string& text) {
+    std::string tempPath = path + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+MetricsMute::MetricsMute() : saved(Metrics::threadShard) {
+    Metrics::threadShard = &GetDiscardShard();
+}
+
+MetricsMute::~MetricsMute() {
+    Metrics::threadShard = saved;
+}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+bool MetricsExporter::Start(const std::string& newPath, float intervalSeconds) {
+    Stop();
+    path = newPath;
+    interval = (intervalSeconds > 0.0f) ? intervalSeconds : MetricsConstants::DEFAULT_EXPORT_INTERVAL;
+    last.reset(new MetricsSnapshot());
+    current.reset(new MetricsSnapshot());
+    Metrics::Collect(*last);
+    if (!Export(-1.0)) {
+        return false;
+    }
+    running = true;
+    thread = std::thread(&MetricsExporter::Run, this);
+    return true;
+}
+
+void MetricsExporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void MetricsExporter::Run() {
+    auto lastTime = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake.wait_for(lock, std::chrono::duration<float>(interval), [this]() { return !running; });
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastTime).count();
+        lastTime = now;
+        Export(seconds);
+    }
+}
+
+bool MetricsExporter::Export(double seconds) {
+    Metrics::Collect(*current);
+    double ticksPerSecond = -1.0;
+    double episodesPerSecond = -1.0;
+    if (seconds > 0.0) {
+        ticksPerSecond = (current->counters[METRIC_TICKS] - last->counters[METRIC_TICKS]) / seconds;
+        episodesPerSecond = (current->counters[METRIC_EPISODES] - last->counters[METRIC_EPISODES]) / seconds;
+    }
+    std::swap(last, current);
+    return Metrics::WriteFile(path, Metrics::FormatPrometheus(*last, ticksPerSecond, episodesPerSecond));
+}
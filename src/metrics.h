@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum MetricCounter {
+    METRIC_TICKS,               // game frames, engine frames and match ticks
+    METRIC_EPISODES,            // games and matches that ended
+    METRIC_SPAWN_RETRIES,       // apple placements that hit an occupied cell
+    METRIC_DROPPED_MOVES,       // moves past MAX_MOVES_PER_FRAME in one frame
+    METRIC_DEATHS_WALL,
+    METRIC_DEATHS_SELF,
+    METRIC_DEATHS_BODY,         // into another snake
+    METRIC_DEATHS_HEAD_TO_HEAD,
+    METRIC_DEATHS_OTHER,        // quit, failed teleport, full body ring
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricHistogram {
+    METRIC_FRAME_TIME,          // displayed frame to displayed frame
+    METRIC_TICK_TIME,           // work per server tick or batch step
+    METRIC_INPUT_LATENCY,       // key press or input packet to the move that applies it
+    METRIC_TICK_JITTER,         // how late a simulation thread tick started
+    METRIC_FRAME_JITTER,        // displayed frame interval away from the target rate
+    METRIC_HISTOGRAM_COUNT
+};
+
+namespace MetricsConstants {
+    // HDR-style buckets over nanoseconds: values below 2^SUB_BITS get a
+    // bucket each, and every power of two above splits into 2^SUB_BITS
+    // buckets, so a bucket is within about 3% of its values
+    const int SUB_BITS = 5;
+    const int SUB_BUCKETS = 1 << SUB_BITS;
+    const int MAX_BITS = 40;    // about 18 minutes; longer values land in the last bucket
+    const int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+    const float DEFAULT_EXPORT_INTERVAL = 5.0f;
+}
+
+// One thread's metrics. Only the owning thread writes, so an update is a
+// relaxed load and store rather than a locked read-modify-write; readers
+// sum the shards and never see a torn value.
+struct MetricsShard {
+    std::atomic<uint64_t> counters[METRIC_COUNTER_COUNT];
+    std::atomic<uint64_t> buckets[METRIC_HISTOGRAM_COUNT][MetricsConstants::BUCKETS];
+    std::atomic<uint64_t> sums[METRIC_HISTOGRAM_COUNT];
+};
+
+struct MetricsSnapshot {
+    uint64_t counters[METRIC_COUNTER_COUNT] = {};
+    uint64_t buckets[METRIC_HISTOGRAM_COUNT][MetricsConstants::BUCKETS] = {};
+    uint64_t sums[METRIC_HISTOGRAM_COUNT] = {};     // nanoseconds
+
+    uint64_t GetCount(MetricHistogram histogram) const;
+    // Lower edge of the bucket holding quantile q (0-1), in nanoseconds
+    uint64_t GetPercentile(MetricHistogram histogram, double q) const;
+};
+
+// Process-wide counters and latency histograms. Each thread records into
+// its own shard, found through a thread-local pointer; shards outlive their
+// threads (a new thread takes over a finished one's), so totals only grow.
+class Metrics {
+public:
+    static void Add(MetricCounter counter, uint64_t n = 1) {
+        std::atomic<uint64_t>& value = GetShard().counters[counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void Record(MetricHistogram histogram, uint64_t nanoseconds) {
+        MetricsShard& shard = GetShard();
+        std::atomic<uint64_t>& bucket = shard.buckets[histogram][GetBucket(nanoseconds)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic<uint64_t>& sum = shard.sums[histogram];
+        sum.store(sum.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    }
+
+    static void RecordSeconds(MetricHistogram histogram, double seconds) {
+        Record(histogram, (seconds > 0.0) ? (uint64_t)(seconds * 1e9) : 0);
+    }
+
+    static int GetBucket(uint64_t nanoseconds);
+    static uint64_t GetBucketStart(int bucket);
+
+    // Sums every shard, including those of threads that have exited
+    static void Collect(MetricsSnapshot& out);
+    // Prometheus text format. The rates are gauges over the exporter's last
+    // interval; pass negative values to leave them out.
+    static std::string FormatPrometheus(const MetricsSnapshot& snapshot, double ticksPerSecond, double episodesPerSecond);
+    // One snapshot to path.tmp, then renamed over path
+    static bool WriteFile(const std::string& path, const std::string& text);
+
+private:
+    friend class MetricsMute;
+
+    static MetricsShard& GetShard() {
+        MetricsShard* shard = threadShard;
+        return shard ? *shard : Attach();
+    }
+    static MetricsShard& Attach();
+
+    static inline thread_local MetricsShard* threadShard = nullptr;
+};
+
+// Sends this thread's recordings nowhere while in scope; for simulations
+// that aren't real games, like a planner's rollouts
+class MetricsMute {
+public:
+    MetricsMute();
+    ~MetricsMute();
+    MetricsMute(const MetricsMute&) = delete;
+    MetricsMute& operator=(const MetricsMute&) = delete;
+
+private:
+    MetricsShard* saved;
+};
+
+// Background thread writing a snapshot to a file every interval (and once
+// more on Stop), for Prometheus' node_exporter textfile collector or a tail
+class MetricsExporter {
+public:
+    ~MetricsExporter();
+
+    bool Start(const std::string& path, float intervalSeconds);
+    void Stop();
+
+private:
+    void Run();
+    bool Export(double seconds);
+
+    std::string path;
+    float interval = MetricsConstants::DEFAULT_EXPORT_INTERVAL;
+    std::unique_ptr<MetricsSnapshot> last;
+    std::unique_ptr<MetricsSnapshot> current;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running = false;
+};
@@ -0,0 +1,581 @@
+#include "multi_snake.h"
+#include "game_rules.h"
+#include "game_types.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void OccupancyGrid::Resize(int w, int h) {
+    width = w;
+    height = h;
+    owner.assign((size_t)w * h, 0);
+    count.assign((size_t)w * h, 0);
+    apple.assign((size_t)w * h, -1);
+    claims.assign((size_t)w * h, 0);
+}
+
+void OccupancyGrid::AddSegment(Position p, int snakeId) {
+    int i = Index(p.col, p.row);
+    uint8_t id = (uint8_t)(snakeId + 1);
+    if (count[i] == 0) {
+        owner[i] = id;
+    } else if (owner[i] != id) {
+        owner[i] = MultiSnakeConstants::SHARED_OWNER;
+    }
+    count[i]++;
+}
+
+void OccupancyGrid::RemoveSegment(Position p) {
+    int i = Index(p.col, p.row);
+    if (count[i] > 0) {
+        count[i]--;
+        if (count[i] == 0) {
+            owner[i] = 0;
+        }
+    }
+}
+
+void MultiSnakeState::Reset(const MultiSnakeConfig& newConfig) {
+    config = newConfig;
+    WithRules(config.gameMode, config.customRules, [this](const auto& rules) { Reset(rules); });
+}
+
+template <class Rules>
+void MultiSnakeState::Reset(const Rules& rules) {
+    config.numSnakes = std::max(MultiSnakeConstants::MIN_SNAKES,
+                                std::min(config.numSnakes, MultiSnakeConstants::MAX_SNAKES));
+    config.numBots = std::max(0, std::min(config.numBots, config.numSnakes));
+    config.gridWidth = std::max(1, config.gridWidth);
+    config.gridHeight = std::max(1, config.gridHeight);
+
+    rng.Seed(config.seed);
+    grid.Resize(config.gridWidth, config.gridHeight);
+    apples.clear();
+    snakes.clear();
+    snakes.resize(config.numSnakes);
+    pendingMoves.clear();
+    pendingMoves.reserve(config.numSnakes);
+
+    moveTimer = 0.0f;
+    gameTime = 0.0f;
+    tick = 0;
+    gameOver = false;
+    aliveCount = 0;
+
+    // Each snake starts as a single stationary segment on a free cell
+    for (int i = 0; i < config.numSnakes; i++) {
+        SnakeEntity& snake = snakes[i];
+        snake.id = i;
+        snake.isBot = i >= config.numSnakes - config.numBots;
+
+        int col, row;
+        int attempts = 0;
+        do {
+            col = rng.GetValue(0, config.gridWidth - 1);
+            row = rng.GetValue(0, config.gridHeight - 1);
+            attempts++;
+        } while (!grid.IsFree(col, row) && attempts < MultiSnakeConstants::MAX_TELEPORT_ATTEMPTS);
+
+        if (!grid.IsFree(col, row)) {
+            snake.alive = false;
+            continue;
+        }
+        snake.body.push_back({col, row});
+        grid.AddSegment({col, row}, i);
+        aliveCount++;
+    }
+
+    int initialApples = std::max(rules.startApples, GetMinApples(rules));
+    for (int i = 0; i < initialApples; i++) {
+        SpawnApple(rules, 0.0f);
+    }
+}
+
+void MultiSnakeState::RebuildGrid() {
+    grid.Resize(config.gridWidth, config.gridHeight);
+    for (const auto& snake : snakes) {
+        for (const auto& segment : snake.body) {
+            grid.AddSegment(segment, snake.id);
+        }
+    }
+    for (size_t i = 0; i < apples.size(); i++) {
+        grid.apple[grid.Index(apples[i].col, apples[i].row)] = (int16_t)i;
+    }
+}
+
+template <class Rules>
+FoodType MultiSnakeState::GetRandomFoodType(const Rules& rules) {
+    return rules.foods.Sample(rng);
+}
+
+template <class Rules>
+bool MultiSnakeState::SpawnApple(const Rules& rules, float currentTime) {
+    if ((int)apples.size() >= GetMaxApples(rules)) {
+        return false;
+    }
+
+    int attempts = 0;
+    int col, row;
+    do {
+        col = rng.GetValue(0, config.gridWidth - 1);
+        row = rng.GetValue(0, config.gridHeight - 1);
+        attempts++;
+    } while (!grid.IsFree(col, row) && attempts < MultiSnakeConstants::MAX_SPAWN_ATTEMPTS);
+    if (attempts > 1) {
+        Metrics::Add(METRIC_SPAWN_RETRIES, (uint64_t)(attempts - 1));
+    }
+
+    if (!grid.IsFree(col, row)) {
+        return false;
+    }
+
+    Apple newApple;
+    newApple.col = col;
+    newApple.row = row;
+    newApple.type = GetRandomFoodType(rules);
+    newApple.spawnTime = currentTime;
+    newApple.despawnTime = rng.GetValue(rules.despawnMin, rules.despawnMax);
+    grid.apple[grid.Index(col, row)] = (int16_t)apples.size();
+    apples.push_back(newApple);
+    return true;
+}
+
+void MultiSnakeState::RemoveApple(int appleIndex) {
+    // Swap-remove so the grid only needs the moved apple's index patched
+    const Apple& removed = apples[appleIndex];
+    grid.apple[grid.Index(removed.col, removed.row)] = -1;
+    int last = (int)apples.size() - 1;
+    if (appleIndex != last) {
+        apples[appleIndex] = apples[last];
+        grid.apple[grid.Index(apples[appleIndex].col, apples[appleIndex].row)] = (int16_t)appleIndex;
+    }
+    apples.pop_back();
+}
+
+void MultiSnakeLogic::Update(MultiSnakeState& state, float deltaTime) {
+    WithRules(state.config.gameMode, state.config.customRules, [&](const auto& rules) {
+        Update(state, rules, deltaTime);
+    });
+}
+
+void MultiSnakeLogic::Step(MultiSnakeState& state) {
+    WithRules(state.config.gameMode, state.config.customRules, [&](const auto& rules) {
+        Step(state, rules);
+    });
+}
+
+template <class Rules>
+void MultiSnakeLogic::Update(MultiSnakeState& state, const Rules& rules, float deltaTime) {
+    if (state.gameOver) {
+        return;
+    }
+    Metrics::Add(METRIC_TICKS);
+
+    state.gameTime += deltaTime;
+    for (auto& snake : state.snakes) {
+        if (snake.alive) {
+            UpdateStatusEffects(snake, deltaTime);
+        }
+    }
+    UpdateAppleDespawn(state, rules);
+
+    // One move per elapsed interval, keeping the remainder for the next
+    // update, as GameLogic::ProcessMovement does. The server passes exactly
+    // one interval, so it always makes exactly one.
+    state.moveTimer += deltaTime;
+    int moves = 0;
+    while (!state.gameOver && state.moveTimer >= rules.moveInterval) {
+        if (moves == GameConstants::MAX_MOVES_PER_FRAME) {
+            Metrics::Add(METRIC_DROPPED_MOVES, (uint64_t)(state.moveTimer / rules.moveInterval));
+            state.moveTimer = std::fmod(state.moveTimer, rules.moveInterval);
+            break;
+        }
+        state.moveTimer -= rules.moveInterval;
+        Step(state, rules);
+        moves++;
+    }
+}
+
+template <class Rules>
+void MultiSnakeLogic::Step(MultiSnakeState& state, const Rules& rules) {
+    if (state.gameOver) {
+        return;
+    }
+    state.tick++;
+    OccupancyGrid& grid = state.grid;
+    std::vector<PendingMove>& moves = state.pendingMoves;
+    moves.clear();
+
+    // Pick every snake's next head against the pre-move board
+    for (size_t i = 0; i < state.snakes.size(); i++) {
+        SnakeEntity& snake = state.snakes[i];
+        if (!snake.alive || snake.isPaused) {
+            continue;
+        }
+        if (snake.isBot) {
+            QueueDirection(snake, ChooseBotDirection(state, snake));
+        }
+
+        if (!snake.directionQueue.empty()) {
+            Direction nextDir = snake.directionQueue.front();
+            if ((snake.dx == 0 && snake.dy == 0) ||
+                (nextDir.dx != -snake.dx || nextDir.dy != -snake.dy)) {
+                snake.dx = nextDir.dx;
+                snake.dy = nextDir.dy;
+            }
+            snake.directionQueue.pop_front();
+        }
+        if (snake.dx == 0 && snake.dy == 0) {
+            continue;
+        }
+
+        PendingMove move;
+        move.snakeIndex = (int)i;
+        move.head = {snake.body.front().col + snake.dx, snake.body.front().row + snake.dy};
+        move.dies = false;
+        move.cause = DEATH_NONE;
+
+        if (snake.canPassWalls) {
+            if (move.head.col < 0) {
+                move.head.col = grid.width - 1;
+            } else if (move.head.col >= grid.width) {
+                move.head.col = 0;
+            }
+            if (move.head.row < 0) {
+                move.head.row = grid.height - 1;
+            } else if (move.head.row >= grid.height) {
+                move.head.row = 0;
+            }
+        } else if (!grid.InBounds(move.head.col, move.head.row)) {
+            move.dies = true;
+            move.cause = DEATH_WALL;
+            moves.push_back(move);
+            continue;
+        }
+
+        grid.claims[grid.Index(move.head.col, move.head.row)]++;
+        moves.push_back(move);
+    }
+
+    // Resolve collisions. Bodies are checked as they were before anyone
+    // moved (tails included, like GameLogic::CheckCollisions). Heads meeting
+    // on one cell: the strictly longest snake survives, ties all die. That
+    // also settles two snakes reaching the same apple.
+    for (auto& move : moves) {
+        if (move.dies) {
+            continue;
+        }
+        const SnakeEntity& snake = state.snakes[move.snakeIndex];
+        int cell = grid.Index(move.head.col, move.head.row);
+
+        if (grid.count[cell] > 0) {
+            bool ownCell = grid.owner[cell] == (uint8_t)(snake.id + 1);
+            if (!ownCell || !snake.canIntersectSelf) {
+                move.dies = true;
+                move.cause = ownCell ? DEATH_SELF : DEATH_BODY;
+                continue;
+            }
+        }
+
+        if (grid.claims[cell] > 1) {
+            for (const auto& other : moves) {
+                if (other.snakeIndex == move.snakeIndex ||
+                    other.head.col != move.head.col || other.head.row != move.head.row) {
+                    continue;
+                }
+                if (state.snakes[other.snakeIndex].body.size() >= snake.body.size()) {
+                    move.dies = true;
+                    move.cause = DEATH_HEAD_TO_HEAD;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (const auto& move : moves) {
+        if (grid.InBounds(move.head.col, move.head.row)) {
+            grid.claims[grid.Index(move.head.col, move.head.row)] = 0;
+        }
+    }
+
+    // Remove the dead first so their cells and apples are settled before
+    // survivors eat
+    for (const auto& move : moves) {
+        if (move.dies) {
+            Kill(state, state.snakes[move.snakeIndex], move.cause);
+        }
+    }
+
+    // Apply surviving moves in snake order, so apple respawns and teleport
+    // targets draw from the RNG deterministically
+    for (const auto& move : moves) {
+        if (move.dies) {
+            continue;
+        }
+        SnakeEntity& snake = state.snakes[move.snakeIndex];
+        snake.body.push_front(move.head);
+        grid.AddSegment(move.head, snake.id);
+
+        int appleIndex = grid.apple[grid.Index(move.head.col, move.head.row)];
+        if (appleIndex >= 0) {
+            HandleAppleConsumption(state, rules, snake, appleIndex);
+        } else {
+            grid.RemoveSegment(snake.body.back());
+            snake.body.pop_back();
+        }
+    }
+
+    int survivorsToEnd = (state.config.numSnakes > 1) ? 1 : 0;
+    if (state.aliveCount <= survivorsToEnd) {
+        state.gameOver = true;
+        Metrics::Add(METRIC_EPISODES);
+    }
+}
+
+template <class Rules>
+void MultiSnakeLogic::HandleAppleConsumption(MultiSnakeState& state, const Rules& rules, SnakeEntity& snake,
+                                             int eatenAppleIndex) {
+    OccupancyGrid& grid = state.grid;
+    FoodType eatenFoodType = state.apples[eatenAppleIndex].type;
+    state.RemoveApple(eatenAppleIndex);
+
+    if (eatenFoodType == POISONOUS) {
+        // Same as GameLogic: reverse, dropping the new head, and stall briefly
+        snake.isPaused = true;
+        snake.pauseTimer = rules.poisonPauseDuration;
+        snake.directionQueue.clear();
+
+        grid.RemoveSegment(snake.body.front());
+        snake.body.pop_front();
+        std::reverse(snake.body.begin(), snake.body.end());
+
+        snake.dx = -snake.dx;
+        snake.dy = -snake.dy;
+
+        snake.cannotEatApples = true;
+        snake.cannotEatTimer = rules.cannotEatDuration;
+    } else if (eatenFoodType == TELEPORT) {
+        if (!snake.cannotEatApples) {
+            Teleport(state, snake);
+        } else {
+            grid.RemoveSegment(snake.body.back());
+            snake.body.pop_back();
+        }
+    } else if (eatenFoodType == POMME_PLUS || eatenFoodType == POMME_SUPREME) {
+        snake.score += 2;
+
+        snake.body.push_back(snake.body.back());
+        grid.AddSegment(snake.body.back(), snake.id);
+        snake.canIntersectSelf = true;
+        snake.immunityTimer = rules.immunityDuration;
+
+        if (eatenFoodType == POMME_SUPREME) {
+            snake.canPassWalls = true;
+            snake.wallImmunityTimer = rules.wallImmunityDuration;
+        }
+    } else {
+        if (!snake.cannotEatApples) {
+            snake.score++;
+            snake.body.push_back(snake.body.back());
+            grid.AddSegment(snake.body.back(), snake.id);
+        } else {
+            grid.RemoveSegment(snake.body.back());
+            snake.body.pop_back();
+        }
+    }
+
+    for (int i = 0; i < rules.applesPerEat && (int)state.apples.size() < state.GetMaxApples(rules); i++) {
+        state.SpawnApple(rules, state.gameTime);
+    }
+}
+
+void MultiSnakeLogic::Teleport(MultiSnakeState& state, SnakeEntity& snake) {
+    OccupancyGrid& grid = state.grid;
+    int snakeLength = (int)snake.body.size() - 1;
+
+    // Target must be clear of every body (this one's included) and apple
+    int newHeadCol, newHeadRow;
+    int attempts = 0;
+    do {
+        newHeadCol = state.rng.GetValue(0, grid.width - 1);
+        newHeadRow = state.rng.GetValue(0, grid.height - 1);
+        attempts++;
+    } while (!grid.IsFree(newHeadCol, newHeadRow) &&
+             attempts < MultiSnakeConstants::MAX_TELEPORT_ATTEMPTS);
+
+    if (!grid.IsFree(newHeadCol, newHeadRow)) {
+        // Board too crowded: behave like an apple that couldn't be eaten
+        grid.RemoveSegment(snake.body.back());
+        snake.body.pop_back();
+        return;
+    }
+
+    int dirX = 0, dirY = 0;
+    switch (state.rng.GetValue(0, 3)) {
+        case 0: dirY = -1; break;
+        case 1: dirY = 1; break;
+        case 2: dirX = -1; break;
+        case 3: dirX = 1; break;
+    }
+
+    for (const auto& segment : snake.body) {
+        grid.RemoveSegment(segment);
+    }
+    snake.body.clear();
+
+    // Lay the body out behind the head, clamped to the walls
+    for (int i = 0; i < snakeLength; i++) {
+        int segCol = std::max(0, std::min(newHeadCol - dirX * i, grid.width - 1));
+        int segRow = std::max(0, std::min(newHeadRow - dirY * i, grid.height - 1));
+        snake.body.push_back({segCol, segRow});
+        grid.AddSegment({segCol, segRow}, snake.id);
+    }
+
+    snake.directionQueue.clear();
+    snake.dx = 0;
+    snake.dy = 0;
+}
+
+void MultiSnakeLogic::Kill(MultiSnakeState& state, SnakeEntity& snake, DeathCause cause) {
+    for (const auto& segment : snake.body) {
+        state.grid.RemoveSegment(segment);
+    }
+    snake.body.clear();
+    snake.directionQueue.clear();
+    snake.alive = false;
+    snake.deathCause = cause;
+    snake.deathTick = state.tick;
+    static const MetricCounter DEATH_METRICS[] = {METRIC_DEATHS_OTHER, METRIC_DEATHS_WALL, METRIC_DEATHS_SELF,
+                                                  METRIC_DEATHS_BODY, METRIC_DEATHS_HEAD_TO_HEAD};
+    Metrics::Add(DEATH_METRICS[cause]);
+    state.aliveCount--;
+}
+
+void MultiSnakeLogic::UpdateStatusEffects(SnakeEntity& snake, float deltaTime) {
+    if (snake.canIntersectSelf) {
+        snake.immunityTimer -= deltaTime;
+        if (snake.immunityTimer <= 0.0f) {
+            snake.canIntersectSelf = false;
+            snake.immunityTimer = 0.0f;
+        }
+    }
+
+    if (snake.cannotEatApples) {
+        snake.cannotEatTimer -= deltaTime;
+        if (snake.cannotEatTimer <= 0.0f) {
+            snake.cannotEatApples = false;
+            snake.cannotEatTimer = 0.0f;
+        }
+    }
+
+    if (snake.canPassWalls) {
+        snake.wallImmunityTimer -= deltaTime;
+        if (snake.wallImmunityTimer <= 0.0f) {
+            snake.canPassWalls = false;
+            snake.wallImmunityTimer = 0.0f;
+        }
+    }
+
+    if (snake.isPaused) {
+        snake.pauseTimer -= deltaTime;
+        if (snake.pauseTimer <= 0.0f) {
+            snake.isPaused = false;
+            snake.pauseTimer = 0.0f;
+        }
+    }
+}
+
+template <class Rules>
+void MultiSnakeLogic::UpdateAppleDespawn(MultiSnakeState& state, const Rules& rules) {
+    if (rules.despawns) {
+        size_t i = 0;
+        while (i < state.apples.size()) {
+            float elapsed = state.gameTime - state.apples[i].spawnTime;
+            if (elapsed >= state.apples[i].despawnTime) {
+                state.RemoveApple((int)i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // Shared boards keep a floor of apples in every mode
+    while ((int)state.apples.size() < state.GetMinApples(rules)) {
+        if (!state.SpawnApple(rules, state.gameTime)) {
+            break;
+        }
+    }
+}
+
+void MultiSnakeLogic::QueueDirection(SnakeEntity& snake, Direction dir) {
+    bool stationary = snake.dx == 0 && snake.dy == 0;
+    bool reversing = dir.dx == -snake.dx && dir.dy == -snake.dy;
+    if ((stationary || !reversing) &&
+        (snake.directionQueue.empty() ||
+         snake.directionQueue.back().dx != dir.dx ||
+         snake.directionQueue.back().dy != dir.dy)) {
+        snake.directionQueue.push_back(dir);
+    }
+}
+
+Direction MultiSnakeLogic::ChooseBotDirection(const MultiSnakeState& state, const SnakeEntity& snake) {
+    const OccupancyGrid& grid = state.grid;
+    const Position head = snake.body.front();
+
+    // Head for the nearest apple that isn't poisonous
+    int targetCol = head.col, targetRow = head.row;
+    int bestDistance = -1;
+    for (const auto& apple : state.apples) {
+        if (apple.type == POISONOUS) {
+            continue;
+        }
+        int distance = std::abs(apple.col - head.col) + std::abs(apple.row - head.row);
+        if (bestDistance < 0 || distance < bestDistance) {
+            bestDistance = distance;
+            targetCol = apple.col;
+            targetRow = apple.row;
+        }
+    }
+
+    static const Direction candidates[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    Direction best = {snake.dx, snake.dy};
+    int bestScore = -1;
+    for (const auto& dir : candidates) {
+        bool stationary = snake.dx == 0 && snake.dy == 0;
+        if (!stationary && dir.dx == -snake.dx && dir.dy == -snake.dy) {
+            continue;
+        }
+
+        int col = head.col + dir.dx;
+        int row = head.row + dir.dy;
+        if (snake.canPassWalls) {
+            col = (col + grid.width) % grid.width;
+            row = (row + grid.height) % grid.height;
+        } else if (!grid.InBounds(col, row)) {
+            continue;
+        }
+        int cell = grid.Index(col, row);
+        if (grid.count[cell] > 0 &&
+            !(snake.canIntersectSelf && grid.owner[cell] == (uint8_t)(snake.id + 1))) {
+            continue;
+        }
+
+        int distance = std::abs(targetCol - col) + std::abs(targetRow - row);
+        int score = grid.width + grid.height - distance;
+        if (score > bestScore) {
+            bestScore = score;
+            best = dir;
+        }
+    }
+    return best;
+}
+
+#define INSTANTIATE(RULES) \
+    template void MultiSnakeState::Reset(const RULES&); \
+    template FoodType MultiSnakeState::GetRandomFoodType(const RULES&); \
+    template bool MultiSnakeState::SpawnApple(const RULES&, float); \
+    template void MultiSnakeLogic::Update(MultiSnakeState&, const RULES&, float); \
+    template void MultiSnakeLogic::Step(MultiSnakeState&, const RULES&);
+SNEK_FOR_EACH_RULES(INSTANTIATE)
+#undef INSTANTIATE
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "game_rules.h"
+#include "game_types.h"
+#include "rng.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace MultiSnakeConstants {
+    const int MIN_SNAKES = 2;
+    const int MAX_SNAKES = 64;
+    const int MAX_SPAWN_ATTEMPTS = 100;
+    const int MAX_TELEPORT_ATTEMPTS = 1000;
+    // Owner value for a cell that holds segments of more than one snake
+    // (only teleport clamping can do this). Lethal to everyone.
+    const uint8_t SHARED_OWNER = 0xFF;
+}
+
+enum DeathCause { DEATH_NONE, DEATH_WALL, DEATH_SELF, DEATH_BODY, DEATH_HEAD_TO_HEAD };
+
+struct MultiSnakeConfig {
+    int gridWidth = GameConstants::GRID_WIDTH;
+    int gridHeight = GameConstants::GRID_HEIGHT;
+    int numSnakes = 2;
+    int numBots = 0;            // the last numBots snakes are driven by ChooseBotDirection
+    GameMode gameMode = MODE_REGULAR;
+    GameRules customRules;      // used when gameMode is MODE_CUSTOM
+    // A big shared board can hold more apples than the mode's; 0 keeps the
+    // rules' maxApples. The rules' minApples is raised to minApples, so a
+    // board never runs dry even in modes without despawns.
+    int maxApples = 0;
+    int minApples = GameConstants::MIN_APPLES;
+    uint64_t seed = 1;
+};
+
+struct SnakeEntity {
+    int id = 0;
+    bool isBot = false;
+    bool alive = true;
+    DeathCause deathCause = DEATH_NONE;
+    int deathTick = 0;
+    int score = 0;
+
+    // Head at front, same orientation as GameState::snake
+    std::deque<Position> body;
+    int dx = 0;
+    int dy = 0;
+    DirectionQueue directionQueue;     // full: new keys are dropped
+
+    // Status effects (same meaning as in GameState, but per snake)
+    bool canIntersectSelf = false;
+    float immunityTimer = 0.0f;
+    bool canPassWalls = false;
+    float wallImmunityTimer = 0.0f;
+    bool cannotEatApples = false;
+    float cannotEatTimer = 0.0f;
+    bool isPaused = false;
+    float pauseTimer = 0.0f;
+};
+
+// Per-cell occupancy shared by every snake and apple, so collision and spawn
+// checks are O(1) instead of walking every body.
+struct OccupancyGrid {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> owner;    // snake id + 1, 0 = empty
+    std::vector<uint16_t> count;   // segments stacked on the cell (growth, immunity)
+    std::vector<int16_t> apple;    // index into MultiSnakeState::apples, -1 = none
+    std::vector<uint8_t> claims;   // heads moving into the cell this tick (scratch)
+
+    void Resize(int w, int h);
+    int Index(int col, int row) const { return row * width + col; }
+    bool InBounds(int col, int row) const {
+        return col >= 0 && col < width && row >= 0 && row < height;
+    }
+    bool IsFree(int col, int row) const {
+        int i = Index(col, row);
+        return count[i] == 0 && apple[i] < 0;
+    }
+    void AddSegment(Position p, int snakeId);
+    void RemoveSegment(Position p);
+};
+
+// A head that wants to enter a cell this tick (scratch for MultiSnakeLogic::Step)
+struct PendingMove {
+    int snakeIndex;
+    Position head;
+    bool dies;
+    DeathCause cause;
+};
+
+class MultiSnakeState {
+public:
+    MultiSnakeConfig config;
+    std::vector<SnakeEntity> snakes;
+    std::vector<Apple> apples;
+    OccupancyGrid grid;
+    Rng rng;
+
+    float moveTimer = 0.0f;
+    float gameTime = 0.0f;
+    int tick = 0;
+    bool gameOver = false;
+    int aliveCount = 0;
+    std::vector<PendingMove> pendingMoves;
+
+    void Reset(const MultiSnakeConfig& newConfig);
+    const GameRules& GetRules() const { return GameRules::ForMode(config.gameMode, config.customRules); }
+    float GetMoveInterval() const { return GetRules().moveInterval; }
+    // Recomputes the occupancy grid from bodies and apples (after loading a state)
+    void RebuildGrid();
+
+    // Apple management (grid-backed counterparts of GameState's)
+    template <class Rules> int GetMaxApples(const Rules& rules) const {
+        return (config.maxApples > 0) ? config.maxApples : rules.maxApples;
+    }
+    template <class Rules> int GetMinApples(const Rules& rules) const {
+        return std::max(rules.minApples, config.minApples);
+    }
+    template <class Rules> FoodType GetRandomFoodType(const Rules& rules);
+    template <class Rules> bool SpawnApple(const Rules& rules, float currentTime);
+    void RemoveApple(int appleIndex);
+
+private:
+    template <class Rules> void Reset(const Rules& rules);
+};
+
+class MultiSnakeLogic {
+public:
+    // Frame update: advances timers and runs a tick for every move interval
+    // that has elapsed (at most MAX_MOVES_PER_FRAME), keeping the remainder
+    static void Update(MultiSnakeState& state, float deltaTime);
+    // One simultaneous move for every live snake
+    static void Step(MultiSnakeState& state);
+
+    // Same filtering main.cpp applies before pushing into directionQueue
+    static void QueueDirection(SnakeEntity& snake, Direction dir);
+    static Direction ChooseBotDirection(const MultiSnakeState& state, const SnakeEntity& snake);
+
+    // The same for one mode's rules. The entry points above look at
+    // config.gameMode once and call these; they are instantiated for each
+    // built-in mode's compile-time rules and for a loaded GameRules.
+    template <class Rules>
+    static void Update(MultiSnakeState& state, const Rules& rules, float deltaTime);
+    template <class Rules>
+    static void Step(MultiSnakeState& state, const Rules& rules);
+
+private:
+    static void UpdateStatusEffects(SnakeEntity& snake, float deltaTime);
+    template <class Rules>
+    static void UpdateAppleDespawn(MultiSnakeState& state, const Rules& rules);
+    template <class Rules>
+    static void HandleAppleConsumption(MultiSnakeState& state, const Rules& rules, SnakeEntity& snake,
+                                       int eatenAppleIndex);
+    static void Teleport(MultiSnakeState& state, SnakeEntity& snake);
+    static void Kill(MultiSnakeState& state, SnakeEntity& snake, DeathCause cause);
+};
@@ -0,0 +1,210 @@
+#include "net_client.h"
+#include <algorithm>
+#include <utility>
+
+bool NetClient::Connect(const char* host, uint16_t port, uint16_t requestedMatchId) {
+    if (!UdpSocket::Resolve(host, port, server) || !socket.Open(0, false)) {
+        return false;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    recvBuffer.resize(NetConstants::MAX_PACKET_SIZE);
+    sendBuffer.reserve(256);
+    requestedMatch = requestedMatchId;
+    joined = false;
+    rejected = false;
+    hasSnapshot = false;
+    pending.clear();
+    nextSeq = 1;
+    ackedSeq = 0;
+    stats = NetClientStats();
+    for (int i = 0; i < HISTORY_SIZE; i++) {
+        historyTick[i] = -1;
+    }
+
+    // Tells our JOIN apart from other clients behind the same address
+    nonce = (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count() ^
+            ((uint32_t)socket.LocalPort() << 16);
+    NetProtocol::WriteJoin(sendBuffer, requestedMatch, nonce);
+    socket.Send(server, sendBuffer.data(), sendBuffer.size());
+    joinRetryTimer = 0.0f;
+    return true;
+}
+
+void NetClient::Disconnect() {
+    if (joined) {
+        NetProtocol::WriteLeave(sendBuffer, matchId, (uint8_t)slot);
+        socket.Send(server, sendBuffer.data(), sendBuffer.size());
+    }
+    socket.Close();
+    joined = false;
+    hasSnapshot = false;
+}
+
+uint32_t NetClient::NowMs() const {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void NetClient::SendDirection(Direction dir) {
+    if (!joined || !hasSnapshot || slot >= (int)predicted.snakes.size()) {
+        return;
+    }
+
+    InputCommand input;
+    input.seq = nextSeq++;
+    input.targetTick = (uint32_t)predicted.tick + 1;
+    input.dx = (int8_t)dir.dx;
+    input.dy = (int8_t)dir.dy;
+    pending.push_back(input);
+
+    // The turn shows up locally without waiting for the round trip
+    MultiSnakeLogic::QueueDirection(predicted.snakes[slot], dir);
+    nextPendingToApply = pending.size();
+    SendPendingInputs();
+}
+
+void NetClient::Update(float deltaTime) {
+    if (!socket.IsOpen()) {
+        return;
+    }
+
+    NetAddress from;
+    int received;
+    while ((received = socket.Receive(from, recvBuffer.data(), recvBuffer.size())) > 0) {
+        if (from == server) {
+            HandlePacket(recvBuffer.data(), received);
+        }
+    }
+
+    if (!joined) {
+        joinRetryTimer += deltaTime;
+        if (!rejected && joinRetryTimer >= 0.5f) {
+            joinRetryTimer = 0.0f;
+            NetProtocol::WriteJoin(sendBuffer, requestedMatch, nonce);
+            socket.Send(server, sendBuffer.data(), sendBuffer.size());
+        }
+        return;
+    }
+    if (!hasSnapshot) {
+        return;
+    }
+
+    tickAccumulator = std::min(tickAccumulator + deltaTime, tickInterval * NetConstants::MAX_PREDICTION_TICKS);
+    while (tickAccumulator >= tickInterval) {
+        tickAccumulator -= tickInterval;
+        if (predicted.tick < authoritative.tick + NetConstants::MAX_PREDICTION_TICKS) {
+            AdvancePrediction();
+        }
+        // Doubles as keepalive and resend of anything unacknowledged
+        SendPendingInputs();
+    }
+}
+
+void NetClient::HandlePacket(const uint8_t* data, size_t size) {
+    switch (NetProtocol::PeekType(data, size)) {
+        case PACKET_WELCOME: {
+            WelcomeMessage welcome;
+            if (!joined && NetProtocol::ReadWelcome(data, size, welcome) && welcome.nonce == nonce) {
+                joined = true;
+                matchId = welcome.matchId;
+                slot = welcome.slot;
+                tickInterval = welcome.tickInterval;
+            }
+            break;
+        }
+        case PACKET_REJECT:
+            if (!joined) {
+                rejected = true;
+            }
+            break;
+        case PACKET_SNAPSHOT: {
+            SnapshotHeader header;
+            if (!joined || !NetProtocol::ReadSnapshot(data, size, header, incoming)) {
+                break;
+            }
+            // Ignore reordered packets, but accept the restart of a new round
+            bool newRound = incoming.config.seed != authoritative.config.seed;
+            if (hasSnapshot && !newRound && incoming.tick <= authoritative.tick) {
+                break;
+            }
+            std::swap(authoritative, incoming);
+            stats.snapshotsReceived++;
+
+            if (header.echoTimeMs != 0) {
+                float sample = (float)(NowMs() - header.echoTimeMs) - header.holdMs;
+                sample = std::max(0.0f, sample);
+                stats.roundTripMs = (stats.roundTripMs == 0.0f) ? sample : stats.roundTripMs * 0.9f + sample * 0.1f;
+            }
+            Reconcile(header, newRound || !hasSnapshot);
+            hasSnapshot = true;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void NetClient::Reconcile(const SnapshotHeader& header, bool resetPrediction) {
+    ackedSeq = std::max(ackedSeq, header.ackSeq);
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+        [this](const InputCommand& input) { return input.seq <= ackedSeq; }), pending.end());
+
+    int confirmedTick = authoritative.tick;
+    int h = confirmedTick % HISTORY_SIZE;
+    if (!resetPrediction && slot < (int)authoritative.snakes.size() && historyTick[h] == confirmedTick) {
+        const SnakeEntity& snake = authoritative.snakes[slot];
+        if (snake.alive && !snake.body.empty() &&
+            (snake.body.front().col != headHistory[h].col || snake.body.front().row != headHistory[h].row)) {
+            stats.mispredictions++;
+        }
+    }
+
+    // Rewind to the server's state and replay what it hasn't seen yet
+    int targetTick = resetPrediction ? confirmedTick : std::max(predicted.tick, confirmedTick);
+    targetTick = std::min(targetTick, confirmedTick + NetConstants::MAX_PREDICTION_TICKS);
+    predicted = authoritative;
+    nextPendingToApply = 0;
+    while (predicted.tick < targetTick) {
+        AdvancePrediction();
+    }
+    ApplyDueInputs();
+}
+
+void NetClient::ApplyDueInputs() {
+    if (slot >= (int)predicted.snakes.size()) {
+        return;
+    }
+    while (nextPendingToApply < pending.size() &&
+           (int)pending[nextPendingToApply].targetTick <= predicted.tick + 1) {
+        const InputCommand& input = pending[nextPendingToApply];
+        MultiSnakeLogic::QueueDirection(predicted.snakes[slot], {input.dx, input.dy});
+        nextPendingToApply++;
+    }
+}
+
+void NetClient::AdvancePrediction() {
+    ApplyDueInputs();
+    MultiSnakeLogic::Update(predicted, predicted.GetMoveInterval());
+
+    int h = predicted.tick % HISTORY_SIZE;
+    historyTick[h] = predicted.tick;
+    if (slot < (int)predicted.snakes.size() && !predicted.snakes[slot].body.empty()) {
+        headHistory[h] = predicted.snakes[slot].body.front();
+    }
+}
+
+void NetClient::SendPendingInputs() {
+    InputMessage message;
+    message.matchId = matchId;
+    message.slot = (uint8_t)slot;
+    message.clientTimeMs = NowMs();
+    message.count = (int)std::min(pending.size(), (size_t)NetConstants::MAX_INPUTS_PER_PACKET);
+    for (int i = 0; i < message.count; i++) {
+        message.inputs[i] = pending[i];
+    }
+    NetProtocol::WriteInput(sendBuffer, message);
+    if (socket.Send(server, sendBuffer.data(), sendBuffer.size())) {
+        stats.inputsSent += message.count;
+    }
+}
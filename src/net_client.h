@@ -0,0 +1,77 @@
+#pragma once
+
+#include "multi_snake.h"
+#include "net_protocol.h"
+#include "udp_socket.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct NetClientStats {
+    uint64_t snapshotsReceived = 0;
+    uint64_t inputsSent = 0;
+    uint64_t mispredictions = 0;    // own head differed from the server at a confirmed tick
+    float roundTripMs = 0.0f;
+};
+
+// Client side of MatchServer. Local inputs are applied to a predicted copy of
+// the match straight away; each snapshot replaces it with the server's state
+// and replays the inputs the server hasn't acknowledged yet.
+class NetClient {
+public:
+    bool Connect(const char* host, uint16_t port, uint16_t matchId = NetConstants::ANY_MATCH);
+    void Disconnect();
+
+    void SendDirection(Direction dir);
+    void Update(float deltaTime);
+
+    bool IsJoined() const { return joined; }
+    bool IsRejected() const { return rejected; }
+    bool HasState() const { return hasSnapshot; }
+    int GetSlot() const { return slot; }
+    uint16_t GetMatchId() const { return matchId; }
+    const MultiSnakeState& GetPredictedState() const { return predicted; }
+    const MultiSnakeState& GetAuthoritativeState() const { return authoritative; }
+    uint32_t GetAckedSeq() const { return ackedSeq; }
+    uint32_t GetLastSentSeq() const { return nextSeq - 1; }
+    const NetClientStats& GetStats() const { return stats; }
+
+private:
+    uint32_t NowMs() const;
+    void HandlePacket(const uint8_t* data, size_t size);
+    void Reconcile(const SnapshotHeader& header, bool resetPrediction);
+    void ApplyDueInputs();
+    void AdvancePrediction();
+    void SendPendingInputs();
+
+    UdpSocket socket;
+    NetAddress server;
+    bool joined = false;
+    bool rejected = false;
+    bool hasSnapshot = false;
+    uint16_t requestedMatch = NetConstants::ANY_MATCH;
+    uint16_t matchId = 0;
+    int slot = -1;
+    uint32_t nonce = 0;
+    float tickInterval = 0.25f;
+    float joinRetryTimer = 0.0f;
+    float tickAccumulator = 0.0f;
+
+    MultiSnakeState authoritative;
+    MultiSnakeState predicted;
+    MultiSnakeState incoming;
+    std::vector<InputCommand> pending;      // sent but not yet acknowledged
+    size_t nextPendingToApply = 0;          // first pending input not yet in `predicted`
+    uint32_t nextSeq = 1;
+    uint32_t ackedSeq = 0;
+
+    // Own head position per predicted tick, to count mispredictions
+    static const int HISTORY_SIZE = 64;
+    Position headHistory[HISTORY_SIZE];
+    int historyTick[HISTORY_SIZE];
+
+    NetClientStats stats;
+    std::chrono::steady_clock::time_point startTime;
+    std::vector<uint8_t> recvBuffer;
+    std::vector<uint8_t> sendBuffer;
+};
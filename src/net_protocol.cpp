@@ -0,0 +1,310 @@
+#include "net_protocol.h"
+#include "state_codec.h"
+#include <cstdlib>
+
+static void WriteHeader(ByteWriter& writer, PacketType type) {
+    writer.U8(type);
+    writer.U8(NetConstants::PROTOCOL_VERSION);
+}
+
+static bool ReadHeader(ByteReader& reader, PacketType type) {
+    return reader.U8() == type && reader.U8() == NetConstants::PROTOCOL_VERSION;
+}
+
+void NetProtocol::WriteJoin(std::vector<uint8_t>& out, uint16_t matchId, uint32_t nonce) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_JOIN);
+    writer.U16(matchId);
+    writer.U32(nonce);
+}
+
+void NetProtocol::WriteWelcome(std::vector<uint8_t>& out, const WelcomeMessage& welcome) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_WELCOME);
+    writer.U16(welcome.matchId);
+    writer.U8(welcome.slot);
+    writer.U32(welcome.nonce);
+    writer.U32(welcome.tick);
+    writer.F32(welcome.tickInterval);
+}
+
+void NetProtocol::WriteReject(std::vector<uint8_t>& out, uint32_t nonce) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_REJECT);
+    writer.U32(nonce);
+}
+
+void NetProtocol::WriteInput(std::vector<uint8_t>& out, const InputMessage& input) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_INPUT);
+    writer.U16(input.matchId);
+    writer.U8(input.slot);
+    writer.U32(input.clientTimeMs);
+    writer.U8((uint8_t)input.count);
+    for (int i = 0; i < input.count; i++) {
+        writer.U32(input.inputs[i].seq);
+        writer.U32(input.inputs[i].targetTick);
+        writer.I8(input.inputs[i].dx);
+        writer.I8(input.inputs[i].dy);
+    }
+}
+
+void NetProtocol::WriteLeave(std::vector<uint8_t>& out, uint16_t matchId, uint8_t slot) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_LEAVE);
+    writer.U16(matchId);
+    writer.U8(slot);
+}
+
+void NetProtocol::WriteSnapshot(std::vector<uint8_t>& out, const MultiSnakeState& state) {
+    out.clear();
+    ByteWriter writer(out);
+    WriteHeader(writer, PACKET_SNAPSHOT);
+    writer.U32(0);   // ackSeq
+    writer.U32(0);   // echoTimeMs
+    writer.U16(0);   // holdMs
+    WriteState(writer, state);
+}
+
+void NetProtocol::PatchSnapshotHeader(std::vector<uint8_t>& packet, const SnapshotHeader& header) {
+    uint8_t* p = packet.data() + NetConstants::SNAPSHOT_ACK_OFFSET;
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(header.ackSeq >> (8 * i));
+        p[4 + i] = (uint8_t)(header.echoTimeMs >> (8 * i));
+    }
+    p[8] = (uint8_t)header.holdMs;
+    p[9] = (uint8_t)(header.holdMs >> 8);
+}
+
+uint8_t NetProtocol::PeekType(const uint8_t* data, size_t size) {
+    if (size < 2 || data[1] != NetConstants::PROTOCOL_VERSION) {
+        return 0;
+    }
+    return (data[0] >= PACKET_JOIN && data[0] <= PACKET_LEAVE) ? data[0] : 0;
+}
+
+bool NetProtocol::ReadJoin(const uint8_t* data, size_t size, uint16_t& matchId, uint32_t& nonce) {
+    ByteReader reader(data, size);
+    if (!ReadHeader(reader, PACKET_JOIN)) {
+        return false;
+    }
+    matchId = reader.U16();
+    nonce = reader.U32();
+    return reader.Ok();
+}
+
+bool NetProtocol::ReadWelcome(const uint8_t* data, size_t size, WelcomeMessage& welcome) {
+    ByteReader reader(data, size);
+    if (!ReadHeader(reader, PACKET_WELCOME)) {
+        return false;
+    }
+    welcome.matchId = reader.U16();
+    welcome.slot = reader.U8();
+    welcome.nonce = reader.U32();
+    welcome.tick = reader.U32();
+    welcome.tickInterval = reader.F32();
+    return reader.Ok();
+}
+
+bool NetProtocol::ReadInput(const uint8_t* data, size_t size, InputMessage& input) {
+    ByteReader reader(data, size);
+    if (!ReadHeader(reader, PACKET_INPUT)) {
+        return false;
+    }
+    input.matchId = reader.U16();
+    input.slot = reader.U8();
+    input.clientTimeMs = reader.U32();
+    input.count = reader.U8();
+    if (input.count > NetConstants::MAX_INPUTS_PER_PACKET) {
+        return false;
+    }
+    for (int i = 0; i < input.count; i++) {
+        input.inputs[i].seq = reader.U32();
+        input.inputs[i].targetTick = reader.U32();
+        input.inputs[i].dx = reader.I8();
+        input.inputs[i].dy = reader.I8();
+        // Only unit moves along one axis are legal
+        if (std::abs(input.inputs[i].dx) + std::abs(input.inputs[i].dy) != 1) {
+            return false;
+        }
+    }
+    return reader.Ok();
+}
+
+bool NetProtocol::ReadLeave(const uint8_t* data, size_t size, uint16_t& matchId, uint8_t& slot) {
+    ByteReader reader(data, size);
+    if (!ReadHeader(reader, PACKET_LEAVE)) {
+        return false;
+    }
+    matchId = reader.U16();
+    slot = reader.U8();
+    return reader.Ok();
+}
+
+bool NetProtocol::ReadSnapshot(const uint8_t* data, size_t size, SnapshotHeader& header, MultiSnakeState& state) {
+    ByteReader reader(data, size);
+    if (!ReadHeader(reader, PACKET_SNAPSHOT)) {
+        return false;
+    }
+    header.ackSeq = reader.U32();
+    header.echoTimeMs = reader.U32();
+    header.holdMs = reader.U16();
+    return ReadState(reader, state);
+}
+
+void NetProtocol::WriteState(ByteWriter& writer, const MultiSnakeState& state) {
+    const MultiSnakeConfig& config = state.config;
+    writer.U16((uint16_t)config.gridWidth);
+    writer.U16((uint16_t)config.gridHeight);
+    writer.U8((uint8_t)config.numSnakes);
+    writer.U8((uint8_t)config.numBots);
+    writer.U8((uint8_t)config.gameMode);
+    writer.U16((uint16_t)config.maxApples);
+    writer.U16((uint16_t)config.minApples);
+    writer.U64(config.seed);
+    if (config.gameMode == MODE_CUSTOM) {
+        StateCodec::WriteRules(writer, config.customRules);
+    }
+
+    writer.U32((uint32_t)state.tick);
+    writer.F32(state.gameTime);
+    writer.F32(state.moveTimer);
+    writer.U64(state.rng.state);
+    writer.U8(state.gameOver ? 1 : 0);
+
+    writer.U16((uint16_t)state.apples.size());
+    for (const auto& apple : state.apples) {
+        writer.U16((uint16_t)apple.col);
+        writer.U16((uint16_t)apple.row);
+        writer.U8((uint8_t)apple.type);
+        writer.F32(apple.spawnTime);
+        writer.F32(apple.despawnTime);
+    }
+
+    for (const auto& snake : state.snakes) {
+        uint8_t flags = (snake.alive ? 1 : 0) | (snake.isBot ? 2 : 0) |
+                        (snake.canIntersectSelf ? 4 : 0) | (snake.canPassWalls ? 8 : 0) |
+                        (snake.cannotEatApples ? 16 : 0) | (snake.isPaused ? 32 : 0);
+        writer.U8(flags);
+        writer.U8((uint8_t)snake.deathCause);
+        writer.U32((uint32_t)snake.deathTick);
+        writer.I32(snake.score);
+        writer.I8((int8_t)snake.dx);
+        writer.I8((int8_t)snake.dy);
+        writer.F32(snake.immunityTimer);
+        writer.F32(snake.wallImmunityTimer);
+        writer.F32(snake.cannotEatTimer);
+        writer.F32(snake.pauseTimer);
+
+        writer.U16((uint16_t)snake.directionQueue.size());
+        for (const auto& dir : snake.directionQueue) {
+            writer.I8((int8_t)dir.dx);
+            writer.I8((int8_t)dir.dy);
+        }
+        writer.U32((uint32_t)snake.body.size());
+        for (const auto& segment : snake.body) {
+            writer.U16((uint16_t)segment.col);
+            writer.U16((uint16_t)segment.row);
+        }
+    }
+}
+
+bool NetProtocol::ReadState(ByteReader& reader, MultiSnakeState& state) {
+    MultiSnakeConfig& config = state.config;
+    config.gridWidth = reader.U16();
+    config.gridHeight = reader.U16();
+    config.numSnakes = reader.U8();
+    config.numBots = reader.U8();
+    config.gameMode = (GameMode)reader.U8();
+    config.maxApples = reader.U16();
+    config.minApples = reader.U16();
+    config.seed = reader.U64();
+    if (config.gameMode == MODE_CUSTOM && !StateCodec::ReadRules(reader, config.customRules)) {
+        return false;
+    }
+    if (!reader.Ok() || config.gridWidth <= 0 || config.gridHeight <= 0 ||
+        config.numSnakes > MultiSnakeConstants::MAX_SNAKES) {
+        return false;
+    }
+
+    state.tick = (int)reader.U32();
+    state.gameTime = reader.F32();
+    state.moveTimer = reader.F32();
+    state.rng.state = reader.U64();
+    state.gameOver = reader.U8() != 0;
+
+    int appleCount = reader.U16();
+    state.apples.resize(appleCount);
+    for (auto& apple : state.apples) {
+        apple.col = reader.U16();
+        apple.row = reader.U16();
+        apple.type = (FoodType)reader.U8();
+        apple.spawnTime = reader.F32();
+        apple.despawnTime = reader.F32();
+        if (apple.col >= config.gridWidth || apple.row >= config.gridHeight) {
+            return false;
+        }
+    }
+
+    state.snakes.resize(config.numSnakes);
+    state.aliveCount = 0;
+    for (int i = 0; i < config.numSnakes; i++) {
+        SnakeEntity& snake = state.snakes[i];
+        snake.id = i;
+        uint8_t flags = reader.U8();
+        snake.alive = (flags & 1) != 0;
+        snake.isBot = (flags & 2) != 0;
+        snake.canIntersectSelf = (flags & 4) != 0;
+        snake.canPassWalls = (flags & 8) != 0;
+        snake.cannotEatApples = (flags & 16) != 0;
+        snake.isPaused = (flags & 32) != 0;
+        snake.deathCause = (DeathCause)reader.U8();
+        snake.deathTick = (int)reader.U32();
+        snake.score = reader.I32();
+        snake.dx = reader.I8();
+        snake.dy = reader.I8();
+        snake.immunityTimer = reader.F32();
+        snake.wallImmunityTimer = reader.F32();
+        snake.cannotEatTimer = reader.F32();
+        snake.pauseTimer = reader.F32();
+
+        int queueLength = reader.U16();
+        if (queueLength > (int)snake.directionQueue.capacity()) {
+            return false;
+        }
+        snake.directionQueue.clear();
+        for (int q = 0; q < queueLength && reader.Ok(); q++) {
+            Direction dir;
+            dir.dx = reader.I8();
+            dir.dy = reader.I8();
+            snake.directionQueue.push_back(dir);
+        }
+
+        uint32_t bodyLength = reader.U32();
+        if (!reader.Ok() || bodyLength > reader.Remaining() / 4) {
+            return false;
+        }
+        snake.body.resize(bodyLength);
+        for (auto& segment : snake.body) {
+            segment.col = reader.U16();
+            segment.row = reader.U16();
+            if (segment.col >= config.gridWidth || segment.row >= config.gridHeight) {
+                return false;
+            }
+        }
+        if (snake.alive) {
+            state.aliveCount++;
+        }
+    }
+
+    if (!reader.Ok()) {
+        return false;
+    }
+    state.RebuildGrid();
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "byte_buffer.h"
+#include "multi_snake.h"
+#include <cstdint>
+#include <vector>
+
+namespace NetConstants {
+    const uint8_t PROTOCOL_VERSION = 2;     // 2: custom rules in MODE_CUSTOM snapshots
+    const uint16_t DEFAULT_PORT = 7777;
+    const size_t MAX_PACKET_SIZE = 65000;
+    const uint16_t ANY_MATCH = 0xFFFF;
+    // Unacknowledged inputs are resent with every input packet to ride out loss
+    const int MAX_INPUTS_PER_PACKET = 8;
+    const float CLIENT_TIMEOUT = 10.0f;
+    const int MAX_PREDICTION_TICKS = 16;
+    // Inputs the server holds per client: a full prediction window of
+    // packets' worth. A client sending more loses its oldest.
+    const size_t MAX_PENDING_INPUTS = MAX_PREDICTION_TICKS * MAX_INPUTS_PER_PACKET;
+    // Byte offset of the per-recipient fields in a snapshot packet
+    const size_t SNAPSHOT_ACK_OFFSET = 2;
+}
+
+enum PacketType : uint8_t {
+    PACKET_JOIN = 1,
+    PACKET_WELCOME,
+    PACKET_REJECT,
+    PACKET_INPUT,
+    PACKET_SNAPSHOT,
+    PACKET_LEAVE,
+};
+
+// One direction change, tagged with the tick it was meant for
+struct InputCommand {
+    uint32_t seq = 0;
+    uint32_t targetTick = 0;
+    int8_t dx = 0;
+    int8_t dy = 0;
+};
+
+struct WelcomeMessage {
+    uint16_t matchId = 0;
+    uint8_t slot = 0;
+    uint32_t nonce = 0;
+    uint32_t tick = 0;
+    float tickInterval = 0.0f;   // wall-clock seconds between server ticks
+};
+
+struct InputMessage {
+    uint16_t matchId = 0;
+    uint8_t slot = 0;
+    uint32_t clientTimeMs = 0;   // echoed back for round-trip measurement
+    int count = 0;
+    InputCommand inputs[NetConstants::MAX_INPUTS_PER_PACKET];
+};
+
+struct SnapshotHeader {
+    uint32_t ackSeq = 0;         // newest input seq the server has applied
+    uint32_t echoTimeMs = 0;     // clientTimeMs of the newest input packet
+    uint16_t holdMs = 0;         // how long the server held that packet before replying
+};
+
+class NetProtocol {
+public:
+    static void WriteJoin(std::vector<uint8_t>& out, uint16_t matchId, uint32_t nonce);
+    static void WriteWelcome(std::vector<uint8_t>& out, const WelcomeMessage& welcome);
+    static void WriteReject(std::vector<uint8_t>& out, uint32_t nonce);
+    static void WriteInput(std::vector<uint8_t>& out, const InputMessage& input);
+    static void WriteLeave(std::vector<uint8_t>& out, uint16_t matchId, uint8_t slot);
+    // Snapshot = header + full match state. The header sits at a fixed offset
+    // so one serialized state can be patched per recipient.
+    static void WriteSnapshot(std::vector<uint8_t>& out, const MultiSnakeState& state);
+    static void PatchSnapshotHeader(std::vector<uint8_t>& packet, const SnapshotHeader& header);
+
+    // Returns PacketType, or 0 for a malformed/foreign packet
+    static uint8_t PeekType(const uint8_t* data, size_t size);
+    static bool ReadJoin(const uint8_t* data, size_t size, uint16_t& matchId, uint32_t& nonce);
+    static bool ReadWelcome(const uint8_t* data, size_t size, WelcomeMessage& welcome);
+    static bool ReadInput(const uint8_t* data, size_t size, InputMessage& input);
+    static bool ReadLeave(const uint8_t* data, size_t size, uint16_t& matchId, uint8_t& slot);
+    static bool ReadSnapshot(const uint8_t* data, size_t size, SnapshotHeader& header, MultiSnakeState& state);
+
+    // Full match state: everything a client needs to keep simulating locally
+    static void WriteState(ByteWriter& writer, const MultiSnakeState& state);
+    static bool ReadState(ByteReader& reader, MultiSnakeState& state);
+};
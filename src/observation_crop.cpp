@@ -0,0 +1,208 @@
+#include "observation_crop.h"
+#include "libsnek.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SNEK_CROP_AVX2 1
+#include <immintrin.h>
+#endif
+
+using GameConstants::GRID_HEIGHT;
+using GameConstants::GRID_WIDTH;
+using SnekEngineConstants::CELLS;
+
+namespace {
+    // Where one window row starts on the board and how it steps across.
+    // Heading (dx, dy) is up in the window, so the window's right is
+    // (-dy, dx) on the board and each row further down is one step back.
+    struct RowWalk {
+        int col;
+        int row;
+        int stepCol;
+        int stepRow;
+    };
+
+    inline void Heading(const SnekGame& game, int& dx, int& dy) {
+        dx = game.dx;
+        dy = game.dy;
+        if (dx == 0 && dy == 0) {
+            dy = -1;
+        }
+    }
+
+    inline RowWalk StartRow(const SnekGame& game, int dx, int dy, int half, int r) {
+        Cell head = game.Segment(0);
+        int ahead = half - r;
+        RowWalk walk;
+        walk.stepCol = -dy;
+        walk.stepRow = dx;
+        walk.col = head.col + ahead * dx - half * walk.stepCol;
+        walk.row = head.row + ahead * dy - half * walk.stepRow;
+        return walk;
+    }
+
+    // Windows are at most MAX_SIZE, so one wrap always lands on the board
+    inline int WrapOnce(int value, int size) {
+        return (value < 0) ? value + size : (value >= size) ? value - size : value;
+    }
+}
+
+bool ObservationCrop::IsValidSize(int size) {
+    return size >= 1 && size <= CropConstants::MAX_SIZE && size % 2 == 1;
+}
+
+void ObservationCrop::ExtractScalar(const SnekGame* games, const uint8_t* observations, int count, int size,
+                                    uint8_t* out) {
+    int half = size / 2;
+    for (int g = 0; g < count; g++) {
+        const SnekGame& game = games[g];
+        const uint8_t* plane = observations + (size_t)g * CELLS;
+        int dx, dy;
+        Heading(game, dx, dy);
+        for (int r = 0; r < size; r++) {
+            RowWalk walk = StartRow(game, dx, dy, half, r);
+            for (int c = 0; c < size; c++) {
+                int col = walk.col + c * walk.stepCol;
+                int row = walk.row + c * walk.stepRow;
+                if (game.canPassWalls) {
+                    col = WrapOnce(col, GRID_WIDTH);
+                    row = WrapOnce(row, GRID_HEIGHT);
+                }
+                bool inside = col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+                *out++ = inside ? plane[row * GRID_WIDTH + col] : (uint8_t)SNEK_CELL_WALL;
+            }
+        }
+    }
+}
+
+#ifdef SNEK_CROP_AVX2
+// The window is walked as one run of size * size cells, 8 lanes at a time,
+// each lane keeping its own (r, c) and board cell as it steps on, so rows
+// that don't fill a vector don't leave lanes idle. Board cells are wrapped
+// or masked at the walls, then fetched with one gather. Gathers read 32
+// bits, so each lane reads the aligned word holding its cell (planes are
+// 484 bytes, a multiple of 4, so no word crosses the end of the buffer) and
+// shifts its byte down.
+__attribute__((target("avx2")))
+static void ExtractAvx2(const SnekGame* games, const uint8_t* observations, int count, int size, uint8_t* out) {
+    static_assert(CELLS % 4 == 0, "planes have to be whole 32-bit words");
+    int half = size / 2;
+    int area = size * size;
+    const __m256i width = _mm256_set1_epi32(GRID_WIDTH);
+    const __m256i height = _mm256_set1_epi32(GRID_HEIGHT);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i wall = _mm256_set1_epi32(SNEK_CELL_WALL);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i sizeVector = _mm256_set1_epi32(size);
+    const __m256i lastColumn = _mm256_set1_epi32(size - 1);
+    // Low byte of each dword to the bottom of its 128-bit lane, then both
+    // lanes' four bytes side by side
+    const __m256i packBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i joinLanes = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+
+    // Where lanes start in the window and how far 8 cells move them
+    alignas(32) int startR[8];
+    alignas(32) int startC[8];
+    for (int lane = 0; lane < 8; lane++) {
+        startR[lane] = lane / size;
+        startC[lane] = lane % size;
+    }
+    const __m256i firstR = _mm256_load_si256((const __m256i*)startR);
+    const __m256i firstC = _mm256_load_si256((const __m256i*)startC);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int stepR = 8 / size;
+    int stepC = 8 % size;
+
+    for (int g = 0; g < count; g++) {
+        const SnekGame& game = games[g];
+        const int* plane = (const int*)(observations + (size_t)g * CELLS);
+        int dx, dy;
+        Heading(game, dx, dy);
+        bool wrap = game.canPassWalls;
+        // Board cell of window (r, c) is origin + r * down + c * right
+        Cell head = game.Segment(0);
+        int originCol = head.col + half * dx + half * dy;
+        int originRow = head.row + half * dy - half * dx;
+        int downCol = -dx, downRow = -dy;
+        int rightCol = -dy, rightRow = dx;
+        __m256i r = firstR;
+        __m256i c = firstC;
+        __m256i col = _mm256_add_epi32(_mm256_set1_epi32(originCol),
+                                       _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(downCol)),
+                                                        _mm256_mullo_epi32(c, _mm256_set1_epi32(rightCol))));
+        __m256i row = _mm256_add_epi32(_mm256_set1_epi32(originRow),
+                                       _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(downRow)),
+                                                        _mm256_mullo_epi32(c, _mm256_set1_epi32(rightRow))));
+        const __m256i stepCol = _mm256_set1_epi32(stepR * downCol + stepC * rightCol);
+        const __m256i stepRow = _mm256_set1_epi32(stepR * downRow + stepC * rightRow);
+        // A lane that runs off the end of its row goes to the next one
+        const __m256i carryCol = _mm256_set1_epi32(downCol - size * rightCol);
+        const __m256i carryRow = _mm256_set1_epi32(downRow - size * rightRow);
+        const __m256i stepCVector = _mm256_set1_epi32(stepC);
+
+        for (int i = 0; i < area; i += 8) {
+            __m256i wrappedCol = col;
+            __m256i wrappedRow = row;
+            if (wrap) {
+                wrappedCol = _mm256_add_epi32(col, _mm256_and_si256(_mm256_cmpgt_epi32(zero, col), width));
+                wrappedCol = _mm256_sub_epi32(wrappedCol, _mm256_andnot_si256(_mm256_cmpgt_epi32(width, wrappedCol), width));
+                wrappedRow = _mm256_add_epi32(row, _mm256_and_si256(_mm256_cmpgt_epi32(zero, row), height));
+                wrappedRow = _mm256_sub_epi32(wrappedRow, _mm256_andnot_si256(_mm256_cmpgt_epi32(height, wrappedRow), height));
+            }
+            // Lanes past the window's last cell are masked off like walls
+            __m256i valid = _mm256_and_si256(_mm256_cmpgt_epi32(wrappedCol, minusOne),
+                                             _mm256_cmpgt_epi32(width, wrappedCol));
+            valid = _mm256_and_si256(valid, _mm256_and_si256(_mm256_cmpgt_epi32(wrappedRow, minusOne),
+                                                             _mm256_cmpgt_epi32(height, wrappedRow)));
+            valid = _mm256_and_si256(valid, _mm256_cmpgt_epi32(_mm256_set1_epi32(area - i), laneIndex));
+
+            __m256i index = _mm256_and_si256(_mm256_add_epi32(_mm256_mullo_epi32(wrappedRow, width), wrappedCol), valid);
+            __m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, three), 3);
+            __m256i cells = _mm256_mask_i32gather_epi32(wall, plane, _mm256_srli_epi32(index, 2), valid, 4);
+            cells = _mm256_srlv_epi32(cells, shift);
+
+            __m128i packed = _mm256_castsi256_si128(
+                _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(cells, packBytes), joinLanes));
+            if (area - i >= 8) {
+                _mm_storel_epi64((__m128i*)out, packed);
+                out += 8;
+            } else {
+                uint8_t bytes[8];
+                _mm_storel_epi64((__m128i*)bytes, packed);
+                std::memcpy(out, bytes, area - i);
+                out += area - i;
+            }
+
+            c = _mm256_add_epi32(c, stepCVector);
+            col = _mm256_add_epi32(col, stepCol);
+            row = _mm256_add_epi32(row, stepRow);
+            __m256i carry = _mm256_cmpgt_epi32(c, lastColumn);
+            c = _mm256_sub_epi32(c, _mm256_and_si256(carry, sizeVector));
+            col = _mm256_add_epi32(col, _mm256_and_si256(carry, carryCol));
+            row = _mm256_add_epi32(row, _mm256_and_si256(carry, carryRow));
+        }
+    }
+}
+#endif
+
+bool ObservationCrop::HasAvx2() {
+#ifdef SNEK_CROP_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void ObservationCrop::Extract(const SnekGame* games, const uint8_t* observations, int count, int size,
+                              uint8_t* out) {
+#ifdef SNEK_CROP_AVX2
+    if (HasAvx2()) {
+        ExtractAvx2(games, observations, count, size, out);
+        return;
+    }
+#endif
+    ExtractScalar(games, observations, count, size, out);
+}
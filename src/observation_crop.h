@@ -0,0 +1,29 @@
+#pragma once
+
+#include "snek_engine.h"
+#include <cstdint>
+
+namespace CropConstants {
+    // Largest window: a head in one corner still sees the far one
+    const int MAX_SIZE = 2 * (GameConstants::GRID_WIDTH < GameConstants::GRID_HEIGHT
+                              ? GameConstants::GRID_WIDTH : GameConstants::GRID_HEIGHT) + 1;
+}
+
+// Egocentric views for a batch: a size x size window around each game's
+// head, turned so the heading points up (row 0 is furthest ahead, the head
+// is in the middle, its right is on the right). Cells past a wall read as
+// SNEK_CELL_WALL, or wrap around while the game has canPassWalls. A game
+// that hasn't moved yet faces up.
+//
+// Windows are gathered from the batch's observation planes straight into
+// `out`, [count][size][size]. On x86 CPUs with AVX2 each row is gathered
+// 8 cells at a time; elsewhere the scalar version runs, with the same output.
+class ObservationCrop {
+public:
+    // Odd sizes from 1 to MAX_SIZE
+    static bool IsValidSize(int size);
+    static void Extract(const SnekGame* games, const uint8_t* observations, int count, int size, uint8_t* out);
+    // The reference version, and what Extract runs without AVX2
+    static void ExtractScalar(const SnekGame* games, const uint8_t* observations, int count, int size, uint8_t* out);
+    static bool HasAvx2();
+};
@@ -0,0 +1,160 @@
+#include "packed_body.h"
+
+// Step code from one cell to the next (wrapping), or -1 if they aren't adjacent
+static int StepCode(Position from, Position to, int width, int height) {
+    int dc = to.col - from.col;
+    int dr = to.row - from.row;
+    if (dc == width - 1) {
+        dc = -1;
+    } else if (dc == 1 - width) {
+        dc = 1;
+    }
+    if (dr == height - 1) {
+        dr = -1;
+    } else if (dr == 1 - height) {
+        dr = 1;
+    }
+    if (dc == 0 && dr == -1) {
+        return 0;
+    } else if (dc == 0 && dr == 1) {
+        return 1;
+    } else if (dr == 0 && dc == -1) {
+        return 2;
+    } else if (dr == 0 && dc == 1) {
+        return 3;
+    }
+    return -1;
+}
+
+void PackedBody::Clear() {
+    length = 0;
+    headCol = 0;
+    headRow = 0;
+    words.clear();
+    runs.clear();
+}
+
+bool PackedBody::Encode(const Position* body, size_t count, int boardWidth, int boardHeight) {
+    Clear();
+    if (boardWidth < 1 || boardWidth > PackedBodyConstants::MAX_BOARD_SIZE ||
+        boardHeight < 1 || boardHeight > PackedBodyConstants::MAX_BOARD_SIZE ||
+        count > (size_t)PackedBodyConstants::MAX_LENGTH) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Position& segment = body[i];
+        if (segment.col < 0 || segment.col >= boardWidth || segment.row < 0 || segment.row >= boardHeight) {
+            return false;
+        }
+    }
+    width = boardWidth;
+    height = boardHeight;
+    length = (int)count;
+    if (length == 0) {
+        return true;
+    }
+    headCol = body[0].col;
+    headRow = body[0].row;
+
+    words.assign((length - 1 + PackedBodyConstants::STEPS_PER_WORD - 1) / PackedBodyConstants::STEPS_PER_WORD, 0);
+    for (int i = 1; i < length; i++) {
+        int code = StepCode(body[i - 1], body[i], width, height);
+        if (code >= 0) {
+            words[(i - 1) / PackedBodyConstants::STEPS_PER_WORD] |=
+                (uint64_t)code << (2 * ((i - 1) % PackedBodyConstants::STEPS_PER_WORD));
+            continue;
+        }
+        // Extend the previous run when this segment stacks on it
+        if (!runs.empty() && runs.back().index + runs.back().count == i &&
+            runs.back().col == body[i].col && runs.back().row == body[i].row) {
+            runs.back().count++;
+        } else {
+            runs.push_back({(uint16_t)i, 1, (uint8_t)body[i].col, (uint8_t)body[i].row});
+        }
+    }
+    return true;
+}
+
+void PackedBody::Reserve(int maxLength) {
+    words.reserve((maxLength + PackedBodyConstants::STEPS_PER_WORD - 1) / PackedBodyConstants::STEPS_PER_WORD);
+    runs.reserve(maxLength);
+}
+
+void PackedBody::Write(ByteWriter& writer) const {
+    writer.VarU32((uint32_t)length);
+    if (length == 0) {
+        return;
+    }
+    writer.U8((uint8_t)(width - 1));
+    writer.U8((uint8_t)(height - 1));
+    writer.U8((uint8_t)headCol);
+    writer.U8((uint8_t)headRow);
+
+    // Run starts as gaps from the end of the run before
+    writer.VarU32((uint32_t)runs.size());
+    int end = 1;
+    for (const auto& run : runs) {
+        writer.VarU32((uint32_t)(run.index - end));
+        writer.VarU32(run.count);
+        writer.U8(run.col);
+        writer.U8(run.row);
+        end = run.index + run.count;
+    }
+
+    size_t stepBytes = ((size_t)(length - 1) * 2 + 7) / 8;
+    for (size_t i = 0; i < stepBytes; i++) {
+        writer.U8((uint8_t)(words[i / 8] >> (8 * (i % 8))));
+    }
+}
+
+bool PackedBody::Read(ByteReader& reader) {
+    Clear();
+    uint32_t count = reader.VarU32();
+    // Every four segments take at least a byte of steps
+    if (!reader.Ok() || count > (uint32_t)PackedBodyConstants::MAX_LENGTH ||
+        (count > 0 && (count - 1) / 4 > reader.Remaining())) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    width = reader.U8() + 1;
+    height = reader.U8() + 1;
+    headCol = reader.U8();
+    headRow = reader.U8();
+    if (headCol >= width || headRow >= height) {
+        return false;
+    }
+
+    uint32_t runCount = reader.VarU32();
+    if (!reader.Ok() || runCount > count || runCount > reader.Remaining() / 4) {
+        return false;
+    }
+    runs.resize(runCount);
+    uint32_t end = 1;
+    for (auto& run : runs) {
+        uint32_t index = end + reader.VarU32();
+        uint32_t runLength = reader.VarU32();
+        run.col = reader.U8();
+        run.row = reader.U8();
+        if (!reader.Ok() || runLength == 0 || index + runLength > count ||
+            run.col >= width || run.row >= height) {
+            return false;
+        }
+        run.index = (uint16_t)index;
+        run.count = (uint16_t)runLength;
+        end = index + runLength;
+    }
+
+    length = (int)count;
+    words.assign((length - 1 + PackedBodyConstants::STEPS_PER_WORD - 1) / PackedBodyConstants::STEPS_PER_WORD, 0);
+    size_t stepBytes = ((size_t)(length - 1) * 2 + 7) / 8;
+    for (size_t i = 0; i < stepBytes; i++) {
+        words[i / 8] |= (uint64_t)reader.U8() << (8 * (i % 8));
+    }
+    if (!reader.Ok()) {
+        Clear();
+        return false;
+    }
+    return true;
+}
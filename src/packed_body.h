@@ -0,0 +1,140 @@
+#pragma once
+
+#include "byte_buffer.h"
+#include "game_types.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PackedBodyConstants {
+    const int STEPS_PER_WORD = 32;
+    // Coordinates are stored in a byte, lengths and run indices in 16 bits
+    const int MAX_BOARD_SIZE = 256;
+    const int MAX_LENGTH = 65535;
+}
+
+// A snake body as its head cell plus a 2-bit step (up, down, left, right) from
+// each segment to the next, 32 steps to a 64-bit word: a 500-segment snake
+// takes 128 bytes of steps instead of 4 KB of Positions. Steps wrap around the
+// board, so wall wraps are ordinary steps. Segments that aren't one step from
+// the one before (the stacked tail after growth, teleport clamping against a
+// wall) are stored as runs of segments on one cell, in body order.
+class PackedBody {
+public:
+    // False (and empty) if the board is too big or a segment is off it
+    bool Encode(const Position* body, size_t count,
+                int boardWidth = GameConstants::GRID_WIDTH,
+                int boardHeight = GameConstants::GRID_HEIGHT);
+    // Any contiguous body: std::vector, SnakeBody
+    template <class Body>
+    bool Encode(const Body& body,
+                int boardWidth = GameConstants::GRID_WIDTH,
+                int boardHeight = GameConstants::GRID_HEIGHT) {
+        return Encode(body.data(), body.size(), boardWidth, boardHeight);
+    }
+    // False if `out` has a fixed capacity too small for the body
+    template <class Body>
+    bool Decode(Body& out) const;
+    // Sizes the buffers for bodies up to maxLength so encoding them never allocates
+    void Reserve(int maxLength);
+    // Calls fn(Position) for every segment, head first
+    template <class Fn>
+    void ForEach(Fn&& fn) const;
+
+    int GetLength() const { return length; }
+    Position GetHead() const { return {headCol, headRow}; }
+    size_t GetRunCount() const { return runs.size(); }
+    // Steps and runs, not counting the vectors' own bookkeeping
+    size_t GetBytes() const { return words.size() * sizeof(uint64_t) + runs.size() * sizeof(Run); }
+
+    // Head, runs, then the step words trimmed to whole bytes
+    void Write(ByteWriter& writer) const;
+    // False on malformed input (runs out of order, cells off the board)
+    bool Read(ByteReader& reader);
+
+private:
+    // Segments [index, index + count) all sit on (col, row)
+    struct Run {
+        uint16_t index;
+        uint16_t count;
+        uint8_t col;
+        uint8_t row;
+    };
+
+    void Clear();
+
+    int width = GameConstants::GRID_WIDTH;
+    int height = GameConstants::GRID_HEIGHT;
+    int length = 0;
+    int headCol = 0;
+    int headRow = 0;
+    std::vector<uint64_t> words;    // step from segment i - 1 to i at bit 2 * (i - 1)
+    std::vector<Run> runs;
+};
+
+namespace PackedBodySteps {
+    // Indexed by step code
+    const int DX[4] = {0, 0, -1, 1};
+    const int DY[4] = {-1, 1, 0, 0};
+}
+
+template <class Body>
+bool PackedBody::Decode(Body& out) const {
+    out.resize(length);
+    if (out.size() != (size_t)length) {
+        out.clear();
+        return false;
+    }
+    Position* next = out.data();
+    ForEach([&next](Position segment) { *next++ = segment; });
+    return true;
+}
+
+template <class Fn>
+void PackedBody::ForEach(Fn&& fn) const {
+    if (length == 0) {
+        return;
+    }
+    int col = headCol;
+    int row = headRow;
+    fn(Position{col, row});
+
+    size_t nextRun = 0;
+    int i = 1;
+    while (i < length) {
+        int stop = (nextRun < runs.size()) ? runs[nextRun].index : length;
+        // Plain steps up to the next run, one word at a time
+        while (i < stop) {
+            uint64_t word = words[(i - 1) / PackedBodyConstants::STEPS_PER_WORD] >>
+                            (2 * ((i - 1) % PackedBodyConstants::STEPS_PER_WORD));
+            int wordEnd = std::min(stop, (i - 1) - (i - 1) % PackedBodyConstants::STEPS_PER_WORD +
+                                             PackedBodyConstants::STEPS_PER_WORD + 1);
+            for (; i < wordEnd; i++, word >>= 2) {
+                int code = (int)(word & 3);
+                col += PackedBodySteps::DX[code];
+                row += PackedBodySteps::DY[code];
+                if (col < 0) {
+                    col += width;
+                } else if (col >= width) {
+                    col -= width;
+                }
+                if (row < 0) {
+                    row += height;
+                } else if (row >= height) {
+                    row -= height;
+                }
+                fn(Position{col, row});
+            }
+        }
+        if (nextRun < runs.size()) {
+            const Run& run = runs[nextRun++];
+            col = run.col;
+            row = run.row;
+            for (int k = 0; k < run.count; k++) {
+                fn(Position{col, row});
+            }
+            i += run.count;
+        }
+    }
+}
@@ -1,27 +1,140 @@
 #include "renderer.h"
 #include "game_types.h"
 #include "raylib.h"
-#include <string>
+#include <cstdio>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+Color Renderer::GetFoodColor(FoodType type) {
+    if (type == POMME_SUPREME) {
+        return GameConstants::ENCHANTED_GOLD_COLOR;
+    } else if (type == POMME_PLUS) {
+        return GameConstants::GOLD_COLOR;
+    } else if (type == POISONOUS) {
+        return GameConstants::POISON_COLOR;
+    } else if (type == TELEPORT) {
+        return GameConstants::PURPLE_COLOR;
+    }
+    return RED;
+}
+
+// Board rectangle in cells (fractions allowed), clipped to the board so a
+// sliding cell never covers the border
+static void DrawBoardRect(float col, float row, float width, float height, Color color) {
+    float left = std::max(col, 0.0f);
+    float top = std::max(row, 0.0f);
+    float right = std::min(col + width, (float)GameConstants::GRID_WIDTH);
+    float bottom = std::min(row + height, (float)GameConstants::GRID_HEIGHT);
+    if (right <= left || bottom <= top) {
+        return;
+    }
+    const float cellSize = (float)GameConstants::CELL_SIZE;
+    DrawRectangleRec({(left + GameConstants::BORDER_OFFSET) * cellSize,
+                      GameConstants::BOARD_START_Y + (top + GameConstants::BORDER_OFFSET) * cellSize,
+                      (right - left) * cellSize, (bottom - top) * cellSize}, color);
+}
+
+// A cell moved `offset` cells along (dx, dy). While walls wrap, the part
+// past an edge comes back in at the opposite one.
+static void DrawSlidingCell(Position cell, int dx, int dy, float offset, bool wrap, Color color) {
+    float col = cell.col + dx * offset;
+    float row = cell.row + dy * offset;
+    DrawBoardRect(col, row, 1.0f, 1.0f, color);
+    if (wrap && (dx != 0 || dy != 0)) {
+        DrawBoardRect(col - dx * GameConstants::GRID_WIDTH, row - dy * GameConstants::GRID_HEIGHT, 1.0f, 1.0f, color);
+    }
+}
+
+// One step from `from` to the adjacent `to`, across a wrapped edge too;
+// zero if they aren't neighbours (stacked segments, a clamped teleport)
+static void StepBetween(Position from, Position to, int& dx, int& dy) {
+    dx = to.col - from.col;
+    dy = to.row - from.row;
+    if (dx == GameConstants::GRID_WIDTH - 1 || dx == -(GameConstants::GRID_WIDTH - 1)) {
+        dx = (dx > 0) ? -1 : 1;
+    }
+    if (dy == GameConstants::GRID_HEIGHT - 1 || dy == -(GameConstants::GRID_HEIGHT - 1)) {
+        dy = (dy > 0) ? -1 : 1;
+    }
+    if (std::abs(dx) + std::abs(dy) != 1) {
+        dx = 0;
+        dy = 0;
+    }
+}
+
+SnakeMotion Renderer::GetSnakeMotion(const GameState& state) {
+    SnakeMotion motion;
+    if (state.snake.empty() || state.gameOver || state.isPaused || state.isUserPaused || state.isResuming) {
+        return motion;
+    }
+    // The direction the next move takes (GameLogic::ProcessDirectionQueue)
+    int dx = state.dx;
+    int dy = state.dy;
+    if (!state.directionQueue.empty()) {
+        Direction next = state.directionQueue.front();
+        if ((dx == 0 && dy == 0) || next.dx != -dx || next.dy != -dy) {
+            dx = next.dx;
+            dy = next.dy;
+        }
+    }
+    if (dx == 0 && dy == 0) {
+        return motion;
+    }
+    Position head = state.snake[0];
+    Position next = {head.col + dx, head.row + dy};
+    bool offBoard = next.col < 0 || next.col >= GameConstants::GRID_WIDTH ||
+                    next.row < 0 || next.row >= GameConstants::GRID_HEIGHT;
+    if (offBoard && !state.canPassWalls) {
+        return motion;
+    }
+    next.col = (next.col + GameConstants::GRID_WIDTH) % GameConstants::GRID_WIDTH;
+    next.row = (next.row + GameConstants::GRID_HEIGHT) % GameConstants::GRID_HEIGHT;
+
+    float interval = MoveIntervalAt(state.GetRules(), state.score);
+    motion.fraction = std::min(std::max(state.moveTimer / interval, 0.0f), 1.0f);
+    motion.headDx = dx;
+    motion.headDy = dy;
+
+    // The tail holds still when the next move grows the snake: an apple that
+    // will be eaten ahead, or a tail still doubled from the last one
+    bool grows = false;
+    for (const auto& apple : state.apples) {
+        if (apple.col == next.col && apple.row == next.row) {
+            grows = apple.type == POMME_PLUS || apple.type == POMME_SUPREME || apple.type == POISONOUS ||
+                    (apple.type == REGULAR && !state.cannotEatApples);
+        }
+    }
+    size_t length = state.snake.size();
+    if (length == 1) {
+        if (!grows) {
+            motion.tailDx = dx;
+            motion.tailDy = dy;
+        }
+    } else if (!grows) {
+        StepBetween(state.snake[length - 1], state.snake[length - 2], motion.tailDx, motion.tailDy);
+    }
+    return motion;
+}
 
 void Renderer::DrawModeSelectionScreen(const GameState& state) {
     ClearBackground(BLACK);
     
     // Title
     const int titleFontSize = 60;
-    std::string titleText = "SNAKE GAME";
-    int titleWidth = MeasureText(titleText.c_str(), titleFontSize);
+    const char* titleText = "SNAKE GAME";
+    int titleWidth = MeasureText(titleText, titleFontSize);
     int titleX = (GameConstants::SCREEN_WIDTH - titleWidth) / 2;
     int titleY = 150;
-    DrawText(titleText.c_str(), titleX, titleY, titleFontSize, WHITE);
+    DrawText(titleText, titleX, titleY, titleFontSize, WHITE);
     
     // Subtitle
     const int subtitleFontSize = 32;
-    std::string subtitleText = "Select Game Mode";
-    int subtitleWidth = MeasureText(subtitleText.c_str(), subtitleFontSize);
+    const char* subtitleText = "Select Game Mode";
+    int subtitleWidth = MeasureText(subtitleText, subtitleFontSize);
     int subtitleX = (GameConstants::SCREEN_WIDTH - subtitleWidth) / 2;
     int subtitleY = titleY + 80;
-    DrawText(subtitleText.c_str(), subtitleX, subtitleY, subtitleFontSize, YELLOW);
+    DrawText(subtitleText, subtitleX, subtitleY, subtitleFontSize, YELLOW);
     
     // Mode options
     const int modeFontSize = 36;
@@ -31,19 +144,31 @@ void Renderer::DrawModeSelectionScreen(const GameState& state) {
     
     // Regular mode
     Color regularColor = (state.selectedModeIndex == 0) ? GREEN : LIGHTGRAY;
-    std::string regularText = "Regular";
-    int regularTextWidth = MeasureText(regularText.c_str(), modeFontSize);
+    const char* regularText = "Regular";
+    int regularTextWidth = MeasureText(regularText, modeFontSize);
     int regularX = modeX - regularTextWidth / 2;
     int regularY = modeStartY;
-    DrawText(regularText.c_str(), regularX, regularY, modeFontSize, regularColor);
+    DrawText(regularText, regularX, regularY, modeFontSize, regularColor);
     
     // Accelerated mode
     Color acceleratedColor = (state.selectedModeIndex == 1) ? GREEN : LIGHTGRAY;
-    std::string acceleratedText = "Accelerated";
-    int acceleratedTextWidth = MeasureText(acceleratedText.c_str(), modeFontSize);
+    const char* acceleratedText = "Accelerated";
+    int acceleratedTextWidth = MeasureText(acceleratedText, modeFontSize);
     int acceleratedX = modeX - acceleratedTextWidth / 2;
     int acceleratedY = modeStartY + modeSpacing;
-    DrawText(acceleratedText.c_str(), acceleratedX, acceleratedY, modeFontSize, acceleratedColor);
+    DrawText(acceleratedText, acceleratedX, acceleratedY, modeFontSize, acceleratedColor);
+    int lastModeY = acceleratedY;
+    
+    // Custom mode, when rules were loaded with --rules
+    if (!state.customRules.name.empty()) {
+        Color customColor = (state.selectedModeIndex == 2) ? GREEN : LIGHTGRAY;
+        const char* customText = state.customRules.name.c_str();
+        int customTextWidth = MeasureText(customText, modeFontSize);
+        int customX = modeX - customTextWidth / 2;
+        int customY = modeStartY + 2 * modeSpacing;
+        DrawText(customText, customX, customY, modeFontSize, customColor);
+        lastModeY = customY;
+    }
     
     // Selection indicator
     const int arrowSize = 20;
@@ -53,11 +178,11 @@ void Renderer::DrawModeSelectionScreen(const GameState& state) {
     
     // Instructions
     const int instructionFontSize = 20;
-    std::string instructionText = "Use UP/DOWN or W/S to select, SPACE or ENTER to confirm";
-    int instructionWidth = MeasureText(instructionText.c_str(), instructionFontSize);
+    const char* instructionText = "Use UP/DOWN or W/S to select, SPACE or ENTER to confirm";
+    int instructionWidth = MeasureText(instructionText, instructionFontSize);
     int instructionX = (GameConstants::SCREEN_WIDTH - instructionWidth) / 2;
-    int instructionY = acceleratedY + modeSpacing + 40;
-    DrawText(instructionText.c_str(), instructionX, instructionY, instructionFontSize, LIGHTGRAY);
+    int instructionY = lastModeY + modeSpacing + 40;
+    DrawText(instructionText, instructionX, instructionY, instructionFontSize, LIGHTGRAY);
 }
 
 void Renderer::DrawInstructionsScreen() {
@@ -65,19 +190,19 @@ void Renderer::DrawInstructionsScreen() {
     
     // Title
     const int titleFontSize = 50;
-    std::string titleText = "SNAKE GAME";
-    int titleWidth = MeasureText(titleText.c_str(), titleFontSize);
+    const char* titleText = "SNAKE GAME";
+    int titleWidth = MeasureText(titleText, titleFontSize);
     int titleX = (GameConstants::SCREEN_WIDTH - titleWidth) / 2;
     int titleY = 40;
-    DrawText(titleText.c_str(), titleX, titleY, titleFontSize, WHITE);
+    DrawText(titleText, titleX, titleY, titleFontSize, WHITE);
     
     // Instructions header
     const int headerFontSize = 32;
-    std::string headerText = "APPLE TYPES";
-    int headerWidth = MeasureText(headerText.c_str(), headerFontSize);
+    const char* headerText = "APPLE TYPES";
+    int headerWidth = MeasureText(headerText, headerFontSize);
     int headerX = (GameConstants::SCREEN_WIDTH - headerWidth) / 2;
     int headerY = titleY + 70;
-    DrawText(headerText.c_str(), headerX, headerY, headerFontSize, YELLOW);
+    DrawText(headerText, headerX, headerY, headerFontSize, YELLOW);
     
     // Apple type instructions
     const int textFontSize = 20;
@@ -88,47 +213,47 @@ void Renderer::DrawInstructionsScreen() {
     
     // Regular Apple
     DrawRectangle(leftMargin - 35, currentY - 2, 25, 25, RED);
-    std::string regularText = "Regular Apple (Red) - 82%: Score +1, Grow +2 units";
-    DrawText(regularText.c_str(), leftMargin, currentY, textFontSize, WHITE);
+    const char* regularText = "Regular Apple (Red) - 82%: Score +1, Grow +2 units";
+    DrawText(regularText, leftMargin, currentY, textFontSize, WHITE);
     currentY += lineHeight;
     
     // Poisonous Apple
     DrawRectangle(leftMargin - 35, currentY - 2, 25, 25, GameConstants::POISON_COLOR);
-    std::string poisonText = "Poisonous Apple (Brown) - 10%: Reverses direction, 10s debuff";
-    DrawText(poisonText.c_str(), leftMargin, currentY, textFontSize, WHITE);
-    std::string poisonSubText = "  Cannot eat regular/purple apples during debuff";
-    DrawText(poisonSubText.c_str(), leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
+    const char* poisonText = "Poisonous Apple (Brown) - 10%: Reverses direction, 10s debuff";
+    DrawText(poisonText, leftMargin, currentY, textFontSize, WHITE);
+    const char* poisonSubText = "  Cannot eat regular/purple apples during debuff";
+    DrawText(poisonSubText, leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
     currentY += lineHeight * 2;
     
     // Pomme Plus
     DrawRectangle(leftMargin - 35, currentY - 2, 25, 25, GameConstants::GOLD_COLOR);
-    std::string pommePlusText = "Pomme Plus (Orange) - 4%: Score +2, Resistance 10s";
-    DrawText(pommePlusText.c_str(), leftMargin, currentY, textFontSize, WHITE);
-    std::string pommePlusSubText = "  Can pass through own body, works when poisoned";
-    DrawText(pommePlusSubText.c_str(), leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
+    const char* pommePlusText = "Pomme Plus (Orange) - 4%: Score +2, Resistance 10s";
+    DrawText(pommePlusText, leftMargin, currentY, textFontSize, WHITE);
+    const char* pommePlusSubText = "  Can pass through own body, works when poisoned";
+    DrawText(pommePlusSubText, leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
     currentY += lineHeight * 2;
     
     // Pomme Supreme
     DrawRectangle(leftMargin - 35, currentY - 2, 25, 25, GameConstants::ENCHANTED_GOLD_COLOR);
-    std::string pommeText = "Pomme Supreme (Yellow) - 1%: Score +2, Resistance II 10s";
-    DrawText(pommeText.c_str(), leftMargin, currentY, textFontSize, WHITE);
-    std::string pommeSubText = "  Pass through body + walls, works when poisoned";
-    DrawText(pommeSubText.c_str(), leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
+    const char* pommeText = "Pomme Supreme (Yellow) - 1%: Score +2, Resistance II 10s";
+    DrawText(pommeText, leftMargin, currentY, textFontSize, WHITE);
+    const char* pommeSubText = "  Pass through body + walls, works when poisoned";
+    DrawText(pommeSubText, leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
     currentY += lineHeight * 2;
     
     // Purple Apple
     DrawRectangle(leftMargin - 35, currentY - 2, 25, 25, GameConstants::PURPLE_COLOR);
-    std::string purpleText = "Purple Apple (Purple) - 3%: Teleport to random location";
-    DrawText(purpleText.c_str(), leftMargin, currentY, textFontSize, WHITE);
-    std::string purpleSubText = "  No growth, cannot be eaten when poisoned";
-    DrawText(purpleSubText.c_str(), leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
+    const char* purpleText = "Purple Apple (Purple) - 3%: Teleport to random location";
+    DrawText(purpleText, leftMargin, currentY, textFontSize, WHITE);
+    const char* purpleSubText = "  No growth, cannot be eaten when poisoned";
+    DrawText(purpleSubText, leftMargin + 10, currentY + lineHeight - 5, textFontSize - 2, LIGHTGRAY);
     currentY += lineHeight * 2 + 20;
     
     // Controls header
-    std::string controlsHeader = "CONTROLS";
-    int controlsHeaderWidth = MeasureText(controlsHeader.c_str(), headerFontSize);
+    const char* controlsHeader = "CONTROLS";
+    int controlsHeaderWidth = MeasureText(controlsHeader, headerFontSize);
     int controlsHeaderX = (GameConstants::SCREEN_WIDTH - controlsHeaderWidth) / 2;
-    DrawText(controlsHeader.c_str(), controlsHeaderX, currentY, headerFontSize, YELLOW);
+    DrawText(controlsHeader, controlsHeaderX, currentY, headerFontSize, YELLOW);
     currentY += lineHeight + 10;
     
     // Controls
@@ -141,13 +266,17 @@ void Renderer::DrawInstructionsScreen() {
     DrawText("ESC - Exit game", leftMargin, currentY, textFontSize, WHITE);
     currentY += lineHeight;
     DrawText("R / Space - Restart (on game over)", leftMargin, currentY, textFontSize, WHITE);
+    currentY += lineHeight;
+    DrawText("Backspace (hold) - Rewind", leftMargin, currentY, textFontSize, WHITE);
+    currentY += lineHeight;
+    DrawText("Tab - Autopilot on/off", leftMargin, currentY, textFontSize, WHITE);
     currentY += lineHeight * 2;
     
     // Start prompt
-    std::string startText = "Press SPACE or ENTER to start";
-    int startTextWidth = MeasureText(startText.c_str(), textFontSize + 4);
+    const char* startText = "Press SPACE or ENTER to start";
+    int startTextWidth = MeasureText(startText, textFontSize + 4);
     int startTextX = (GameConstants::SCREEN_WIDTH - startTextWidth) / 2;
-    DrawText(startText.c_str(), startTextX, currentY, textFontSize + 4, GREEN);
+    DrawText(startText, startTextX, currentY, textFontSize + 4, GREEN);
 }
 
 void Renderer::DrawGame(const GameState& state) {
@@ -159,18 +288,18 @@ void Renderer::DrawGame(const GameState& state) {
     
     // Draw score text
     const int fontSize = 40;
-    std::string scoreText = "Score: " + std::to_string(state.score);
-    int textWidth = MeasureText(scoreText.c_str(), fontSize);
+    const char* scoreText = TextFormat("Score: %d", state.score);
+    int textWidth = MeasureText(scoreText, fontSize);
     int textX = (GameConstants::SCREEN_WIDTH - textWidth) / 2;
     int textY = (GameConstants::SCORE_AREA_HEIGHT - fontSize) / 2;
-    DrawText(scoreText.c_str(), textX, textY, fontSize, WHITE);
+    DrawText(scoreText, textX, textY, fontSize, WHITE);
     
     // Draw high score text
     const int highScoreFontSize = 24;
-    std::string highScoreText = "High: " + std::to_string(state.GetCurrentHighScore());
-    int highScoreX = GameConstants::SCREEN_WIDTH - MeasureText(highScoreText.c_str(), highScoreFontSize) - 20;
+    const char* highScoreText = TextFormat("High: %d", state.GetCurrentHighScore());
+    int highScoreX = GameConstants::SCREEN_WIDTH - MeasureText(highScoreText, highScoreFontSize) - 20;
     int highScoreY = (GameConstants::SCORE_AREA_HEIGHT - highScoreFontSize) / 2;
-    DrawText(highScoreText.c_str(), highScoreX, highScoreY, highScoreFontSize, LIGHTGRAY);
+    DrawText(highScoreText, highScoreX, highScoreY, highScoreFontSize, LIGHTGRAY);
     
     // Draw status effects
     const int statusFontSize = 18;
@@ -179,25 +308,25 @@ void Renderer::DrawGame(const GameState& state) {
     
     if (state.cannotEatApples && state.cannotEatTimer > 0.0f) {
         int countdown = (int)std::ceil(state.cannotEatTimer);
-        std::string statusText = "Poisoned: " + std::to_string(countdown);
-        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText.c_str(), statusFontSize) - statusRightMargin;
-        DrawText(statusText.c_str(), statusX, statusY, statusFontSize, GameConstants::POISON_COLOR);
+        const char* statusText = TextFormat("Poisoned: %d", countdown);
+        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText, statusFontSize) - statusRightMargin;
+        DrawText(statusText, statusX, statusY, statusFontSize, GameConstants::POISON_COLOR);
         statusY += statusFontSize + 3;
     }
     
     if (state.canIntersectSelf && state.immunityTimer > 0.0f) {
         int countdown = (int)std::ceil(state.immunityTimer);
-        std::string statusText = "Resistance: " + std::to_string(countdown);
-        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText.c_str(), statusFontSize) - statusRightMargin;
-        DrawText(statusText.c_str(), statusX, statusY, statusFontSize, GameConstants::GOLD_COLOR);
+        const char* statusText = TextFormat("Resistance: %d", countdown);
+        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText, statusFontSize) - statusRightMargin;
+        DrawText(statusText, statusX, statusY, statusFontSize, GameConstants::GOLD_COLOR);
         statusY += statusFontSize + 3;
     }
     
     if (state.canPassWalls && state.wallImmunityTimer > 0.0f) {
         int countdown = (int)std::ceil(state.wallImmunityTimer);
-        std::string statusText = "Resistance II: " + std::to_string(countdown);
-        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText.c_str(), statusFontSize) - statusRightMargin;
-        DrawText(statusText.c_str(), statusX, statusY, statusFontSize, GameConstants::ENCHANTED_GOLD_COLOR);
+        const char* statusText = TextFormat("Resistance II: %d", countdown);
+        int statusX = GameConstants::SCREEN_WIDTH - MeasureText(statusText, statusFontSize) - statusRightMargin;
+        DrawText(statusText, statusX, statusY, statusFontSize, GameConstants::ENCHANTED_GOLD_COLOR);
     }
     
     // Draw white border
@@ -231,93 +360,141 @@ void Renderer::DrawGame(const GameState& state) {
     
     // Draw apples
     for (const auto& apple : state.apples) {
-        Color foodColor;
-        if (apple.type == POMME_SUPREME) {
-            foodColor = GameConstants::ENCHANTED_GOLD_COLOR;
-        } else if (apple.type == POMME_PLUS) {
-            foodColor = GameConstants::GOLD_COLOR;
-        } else if (apple.type == POISONOUS) {
-            foodColor = GameConstants::POISON_COLOR;
-        } else if (apple.type == TELEPORT) {
-            foodColor = GameConstants::PURPLE_COLOR;
-        } else {
-            foodColor = RED;
-        }
+        Color foodColor = GetFoodColor(apple.type);
         DrawRectangle((apple.col + GameConstants::BORDER_OFFSET) * cellSize, 
                      boardStartY + (apple.row + GameConstants::BORDER_OFFSET) * cellSize, 
                      cellSize, cellSize, foodColor);
     }
     
-    // Draw snake
-    for (size_t i = 1; i < state.snake.size(); i++) {
+    // Draw snake: whole cells between the ends, then the tail and head slid
+    // part of the way to where the next move puts them
+    if (state.snake.empty()) {
+        return;
+    }
+    SnakeMotion motion = GetSnakeMotion(state);
+    bool wrap = state.canPassWalls;
+    size_t length = state.snake.size();
+    for (size_t i = 1; i + 1 < length; i++) {
         const auto& segment = state.snake[i];
         DrawRectangle((segment.col + GameConstants::BORDER_OFFSET) * cellSize, 
                      boardStartY + (segment.row + GameConstants::BORDER_OFFSET) * cellSize, 
                      cellSize, cellSize, GameConstants::SNAKE_COLOR);
     }
     
-    if (!state.snake.empty()) {
-        const auto& head = state.snake[0];
+    const auto& head = state.snake[0];
+    DrawSlidingCell(state.snake[length - 1], motion.tailDx, motion.tailDy, motion.fraction, wrap,
+                    GameConstants::SNAKE_COLOR);
+    if (length > 1) {
+        // The head's own cell stays body until the move lands
         DrawRectangle((head.col + GameConstants::BORDER_OFFSET) * cellSize, 
                      boardStartY + (head.row + GameConstants::BORDER_OFFSET) * cellSize, 
-                     cellSize, cellSize, GameConstants::SNAKE_HEAD_COLOR);
+                     cellSize, cellSize, GameConstants::SNAKE_COLOR);
     }
+    DrawSlidingCell(head, motion.headDx, motion.headDy, motion.fraction, wrap, GameConstants::SNAKE_HEAD_COLOR);
 }
 
-void Renderer::DrawGameOverScreen(const GameState& state) {
+void Renderer::DrawGameOverScreen(const GameState& state, const ScoreStore& scores) {
     DrawRectangle(0, 0, GameConstants::SCREEN_WIDTH, GameConstants::SCREEN_HEIGHT, {0, 0, 0, 180});
     
     const int gameOverFontSize = 60;
-    std::string gameOverText = "GAME OVER";
-    int gameOverTextWidth = MeasureText(gameOverText.c_str(), gameOverFontSize);
+    const char* gameOverText = "GAME OVER";
+    int gameOverTextWidth = MeasureText(gameOverText, gameOverFontSize);
     int gameOverX = (GameConstants::SCREEN_WIDTH - gameOverTextWidth) / 2;
     int gameOverY = GameConstants::SCREEN_HEIGHT / 2 - 100;
-    DrawText(gameOverText.c_str(), gameOverX, gameOverY, gameOverFontSize, WHITE);
+    DrawText(gameOverText, gameOverX, gameOverY, gameOverFontSize, WHITE);
     
     const int finalScoreFontSize = 40;
-    std::string finalScoreText = "Final Score: " + std::to_string(state.score);
-    int finalScoreTextWidth = MeasureText(finalScoreText.c_str(), finalScoreFontSize);
+    const char* finalScoreText = TextFormat("Final Score: %d", state.score);
+    int finalScoreTextWidth = MeasureText(finalScoreText, finalScoreFontSize);
     int finalScoreX = (GameConstants::SCREEN_WIDTH - finalScoreTextWidth) / 2;
     int finalScoreY = gameOverY + 80;
-    DrawText(finalScoreText.c_str(), finalScoreX, finalScoreY, finalScoreFontSize, WHITE);
+    DrawText(finalScoreText, finalScoreX, finalScoreY, finalScoreFontSize, WHITE);
     
-    std::string highScoreText = "High Score: " + std::to_string(state.GetCurrentHighScore());
-    int highScoreTextWidth = MeasureText(highScoreText.c_str(), finalScoreFontSize);
+    LeaderboardEntry top[5];
+    int topCount = scores.GetTopScores(state.gameMode, top, 5);
+    int highScore = std::max(state.GetCurrentHighScore(), (topCount > 0) ? top[0].score : 0);
+    const char* highScoreText = TextFormat("High Score: %d", highScore);
+    int highScoreTextWidth = MeasureText(highScoreText, finalScoreFontSize);
     int highScoreX = (GameConstants::SCREEN_WIDTH - highScoreTextWidth) / 2;
     int highScoreY = finalScoreY + 60;
-    DrawText(highScoreText.c_str(), highScoreX, highScoreY, finalScoreFontSize, YELLOW);
+    DrawText(highScoreText, highScoreX, highScoreY, finalScoreFontSize, YELLOW);
     
     const int instructionFontSize = 24;
-    std::string restartText = "Press R or SPACE to restart";
-    std::string menuText = "Press M to return to menu";
-    std::string quitText = "Press ESC to exit or Q to quit";
-    int restartTextWidth = MeasureText(restartText.c_str(), instructionFontSize);
-    int menuTextWidth = MeasureText(menuText.c_str(), instructionFontSize);
-    int quitTextWidth = MeasureText(quitText.c_str(), instructionFontSize);
+    int leaderboardHeight = 0;
+    if (topCount > 1) {
+        char topText[128] = "Top:";
+        int topLength = 4;
+        for (int i = 0; i < topCount; i++) {
+            topLength += std::snprintf(topText + topLength, sizeof(topText) - topLength, "  %d", top[i].score);
+        }
+        int topTextWidth = MeasureText(topText, instructionFontSize);
+        DrawText(topText, (GameConstants::SCREEN_WIDTH - topTextWidth) / 2,
+                 highScoreY + 48, instructionFontSize, GOLD);
+        leaderboardHeight = 30;
+    }
+    
+    const char* restartText = "Press R or SPACE to restart";
+    const char* menuText = "Press M to return to menu";
+    const char* quitText = "Press ESC to exit or Q to quit";
+    int restartTextWidth = MeasureText(restartText, instructionFontSize);
+    int menuTextWidth = MeasureText(menuText, instructionFontSize);
+    int quitTextWidth = MeasureText(quitText, instructionFontSize);
     int restartX = (GameConstants::SCREEN_WIDTH - restartTextWidth) / 2;
     int menuX = (GameConstants::SCREEN_WIDTH - menuTextWidth) / 2;
     int quitX = (GameConstants::SCREEN_WIDTH - quitTextWidth) / 2;
-    int instructionY = highScoreY + 80;
-    DrawText(restartText.c_str(), restartX, instructionY, instructionFontSize, LIGHTGRAY);
-    DrawText(menuText.c_str(), menuX, instructionY + 35, instructionFontSize, LIGHTGRAY);
-    DrawText(quitText.c_str(), quitX, instructionY + 70, instructionFontSize, LIGHTGRAY);
+    int instructionY = highScoreY + 80 + leaderboardHeight;
+    DrawText(restartText, restartX, instructionY, instructionFontSize, LIGHTGRAY);
+    DrawText(menuText, menuX, instructionY + 35, instructionFontSize, LIGHTGRAY);
+    DrawText(quitText, quitX, instructionY + 70, instructionFontSize, LIGHTGRAY);
+}
+
+void Renderer::DrawRewindIndicator() {
+    const int fontSize = 30;
+    const char* rewindText = "<< REWIND";
+    int rewindTextWidth = MeasureText(rewindText, fontSize);
+    DrawText(rewindText, (GameConstants::SCREEN_WIDTH - rewindTextWidth) / 2,
+             GameConstants::BOARD_START_Y + 20, fontSize, SKYBLUE);
+}
+
+void Renderer::DrawAutopilotIndicator(bool active) {
+    const int fontSize = 20;
+    DrawText("AUTOPILOT", 20, GameConstants::BOARD_START_Y - fontSize - 6, fontSize, active ? SKYBLUE : DARKGRAY);
+}
+
+Rectangle Renderer::GetReplayBarBounds() {
+    const float margin = 20.0f;
+    const float height = 12.0f;
+    return {margin, GameConstants::SCREEN_HEIGHT - margin - height,
+            GameConstants::SCREEN_WIDTH - 2 * margin, height};
+}
+
+void Renderer::DrawReplayOverlay(uint32_t frame, uint32_t frameCount, int speed, bool paused) {
+    Rectangle bar = GetReplayBarBounds();
+    float progress = (frameCount > 0) ? (float)frame / frameCount : 0.0f;
+    DrawRectangleRec(bar, {0, 0, 0, 160});
+    DrawRectangleRec({bar.x, bar.y, bar.width * progress, bar.height}, GameConstants::SNAKE_COLOR);
+    
+    const int fontSize = 20;
+    const char* statusText = TextFormat("%s  %dx  frame %u / %u", paused ? "PAUSED" : "PLAYING",
+                                        speed, (unsigned)frame, (unsigned)frameCount);
+    DrawText(statusText, (int)bar.x, (int)bar.y - fontSize - 6, fontSize, LIGHTGRAY);
 }
 
 void Renderer::DrawPauseScreen(const GameState& state) {
     DrawRectangle(0, 0, GameConstants::SCREEN_WIDTH, GameConstants::SCREEN_HEIGHT, {0, 0, 0, 180});
     
     const int pauseFontSize = 60;
-    std::string pauseText = "PAUSED";
-    int pauseTextWidth = MeasureText(pauseText.c_str(), pauseFontSize);
+    const char* pauseText = "PAUSED";
+    int pauseTextWidth = MeasureText(pauseText, pauseFontSize);
     int pauseX = (GameConstants::SCREEN_WIDTH - pauseTextWidth) / 2;
     int pauseY = GameConstants::SCREEN_HEIGHT / 2 - 30;
-    DrawText(pauseText.c_str(), pauseX, pauseY, pauseFontSize, WHITE);
+    DrawText(pauseText, pauseX, pauseY, pauseFontSize, WHITE);
     
     const int instructionFontSize = 24;
-    std::string resumeText = "Press P to resume (or Q to quit)";
-    int resumeTextWidth = MeasureText(resumeText.c_str(), instructionFontSize);
+    const char* resumeText = "Press P to resume (or Q to quit)";
+    int resumeTextWidth = MeasureText(resumeText, instructionFontSize);
     int resumeX = (GameConstants::SCREEN_WIDTH - resumeTextWidth) / 2;
-    DrawText(resumeText.c_str(), resumeX, pauseY + 80, instructionFontSize, LIGHTGRAY);
+    DrawText(resumeText, resumeX, pauseY + 80, instructionFontSize, LIGHTGRAY);
 }
 
 void Renderer::DrawResumeCountdown(const GameState& state) {
@@ -325,10 +502,110 @@ void Renderer::DrawResumeCountdown(const GameState& state) {
     
     const int resumeFontSize = 40;
     int countdown = (int)std::ceil(state.resumeDelayTimer);
-    std::string resumeText = "Resuming in " + std::to_string(countdown) + "...";
-    int resumeTextWidth = MeasureText(resumeText.c_str(), resumeFontSize);
+    const char* resumeText = TextFormat("Resuming in %d...", countdown);
+    int resumeTextWidth = MeasureText(resumeText, resumeFontSize);
     int resumeX = (GameConstants::SCREEN_WIDTH - resumeTextWidth) / 2;
     int resumeY = GameConstants::SCREEN_HEIGHT / 2;
-    DrawText(resumeText.c_str(), resumeX, resumeY, resumeFontSize, WHITE);
+    DrawText(resumeText, resumeX, resumeY, resumeFontSize, WHITE);
 }
 
+
+void Renderer::DrawMultiSnakeGame(const MultiSnakeState& state, int localSnake,
+                                  const BoardCamera& camera, BoardLayerCache& layers) {
+    ClearBackground(BLACK);
+
+    const int gridWidth = state.config.gridWidth;
+    const int gridHeight = state.config.gridHeight;
+    const int cellSize = camera.GetCellSize();
+
+    // Score area: own score, players left
+    const int fontSize = 40;
+    int ownScore = (localSnake >= 0 && localSnake < (int)state.snakes.size()) ? state.snakes[localSnake].score : 0;
+    const char* scoreText = TextFormat("Score: %d", ownScore);
+    int textWidth = MeasureText(scoreText, fontSize);
+    DrawText(scoreText, (GameConstants::SCREEN_WIDTH - textWidth) / 2,
+             (GameConstants::SCORE_AREA_HEIGHT - fontSize) / 2, fontSize, WHITE);
+
+    const int aliveFontSize = 24;
+    const char* aliveText = TextFormat("Alive: %d/%d", state.aliveCount, (int)state.snakes.size());
+    int aliveX = GameConstants::SCREEN_WIDTH - MeasureText(aliveText, aliveFontSize) - 20;
+    DrawText(aliveText, aliveX, (GameConstants::SCORE_AREA_HEIGHT - aliveFontSize) / 2, aliveFontSize, LIGHTGRAY);
+
+    // Border and checkerboard from the cached chunks
+    layers.Draw(camera, gridWidth + 2 * GameConstants::BORDER_OFFSET, gridHeight + 2 * GameConstants::BORDER_OFFSET);
+    if (state.grid.width != gridWidth || state.grid.height != gridHeight) {
+        return;
+    }
+
+    // Snakes: the local one in the usual green, the rest spread around the hue wheel.
+    // Indexed by grid owner (snake id + 1).
+    Color bodyColors[MultiSnakeConstants::MAX_SNAKES + 1];
+    Color headColors[MultiSnakeConstants::MAX_SNAKES + 1];
+    int snakeCount = std::min((int)state.snakes.size(), MultiSnakeConstants::MAX_SNAKES);
+    for (int i = 0; i < snakeCount; i++) {
+        const auto& snake = state.snakes[i];
+        bodyColors[i + 1] = GameConstants::SNAKE_COLOR;
+        headColors[i + 1] = GameConstants::SNAKE_HEAD_COLOR;
+        if (snake.id != localSnake) {
+            float hue = 360.0f * snake.id / (float)state.snakes.size();
+            bodyColors[i + 1] = ColorFromHSV(hue, 0.6f, 0.8f);
+            headColors[i + 1] = ColorFromHSV(hue, 0.8f, 0.5f);
+        }
+    }
+
+    // Bodies and apples from the occupancy grid, visible cells only, with
+    // runs of one color along a row drawn as one rectangle
+    int minCol, minRow, maxCol, maxRow;
+    camera.GetVisibleCells(minCol, minRow, maxCol, maxRow);
+    minCol = std::max(minCol - GameConstants::BORDER_OFFSET, 0);
+    minRow = std::max(minRow - GameConstants::BORDER_OFFSET, 0);
+    maxCol = std::min(maxCol - GameConstants::BORDER_OFFSET, gridWidth);
+    maxRow = std::min(maxRow - GameConstants::BORDER_OFFSET, gridHeight);
+    const Rectangle& viewport = camera.viewport;
+    BeginScissorMode((int)viewport.x, (int)viewport.y, (int)viewport.width, (int)viewport.height);
+    for (int row = minRow; row < maxRow; row++) {
+        int y = camera.ScreenY(row + GameConstants::BORDER_OFFSET);
+        int runStart = -1;
+        Color runColor = BLANK;
+        for (int col = minCol; col <= maxCol; col++) {
+            bool filled = false;
+            Color color = BLANK;
+            if (col < maxCol) {
+                int cell = state.grid.Index(col, row);
+                if (state.grid.count[cell] > 0) {
+                    uint8_t owner = state.grid.owner[cell];
+                    color = (owner <= snakeCount) ? bodyColors[owner] : LIGHTGRAY;
+                    filled = true;
+                } else if (state.grid.apple[cell] >= 0) {
+                    color = GetFoodColor(state.apples[state.grid.apple[cell]].type);
+                    filled = true;
+                }
+            }
+            bool sameColor = color.r == runColor.r && color.g == runColor.g && color.b == runColor.b;
+            if (runStart >= 0 && (!filled || !sameColor)) {
+                DrawRectangle(camera.ScreenX(runStart + GameConstants::BORDER_OFFSET), y,
+                              (col - runStart) * cellSize, cellSize, runColor);
+                runStart = -1;
+            }
+            if (filled && runStart < 0) {
+                runStart = col;
+                runColor = color;
+            }
+        }
+    }
+
+    // Heads over their bodies, one per snake
+    for (int i = 0; i < snakeCount; i++) {
+        const auto& snake = state.snakes[i];
+        if (!snake.alive || snake.body.empty()) {
+            continue;
+        }
+        const auto& head = snake.body.front();
+        if (head.col >= minCol && head.col < maxCol && head.row >= minRow && head.row < maxRow) {
+            DrawRectangle(camera.ScreenX(head.col + GameConstants::BORDER_OFFSET),
+                          camera.ScreenY(head.row + GameConstants::BORDER_OFFSET),
+                          cellSize, cellSize, headColors[i + 1]);
+        }
+    }
+    EndScissorMode();
+}
@@ -1,14 +1,46 @@
 #pragma once
 
+#include "board_camera.h"
 #include "game_state.h"
+#include "multi_snake.h"
+#include "score_store.h"
+#include <cstdint>
+
+// How far the snake is drawn between moves: the head slides `fraction` of a
+// cell toward the cell it moves into next, and the tail the same toward the
+// segment ahead of it. A zero step leaves that end on its cell (a tail that
+// is about to grow, a snake that isn't moving or is about to hit a wall).
+struct SnakeMotion {
+    float fraction = 0.0f;
+    int headDx = 0;
+    int headDy = 0;
+    int tailDx = 0;
+    int tailDy = 0;
+};
 
 class Renderer {
 public:
     static void DrawModeSelectionScreen(const GameState& state);
     static void DrawInstructionsScreen();
+    // Draws the snake between its last move and the next (see GetSnakeMotion)
     static void DrawGame(const GameState& state);
-    static void DrawGameOverScreen(const GameState& state);
+    // Sub-move progress, moveTimer over the current interval, and which way
+    // each end is heading. Nothing moves while paused, poisoned or over.
+    static SnakeMotion GetSnakeMotion(const GameState& state);
+    static Color GetFoodColor(FoodType type);
+    // High score and top-5 line come from the result store when it's open
+    static void DrawGameOverScreen(const GameState& state, const ScoreStore& scores);
     static void DrawPauseScreen(const GameState& state);
     static void DrawResumeCountdown(const GameState& state);
+    static void DrawRewindIndicator();
+    // Corner label while the planner steers; greyed out when it can't (custom rules)
+    static void DrawAutopilotIndicator(bool active);
+    // Replay viewer progress bar along the bottom of the board, with frame and speed
+    static Rectangle GetReplayBarBounds();
+    static void DrawReplayOverlay(uint32_t frame, uint32_t frameCount, int speed, bool paused);
+    // Shared board through a camera; localSnake (-1 for none) is drawn in the usual green.
+    // Only cells in view are visited, so the cost doesn't grow with the board.
+    static void DrawMultiSnakeGame(const MultiSnakeState& state, int localSnake,
+                                   const BoardCamera& camera, BoardLayerCache& layers);
 };
 
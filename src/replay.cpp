@@ -0,0 +1,304 @@
+#include "replay.h"
+#include "byte_buffer.h"
+#include "game_logic.h"
+#include "state_codec.h"
+#include <algorithm>
+#include <cstring>
+
+static const char REPLAY_MAGIC[4] = {'S', 'N', 'K', 'P'};
+static const char FOOTER_MAGIC[4] = {'S', 'N', 'K', 'X'};
+static const size_t HEADER_SIZE = 12;
+static const size_t TRAILER_SIZE = 16;
+static const uint8_t TAG_KEYFRAME = 0x80;
+static const uint8_t TAG_NEW_DELTA = 0x40;
+static const size_t FLUSH_SIZE = 64 * 1024;
+
+ReplayWriter::~ReplayWriter() {
+    Finish();
+}
+
+bool ReplayWriter::Begin(const std::string& path, const GameState& start, uint32_t interval) {
+    Finish();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    buffer.clear();
+    keyframes.clear();
+    fileOffset = 0;
+    keyframeInterval = std::max(1u, interval);
+    frameCount = 0;
+    lastDelta = 0.0f;
+
+    ByteWriter writer(buffer);
+    writer.Bytes(REPLAY_MAGIC, 4);
+    writer.U32(ReplayConstants::VERSION);
+    writer.U32(keyframeInterval);
+    WriteKeyframe(start);
+    return true;
+}
+
+void ReplayWriter::WriteKeyframe(const GameState& state) {
+    scratch.clear();
+    ByteWriter stateWriter(scratch);
+    StateCodec::Write(stateWriter, state);
+
+    keyframes.push_back({frameCount, fileOffset + buffer.size()});
+    ByteWriter writer(buffer);
+    writer.U8(TAG_KEYFRAME);
+    writer.VarU32(frameCount);
+    writer.F32(lastDelta);
+    writer.VarU32((uint32_t)scratch.size());
+    writer.Bytes(scratch.data(), scratch.size());
+}
+
+void ReplayWriter::RecordFrame(float deltaTime, uint8_t input, const GameState& after) {
+    if (!file) {
+        return;
+    }
+    ByteWriter writer(buffer);
+    if (deltaTime != lastDelta) {
+        writer.U8((uint8_t)((input & FrameInput::ALL) | TAG_NEW_DELTA));
+        writer.F32(deltaTime);
+        lastDelta = deltaTime;
+    } else {
+        writer.U8((uint8_t)(input & FrameInput::ALL));
+    }
+    frameCount++;
+
+    if (frameCount % keyframeInterval == 0) {
+        WriteKeyframe(after);
+    }
+    if (buffer.size() >= FLUSH_SIZE) {
+        Flush();
+    }
+}
+
+void ReplayWriter::Flush() {
+    if (!buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        fileOffset += buffer.size();
+        buffer.clear();
+    }
+}
+
+bool ReplayWriter::Finish() {
+    if (!file) {
+        return false;
+    }
+    uint64_t footerOffset = fileOffset + buffer.size();
+    ByteWriter writer(buffer);
+    writer.VarU32((uint32_t)keyframes.size());
+    for (const auto& keyframe : keyframes) {
+        writer.VarU32(keyframe.first);
+        writer.U64(keyframe.second);
+    }
+    writer.U64(footerOffset);
+    writer.U32(frameCount);
+    writer.Bytes(FOOTER_MAGIC, 4);
+    Flush();
+
+    bool ok = std::ferror(file) == 0;
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool ReplayReader::Open(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        bytes.resize((size_t)size);
+        if (std::fread(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+            bytes.clear();
+        }
+    }
+    std::fclose(file);
+    return Load(std::move(bytes));
+}
+
+bool ReplayReader::Load(std::vector<uint8_t> bytes) {
+    data = std::move(bytes);
+    keyframes.clear();
+    hasState = false;
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), REPLAY_MAGIC, 4) != 0) {
+        return false;
+    }
+    ByteReader header(data.data() + 4, HEADER_SIZE - 4);
+    if (header.U32() != ReplayConstants::VERSION) {
+        return false;
+    }
+    keyframeInterval = header.U32();
+
+    if (!ReadFooter() && !ScanRecords()) {
+        return false;
+    }
+    return !keyframes.empty() && keyframes[0].frame == 0 && Seek(0);
+}
+
+bool ReplayReader::ReadFooter() {
+    if (data.size() < HEADER_SIZE + TRAILER_SIZE ||
+        std::memcmp(data.data() + data.size() - 4, FOOTER_MAGIC, 4) != 0) {
+        return false;
+    }
+    ByteReader trailer(data.data() + data.size() - TRAILER_SIZE, TRAILER_SIZE);
+    uint64_t footerOffset = trailer.U64();
+    uint32_t frames = trailer.U32();
+    if (footerOffset < HEADER_SIZE || footerOffset > data.size() - TRAILER_SIZE) {
+        return false;
+    }
+
+    ByteReader footer(data.data() + footerOffset, data.size() - TRAILER_SIZE - footerOffset);
+    uint32_t count = footer.VarU32();
+    if (!footer.Ok() || count > footer.Remaining() / 9) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Keyframe keyframe;
+        keyframe.frame = footer.VarU32();
+        keyframe.offset = footer.U64();
+        if (keyframe.offset >= footerOffset ||
+            (!keyframes.empty() && keyframe.frame <= keyframes.back().frame)) {
+            keyframes.clear();
+            return false;
+        }
+        keyframes.push_back(keyframe);
+    }
+    recordsEnd = (size_t)footerOffset;
+    frameCount = frames;
+    return footer.Ok();
+}
+
+bool ReplayReader::ScanRecords() {
+    keyframes.clear();
+    size_t offset = HEADER_SIZE;
+    uint32_t frames = 0;
+    while (offset < data.size()) {
+        ByteReader reader(data.data() + offset, data.size() - offset);
+        uint8_t tag = reader.U8();
+        if (tag == TAG_KEYFRAME) {
+            uint32_t keyframeFrame = reader.VarU32();
+            reader.F32();
+            uint32_t size = reader.VarU32();
+            if (!reader.Ok() || size > reader.Remaining() || keyframeFrame != frames) {
+                break;
+            }
+            keyframes.push_back({keyframeFrame, offset});
+            offset += reader.Offset() + size;
+            continue;
+        }
+        if (tag & TAG_NEW_DELTA) {
+            reader.F32();
+        }
+        if (!reader.Ok() || (tag & TAG_KEYFRAME)) {
+            break;
+        }
+        offset += reader.Offset();
+        frames++;
+    }
+    recordsEnd = offset;
+    frameCount = frames;
+    return !keyframes.empty();
+}
+
+bool ReplayReader::LoadKeyframe(size_t index) {
+    const Keyframe& keyframe = keyframes[index];
+    ByteReader reader(data.data() + keyframe.offset, recordsEnd - keyframe.offset);
+    if (reader.U8() != TAG_KEYFRAME || reader.VarU32() != keyframe.frame) {
+        return false;
+    }
+    float delta = reader.F32();
+    uint32_t size = reader.VarU32();
+    if (!reader.Ok() || size > reader.Remaining()) {
+        return false;
+    }
+    ByteReader stateReader(data.data() + keyframe.offset + reader.Offset(), size);
+    if (!StateCodec::Read(stateReader, state)) {
+        return false;
+    }
+    frame = keyframe.frame;
+    currentDelta = delta;
+    cursor = keyframe.offset + reader.Offset() + size;
+    return true;
+}
+
+bool ReplayReader::NextFrameRecord(size_t& offset, uint8_t& input, float& delta) const {
+    while (offset < recordsEnd) {
+        ByteReader reader(data.data() + offset, recordsEnd - offset);
+        uint8_t tag = reader.U8();
+        if (tag == TAG_KEYFRAME) {
+            reader.VarU32();
+            reader.F32();
+            uint32_t size = reader.VarU32();
+            if (!reader.Ok() || size > reader.Remaining()) {
+                return false;
+            }
+            offset += reader.Offset() + size;
+            continue;
+        }
+        if (tag & TAG_NEW_DELTA) {
+            delta = reader.F32();
+        }
+        if (!reader.Ok()) {
+            return false;
+        }
+        input = tag & FrameInput::ALL;
+        offset += reader.Offset();
+        return true;
+    }
+    return false;
+}
+
+bool ReplayReader::Seek(uint32_t target) {
+    target = std::min(target, frameCount);
+    lastSeekCost = 0;
+
+    // Stepping forward from where we are beats reloading a keyframe when the
+    // target is ahead and no later keyframe sits in between
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), target,
+        [](uint32_t f, const Keyframe& keyframe) { return f < keyframe.frame; });
+    size_t index = (size_t)(next - keyframes.begin()) - 1;
+    if (!hasState || !(target >= frame && frame >= keyframes[index].frame)) {
+        if (!LoadKeyframe(index)) {
+            return false;
+        }
+        hasState = true;
+    }
+    while (frame < target) {
+        if (!StepForward()) {
+            return false;
+        }
+        lastSeekCost++;
+    }
+    return true;
+}
+
+bool ReplayReader::StepForward() {
+    uint8_t input = 0;
+    size_t offset = cursor;
+    float delta = currentDelta;
+    if (frame >= frameCount || !NextFrameRecord(offset, input, delta)) {
+        return false;
+    }
+    GameLogic::RunFrame(state, delta, input);
+    cursor = offset;
+    currentDelta = delta;
+    frame++;
+    return true;
+}
+
+float ReplayReader::GetNextFrameDelta() const {
+    uint8_t input = 0;
+    size_t offset = cursor;
+    float delta = currentDelta;
+    if (frame >= frameCount || !NextFrameRecord(offset, input, delta)) {
+        return 0.0f;
+    }
+    return delta;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "game_state.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ReplayConstants {
+    // 2: food odds from the rules' alias table, custom rules in the state
+    // 3: packed snake bodies in keyframes
+    // 4: moves catch up on every elapsed interval, speed ramp in custom rules
+    const uint32_t VERSION = 4;
+    // Frames between keyframes: the most a seek ever has to re-simulate
+    const uint32_t DEFAULT_KEYFRAME_INTERVAL = 300;
+    const int MIN_SPEED = 1;
+    const int MAX_SPEED = 256;
+}
+
+// A recorded game: the state at the first frame, then every frame's delta
+// time and key presses (GameLogic::RunFrame replays them exactly), with a
+// compact keyframe of the full state every keyframeInterval frames.
+//
+//   header    "SNKP", version, keyframeInterval
+//   records   frame:    tag byte = FrameInput bits, bit 6 set if a new f32 dt follows
+//             keyframe: 0x80, varint frame, f32 dt, varint size, StateCodec bytes
+//   footer    varint count, (varint frame, u64 offset) per keyframe,
+//             then u64 footer offset, u32 frame count, "SNKX"
+//
+// A file without a footer (the game crashed while recording) is still
+// readable; the reader rebuilds the index by scanning the records.
+class ReplayWriter {
+public:
+    ~ReplayWriter();
+    bool Begin(const std::string& path, const GameState& start,
+               uint32_t keyframeInterval = ReplayConstants::DEFAULT_KEYFRAME_INTERVAL);
+    // `after` is the state once the frame has run; used for keyframes
+    void RecordFrame(float deltaTime, uint8_t input, const GameState& after);
+    bool Finish();
+    bool IsRecording() const { return file != nullptr; }
+    uint32_t GetFrameCount() const { return frameCount; }
+
+private:
+    void WriteKeyframe(const GameState& state);
+    void Flush();
+
+    FILE* file = nullptr;
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> scratch;
+    std::vector<std::pair<uint32_t, uint64_t>> keyframes;
+    uint64_t fileOffset = 0;
+    uint32_t keyframeInterval = ReplayConstants::DEFAULT_KEYFRAME_INTERVAL;
+    uint32_t frameCount = 0;
+    float lastDelta = 0.0f;
+};
+
+class ReplayReader {
+public:
+    bool Open(const std::string& path);
+    // Same as Open, from bytes already in memory
+    bool Load(std::vector<uint8_t> bytes);
+
+    uint32_t GetFrameCount() const { return frameCount; }
+    uint32_t GetKeyframeInterval() const { return keyframeInterval; }
+    size_t GetKeyframeCount() const { return keyframes.size(); }
+
+    // State after `frame` frames: decode the nearest keyframe at or before it,
+    // then re-simulate the rest (at most one keyframe interval)
+    bool Seek(uint32_t frame);
+    // Runs one more recorded frame; false at the end
+    bool StepForward();
+
+    uint32_t GetFrame() const { return frame; }
+    const GameState& GetState() const { return state; }
+    // Delta time of the frame StepForward would run next (0 at the end)
+    float GetNextFrameDelta() const;
+    // Frames re-simulated by the last Seek
+    uint32_t GetLastSeekCost() const { return lastSeekCost; }
+
+private:
+    struct Keyframe {
+        uint32_t frame;
+        uint64_t offset;
+    };
+
+    bool ReadFooter();
+    bool ScanRecords();
+    bool LoadKeyframe(size_t index);
+    // Skips keyframe records; reads the next frame record at `offset`
+    bool NextFrameRecord(size_t& offset, uint8_t& input, float& delta) const;
+
+    std::vector<uint8_t> data;
+    std::vector<Keyframe> keyframes;
+    size_t recordsEnd = 0;
+    uint32_t keyframeInterval = 0;
+    uint32_t frameCount = 0;
+
+    GameState state;
+    bool hasState = false;
+    uint32_t frame = 0;
+    size_t cursor = 0;
+    float currentDelta = 0.0f;
+    uint32_t lastSeekCost = 0;
+};
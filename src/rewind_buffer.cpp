@@ -0,0 +1,386 @@
+#include "rewind_buffer.h"
+#include "byte_buffer.h"
+#include "state_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Body ops: what one move did to the snake, undone in reverse
+    const uint8_t BODY_UNCHANGED = 0;   // not recorded
+    const uint8_t BODY_PUSHED = 1;      // head pushed, tail kept (ran into itself)
+    const uint8_t BODY_MOVED = 2;       // head pushed, tail popped; tail cell follows
+    const uint8_t BODY_GREW = 3;        // head pushed, tail duplicated
+    const uint8_t BODY_REPLACED = 4;    // poison or teleport; whole previous body follows
+
+    const uint32_t SCORE = 1 << 0;
+    const uint32_t HIGH_SCORES = 1 << 1;
+    const uint32_t DIRECTION = 1 << 2;
+    const uint32_t MOVE_COUNT = 1 << 3;
+    const uint32_t RNG = 1 << 4;
+    const uint32_t FLAGS = 1 << 5;
+    const uint32_t APPLES = 1 << 6;
+    const uint32_t QUEUE = 1 << 7;
+    const uint32_t HASH = 1 << 8;
+    const int TIMER_SHIFT = 9;          // one bit per timer from here up
+
+    float GameState::* const TIMERS[] = {
+        &GameState::moveTimer, &GameState::gameTime, &GameState::immunityTimer,
+        &GameState::wallImmunityTimer, &GameState::cannotEatTimer, &GameState::pauseTimer,
+        &GameState::resumeDelayTimer, &GameState::poisonSoundTimer, &GameState::pauseSoundTimer,
+    };
+
+    bool GameState::* const FLAG_FIELDS[] = {
+        &GameState::gameOver, &GameState::canIntersectSelf, &GameState::canPassWalls,
+        &GameState::cannotEatApples, &GameState::isPaused, &GameState::isUserPaused,
+        &GameState::isResuming, &GameState::gameOverSoundPlayed,
+    };
+
+    uint16_t GetFlags(const GameState& state) {
+        uint16_t flags = 0;
+        for (size_t i = 0; i < sizeof(FLAG_FIELDS) / sizeof(FLAG_FIELDS[0]); i++) {
+            flags |= (state.*FLAG_FIELDS[i]) ? (uint16_t)(1 << i) : 0;
+        }
+        return flags;
+    }
+
+    // Timers are compared bit for bit so a restore is exact
+    bool SameBits(float a, float b) {
+        return std::memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    bool SameApples(const AppleList& a, const AppleList& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].col != b[i].col || a[i].row != b[i].row || a[i].type != b[i].type ||
+                !SameBits(a[i].spawnTime, b[i].spawnTime) || !SameBits(a[i].despawnTime, b[i].despawnTime)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SameQueue(const DirectionQueue& a, const DirectionQueue& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].dx != b[i].dx || a[i].dy != b[i].dy) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SamePosition(Position a, Position b) {
+        return a.col == b.col && a.row == b.row;
+    }
+}
+
+RewindBuffer::RewindBuffer(uint32_t maxFrames, size_t capacity)
+    : ring(capacity), lengths(std::max(maxFrames, 1u)) {
+    packedBody.Reserve(GameConstants::MAX_SNAKE_LENGTH);
+    scratch.reserve(RewindConstants::RECORD_RESERVE);
+    bodyOps.reserve(RewindConstants::RECORD_RESERVE);
+    opScratch.reserve(RewindConstants::RECORD_RESERVE);
+}
+
+void RewindBuffer::BeginFrame(const GameState& state) {
+    before.score = state.score;
+    before.highScoreRegular = state.highScoreRegular;
+    before.highScoreAccelerated = state.highScoreAccelerated;
+    before.highScoreCustom = state.highScoreCustom;
+    before.dx = state.dx;
+    before.dy = state.dy;
+    before.moveCount = state.moveCount;
+    before.rngState = state.rng.state;
+    before.hash = state.hash;
+    before.flags = GetFlags(state);
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        before.timers[i] = state.*TIMERS[i];
+    }
+    before.apples = state.apples;
+    before.queue = state.directionQueue;
+    bodyOps.clear();
+    bodyOpCount = 0;
+    bodyReplaced = false;
+    lostTrack = false;
+    bodySaved = false;
+    inFrame = true;
+}
+
+void RewindBuffer::BeginMove(const GameState& state) {
+    move.moveCount = state.moveCount;
+    move.snakeSize = state.snake.size();
+    if (!state.snake.empty()) {
+        move.head = state.snake.front();
+        move.tail = state.snake.back();
+    }
+    bodySaved = false;
+}
+
+void RewindBuffer::SaveBody(const SnakeBody& snake) {
+    if (inFrame && !bodySaved && !bodyReplaced) {
+        savedBody.assign(snake.begin() + 1, snake.end());
+        bodySaved = true;
+    }
+}
+
+void RewindBuffer::EndMove(const GameState& state) {
+    // Undoing a replace restores the whole body from before it, so the
+    // moves after one in the same frame needn't be kept
+    if (!inFrame || bodyReplaced || lostTrack) {
+        return;
+    }
+
+    // Work out the body change from the move count and the length
+    uint8_t body = BODY_UNCHANGED;
+    if (bodySaved) {
+        body = BODY_REPLACED;
+    } else if (state.moveCount != move.moveCount && !state.snake.empty()) {
+        size_t size = state.snake.size();
+        if (size == move.snakeSize && SamePosition(state.snake.front(), move.head)) {
+            body = BODY_UNCHANGED;   // hit a wall, nothing moved
+        } else if (size == move.snakeSize) {
+            body = BODY_MOVED;
+        } else if (size == move.snakeSize + 1) {
+            body = BODY_PUSHED;
+        } else if (size == move.snakeSize + 2) {
+            body = BODY_GREW;
+        } else {
+            // Not something GameLogic does in one move; the history no longer lines up
+            lostTrack = true;
+            return;
+        }
+    }
+    if (body == BODY_UNCHANGED) {
+        return;
+    }
+
+    opScratch.clear();
+    ByteWriter writer(opScratch);
+    writer.U8(body);
+    if (body == BODY_MOVED) {
+        writer.U8((uint8_t)move.tail.col);
+        writer.U8((uint8_t)move.tail.row);
+    } else if (body == BODY_REPLACED) {
+        StateCodec::WriteBody(writer, savedBody, packedBody);
+        bodyReplaced = true;
+    }
+    // Newest first, so StepBack undoes them as it reads
+    bodyOps.insert(bodyOps.begin(), opScratch.begin(), opScratch.end());
+    bodyOpCount++;
+}
+
+void RewindBuffer::EndFrame(const GameState& state) {
+    if (!inFrame) {
+        return;
+    }
+    inFrame = false;
+    if (lostTrack) {
+        Clear();
+        return;
+    }
+
+    uint32_t mask = 0;
+    mask |= (state.score != before.score) ? SCORE : 0;
+    mask |= (state.highScoreRegular != before.highScoreRegular ||
+             state.highScoreAccelerated != before.highScoreAccelerated ||
+             state.highScoreCustom != before.highScoreCustom) ? HIGH_SCORES : 0;
+    mask |= (state.dx != before.dx || state.dy != before.dy) ? DIRECTION : 0;
+    mask |= (state.moveCount != before.moveCount) ? MOVE_COUNT : 0;
+    mask |= (state.rng.state != before.rngState) ? RNG : 0;
+    mask |= (state.hash != before.hash) ? HASH : 0;
+    mask |= (GetFlags(state) != before.flags) ? FLAGS : 0;
+    mask |= !SameApples(before.apples, state.apples) ? APPLES : 0;
+    mask |= !SameQueue(before.queue, state.directionQueue) ? QUEUE : 0;
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        mask |= !SameBits(state.*TIMERS[i], before.timers[i]) ? (1u << (TIMER_SHIFT + i)) : 0;
+    }
+
+    scratch.clear();
+    ByteWriter writer(scratch);
+    writer.VarU32(bodyOpCount);
+    writer.VarU32(mask);
+    if (mask & SCORE) {
+        writer.VarI32(before.score);
+    }
+    if (mask & HIGH_SCORES) {
+        writer.VarI32(before.highScoreRegular);
+        writer.VarI32(before.highScoreAccelerated);
+        writer.VarI32(before.highScoreCustom);
+    }
+    if (mask & DIRECTION) {
+        writer.I8((int8_t)before.dx);
+        writer.I8((int8_t)before.dy);
+    }
+    if (mask & MOVE_COUNT) {
+        writer.VarU32(before.moveCount);
+    }
+    if (mask & RNG) {
+        writer.U64(before.rngState);
+    }
+    if (mask & HASH) {
+        writer.U64(before.hash);
+    }
+    if (mask & FLAGS) {
+        writer.U16(before.flags);
+    }
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        if (mask & (1u << (TIMER_SHIFT + i))) {
+            writer.F32(before.timers[i]);
+        }
+    }
+    if (mask & APPLES) {
+        writer.VarU32((uint32_t)before.apples.size());
+        for (const auto& apple : before.apples) {
+            writer.U8((uint8_t)apple.col);
+            writer.U8((uint8_t)apple.row);
+            writer.U8((uint8_t)apple.type);
+            writer.F32(apple.spawnTime);
+            writer.F32(apple.despawnTime);
+        }
+    }
+    if (mask & QUEUE) {
+        writer.VarU32((uint32_t)before.queue.size());
+        for (const auto& dir : before.queue) {
+            writer.U8((uint8_t)(((dir.dx + 1) << 2) | (dir.dy + 1)));
+        }
+    }
+    writer.Bytes(bodyOps.data(), bodyOps.size());
+    Push();
+}
+
+void RewindBuffer::Push() {
+    if (scratch.size() > ring.size()) {
+        // Can't hold even this one frame; nothing before it can be undone either
+        Clear();
+        return;
+    }
+    while (frameCount > 0 && (frameCount == lengths.size() || ring.size() - used < scratch.size())) {
+        PopOldest();
+    }
+    size_t offset = (start + used) % ring.size();
+    size_t first = std::min(scratch.size(), ring.size() - offset);
+    std::memcpy(ring.data() + offset, scratch.data(), first);
+    std::memcpy(ring.data(), scratch.data() + first, scratch.size() - first);
+    used += scratch.size();
+    lengths[(firstFrame + frameCount) % lengths.size()] = (uint32_t)scratch.size();
+    frameCount++;
+}
+
+void RewindBuffer::PopOldest() {
+    uint32_t length = lengths[firstFrame];
+    start = (start + length) % ring.size();
+    used -= length;
+    firstFrame = (firstFrame + 1) % lengths.size();
+    frameCount--;
+}
+
+bool RewindBuffer::StepBack(GameState& state) {
+    if (frameCount == 0) {
+        return false;
+    }
+    inFrame = false;
+
+    // Copy the newest record out of the ring (it may wrap)
+    uint32_t length = lengths[(firstFrame + frameCount - 1) % lengths.size()];
+    size_t offset = (start + used - length) % ring.size();
+    size_t first = std::min((size_t)length, ring.size() - offset);
+    scratch.resize(length);
+    std::memcpy(scratch.data(), ring.data() + offset, first);
+    std::memcpy(scratch.data() + first, ring.data(), length - first);
+    used -= length;
+    frameCount--;
+
+    ByteReader reader(scratch.data(), scratch.size());
+    uint32_t opCount = reader.VarU32();
+    uint32_t mask = reader.VarU32();
+    if (mask & SCORE) {
+        state.score = reader.VarI32();
+    }
+    if (mask & HIGH_SCORES) {
+        state.highScoreRegular = reader.VarI32();
+        state.highScoreAccelerated = reader.VarI32();
+        state.highScoreCustom = reader.VarI32();
+    }
+    if (mask & DIRECTION) {
+        state.dx = reader.I8();
+        state.dy = reader.I8();
+    }
+    if (mask & MOVE_COUNT) {
+        state.moveCount = reader.VarU32();
+    }
+    if (mask & RNG) {
+        state.rng.state = reader.U64();
+    }
+    if (mask & HASH) {
+        state.hash = reader.U64();
+    }
+    if (mask & FLAGS) {
+        uint16_t flags = reader.U16();
+        for (size_t i = 0; i < sizeof(FLAG_FIELDS) / sizeof(FLAG_FIELDS[0]); i++) {
+            state.*FLAG_FIELDS[i] = (flags & (1 << i)) != 0;
+        }
+    }
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        if (mask & (1u << (TIMER_SHIFT + i))) {
+            state.*TIMERS[i] = reader.F32();
+        }
+    }
+    if (mask & APPLES) {
+        uint32_t count = reader.VarU32();
+        if (count > state.apples.capacity()) {
+            return false;
+        }
+        state.apples.resize(count);
+        for (auto& apple : state.apples) {
+            apple.col = reader.U8();
+            apple.row = reader.U8();
+            apple.type = (FoodType)reader.U8();
+            apple.spawnTime = reader.F32();
+            apple.despawnTime = reader.F32();
+        }
+    }
+    if (mask & QUEUE) {
+        uint32_t count = reader.VarU32();
+        if (count > state.directionQueue.capacity()) {
+            return false;
+        }
+        state.directionQueue.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t packed = reader.U8();
+            state.directionQueue.push_back({(packed >> 2) - 1, (packed & 3) - 1});
+        }
+    }
+
+    // Newest move first
+    for (uint32_t i = 0; i < opCount && reader.Ok(); i++) {
+        uint8_t body = reader.U8();
+        if (body == BODY_REPLACED) {
+            if (!StateCodec::ReadBody(reader, state.snake, packedBody)) {
+                return false;
+            }
+        } else if (!state.snake.empty()) {
+            state.snake.erase(state.snake.begin());
+            if (body == BODY_MOVED) {
+                int col = reader.U8();
+                int row = reader.U8();
+                state.snake.push_back({col, row});
+            } else if (body == BODY_GREW) {
+                state.snake.pop_back();
+            }
+        }
+    }
+    return reader.Ok();
+}
+
+void RewindBuffer::Clear() {
+    start = 0;
+    used = 0;
+    firstFrame = 0;
+    frameCount = 0;
+    bodySaved = false;
+    inFrame = false;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "game_state.h"
+#include "packed_body.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RewindConstants {
+    // 40 s at 60 fps. Most frames cost 10-20 bytes, so the byte ring rarely
+    // fills before the frame count does.
+    const uint32_t DEFAULT_MAX_FRAMES = 2400;
+    const size_t DEFAULT_CAPACITY = 64 * 1024;
+    // Scratch reserved for one record, so recording never allocates; a
+    // full-length body in plain cells stays under it
+    const size_t RECORD_RESERVE = 8 * 1024;
+}
+
+// Undo history for the last few thousand frames of a single-player game.
+// Each frame stores only what it changed, as the values from before it ran:
+//   varint  number of body ops
+//   varint  mask of the fields that follow (see rewind_buffer.cpp)
+//   ...     previous score, direction, flags, RNG, hash, changed timers, apples, queue
+//   ...     body ops, newest move first: each a u8 op and its payload, the
+//           popped tail or the whole previous body
+// A frame can make several moves (GameLogic catches up on every elapsed
+// interval), so GameLogic::Move reports each one through GameState::rewind
+// with BeginMove/EndMove. A move stores one tail cell, so nothing scales with
+// snake length except poison reversals and teleports, which hand over the
+// old body packed to 2 bits a segment (SaveBody, before the rebuild).
+// Records sit back to back in a fixed byte ring; the oldest frames are
+// dropped when it or the frame limit is full.
+class RewindBuffer {
+public:
+    explicit RewindBuffer(uint32_t maxFrames = RewindConstants::DEFAULT_MAX_FRAMES,
+                          size_t capacity = RewindConstants::DEFAULT_CAPACITY);
+
+    // Call around every GameLogic::RunFrame, with state.rewind pointing here
+    void BeginFrame(const GameState& state);
+    void EndFrame(const GameState& state);
+    // Around every GameLogic::Move inside a frame
+    void BeginMove(const GameState& state);
+    void EndMove(const GameState& state);
+    // Body as it was before this move; `snake` already has the new head in front
+    void SaveBody(const SnakeBody& snake);
+
+    // Restores the state from before the latest recorded frame; false when
+    // there is nothing left to undo
+    bool StepBack(GameState& state);
+    void Clear();
+
+    uint32_t GetFrameCount() const { return frameCount; }
+    size_t GetBytesUsed() const { return used; }
+    size_t GetCapacity() const { return ring.size(); }
+
+private:
+    static const int TIMER_COUNT = 9;
+
+    // Values at the start of the frame being recorded
+    struct FrameStart {
+        int score;
+        int highScoreRegular;
+        int highScoreAccelerated;
+        int highScoreCustom;
+        int dx;
+        int dy;
+        uint32_t moveCount;
+        uint64_t rngState;
+        uint64_t hash;
+        uint16_t flags;
+        float timers[TIMER_COUNT];
+        AppleList apples;
+        DirectionQueue queue;
+    };
+
+    // Values at the start of the move being recorded
+    struct MoveStart {
+        uint32_t moveCount;
+        size_t snakeSize;
+        Position head;
+        Position tail;
+    };
+
+    void Push();
+    void PopOldest();
+
+    std::vector<uint8_t> ring;
+    size_t start = 0;       // oldest record's first byte
+    size_t used = 0;
+    std::vector<uint32_t> lengths;  // per-frame record sizes, also a ring
+    uint32_t firstFrame = 0;
+    uint32_t frameCount = 0;
+
+    FrameStart before;
+    MoveStart move;
+    SnakeBody savedBody;
+    PackedBody packedBody;
+    bool bodySaved = false;
+    bool inFrame = false;
+    // This frame's body ops so far, newest first
+    std::vector<uint8_t> bodyOps;
+    uint32_t bodyOpCount = 0;
+    bool bodyReplaced = false;  // later moves needn't be kept: the body from before is
+    bool lostTrack = false;     // a move GameLogic doesn't make; the frame can't be undone
+    std::vector<uint8_t> opScratch;
+    std::vector<uint8_t> scratch;
+};
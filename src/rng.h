@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+// Small seeded PRNG (xorshift64*) for game code that has to be reproducible.
+// raylib's GetRandomValue shares one global state, so it can't be seeded per
+// game or saved alongside a game's state.
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    void Seed(uint64_t seed) {
+        // splitmix64 scramble so small seeds still give well-mixed states
+        uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+        state = (z != 0) ? z : 0x9E3779B97F4A7C15ull;
+    }
+
+    uint32_t NextU32() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    // Inclusive range, same contract as raylib's GetRandomValue
+    int GetValue(int min, int max) {
+        if (min > max) {
+            int tmp = max;
+            max = min;
+            min = tmp;
+        }
+        uint64_t range = (uint64_t)((int64_t)max - (int64_t)min) + 1;
+        return (int)((int64_t)min + (int64_t)(((uint64_t)NextU32() * range) >> 32));
+    }
+};
@@ -0,0 +1,530 @@
+#include "scenario.h"
+#include "byte_buffer.h"
+#include "state_codec.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using GameConstants::GRID_HEIGHT;
+using GameConstants::GRID_WIDTH;
+
+namespace {
+    // Lines are copied here before tokenizing; a full 512-segment body of
+    // single steps takes about 1 KB
+    const int MAX_LINE = 4096;
+
+    const char* const FOOD_NAMES[FOOD_TYPE_COUNT] = {
+        "regular", "poison", "pomme_plus", "pomme_supreme", "teleport",
+    };
+
+    struct Step {
+        char letter;
+        const char* name;
+        int dx;
+        int dy;
+    };
+    const Step STEPS[4] = {
+        {'U', "up", 0, -1},
+        {'D', "down", 0, 1},
+        {'L', "left", -1, 0},
+        {'R', "right", 1, 0},
+    };
+}
+
+// Splits off the next whitespace-separated token in place; nullptr at the end
+static char* NextToken(char*& cursor) {
+    while (*cursor == ' ' || *cursor == '\t') {
+        cursor++;
+    }
+    if (*cursor == '\0') {
+        return nullptr;
+    }
+    char* token = cursor;
+    while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t') {
+        cursor++;
+    }
+    if (*cursor != '\0') {
+        *cursor++ = '\0';
+    }
+    return token;
+}
+
+static bool ParseInt(const char* text, int& out) {
+    if (!text) {
+        return false;
+    }
+    char* end = nullptr;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < -1000000000L || value > 1000000000L) {
+        return false;
+    }
+    out = (int)value;
+    return true;
+}
+
+static bool ParseFloat(const char* text, float& out) {
+    char* end = nullptr;
+    out = text ? std::strtof(text, &end) : 0.0f;
+    return text && end != text && *end == '\0';
+}
+
+static bool ParseU64(const char* text, uint64_t& out, int base) {
+    char* end = nullptr;
+    out = text ? std::strtoull(text, &end, base) : 0;
+    return text && end != text && *end == '\0' && *text != '-';
+}
+
+static const Step* FindStep(const char* name) {
+    for (const auto& step : STEPS) {
+        if (std::strcmp(name, step.name) == 0) {
+            return &step;
+        }
+    }
+    return nullptr;
+}
+
+static int Wrap(int value, int size) {
+    return ((value % size) + size) % size;
+}
+
+// A fresh game's play fields, with no random draws
+static void ClearPlay(GameState& state) {
+    state.gameMode = MODE_REGULAR;
+    state.showModeSelection = false;
+    state.showInstructions = false;
+    state.gameOver = false;
+    state.score = 0;
+    state.snake.clear();
+    state.dx = 0;
+    state.dy = 0;
+    state.directionQueue.clear();
+    state.moveTimer = 0.0f;
+    state.moveCount = 0;
+    state.apples.clear();
+    state.gameTime = 0.0f;
+    state.rng.Seed(0);
+    state.seed = 0;
+    state.canIntersectSelf = false;
+    state.immunityTimer = 0.0f;
+    state.canPassWalls = false;
+    state.wallImmunityTimer = 0.0f;
+    state.cannotEatApples = false;
+    state.cannotEatTimer = 0.0f;
+    state.isPaused = false;
+    state.pauseTimer = 0.0f;
+    state.isUserPaused = false;
+    state.isResuming = false;
+    state.resumeDelayTimer = 0.0f;
+    state.poisonSoundTimer = 0.0f;
+    state.pauseSoundTimer = 0.0f;
+    state.gameOverSoundPlayed = false;
+}
+
+// "head col row" then the steps, appended to the (cleared) body
+static bool ParseBody(char* cursor, SnakeBody& body, std::string& error) {
+    int col = 0;
+    int row = 0;
+    if (!ParseInt(NextToken(cursor), col) || !ParseInt(NextToken(cursor), row)) {
+        error = "body starts with the head's col and row";
+        return false;
+    }
+    body.clear();
+    body.push_back({col, row});
+    while (char* token = NextToken(cursor)) {
+        Position next = body.back();
+        int dx = 0;
+        int dy = 0;
+        int count = 1;
+        if (token[0] == '@') {
+            // Jump to an absolute cell (clamped teleports leave gaps)
+            if (std::sscanf(token + 1, "%d,%d", &next.col, &next.row) != 2) {
+                error = std::string("bad body jump ") + token;
+                return false;
+            }
+        } else {
+            const Step* step = nullptr;
+            for (const auto& candidate : STEPS) {
+                step = (candidate.letter == token[0]) ? &candidate : step;
+            }
+            if (!step && token[0] != '=') {
+                error = std::string("bad body step ") + token;
+                return false;
+            }
+            if (token[1] != '\0' && (!ParseInt(token + 1, count) || count < 1)) {
+                error = std::string("bad body step ") + token;
+                return false;
+            }
+            dx = step ? step->dx : 0;
+            dy = step ? step->dy : 0;
+        }
+        for (int i = 0; i < count; i++) {
+            next.col = Wrap(next.col + dx, GRID_WIDTH);
+            next.row = Wrap(next.row + dy, GRID_HEIGHT);
+            if (!body.push_back(next)) {
+                error = "body is longer than " + std::to_string(GameConstants::MAX_SNAKE_LENGTH) + " segments";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool ParseApple(char* cursor, AppleList& apples, std::string& error) {
+    Apple apple;
+    const char* type = nullptr;
+    bool ok = ParseInt(NextToken(cursor), apple.col) && ParseInt(NextToken(cursor), apple.row) &&
+              (type = NextToken(cursor)) != nullptr;
+    int food = -1;
+    for (int i = 0; ok && i < FOOD_TYPE_COUNT; i++) {
+        food = (std::strcmp(type, FOOD_NAMES[i]) == 0) ? i : food;
+    }
+    if (!ok || food < 0 || !ParseFloat(NextToken(cursor), apple.spawnTime) ||
+        !ParseFloat(NextToken(cursor), apple.despawnTime) || NextToken(cursor)) {
+        error = "apple is col row type spawn despawn";
+        return false;
+    }
+    apple.type = (FoodType)food;
+    if (!apples.push_back(apple)) {
+        error = "more than " + std::to_string(GameConstants::MAX_APPLES) + " apples";
+        return false;
+    }
+    return true;
+}
+
+// A timer key sets the timer and turns its effect on when it's positive
+static bool ParseTimer(const char* value, float& timer, bool* active) {
+    if (!ParseFloat(value, timer)) {
+        return false;
+    }
+    if (active) {
+        *active = timer > 0.0f;
+    }
+    return true;
+}
+
+bool Scenario::Parse(const char* text, size_t size, GameState& state, std::string& error) {
+    ClearPlay(state);
+    bool hasBody = false;
+    int lineNumber = 0;
+    error.clear();
+    for (size_t pos = 0; pos < size && error.empty();) {
+        const char* begin = text + pos;
+        const char* newline = (const char*)std::memchr(begin, '\n', size - pos);
+        size_t length = newline ? (size_t)(newline - begin) : size - pos;
+        pos += length + 1;
+        lineNumber++;
+        if (length >= (size_t)MAX_LINE) {
+            error = "line " + std::to_string(lineNumber) + ": line is too long";
+            break;
+        }
+        char line[MAX_LINE];
+        std::memcpy(line, begin, length);
+        line[length] = '\0';
+        char* comment = std::strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        for (char* c = line; *c; c++) {
+            *c = (*c == '\r') ? ' ' : *c;
+        }
+
+        // The first '=' splits the key off; later ones are body steps
+        char* equals = std::strchr(line, '=');
+        char* cursor = line;
+        if (equals) {
+            *equals = '\0';
+        }
+        char* key = NextToken(cursor);
+        if (!key && !equals) {
+            continue;
+        }
+        if (!key || !equals || NextToken(cursor)) {
+            error = "line " + std::to_string(lineNumber) + ": expected key = value";
+            break;
+        }
+        cursor = equals + 1;
+        bool ok = true;
+        if (std::strcmp(key, "body") == 0 || std::strcmp(key, "apple") == 0 || std::strcmp(key, "queue") == 0) {
+            std::string detail;
+            if (std::strcmp(key, "body") == 0) {
+                ok = ParseBody(cursor, state.snake, detail);
+                hasBody = true;
+            } else if (std::strcmp(key, "apple") == 0) {
+                ok = ParseApple(cursor, state.apples, detail);
+            } else {
+                state.directionQueue.clear();
+                while (char* name = NextToken(cursor)) {
+                    const Step* step = FindStep(name);
+                    if (!step || !state.directionQueue.push_back({step->dx, step->dy})) {
+                        detail = step ? "more than " + std::to_string(GameConstants::DIRECTION_QUEUE_CAPACITY) + " queued keys"
+                                      : std::string("bad queued key ") + name;
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            if (!ok) {
+                error = "line " + std::to_string(lineNumber) + ": " + detail;
+            }
+            continue;
+        }
+        // The rest take exactly one value
+        char* value = NextToken(cursor);
+        bool single = value && !NextToken(cursor);
+        if (!single) {
+            ok = false;
+        } else if (std::strcmp(key, "mode") == 0) {
+            if (std::strcmp(value, "regular") == 0 || std::strcmp(value, "accelerated") == 0) {
+                state.gameMode = (value[0] == 'r') ? MODE_REGULAR : MODE_ACCELERATED;
+            } else {
+                error = "line " + std::to_string(lineNumber) + ": mode is regular or accelerated "
+                        "(custom rules only load from binary scenarios)";
+            }
+        } else if (std::strcmp(key, "seed") == 0) {
+            uint64_t seed = 0;
+            ok = ParseU64(value, seed, 10);
+            state.rng.Seed(seed);
+        } else if (std::strcmp(key, "rng") == 0) {
+            ok = ParseU64(value, state.rng.state, 0) && state.rng.state != 0;
+        } else if (std::strcmp(key, "score") == 0) {
+            ok = ParseInt(value, state.score);
+        } else if (std::strcmp(key, "moves") == 0) {
+            int moves = 0;
+            ok = ParseInt(value, moves) && moves >= 0;
+            state.moveCount = (uint32_t)moves;
+        } else if (std::strcmp(key, "direction") == 0) {
+            const Step* step = FindStep(value);
+            ok = step || std::strcmp(value, "none") == 0;
+            state.dx = step ? step->dx : 0;
+            state.dy = step ? step->dy : 0;
+        } else if (std::strcmp(key, "move_timer") == 0) {
+            ok = ParseTimer(value, state.moveTimer, nullptr);
+        } else if (std::strcmp(key, "game_time") == 0) {
+            ok = ParseTimer(value, state.gameTime, nullptr);
+        } else if (std::strcmp(key, "immunity") == 0) {
+            ok = ParseTimer(value, state.immunityTimer, &state.canIntersectSelf);
+        } else if (std::strcmp(key, "wall_immunity") == 0) {
+            ok = ParseTimer(value, state.wallImmunityTimer, &state.canPassWalls);
+        } else if (std::strcmp(key, "cannot_eat") == 0) {
+            ok = ParseTimer(value, state.cannotEatTimer, &state.cannotEatApples);
+        } else if (std::strcmp(key, "pause") == 0) {
+            ok = ParseTimer(value, state.pauseTimer, &state.isPaused);
+        } else if (std::strcmp(key, "poison_sound") == 0) {
+            ok = ParseTimer(value, state.poisonSoundTimer, nullptr);
+        } else {
+            error = "line " + std::to_string(lineNumber) + ": unknown key " + key;
+        }
+        if (!ok && error.empty()) {
+            error = "line " + std::to_string(lineNumber) + ": bad value for " + key;
+        }
+    }
+    if (error.empty() && !hasBody) {
+        error = "no body";
+    }
+    if (!error.empty() || !Validate(state, error)) {
+        return false;
+    }
+    state.hash = state.ComputeHash();
+    return true;
+}
+
+bool Scenario::Load(const std::string& path, GameState& state, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<char> data;
+    char chunk[4096];
+    size_t got = 0;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    std::fclose(file);
+
+    bool ok = false;
+    if (data.size() >= sizeof(ScenarioConstants::MAGIC) &&
+        std::memcmp(data.data(), ScenarioConstants::MAGIC, sizeof(ScenarioConstants::MAGIC)) == 0) {
+        ByteReader reader((const uint8_t*)data.data() + sizeof(ScenarioConstants::MAGIC),
+                          data.size() - sizeof(ScenarioConstants::MAGIC));
+        ClearPlay(state);
+        if (reader.VarU32() != ScenarioConstants::VERSION || !reader.Ok()) {
+            error = "unknown scenario version";
+        } else if (!StateCodec::Read(reader, state) || reader.Remaining() != 0) {
+            error = "malformed binary scenario";
+        } else {
+            ok = Validate(state, error);
+        }
+    } else {
+        ok = Parse(data.data(), data.size(), state, error);
+    }
+    if (!ok) {
+        error = path + ": " + error;
+    }
+    return ok;
+}
+
+bool Scenario::Validate(const GameState& state, std::string& error) {
+    auto onBoard = [](int col, int row) { return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT; };
+    auto unit = [](int dx, int dy) { return (dx == 0) != (dy == 0) && dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1; };
+    if (state.snake.empty()) {
+        error = "no body";
+        return false;
+    }
+    for (const auto& segment : state.snake) {
+        if (!onBoard(segment.col, segment.row)) {
+            error = "body leaves the board at " + std::to_string(segment.col) + "," + std::to_string(segment.row);
+            return false;
+        }
+    }
+    for (const auto& apple : state.apples) {
+        if (!onBoard(apple.col, apple.row) || apple.type < REGULAR || apple.type > TELEPORT) {
+            error = "apple off the board or of an unknown type";
+            return false;
+        }
+    }
+    if (!unit(state.dx, state.dy) && (state.dx != 0 || state.dy != 0)) {
+        error = "direction has to move one cell";
+        return false;
+    }
+    for (const auto& dir : state.directionQueue) {
+        if (!unit(dir.dx, dir.dy)) {
+            error = "queued keys have to move one cell";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs of the same step collapse to one token with a count
+static void AppendStep(std::string& out, char letter, int count) {
+    if (count == 0) {
+        return;
+    }
+    char token[16];
+    if (count == 1) {
+        std::snprintf(token, sizeof(token), " %c", letter);
+    } else {
+        std::snprintf(token, sizeof(token), " %c%d", letter, count);
+    }
+    out += token;
+}
+
+bool Scenario::FormatText(const GameState& state, std::string& out) {
+    // Effects are on exactly while their timers run, so the timer says both
+    if (state.gameMode == MODE_CUSTOM || state.snake.empty() ||
+        state.canIntersectSelf != (state.immunityTimer > 0.0f) ||
+        state.canPassWalls != (state.wallImmunityTimer > 0.0f) ||
+        state.cannotEatApples != (state.cannotEatTimer > 0.0f) ||
+        state.isPaused != (state.pauseTimer > 0.0f)) {
+        return false;
+    }
+    char line[128];
+    out.clear();
+    std::snprintf(line, sizeof(line), "mode = %s\nrng = 0x%016llx\nscore = %d\nmoves = %u\n",
+                  state.gameMode == MODE_ACCELERATED ? "accelerated" : "regular",
+                  (unsigned long long)state.rng.state, state.score, state.moveCount);
+    out += line;
+
+    auto directionName = [](int dx, int dy) {
+        for (const auto& step : STEPS) {
+            if (step.dx == dx && step.dy == dy) {
+                return step.name;
+            }
+        }
+        return "none";
+    };
+    out += "direction = ";
+    out += directionName(state.dx, state.dy);
+    out += "\n";
+    if (!state.directionQueue.empty()) {
+        out += "queue =";
+        for (const auto& dir : state.directionQueue) {
+            out += " ";
+            out += directionName(dir.dx, dir.dy);
+        }
+        out += "\n";
+    }
+
+    std::snprintf(line, sizeof(line), "body = %d %d", state.snake.front().col, state.snake.front().row);
+    out += line;
+    char letter = 0;
+    int run = 0;
+    for (size_t i = 1; i < state.snake.size(); i++) {
+        Position prev = state.snake[i - 1];
+        Position next = state.snake[i];
+        char stepLetter = 0;
+        if (next.col == prev.col && next.row == prev.row) {
+            stepLetter = '=';
+        }
+        for (const auto& step : STEPS) {
+            if (Wrap(prev.col + step.dx, GRID_WIDTH) == next.col && Wrap(prev.row + step.dy, GRID_HEIGHT) == next.row) {
+                stepLetter = step.letter;
+            }
+        }
+        if (stepLetter != letter || stepLetter == 0) {
+            AppendStep(out, letter, run);
+            letter = stepLetter;
+            run = 0;
+        }
+        if (stepLetter == 0) {
+            std::snprintf(line, sizeof(line), " @%d,%d", next.col, next.row);
+            out += line;
+        } else {
+            run++;
+        }
+    }
+    AppendStep(out, letter, run);
+    out += "\n";
+
+    for (const auto& apple : state.apples) {
+        std::snprintf(line, sizeof(line), "apple = %d %d %s %.9g %.9g\n", apple.col, apple.row,
+                      FOOD_NAMES[apple.type], apple.spawnTime, apple.despawnTime);
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "move_timer = %.9g\ngame_time = %.9g\n", state.moveTimer, state.gameTime);
+    out += line;
+    const struct {
+        const char* key;
+        float value;
+    } timers[] = {
+        {"immunity", state.immunityTimer},
+        {"wall_immunity", state.wallImmunityTimer},
+        {"cannot_eat", state.cannotEatTimer},
+        {"pause", state.pauseTimer},
+        {"poison_sound", state.poisonSoundTimer},
+    };
+    for (const auto& timer : timers) {
+        if (timer.value != 0.0f) {
+            std::snprintf(line, sizeof(line), "%s = %.9g\n", timer.key, timer.value);
+            out += line;
+        }
+    }
+    return true;
+}
+
+static bool WriteFile(const std::string& path, const void* data, size_t size) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, file) == size;
+    return std::fclose(file) == 0 && ok;
+}
+
+bool Scenario::SaveText(const std::string& path, const GameState& state) {
+    std::string text;
+    return FormatText(state, text) && WriteFile(path, text.data(), text.size());
+}
+
+bool Scenario::SaveBinary(const std::string& path, const GameState& state) {
+    std::vector<uint8_t> data;
+    ByteWriter writer(data);
+    for (char c : ScenarioConstants::MAGIC) {
+        writer.U8((uint8_t)c);
+    }
+    writer.VarU32(ScenarioConstants::VERSION);
+    StateCodec::Write(writer, state);
+    return WriteFile(path, data.data(), data.size());
+}
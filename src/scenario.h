@@ -0,0 +1,57 @@
+#pragma once
+
+#include "game_state.h"
+#include <cstddef>
+#include <string>
+
+namespace ScenarioConstants {
+    // Binary scenarios start with this, then a StateCodec record
+    const char MAGIC[4] = {'S', 'N', 'K', 'S'};
+    const uint32_t VERSION = 2;     // 2: speed ramp in custom rules
+}
+
+// Exact starting positions for benchmarks, bug reports and `snake --scenario`.
+//
+// The text format is "key = value" lines like a rules file, '#' starts a
+// comment and unset keys keep a fresh game's values:
+//
+//   mode = accelerated             # regular or accelerated
+//   seed = 7                       # or `rng = 0x...` for a raw Rng state
+//   score = 12
+//   moves = 40
+//   direction = right              # or none
+//   queue = up left                # keys waiting for the next moves
+//   body = 5 3 L3 D2 =             # head col row, then steps towards the
+//                                  # tail: U D L R with a repeat count, `=`
+//                                  # for a segment stacked on the one before;
+//                                  # steps off an edge wrap around
+//   apple = 9 3 poison 1.5 16      # col row type spawn despawn (seconds);
+//                                  # one line per apple
+//   move_timer = 0.1
+//   game_time = 20
+//   immunity = 4                   # a positive timer turns the effect on;
+//   wall_immunity = 0              # likewise wall_immunity, cannot_eat and
+//   cannot_eat = 0                 # pause (the poison pause)
+//   pause = 0
+//   poison_sound = 0
+//
+// SaveText writes every field with floats to 9 digits, so a state saved and
+// loaded again is bit for bit the same. Binary files hold the full
+// StateCodec record (custom rules included).
+class Scenario {
+public:
+    // Text or binary, told apart by the magic. Overwrites the play fields of
+    // `state` (partly, on failure); `error` names the line or field at fault.
+    static bool Load(const std::string& path, GameState& state, std::string& error);
+    // Text from memory. Bodies, apples and the queue go straight into the
+    // state's fixed containers: nothing is allocated unless it fails.
+    static bool Parse(const char* text, size_t size, GameState& state, std::string& error);
+
+    static bool SaveText(const std::string& path, const GameState& state);
+    static bool SaveBinary(const std::string& path, const GameState& state);
+    // The text form of `state`; false for MODE_CUSTOM, which only binary holds
+    static bool FormatText(const GameState& state, std::string& out);
+
+    // Cells on the board, known apple types, a direction that moves one cell
+    static bool Validate(const GameState& state, std::string& error);
+};
@@ -0,0 +1,467 @@
+#include "score_store.h"
+#include "file_sync.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char LOG_MAGIC[4] = {'S', 'N', 'K', 'R'};
+static const char INDEX_MAGIC[4] = {'S', 'N', 'K', 'I'};
+static const uint32_t STORE_VERSION = 1;
+static const int NO_SCORE = INT_MIN;
+static const uint64_t REPLAY_BATCH = 4096;
+
+struct LogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+// On-disk result, little-endian like the rest of our formats
+struct ResultRecord {
+    uint64_t seed;
+    int64_t timestampMs;
+    uint32_t playerId;
+    int32_t score;
+    uint32_t length;
+    uint32_t ticks;
+    uint8_t mode;
+    uint8_t isBot;
+    uint16_t reserved;
+    uint32_t crc;               // CRC-32 of everything above
+};
+static_assert(sizeof(LogHeader) == 16, "log header layout");
+static_assert(sizeof(ResultRecord) == 40, "result record layout");
+
+struct ScoreStore::IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t topK;
+    uint32_t playerCapacity;    // power of two
+    uint32_t playerCount;
+    uint32_t dirty;             // set while an update is in progress
+    uint64_t resultCount;       // log records reflected in the index
+    uint32_t topCount[ScoreStoreConstants::MAX_MODES];
+};
+
+struct ScoreStore::TopEntry {
+    int32_t score;
+    uint32_t playerId;
+    uint64_t resultIndex;
+};
+
+struct ScoreStore::PlayerEntry {
+    uint32_t playerId;
+    uint32_t used;
+    int32_t best[ScoreStoreConstants::MAX_MODES];
+};
+
+static uint32_t Crc32(const void* data, size_t size) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t RecordCrc(const ResultRecord& record) {
+    return Crc32(&record, offsetof(ResultRecord, crc));
+}
+
+static void ToRecord(const GameResult& result, ResultRecord& record) {
+    std::memset(&record, 0, sizeof(record));
+    record.seed = result.seed;
+    record.timestampMs = result.timestampMs;
+    record.playerId = result.playerId;
+    record.score = result.score;
+    record.length = (uint32_t)result.length;
+    record.ticks = result.ticks;
+    record.mode = (uint8_t)result.mode;
+    record.isBot = result.isBot ? 1 : 0;
+    record.crc = RecordCrc(record);
+}
+
+static void FromRecord(const ResultRecord& record, GameResult& result) {
+    result.mode = (GameMode)record.mode;
+    result.score = record.score;
+    result.length = (int)record.length;
+    result.ticks = record.ticks;
+    result.seed = record.seed;
+    result.timestampMs = record.timestampMs;
+    result.playerId = record.playerId;
+    result.isBot = record.isBot != 0;
+}
+
+static uint32_t HashPlayer(uint32_t playerId) {
+    return playerId * 2654435761u;
+}
+
+static bool WriteAll(int fd, const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+static off_t RecordOffset(uint64_t resultIndex) {
+    return (off_t)(sizeof(LogHeader) + resultIndex * sizeof(ResultRecord));
+}
+
+ScoreStore::~ScoreStore() {
+    Close();
+}
+
+bool ScoreStore::Open(const std::string& directory, const ScoreStoreConfig& newConfig) {
+    Close();
+    config = newConfig;
+    config.topK = std::max(1, config.topK);
+
+    mkdir(directory.c_str(), 0755);
+    if (!OpenLog(directory + "/results.log") || !OpenIndex(directory + "/results.idx")) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ScoreStore::Close() {
+    if (indexMap) {
+        munmap(indexMap, indexSize);
+        indexMap = nullptr;
+        indexSize = 0;
+    }
+    if (indexFd >= 0) {
+        close(indexFd);
+        indexFd = -1;
+    }
+    if (logFd >= 0) {
+        close(logFd);
+        logFd = -1;
+    }
+    logRecords = 0;
+}
+
+bool ScoreStore::OpenLog(const std::string& path) {
+    logFd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (logFd < 0 || flock(logFd, LOCK_EX | LOCK_NB) != 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(logFd, &st) != 0) {
+        return false;
+    }
+    if (st.st_size == 0) {
+        LogHeader header = {};
+        std::memcpy(header.magic, LOG_MAGIC, 4);
+        header.version = STORE_VERSION;
+        header.recordSize = sizeof(ResultRecord);
+        return WriteAll(logFd, &header, sizeof(header)) && SyncFileData(logFd) == 0;
+    }
+
+    LogHeader header;
+    if (pread(logFd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        std::memcmp(header.magic, LOG_MAGIC, 4) != 0 || header.version != STORE_VERSION ||
+        header.recordSize != sizeof(ResultRecord)) {
+        return false;
+    }
+
+    // A crash mid-append leaves a partial record at the end
+    logRecords = ((uint64_t)st.st_size - sizeof(LogHeader)) / sizeof(ResultRecord);
+    if ((off_t)st.st_size != RecordOffset(logRecords)) {
+        if (ftruncate(logFd, RecordOffset(logRecords)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ScoreStore::OpenIndex(const std::string& path) {
+    indexFd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (indexFd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(indexFd, &st) != 0) {
+        return false;
+    }
+
+    bool usable = false;
+    if ((size_t)st.st_size >= sizeof(IndexHeader)) {
+        IndexHeader header;
+        if (pread(indexFd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+            std::memcmp(header.magic, INDEX_MAGIC, 4) == 0 && header.version == STORE_VERSION &&
+            header.topK == (uint32_t)config.topK && header.dirty == 0 &&
+            header.resultCount <= logRecords && header.playerCapacity > 0 &&
+            (header.playerCapacity & (header.playerCapacity - 1)) == 0) {
+            usable = MapIndex(header.playerCapacity);
+        }
+    }
+    if (!usable && !ResetIndex(ScoreStoreConstants::INITIAL_PLAYER_CAPACITY)) {
+        return false;
+    }
+    // Results appended after the index was last updated (or all of them after a reset)
+    return ReplayLog(Header()->resultCount);
+}
+
+bool ScoreStore::MapIndex(uint32_t playerCapacity) {
+    if (indexMap) {
+        munmap(indexMap, indexSize);
+        indexMap = nullptr;
+    }
+    size_t size = sizeof(IndexHeader) +
+                  (size_t)ScoreStoreConstants::MAX_MODES * config.topK * sizeof(TopEntry) +
+                  (size_t)playerCapacity * sizeof(PlayerEntry);
+    struct stat st;
+    if (fstat(indexFd, &st) != 0) {
+        return false;
+    }
+    if ((size_t)st.st_size != size && ftruncate(indexFd, (off_t)size) != 0) {
+        return false;
+    }
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    indexMap = (uint8_t*)map;
+    indexSize = size;
+    return true;
+}
+
+bool ScoreStore::ResetIndex(uint32_t playerCapacity) {
+    // Truncate first so the new mapping starts out zeroed
+    if (indexMap) {
+        munmap(indexMap, indexSize);
+        indexMap = nullptr;
+    }
+    if (ftruncate(indexFd, 0) != 0 || !MapIndex(playerCapacity)) {
+        return false;
+    }
+    IndexHeader* header = Header();
+    std::memcpy(header->magic, INDEX_MAGIC, 4);
+    header->version = STORE_VERSION;
+    header->topK = (uint32_t)config.topK;
+    header->playerCapacity = playerCapacity;
+    return true;
+}
+
+bool ScoreStore::ReplayLog(uint64_t recordCount) {
+    std::vector<ResultRecord> batch(REPLAY_BATCH);
+    GameResult result;
+    Header()->dirty = 1;
+    for (uint64_t next = recordCount; next < logRecords;) {
+        size_t count = (size_t)std::min<uint64_t>(REPLAY_BATCH, logRecords - next);
+        size_t bytes = count * sizeof(ResultRecord);
+        if (pread(logFd, batch.data(), bytes, RecordOffset(next)) != (ssize_t)bytes) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++, next++) {
+            // Only a crash can damage the log, so a bad record ends it
+            if (batch[i].crc != RecordCrc(batch[i])) {
+                logRecords = next;
+                if (ftruncate(logFd, RecordOffset(next)) != 0) {
+                    return false;
+                }
+                break;
+            }
+            FromRecord(batch[i], result);
+            if (!IndexResult(result, next)) {
+                return false;
+            }
+        }
+    }
+    Header()->resultCount = logRecords;
+    Header()->dirty = 0;
+    return true;
+}
+
+ScoreStore::TopEntry* ScoreStore::TopTable(int mode) const {
+    return (TopEntry*)(indexMap + sizeof(IndexHeader)) + (size_t)mode * config.topK;
+}
+
+ScoreStore::PlayerEntry* ScoreStore::Players() const {
+    return (PlayerEntry*)(indexMap + sizeof(IndexHeader) +
+                          (size_t)ScoreStoreConstants::MAX_MODES * config.topK * sizeof(TopEntry));
+}
+
+ScoreStore::PlayerEntry* ScoreStore::FindPlayer(uint32_t playerId) const {
+    uint32_t mask = Header()->playerCapacity - 1;
+    PlayerEntry* players = Players();
+    for (uint32_t i = HashPlayer(playerId) & mask;; i = (i + 1) & mask) {
+        if (!players[i].used || players[i].playerId == playerId) {
+            return &players[i];
+        }
+    }
+}
+
+bool ScoreStore::GrowPlayers() {
+    uint32_t oldCapacity = Header()->playerCapacity;
+    std::vector<PlayerEntry> old(Players(), Players() + oldCapacity);
+
+    // Grow the file, then clear the table at its new size and reinsert
+    if (!MapIndex(oldCapacity * 2)) {
+        return false;
+    }
+    Header()->playerCapacity = oldCapacity * 2;
+    std::memset((void*)Players(), 0, (size_t)oldCapacity * 2 * sizeof(PlayerEntry));
+    for (const auto& entry : old) {
+        if (entry.used) {
+            *FindPlayer(entry.playerId) = entry;
+        }
+    }
+    return true;
+}
+
+bool ScoreStore::IndexResult(const GameResult& result, uint64_t resultIndex) {
+    int mode = (int)result.mode;
+    IndexHeader* header = Header();
+
+    // Top-K: insert after every entry with an equal or higher score
+    uint32_t& count = header->topCount[mode];
+    TopEntry* table = TopTable(mode);
+    if (count < (uint32_t)config.topK || result.score > table[count - 1].score) {
+        uint32_t pos = (uint32_t)(std::upper_bound(table, table + count, result.score,
+            [](int score, const TopEntry& entry) { return score > entry.score; }) - table);
+        uint32_t moved = std::min(count, (uint32_t)config.topK - 1) - pos;
+        std::memmove(&table[pos + 1], &table[pos], moved * sizeof(TopEntry));
+        table[pos] = {result.score, result.playerId, resultIndex};
+        count = std::min(count + 1, (uint32_t)config.topK);
+    }
+
+    // Keep the player table at most half full
+    PlayerEntry* player = FindPlayer(result.playerId);
+    if (!player->used) {
+        if ((header->playerCount + 1) * 2 > header->playerCapacity) {
+            if (!GrowPlayers()) {
+                return false;
+            }
+            header = Header();
+            player = FindPlayer(result.playerId);
+        }
+        player->used = 1;
+        player->playerId = result.playerId;
+        for (int m = 0; m < ScoreStoreConstants::MAX_MODES; m++) {
+            player->best[m] = NO_SCORE;
+        }
+        header->playerCount++;
+    }
+    player->best[mode] = std::max(player->best[mode], (int32_t)result.score);
+    return true;
+}
+
+bool ScoreStore::Append(const GameResult& result) {
+    if (!IsOpen() || (int)result.mode < 0 || (int)result.mode >= ScoreStoreConstants::MAX_MODES) {
+        return false;
+    }
+
+    // Log first: if we crash before the index catches up, Open replays it
+    ResultRecord record;
+    ToRecord(result, record);
+    if (!WriteAll(logFd, &record, sizeof(record))) {
+        // Drop whatever part of the record made it out
+        if (ftruncate(logFd, RecordOffset(logRecords)) != 0) {
+            Close();
+        }
+        return false;
+    }
+    if (config.syncEachAppend) {
+        SyncFileData(logFd);
+    }
+    uint64_t resultIndex = logRecords++;
+
+    Header()->dirty = 1;
+    if (!IndexResult(result, resultIndex)) {
+        // Left dirty, so the next Open rebuilds it
+        Close();
+        return false;
+    }
+    Header()->resultCount = logRecords;
+    Header()->dirty = 0;
+    return true;
+}
+
+void ScoreStore::Sync() {
+    if (!IsOpen()) {
+        return;
+    }
+    SyncFileData(logFd);
+    msync(indexMap, indexSize, MS_SYNC);
+}
+
+int ScoreStore::GetTopScores(GameMode mode, LeaderboardEntry* out, int maxCount) const {
+    if (!IsOpen() || (int)mode < 0 || (int)mode >= ScoreStoreConstants::MAX_MODES) {
+        return 0;
+    }
+    int count = std::min((int)Header()->topCount[mode], maxCount);
+    const TopEntry* table = TopTable(mode);
+    for (int i = 0; i < count; i++) {
+        out[i] = {table[i].score, table[i].playerId, table[i].resultIndex};
+    }
+    return count;
+}
+
+int ScoreStore::GetBestScore(GameMode mode) const {
+    LeaderboardEntry best;
+    return (GetTopScores(mode, &best, 1) == 1) ? best.score : 0;
+}
+
+bool ScoreStore::GetPlayerBest(uint32_t playerId, GameMode mode, int& bestScore) const {
+    if (!IsOpen() || (int)mode < 0 || (int)mode >= ScoreStoreConstants::MAX_MODES) {
+        return false;
+    }
+    const PlayerEntry* player = FindPlayer(playerId);
+    if (!player->used || player->best[mode] == NO_SCORE) {
+        return false;
+    }
+    bestScore = player->best[mode];
+    return true;
+}
+
+bool ScoreStore::ReadResult(uint64_t resultIndex, GameResult& out) const {
+    if (!IsOpen() || resultIndex >= logRecords) {
+        return false;
+    }
+    ResultRecord record;
+    if (pread(logFd, &record, sizeof(record), RecordOffset(resultIndex)) != (ssize_t)sizeof(record) ||
+        record.crc != RecordCrc(record)) {
+        return false;
+    }
+    FromRecord(record, out);
+    return true;
+}
+
+uint64_t ScoreStore::GetResultCount() const {
+    return logRecords;
+}
+
+int64_t ScoreStore::NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
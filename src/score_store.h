@@ -0,0 +1,96 @@
+#pragma once
+
+#include "game_types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ScoreStoreConstants {
+    const int MAX_MODES = 8;
+    const int DEFAULT_TOP_K = 100;
+    const uint32_t INITIAL_PLAYER_CAPACITY = 1024;
+    // Player ids: the local game records as LOCAL_PLAYER_ID, server bots as
+    // BOT_PLAYER_ID_BASE + slot and connected clients by their join nonce
+    const uint32_t LOCAL_PLAYER_ID = 1;
+    const uint32_t BOT_PLAYER_ID_BASE = 0x80000000u;
+}
+
+// One finished game (or one snake's result in a multi-snake round)
+struct GameResult {
+    GameMode mode = MODE_REGULAR;
+    int score = 0;
+    int length = 0;
+    uint32_t ticks = 0;
+    uint64_t seed = 0;          // GameState::seed: with the mode, rebuilds the start; 0 = unknown
+    int64_t timestampMs = 0;    // unix time
+    uint32_t playerId = 0;
+    bool isBot = false;
+};
+
+struct LeaderboardEntry {
+    int score;
+    uint32_t playerId;
+    uint64_t resultIndex;       // position in the log, for ReadResult
+};
+
+struct ScoreStoreConfig {
+    int topK = ScoreStoreConstants::DEFAULT_TOP_K;
+    bool syncEachAppend = false;  // flush the log to disk after every result
+};
+
+// Append-only result log plus a memory-mapped index in one directory:
+//   results.log  fixed-size records with a CRC, the source of truth
+//   results.idx  per-mode top-K tables and a per-player best hash table
+// Queries only touch the index. On open, a torn last record is cut off and
+// results the index hasn't seen yet are replayed into it; an index left
+// half-written by a crash (or from another topK) is rebuilt from the log.
+// One writer per directory, enforced with an exclusive lock.
+class ScoreStore {
+public:
+    ScoreStore() = default;
+    ~ScoreStore();
+    ScoreStore(const ScoreStore&) = delete;
+    ScoreStore& operator=(const ScoreStore&) = delete;
+
+    bool Open(const std::string& directory, const ScoreStoreConfig& newConfig = ScoreStoreConfig());
+    void Close();
+    bool IsOpen() const { return logFd >= 0; }
+
+    bool Append(const GameResult& result);
+    // Flushes the log and index to disk
+    void Sync();
+
+    // Best first; ties keep the earlier result ahead
+    int GetTopScores(GameMode mode, LeaderboardEntry* out, int maxCount) const;
+    int GetBestScore(GameMode mode) const;
+    bool GetPlayerBest(uint32_t playerId, GameMode mode, int& bestScore) const;
+    bool ReadResult(uint64_t resultIndex, GameResult& out) const;
+    uint64_t GetResultCount() const;
+
+    static int64_t NowMs();
+
+private:
+    struct IndexHeader;
+    struct TopEntry;
+    struct PlayerEntry;
+
+    bool OpenLog(const std::string& path);
+    bool OpenIndex(const std::string& path);
+    bool MapIndex(uint32_t playerCapacity);
+    bool ResetIndex(uint32_t playerCapacity);
+    bool ReplayLog(uint64_t recordCount);
+    bool IndexResult(const GameResult& result, uint64_t resultIndex);
+    bool GrowPlayers();
+
+    IndexHeader* Header() const { return (IndexHeader*)indexMap; }
+    TopEntry* TopTable(int mode) const;
+    PlayerEntry* Players() const;
+    PlayerEntry* FindPlayer(uint32_t playerId) const;
+
+    ScoreStoreConfig config;
+    int logFd = -1;
+    int indexFd = -1;
+    uint8_t* indexMap = nullptr;
+    size_t indexSize = 0;
+    uint64_t logRecords = 0;
+};
@@ -0,0 +1,80 @@
+#include "match_server.h"
+#include "metrics.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static MatchServer* activeServer = nullptr;
+
+static void HandleSignal(int) {
+    if (activeServer) {
+        activeServer->Stop();
+    }
+}
+
+static void PrintUsage() {
+    std::printf("Usage: snek_server [--port N] [--matches N] [--players N] [--size N]\n"
+                "                   [--mode regular|accelerated] [--tick-ms N] [--loopback]\n"
+                "                   [--results DIR] [--metrics FILE]\n");
+}
+
+int main(int argc, char** argv) {
+    MatchServerConfig config;
+    config.match.numSnakes = 4;
+    config.reportInterval = 5.0f;
+    std::string metricsPath;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--loopback") == 0) {
+            config.loopbackOnly = true;
+        } else if (value && std::strcmp(arg, "--port") == 0) {
+            config.port = (uint16_t)std::atoi(value); i++;
+        } else if (value && std::strcmp(arg, "--matches") == 0) {
+            config.numMatches = std::atoi(value); i++;
+        } else if (value && std::strcmp(arg, "--players") == 0) {
+            config.match.numSnakes = std::atoi(value); i++;
+        } else if (value && std::strcmp(arg, "--size") == 0) {
+            config.match.gridWidth = config.match.gridHeight = std::atoi(value); i++;
+        } else if (value && std::strcmp(arg, "--mode") == 0) {
+            config.match.gameMode = (std::strcmp(value, "accelerated") == 0) ? MODE_ACCELERATED : MODE_REGULAR; i++;
+        } else if (value && std::strcmp(arg, "--tick-ms") == 0) {
+            config.tickInterval = std::atoi(value) / 1000.0f; i++;
+        } else if (value && std::strcmp(arg, "--results") == 0) {
+            config.resultsDirectory = value; i++;
+        } else if (value && std::strcmp(arg, "--metrics") == 0) {
+            metricsPath = value; i++;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    config.match.seed = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+
+    MatchServer server;
+    if (!server.Start(config)) {
+        std::fprintf(stderr, "Could not bind UDP port %d or open the results store\n", config.port);
+        return 1;
+    }
+    // Prometheus text snapshot every few seconds
+    MetricsExporter exporter;
+    if (!metricsPath.empty() && !exporter.Start(metricsPath, MetricsConstants::DEFAULT_EXPORT_INTERVAL)) {
+        std::fprintf(stderr, "Could not write metrics to %s\n", metricsPath.c_str());
+        return 1;
+    }
+    activeServer = &server;
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+
+    std::printf("snek_server: %d match(es) of %d snakes on port %d, tick %.0f ms\n",
+                config.numMatches, server.GetMatches()[0].state.config.numSnakes,
+                server.GetPort(), server.GetTickInterval() * 1000.0f);
+
+    server.Run();
+    activeServer = nullptr;
+    return 0;
+}
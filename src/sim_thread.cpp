@@ -0,0 +1,370 @@
+#include "sim_thread.h"
+#include "game_logic.h"
+#include "metrics.h"
+#include "scenario.h"
+#include "score_store.h"
+#include "snek_engine.h"
+#include "sound_loader.h"
+#include <algorithm>
+
+// The search runs beside the ticks, so it leaves them a core
+static PlannerConfig AutopilotConfig() {
+    PlannerConfig config;
+    config.threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    config.timeBudget = 0.008f;
+    return config;
+}
+
+SimThread::SimThread(const GameState& initial, const SimConfig& config, SoundLoader* sounds)
+    : state(initial), config(config), sounds(sounds), planner(AutopilotConfig()) {
+    state.rewind = &rewind;
+    period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / SimConstants::TICK_RATE));
+    nextTick = std::chrono::steady_clock::now() + period;
+    if (!config.scenarioPath.empty()) {
+        StartRecording();
+    }
+    // The render thread has something to draw before the first tick
+    Publish();
+}
+
+SimThread::~SimThread() {
+    Stop();
+}
+
+void SimThread::Start() {
+    nextTick = std::chrono::steady_clock::now() + period;
+    #ifndef PLATFORM_WEB
+    running.store(true, std::memory_order_relaxed);
+    plannerStopping = false;
+    plannerThread = std::thread(&SimThread::RunPlanner, this);
+    thread = std::thread(&SimThread::Run, this);
+    #endif
+}
+
+void SimThread::Stop() {
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (plannerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(planMutex);
+            plannerStopping = true;
+        }
+        planWake.notify_one();
+        plannerThread.join();
+    }
+    replay.Finish();
+    FinishGame();
+}
+
+void SimThread::Run() {
+    while (running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(nextTick);
+        RunDueTicks();
+    }
+}
+
+void SimThread::RunDueTicks() {
+    auto now = std::chrono::steady_clock::now();
+    while (now >= nextTick) {
+        Metrics::RecordSeconds(METRIC_TICK_JITTER, std::chrono::duration<double>(now - nextTick).count());
+        Tick();
+        nextTick += period;
+        now = std::chrono::steady_clock::now();
+        if (now - nextTick > period * SimConstants::MAX_LATE_TICKS) {
+            // Too far behind to catch up without a burst of moves; the lost
+            // time is skipped, as if the game had been paused
+            nextTick = now + period;
+            resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+const SimSnapshot& SimThread::Latest() {
+    snapshots.Update();
+    return snapshots.Front();
+}
+
+// Keys from the queue. Frames with moves are taken one per tick so turns
+// keep their order; key-less ones in between are merged in.
+SimInput SimThread::TakeInput() {
+    SimInput merged;
+    SimInput input;
+    while (inputs.Pop(input)) {
+        if (input.frame && !merged.frame) {
+            merged.pressed = input.pressed;
+        }
+        merged.frame |= input.frame;
+        merged.commands |= input.commands & ~SimCommand::REWIND;
+        rewindHeld = (input.commands & SimCommand::REWIND) != 0;
+        if (input.frame) {
+            break;
+        }
+    }
+    return merged;
+}
+
+void SimThread::Tick() {
+    tick++;
+    if (sounds && !sounds->IsDone()) {
+        sounds->Upload(state);
+    }
+    SimInput input = TakeInput();
+
+    // Mode selection screen
+    if (state.showModeSelection) {
+        if (input.frame & FrameInput::UP) {
+            state.selectedModeIndex = std::max(state.selectedModeIndex - 1, 0);
+        }
+        if (input.frame & FrameInput::DOWN) {
+            state.selectedModeIndex = std::min(state.selectedModeIndex + 1, config.modeCount - 1);
+        }
+        if (input.commands & SimCommand::SELECT) {
+            const GameMode modes[] = {MODE_REGULAR, MODE_ACCELERATED, MODE_CUSTOM};
+            state.gameMode = modes[state.selectedModeIndex];
+            state.showModeSelection = false;
+            state.showInstructions = true;
+        }
+        Publish();
+        return;
+    }
+
+    // Instructions screen
+    if (state.showInstructions) {
+        if (input.commands & SimCommand::SELECT) {
+            state.NewGame();
+            rewind.Clear();
+            StartRecording();
+        }
+        Publish();
+        return;
+    }
+
+    // Game over restart and menu (quitting is up to the render thread)
+    if (state.gameOver) {
+        if (input.commands & SimCommand::RESTART) {
+            FinishGame();
+            std::string error;
+            if (config.scenarioPath.empty() || !Scenario::Load(config.scenarioPath, state, error)) {
+                state.NewGame();
+            }
+            rewind.Clear();
+            rewound = false;
+            CancelPlan();
+            StartRecording();
+        }
+        if (input.commands & SimCommand::MENU) {
+            FinishGame();
+            ReturnToMenu();
+            Publish();
+            return;
+        }
+    }
+
+    Play(input);
+    Publish();
+}
+
+void SimThread::Play(const SimInput& input) {
+    // Rewind one recorded tick per tick; from the game over screen, go
+    // straight back to before the crash
+    rewinding = rewindHeld && rewind.StepBack(state);
+    while (rewinding && state.gameOver && rewind.StepBack(state)) {
+    }
+    if (rewinding) {
+        CancelPlan();
+        // A replay can't follow a rewind; a new one starts when play resumes
+        replay.Finish();
+        rewound = true;
+        return;
+    }
+    if (rewound && !state.gameOver) {
+        StartRecording();
+        rewound = false;
+    }
+
+    float deltaTime = 1.0f / SimConstants::TICK_RATE;
+    uint8_t frameInput = input.frame;
+    if (input.commands & SimCommand::AUTOPILOT) {
+        autopilot = !autopilot;
+        CancelPlan();
+    }
+    if (autopilot && (frameInput & (FrameInput::UP | FrameInput::DOWN | FrameInput::LEFT | FrameInput::RIGHT)) == 0) {
+        frameInput |= ReadAutopilotInput();
+    }
+    if ((input.frame & (FrameInput::UP | FrameInput::DOWN | FrameInput::LEFT | FrameInput::RIGHT)) && !keyPending) {
+        pendingKeyTime = input.pressed;
+        keyPending = true;
+    }
+    uint32_t movesBefore = state.moveCount;
+    bool wasOver = state.gameOver;
+    rewind.BeginFrame(state);
+    GameLogic::RunFrame(state, deltaTime, frameInput);
+    rewind.EndFrame(state);
+    if (state.gameOver && !wasOver) {
+        RecordGameOver();
+    }
+    if (keyPending && (state.moveCount != movesBefore || state.gameOver)) {
+        auto now = std::chrono::steady_clock::now();
+        Metrics::RecordSeconds(METRIC_INPUT_LATENCY, std::chrono::duration<double>(now - pendingKeyTime).count());
+        // Keys still queued wait for the next move
+        keyPending = !state.directionQueue.empty();
+        pendingKeyTime = now;
+    }
+    if (replay.IsRecording()) {
+        replay.RecordFrame(deltaTime, frameInput, state);
+        if (state.gameOver) {
+            replay.Finish();
+        }
+    }
+}
+
+void SimThread::ReturnToMenu() {
+    state.gameOver = false;
+    state.showModeSelection = true;
+    state.showInstructions = false;
+    state.score = 0;
+    // Reset game state but keep high scores
+    state.snake.clear();
+    state.apples.clear();
+    state.dx = 0;
+    state.dy = 0;
+    state.directionQueue.clear();
+    state.moveTimer = 0.0f;
+    state.moveCount = 0;
+    state.gameTime = 0.0f;
+    state.canIntersectSelf = false;
+    state.immunityTimer = 0.0f;
+    state.canPassWalls = false;
+    state.wallImmunityTimer = 0.0f;
+    state.cannotEatApples = false;
+    state.cannotEatTimer = 0.0f;
+    state.isPaused = false;
+    state.pauseTimer = 0.0f;
+    state.isUserPaused = false;
+    state.isResuming = false;
+    state.resumeDelayTimer = 0.0f;
+    state.poisonSoundTimer = 0.0f;
+    state.pauseSoundTimer = 0.0f;
+    state.gameOverSoundPlayed = false;
+    rewind.Clear();
+    rewound = false;
+    rewinding = false;
+    CancelPlan();
+}
+
+void SimThread::RecordGameOver() {
+    if (state.gameMode == MODE_CUSTOM || (gameEnded && state.score < bestResult.score)) {
+        return;
+    }
+    bestResult = GameResult();
+    bestResult.mode = state.gameMode;
+    bestResult.score = state.score;
+    bestResult.length = (int)state.snake.size();
+    bestResult.ticks = state.moveCount;
+    bestResult.seed = state.seed;
+    bestResult.timestampMs = ScoreStore::NowMs();
+    bestResult.playerId = ScoreStoreConstants::LOCAL_PLAYER_ID;
+    gameEnded = true;
+}
+
+void SimThread::FinishGame() {
+    // The render thread drains the queue every frame, so it is never full
+    if (gameEnded && results.Push(bestResult)) {
+        gameEnded = false;
+    }
+}
+
+void SimThread::StartRecording() {
+    if (!config.recordDirectory.empty()) {
+        std::string path = config.recordDirectory + "/game-" + std::to_string(ScoreStore::NowMs()) + ".replay";
+        replay.Begin(path, state);
+    }
+}
+
+// Autopilot keys for this tick: one plan per move, pressed like a player
+// would, so replays and rewinds see an ordinary game. The first tick of a
+// move hands the position to the planner thread and a later one reads the
+// answer; a move that passes before the answer comes goes straight on.
+uint8_t SimThread::ReadAutopilotInput() {
+    if (state.gameOver || state.isUserPaused || state.isResuming || state.gameMode == MODE_CUSTOM ||
+        !state.directionQueue.empty() || state.moveCount == plannedMove) {
+        return 0;
+    }
+    Direction dir;
+    #ifdef PLATFORM_WEB
+    // No threads: the frame waits for the search
+    SnekGame game;
+    if (!SnekEngine::FromGameState(state, game) || !planner.Plan(game, dir)) {
+        return 0;
+    }
+    plannedMove = state.moveCount;
+    #else
+    {
+        std::lock_guard<std::mutex> lock(planMutex);
+        if (planMove != state.moveCount) {
+            if (SnekEngine::FromGameState(state, planGame)) {
+                planMove = state.moveCount;
+                planRequested++;
+                planWake.notify_one();
+            }
+            return 0;
+        }
+        if (planAnswered != planRequested) {
+            return 0;
+        }
+        plannedMove = state.moveCount;
+        if (!planFound) {
+            return 0;
+        }
+        dir = planDir;
+    }
+    #endif
+    if (dir.dx == state.dx && dir.dy == state.dy) {
+        return 0;
+    }
+    if (dir.dy < 0) return FrameInput::UP;
+    if (dir.dy > 0) return FrameInput::DOWN;
+    if (dir.dx < 0) return FrameInput::LEFT;
+    return FrameInput::RIGHT;
+}
+
+// Drops the plan asked for, e.g. when a rewind or a new game makes it stale
+void SimThread::CancelPlan() {
+    plannedMove = UINT32_MAX;
+    std::lock_guard<std::mutex> lock(planMutex);
+    planMove = UINT32_MAX;
+}
+
+// Planner thread: searches from the newest position handed over until Stop.
+// A position that comes in mid-search is searched next; the answer it
+// replaces is never read.
+void SimThread::RunPlanner() {
+    std::unique_lock<std::mutex> lock(planMutex);
+    while (true) {
+        planWake.wait(lock, [this] { return plannerStopping || planAnswered != planRequested; });
+        if (plannerStopping) {
+            return;
+        }
+        uint64_t request = planRequested;
+        SnekGame game = planGame;
+        lock.unlock();
+        Direction dir;
+        bool found = planner.Plan(game, dir);
+        lock.lock();
+        planAnswered = request;
+        planFound = found;
+        planDir = dir;
+    }
+}
+
+void SimThread::Publish() {
+    SimSnapshot& snapshot = snapshots.Back();
+    snapshot.state = state;
+    snapshot.rewinding = rewinding;
+    snapshot.autopilot = autopilot;
+    snapshot.tick = tick;
+    snapshots.Publish();
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "game_state.h"
+#include "mcts_planner.h"
+#include "replay.h"
+#include "rewind_buffer.h"
+#include "score_store.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class SoundLoader;
+
+namespace SimConstants {
+    const int TICK_RATE = 120;
+    const size_t INPUT_QUEUE = 64;
+    const size_t RESULT_QUEUE = 8;
+    // A tick this many periods late stops catching up and starts the schedule over
+    const int MAX_LATE_TICKS = 8;
+}
+
+// Keys that aren't moves, read on the render thread
+namespace SimCommand {
+    const uint8_t SELECT = 1 << 0;      // SPACE or ENTER: pick the mode, leave the instructions
+    const uint8_t RESTART = 1 << 1;     // R or SPACE on the game over screen
+    const uint8_t MENU = 1 << 2;        // M on the game over screen
+    const uint8_t AUTOPILOT = 1 << 3;   // TAB
+    const uint8_t REWIND = 1 << 4;      // BACKSPACE is held; sent whenever that changes
+}
+
+// One render frame's keys
+struct SimInput {
+    uint8_t frame = 0;          // FrameInput bits (arrows double as menu keys)
+    uint8_t commands = 0;       // SimCommand bits
+    std::chrono::steady_clock::time_point pressed;
+};
+
+// What the render thread draws: the game after a tick, never written again
+// until the render thread has moved on to a newer one
+struct SimSnapshot {
+    GameState state;
+    bool rewinding = false;
+    bool autopilot = false;
+    uint64_t tick = 0;
+};
+
+struct SimConfig {
+    std::string recordDirectory;    // a replay per game when set
+    std::string scenarioPath;       // R restarts from it when set
+    int modeCount = 2;              // entries in the mode menu
+};
+
+// The local game on its own fixed-rate thread: menus, play, rewind,
+// autopilot and replay recording, TICK_RATE times a second with a fixed
+// delta, however long frames take to draw. Keys come in through a
+// lock-free queue from the render thread, and each tick publishes a
+// snapshot through a triple buffer, so neither thread ever waits on the
+// other. Sounds are uploaded and played from here.
+class SimThread {
+public:
+    // `initial` is past Initialize (and a scenario, if any); `sounds` may be null
+    SimThread(const GameState& initial, const SimConfig& config, SoundLoader* sounds);
+    ~SimThread();
+
+    // On web there are no threads: call RunDueTicks every frame instead
+    void Start();
+    void Stop();
+    // Runs the ticks whose time has come
+    void RunDueTicks();
+
+    // Render thread. False if the queue is full and the keys were dropped.
+    bool Post(const SimInput& input) { return inputs.Push(input); }
+    // Render thread: the newest snapshot
+    const SimSnapshot& Latest();
+    // Render thread: each finished game's result, once, when the player
+    // restarts, goes to the menu or quits (Stop). A rewind can end a game
+    // more than once; its best game over is the one kept. Custom-rules games
+    // aren't reported: their rules change from file to file.
+    bool PopResult(GameResult& result) { return results.Pop(result); }
+    // Times the schedule was given up on after falling MAX_LATE_TICKS behind
+    uint64_t GetResyncs() const { return resyncs.load(std::memory_order_relaxed); }
+
+    // Once stopped
+    GameState& GetState() { return state; }
+
+private:
+    void Run();
+    void Tick();
+    SimInput TakeInput();
+    void Play(const SimInput& input);
+    void ReturnToMenu();
+    void RecordGameOver();
+    void FinishGame();
+    void StartRecording();
+    uint8_t ReadAutopilotInput();
+    void CancelPlan();
+    void RunPlanner();
+    void Publish();
+
+    GameState state;
+    SimConfig config;
+    SoundLoader* sounds;
+
+    SpscQueue<SimInput, SimConstants::INPUT_QUEUE> inputs;
+    TripleBuffer<SimSnapshot> snapshots;
+    SpscQueue<GameResult, SimConstants::RESULT_QUEUE> results;
+    GameResult bestResult;
+    bool gameEnded = false;     // bestResult holds this game's best game over so far
+
+    ReplayWriter replay;
+    // Hold BACKSPACE to rewind the last few thousand ticks
+    RewindBuffer rewind;
+    bool rewindHeld = false;
+    bool rewinding = false;
+    bool rewound = false;
+    // TAB hands the snake to the planner. It searches on its own thread
+    // from the move just made; the tick that finds the answer ready presses
+    // its key, if that move is still the current one.
+    MctsPlanner planner;
+    bool autopilot = false;
+    uint32_t plannedMove = UINT32_MAX;
+    std::thread plannerThread;
+    std::mutex planMutex;
+    std::condition_variable planWake;
+    // Guarded by planMutex, held only to hand positions and answers over
+    SnekGame planGame;
+    uint32_t planMove = UINT32_MAX;     // moveCount planGame was taken at
+    uint64_t planRequested = 0;
+    uint64_t planAnswered = 0;
+    bool planFound = false;
+    Direction planDir = {0, 0};
+    bool plannerStopping = false;
+    // Input latency runs from the first key press still waiting for a move
+    std::chrono::steady_clock::time_point pendingKeyTime;
+    bool keyPending = false;
+
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point nextTick;
+    uint64_t tick = 0;
+    std::atomic<uint64_t> resyncs{0};
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
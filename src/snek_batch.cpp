@@ -0,0 +1,146 @@
+#include "snek_batch.h"
+#include <chrono>
+#include <cstring>
+
+static const Direction ACTION_DIRECTIONS[] = {{0, 0}, {0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static uint64_t EnvSeed(uint64_t seed, int32_t env) {
+    return seed + (uint64_t)env * 0x9E3779B97F4A7C15ull;
+}
+
+bool SnekBatch::IsValidConfig(const SnekBatchConfig& config) {
+    return config.num_envs > 0 &&
+           (config.mode == SNEK_MODE_REGULAR || config.mode == SNEK_MODE_ACCELERATED);
+}
+
+void SnekBatch::Allocate(const SnekBatchConfig& newConfig) {
+    size_t count = (size_t)newConfig.num_envs;
+    config = newConfig;
+    games.resize(count);
+    ticks.resize(count);
+    actions.resize(count, SNEK_ACTION_NONE);
+    observations.resize(count * SnekEngineConstants::CELLS);
+    rewards.resize(count);
+    dones.resize(count);
+    scores.resize(count);
+}
+
+void SnekBatch::WriteObservation(const SnekGame& game, uint8_t* out) {
+    std::memset(out, SNEK_CELL_EMPTY, SnekEngineConstants::CELLS);
+    for (int i = 0; i < game.appleCount; i++) {
+        const Apple& apple = game.apples[i];
+        out[SnekGame::CellIndex(apple.col, apple.row)] = (uint8_t)(SNEK_CELL_APPLE + apple.type);
+    }
+    for (int i = game.length - 1; i >= 0; i--) {
+        Cell cell = game.Segment(i);
+        out[SnekGame::CellIndex(cell.col, cell.row)] = (i == 0) ? SNEK_CELL_HEAD : SNEK_CELL_BODY;
+    }
+}
+
+Transition SnekBatch::MakeTransition(const SnekGame& game, const uint8_t* observation, uint8_t action,
+                                     float reward, bool done, int32_t env, uint32_t tick) {
+    Transition row;
+    row.observation = observation;
+    row.action = action;
+    row.reward = reward;
+    row.done = done ? 1 : 0;
+    row.food = game.eaten ? (uint8_t)(SNEK_CELL_APPLE + game.eaten - 1) : 0;
+    if (game.gameOver) {
+        row.death = (game.deathCause == METRIC_DEATHS_WALL) ? SNEK_DEATH_WALL
+                  : (game.deathCause == METRIC_DEATHS_SELF) ? SNEK_DEATH_SELF : SNEK_DEATH_OTHER;
+    }
+    row.effects = (uint8_t)((game.canIntersectSelf ? 1 : 0) | (game.canPassWalls ? 2 : 0) |
+                            (game.cannotEatApples ? 4 : 0) | (game.isPaused ? 8 : 0));
+    row.score = game.score;
+    row.env = (uint32_t)env;
+    row.tick = tick;
+    return row;
+}
+
+bool SnekBatch::Record(const char* directory, uint32_t chunkRows) {
+    if (!directory) {
+        bool ok = !recorder || recorder->Close();
+        recorder.reset();
+        return ok;
+    }
+    recorder.reset(new TrajectoryWriter());
+    if (!recorder->Open(directory, SnekEngineConstants::CELLS, chunkRows)) {
+        recorder.reset();
+        return false;
+    }
+    return true;
+}
+
+void SnekBatch::Reset(uint64_t seed) {
+    for (int32_t env = 0; env < config.num_envs; env++) {
+        ResetEnv(env, EnvSeed(seed, env));
+    }
+}
+
+void SnekBatch::ResetEnv(int32_t env, uint64_t seed) {
+    SnekEngine::Reset(games[env], (GameMode)config.mode, seed);
+    ticks[env] = 0;
+    rewards[env] = 0.0f;
+    dones[env] = 0;
+    scores[env] = 0;
+    WriteObservation(games[env], &observations[(size_t)env * SnekEngineConstants::CELLS]);
+}
+
+void SnekBatch::Step(const uint8_t* stepActions) {
+    auto start = std::chrono::steady_clock::now();
+    if (!stepActions) {
+        stepActions = actions.data();
+    }
+    for (int32_t env = 0; env < config.num_envs; env++) {
+        SnekGame& game = games[env];
+        uint8_t action = stepActions[env];
+        const Direction* input = (action > SNEK_ACTION_NONE && action <= SNEK_ACTION_RIGHT)
+            ? &ACTION_DIRECTIONS[action] : nullptr;
+
+        int32_t before = game.score;
+        SnekEngine::Step(game, input);
+        uint32_t tick = ticks[env]++;
+
+        float reward = (float)(game.score - before);
+        bool truncated = config.max_ticks > 0 && ticks[env] >= (uint32_t)config.max_ticks;
+        scores[env] = game.score;
+        if (game.gameOver) {
+            reward -= config.death_penalty;
+        }
+        rewards[env] = reward;
+        dones[env] = (game.gameOver || truncated) ? 1 : 0;
+        if (truncated && !game.gameOver) {
+            Metrics::Add(METRIC_EPISODES);
+        }
+        uint8_t* observation = &observations[(size_t)env * SnekEngineConstants::CELLS];
+        if (recorder) {
+            recorder->Append(MakeTransition(game, observation, action, reward, dones[env] != 0, env, tick));
+        }
+        if (dones[env]) {
+            SnekEngine::Restart(game, (GameMode)config.mode);
+            ticks[env] = 0;
+        }
+        WriteObservation(game, observation);
+    }
+    Metrics::RecordSeconds(METRIC_TICK_TIME, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+uint8_t SnekBatch::Plan(int32_t env, uint32_t iterations, float timeBudget, int threads) {
+    if (!planner) {
+        PlannerConfig plannerConfig;
+        plannerConfig.deathPenalty = config.death_penalty;
+        plannerConfig.seed = config.seed;
+        planner.reset(new MctsPlanner(plannerConfig));
+    }
+    planner->SetBudget(iterations, timeBudget, threads);
+    Direction best;
+    if (!planner->Plan(games[env], best)) {
+        return SNEK_ACTION_NONE;
+    }
+    for (uint8_t action = SNEK_ACTION_UP; action <= SNEK_ACTION_RIGHT; action++) {
+        if (ACTION_DIRECTIONS[action].dx == best.dx && ACTION_DIRECTIONS[action].dy == best.dy) {
+            return action;
+        }
+    }
+    return SNEK_ACTION_NONE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "libsnek.h"
+#include "mcts_planner.h"
+#include "snek_engine.h"
+#include "trajectory.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// The object behind libsnek's opaque SnekBatch handle: the games plus the
+// buffers a trainer reads and writes
+struct SnekBatch {
+    SnekBatchConfig config = {};
+    std::vector<SnekGame> games;
+    std::vector<uint32_t> ticks;        // steps into the current episode
+    std::vector<uint8_t> actions;
+    std::vector<uint8_t> observations;
+    std::vector<float> rewards;
+    std::vector<uint8_t> dones;
+    std::vector<int32_t> scores;
+    std::unique_ptr<MctsPlanner> planner;  // made on the first Plan
+    std::unique_ptr<TrajectoryWriter> recorder;  // while recording
+
+    static bool IsValidConfig(const SnekBatchConfig& config);
+    // Sizes every buffer for config.num_envs (throws std::bad_alloc)
+    void Allocate(const SnekBatchConfig& newConfig);
+    void Reset(uint64_t seed);
+    void ResetEnv(int32_t env, uint64_t seed);
+    void Step(const uint8_t* stepActions);
+    // Starts appending every step to chunks in directory, or stops for null
+    bool Record(const char* directory, uint32_t chunkRows = TrajectoryConstants::DEFAULT_CHUNK_ROWS);
+    // SnekAction the planner picks for env's game (NONE once it's over)
+    uint8_t Plan(int32_t env, uint32_t iterations, float timeBudget, int threads);
+
+    static void WriteObservation(const SnekGame& game, uint8_t* out);
+    // The row for env's last step, before a finished game restarts
+    static Transition MakeTransition(const SnekGame& game, const uint8_t* observation, uint8_t action,
+                                     float reward, bool done, int32_t env, uint32_t tick);
+};
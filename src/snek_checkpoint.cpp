@@ -0,0 +1,184 @@
+#include "snek_checkpoint.h"
+#include "file_sync.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CHECKPOINT_MAGIC[4] = {'S', 'N', 'K', 'C'};
+
+CheckpointWriter::~CheckpointWriter() {
+    Abort();
+}
+
+bool CheckpointWriter::Begin(const std::string& path) {
+    Abort();
+    finalPath = path;
+    tempPath = path + ".tmp";
+    fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    position = 0;
+    return fd >= 0;
+}
+
+bool CheckpointWriter::WriteAll(const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        size_t chunk = std::min(size, CheckpointConstants::WRITE_CHUNK);
+        ssize_t written = write(fd, p, chunk);
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+        position += (uint64_t)written;
+    }
+    return true;
+}
+
+bool CheckpointWriter::WriteSection(const void* data, size_t size, uint64_t& offset) {
+    static const uint8_t padding[CheckpointConstants::SECTION_ALIGNMENT] = {};
+    size_t pad = (size_t)((CheckpointConstants::SECTION_ALIGNMENT -
+                           position % CheckpointConstants::SECTION_ALIGNMENT) %
+                          CheckpointConstants::SECTION_ALIGNMENT);
+    if (fd < 0 || !WriteAll(padding, pad)) {
+        return false;
+    }
+    offset = position;
+    return WriteAll(data, size);
+}
+
+bool CheckpointWriter::WriteAt(uint64_t offset, const void* data, size_t size) {
+    return fd >= 0 && pwrite(fd, data, size, (off_t)offset) == (ssize_t)size;
+}
+
+bool CheckpointWriter::Finish(bool durable) {
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = !durable || SyncFileData(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    fd = -1;
+    if (!ok || rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    if (durable) {
+        // Make the rename itself durable
+        std::string directory = finalPath.substr(0, finalPath.find_last_of('/') + 1);
+        int dirFd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+    }
+    return true;
+}
+
+void CheckpointWriter::Abort() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+        unlink(tempPath.c_str());
+    }
+}
+
+bool SnekCheckpoint::Save(const SnekBatch& batch, const std::string& path, bool durable) {
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+    header.version = CheckpointConstants::VERSION;
+    header.gameSize = sizeof(SnekGame);
+    header.cells = SnekEngineConstants::CELLS;
+    header.bodyCapacity = SnekEngineConstants::BODY_CAPACITY;
+    header.numGames = batch.games.size();
+    header.config = batch.config;
+
+    // Header goes first as a placeholder and is rewritten with the offsets
+    // once every section is out
+    size_t n = batch.games.size();
+    CheckpointWriter writer;
+    uint64_t headerOffset = 0;
+    bool ok = writer.Begin(path) &&
+              writer.WriteSection(&header, sizeof(header), headerOffset) &&
+              writer.WriteSection(batch.games.data(), n * sizeof(SnekGame), header.gamesOffset) &&
+              writer.WriteSection(batch.ticks.data(), n * sizeof(uint32_t), header.ticksOffset) &&
+              writer.WriteSection(batch.observations.data(), batch.observations.size(), header.observationsOffset) &&
+              writer.WriteSection(batch.rewards.data(), n * sizeof(float), header.rewardsOffset) &&
+              writer.WriteSection(batch.dones.data(), n, header.donesOffset) &&
+              writer.WriteSection(batch.scores.data(), n * sizeof(int32_t), header.scoresOffset);
+    if (!ok) {
+        writer.Abort();
+        return false;
+    }
+    header.fileSize = header.scoresOffset + n * sizeof(int32_t);
+    return writer.WriteAt(0, &header, sizeof(header)) && writer.Finish(durable);
+}
+
+// Points `out` at a section of `count` elements if it lies inside the file
+template <typename T>
+static bool Section(const uint8_t* base, uint64_t fileSize, uint64_t offset, uint64_t count, const T*& out) {
+    if (offset % alignof(T) != 0 || offset > fileSize || count > (fileSize - offset) / sizeof(T)) {
+        return false;
+    }
+    out = (const T*)(base + offset);
+    return true;
+}
+
+bool SnekCheckpoint::Load(const std::string& path, SnekBatch& batch) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CheckpointHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const uint8_t* base = (const uint8_t*)map;
+    CheckpointHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    uint64_t n = header.numGames;
+    size_t cells = SnekEngineConstants::CELLS;
+
+    const SnekGame* games = nullptr;
+    const uint32_t* ticks = nullptr;
+    const uint8_t* observations = nullptr;
+    const float* rewards = nullptr;
+    const uint8_t* dones = nullptr;
+    const int32_t* scores = nullptr;
+    bool ok = std::memcmp(header.magic, CHECKPOINT_MAGIC, 4) == 0 &&
+              header.version == CheckpointConstants::VERSION &&
+              header.gameSize == sizeof(SnekGame) &&
+              header.cells == (uint32_t)cells &&
+              header.bodyCapacity == (uint32_t)SnekEngineConstants::BODY_CAPACITY &&
+              header.fileSize == size &&
+              SnekBatch::IsValidConfig(header.config) &&
+              n == (uint64_t)header.config.num_envs &&
+              Section(base, size, header.gamesOffset, n, games) &&
+              Section(base, size, header.ticksOffset, n, ticks) &&
+              Section(base, size, header.observationsOffset, n * cells, observations) &&
+              Section(base, size, header.rewardsOffset, n, rewards) &&
+              Section(base, size, header.donesOffset, n, dones) &&
+              Section(base, size, header.scoresOffset, n, scores);
+    if (ok) {
+        batch.config = header.config;
+        batch.games.assign(games, games + n);
+        batch.ticks.assign(ticks, ticks + n);
+        batch.actions.assign(n, SNEK_ACTION_NONE);
+        batch.observations.assign(observations, observations + n * cells);
+        batch.rewards.assign(rewards, rewards + n);
+        batch.dones.assign(dones, dones + n);
+        batch.scores.assign(scores, scores + n);
+    }
+    munmap(map, size);
+    return ok;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "snek_batch.h"
+#include <cstdint>
+#include <string>
+
+namespace CheckpointConstants {
+    const uint32_t VERSION = 2;     // 2: 16-bit cell counts in SnekGame
+    const size_t SECTION_ALIGNMENT = 64;
+    const size_t WRITE_CHUNK = 4 << 20;
+}
+
+// Fixed header at offset 0. Sections are raw arrays in the layout of this
+// build (SnekGame is trivially copyable), each starting at a 64-byte boundary.
+// gameSize/cells/bodyCapacity reject files from builds with another layout.
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t gameSize;
+    uint32_t cells;
+    uint32_t bodyCapacity;
+    uint32_t reserved;
+    uint64_t numGames;
+    SnekBatchConfig config;
+    uint64_t gamesOffset;
+    uint64_t ticksOffset;
+    uint64_t observationsOffset;
+    uint64_t rewardsOffset;
+    uint64_t donesOffset;
+    uint64_t scoresOffset;
+    uint64_t fileSize;
+};
+
+// Streams sections to path.tmp with plain writes straight from the caller's
+// memory, then renames over path so a crash never leaves a torn checkpoint
+class CheckpointWriter {
+public:
+    ~CheckpointWriter();
+    bool Begin(const std::string& path);
+    // Pads to the next section boundary, then writes; returns the section offset
+    bool WriteSection(const void* data, size_t size, uint64_t& offset);
+    bool WriteAt(uint64_t offset, const void* data, size_t size);
+    bool Finish(bool durable);
+    void Abort();
+
+private:
+    bool WriteAll(const void* data, size_t size);
+
+    std::string finalPath;
+    std::string tempPath;
+    int fd = -1;
+    uint64_t position = 0;
+};
+
+class SnekCheckpoint {
+public:
+    static bool Save(const SnekBatch& batch, const std::string& path, bool durable);
+    // mmaps the file and copies each section into the batch in one go
+    static bool Load(const std::string& path, SnekBatch& batch);
+};
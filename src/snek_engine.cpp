@@ -0,0 +1,513 @@
+#include "snek_engine.h"
+#include "game_rules.h"
+#include "game_state.h"
+#include "metrics.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int BODY_MASK = SnekEngineConstants::BODY_CAPACITY - 1;
+
+// WithRules for the modes the engine has
+template <class Fn>
+static auto WithBuiltInRules(int mode, Fn&& fn) {
+    if (mode == MODE_ACCELERATED) {
+        return fn(AcceleratedRules());
+    }
+    return fn(RegularRules());
+}
+
+void SnekEngine::Reset(SnekGame& game, GameMode mode, uint64_t seed) {
+    game.rng.Seed(seed);
+    Restart(game, mode);
+}
+
+void SnekEngine::Restart(SnekGame& game, GameMode mode) {
+    Rng rng = game.rng;
+    std::memset((void*)&game, 0, sizeof(game));
+    game.rng = rng;
+    game.gameMode = mode;
+    WithBuiltInRules(mode, [&](const auto& rules) { Restart(game, rules); });
+}
+
+template <class Rules>
+void SnekEngine::Restart(SnekGame& game, const Rules& rules) {
+    // Same draws in the same order as GameState::Reset
+    int col = game.rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+    int row = game.rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
+    PushFront(game, {(uint8_t)col, (uint8_t)row});
+
+    for (int i = 0; i < rules.startApples; i++) {
+        SpawnApple(game, rules, 0.0f);
+    }
+}
+
+void SnekEngine::Frame(SnekGame& game, float deltaTime, const Direction* input) {
+    WithBuiltInRules(game.gameMode, [&](const auto& rules) { Frame(game, rules, deltaTime, input); });
+}
+
+template <class Rules>
+void SnekEngine::Frame(SnekGame& game, const Rules& rules, float deltaTime, const Direction* input) {
+    game.frame++;
+    game.eaten = 0;
+    Metrics::Add(METRIC_TICKS);
+
+    // GameLogic::UpdateTimers (the engine has no user pause)
+    game.gameTime += deltaTime;
+    UpdateStatusEffects(game, deltaTime);
+    UpdateAppleDespawn(game, rules);
+
+    if (input && !game.gameOver) {
+        QueueDirection(game, *input);
+    }
+    ProcessMovement(game, rules, deltaTime);
+}
+
+void SnekEngine::Step(SnekGame& game, const Direction* input) {
+    Frame(game, GetMoveInterval(game), input);
+}
+
+float SnekEngine::GetMoveInterval(const SnekGame& game) {
+    return WithBuiltInRules(game.gameMode, [&](const auto& rules) { return MoveIntervalAt(rules, game.score); });
+}
+
+void SnekEngine::UpdateStatusEffects(SnekGame& game, float deltaTime) {
+    if (game.canIntersectSelf) {
+        game.immunityTimer -= deltaTime;
+        if (game.immunityTimer <= 0.0f) {
+            game.canIntersectSelf = false;
+            game.immunityTimer = 0.0f;
+        }
+    }
+
+    if (game.cannotEatApples) {
+        game.cannotEatTimer -= deltaTime;
+        game.poisonSoundTimer -= deltaTime;
+        if (game.poisonSoundTimer <= 0.0f) {
+            game.poisonSoundTimer = 1.0f;
+        }
+        if (game.cannotEatTimer <= 0.0f) {
+            game.cannotEatApples = false;
+            game.cannotEatTimer = 0.0f;
+            game.poisonSoundTimer = 0.0f;
+        }
+    } else {
+        game.poisonSoundTimer = 0.0f;
+    }
+
+    if (game.canPassWalls) {
+        game.wallImmunityTimer -= deltaTime;
+        if (game.wallImmunityTimer <= 0.0f) {
+            game.canPassWalls = false;
+            game.wallImmunityTimer = 0.0f;
+        }
+    }
+
+    if (game.isPaused) {
+        game.pauseTimer -= deltaTime;
+        if (game.pauseTimer <= 0.0f) {
+            game.isPaused = false;
+            game.pauseTimer = 0.0f;
+        }
+    }
+}
+
+template <class Rules>
+void SnekEngine::UpdateAppleDespawn(SnekGame& game, const Rules& rules) {
+    if (rules.despawns) {
+        for (int i = 0; i < game.appleCount;) {
+            float elapsed = game.gameTime - game.apples[i].spawnTime;
+            if (elapsed >= game.apples[i].despawnTime) {
+                RemoveApple(game, i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    while (game.appleCount < rules.minApples) {
+        if (!SpawnApple(game, rules, game.gameTime)) {
+            break;
+        }
+    }
+}
+
+void SnekEngine::QueueDirection(SnekGame& game, Direction dir) {
+    const int capacity = SnekEngineConstants::DIRECTION_QUEUE_CAPACITY;
+    bool reversing = dir.dx == -game.dx && dir.dy == -game.dy;
+    if ((game.dx == 0 && game.dy == 0) || !reversing) {
+        if (game.queueCount > 0) {
+            const Direction& back = game.queue[(game.queueHead + game.queueCount - 1) % capacity];
+            if (back.dx == dir.dx && back.dy == dir.dy) {
+                return;
+            }
+        }
+        if (game.queueCount < capacity) {
+            game.queue[(game.queueHead + game.queueCount) % capacity] = dir;
+            game.queueCount++;
+        }
+    }
+}
+
+template <class Rules>
+void SnekEngine::ProcessMovement(SnekGame& game, const Rules& rules, float deltaTime) {
+    if (game.gameOver) {
+        return;
+    }
+    if (!game.isPaused) {
+        game.moveTimer += deltaTime;
+    }
+    // GameLogic's catch-up loop
+    int moves = 0;
+    float interval = MoveIntervalAt(rules, game.score);
+    while (!game.isPaused && !game.gameOver && game.moveTimer >= interval) {
+        if (moves == GameConstants::MAX_MOVES_PER_FRAME) {
+            Metrics::Add(METRIC_DROPPED_MOVES, (uint64_t)(game.moveTimer / interval));
+            game.moveTimer = std::fmod(game.moveTimer, interval);
+            break;
+        }
+        game.moveTimer -= interval;
+        Move(game, rules);
+        moves++;
+        interval = MoveIntervalAt(rules, game.score);
+    }
+}
+
+template <class Rules>
+void SnekEngine::Move(SnekGame& game, const Rules& rules) {
+    // GameLogic::ProcessDirectionQueue
+    if (game.queueCount > 0) {
+        Direction next = game.queue[game.queueHead];
+        if ((game.dx == 0 && game.dy == 0) || next.dx != -game.dx || next.dy != -game.dy) {
+            game.dx = next.dx;
+            game.dy = next.dy;
+        }
+        game.queueHead = (game.queueHead + 1) % SnekEngineConstants::DIRECTION_QUEUE_CAPACITY;
+        game.queueCount--;
+    }
+
+    if (game.dx == 0 && game.dy == 0) {
+        return;
+    }
+    game.moveCount++;
+
+    Cell head = game.Segment(0);
+    int col = head.col + game.dx;
+    int row = head.row + game.dy;
+    if (game.canPassWalls) {
+        if (col < 0) {
+            col = GameConstants::GRID_WIDTH - 1;
+        } else if (col >= GameConstants::GRID_WIDTH) {
+            col = 0;
+        }
+        if (row < 0) {
+            row = GameConstants::GRID_HEIGHT - 1;
+        } else if (row >= GameConstants::GRID_HEIGHT) {
+            row = 0;
+        }
+    } else if (col < 0 || col >= GameConstants::GRID_WIDTH ||
+               row < 0 || row >= GameConstants::GRID_HEIGHT) {
+        EndGame(game, METRIC_DEATHS_WALL);
+        return;
+    }
+    CheckCollisions(game, rules, {(uint8_t)col, (uint8_t)row});
+}
+
+template <class Rules>
+void SnekEngine::CheckCollisions(SnekGame& game, const Rules& rules, Cell newHead) {
+    // Room for the new head plus a grown tail
+    if (game.length + 2 > SnekEngineConstants::BODY_CAPACITY) {
+        EndGame(game, METRIC_DEATHS_OTHER);
+        return;
+    }
+
+    // Segment counts cover the whole body, tail included, like GameLogic's scan
+    if (!game.canIntersectSelf && game.cellCount[SnekGame::CellIndex(newHead.col, newHead.row)] > 0) {
+        PushFront(game, newHead);
+        EndGame(game, METRIC_DEATHS_SELF);
+        return;
+    }
+
+    int eatenAppleIndex = -1;
+    for (int i = 0; i < game.appleCount; i++) {
+        if (game.apples[i].col == newHead.col && game.apples[i].row == newHead.row) {
+            eatenAppleIndex = i;
+            break;
+        }
+    }
+
+    PushFront(game, newHead);
+    if (eatenAppleIndex >= 0) {
+        HandleAppleConsumption(game, rules, eatenAppleIndex);
+    } else {
+        PopBack(game);
+    }
+}
+
+template <class Rules>
+void SnekEngine::HandleAppleConsumption(SnekGame& game, const Rules& rules, int eatenAppleIndex) {
+    FoodType eatenFoodType = game.apples[eatenAppleIndex].type;
+    RemoveApple(game, eatenAppleIndex);
+    game.eaten = (uint8_t)(eatenFoodType + 1);
+
+    if (eatenFoodType == POISONOUS) {
+        game.isPaused = true;
+        game.pauseTimer = rules.poisonPauseDuration;
+        game.queueCount = 0;
+
+        for (int i = 0, j = game.length - 1; i < j; i++, j--) {
+            std::swap(game.body[(game.head + i) & BODY_MASK], game.body[(game.head + j) & BODY_MASK]);
+        }
+        PopBack(game);
+
+        game.dx = -game.dx;
+        game.dy = -game.dy;
+
+        game.cannotEatApples = true;
+        game.cannotEatTimer = rules.cannotEatDuration;
+        game.poisonSoundTimer = 1.0f;
+    } else if (eatenFoodType == TELEPORT) {
+        if (!game.cannotEatApples) {
+            Teleport(game);
+            if (game.gameOver) {
+                return;
+            }
+        } else {
+            PopBack(game);
+        }
+    } else if (eatenFoodType == POMME_PLUS || eatenFoodType == POMME_SUPREME) {
+        game.score += 2;
+        PushBack(game, game.Segment(game.length - 1));
+        game.canIntersectSelf = true;
+        game.immunityTimer = rules.immunityDuration;
+        if (eatenFoodType == POMME_SUPREME) {
+            game.canPassWalls = true;
+            game.wallImmunityTimer = rules.wallImmunityDuration;
+        }
+    } else {
+        if (!game.cannotEatApples) {
+            game.score++;
+            PushBack(game, game.Segment(game.length - 1));
+        } else {
+            PopBack(game);
+        }
+    }
+
+    for (int i = 0; i < rules.applesPerEat && game.appleCount < rules.maxApples; i++) {
+        SpawnApple(game, rules, game.gameTime);
+    }
+}
+
+void SnekEngine::Teleport(SnekGame& game) {
+    PopFront(game);
+    int snakeLength = game.length;
+
+    int col, row;
+    int attempts = 0;
+    do {
+        if (attempts++ == SnekEngineConstants::MAX_TELEPORT_ATTEMPTS) {
+            EndGame(game, METRIC_DEATHS_OTHER);
+            return;
+        }
+        col = game.rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+        row = game.rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
+    } while (!IsValidPosition(game, col, row));
+
+    switch (game.rng.GetValue(0, 3)) {
+        case 0: game.dx = 0; game.dy = -1; break;
+        case 1: game.dx = 0; game.dy = 1; break;
+        case 2: game.dx = -1; game.dy = 0; break;
+        case 3: game.dx = 1; game.dy = 0; break;
+    }
+
+    // Lay the body out behind the new head, clamped to the walls
+    std::memset(game.cellCount, 0, sizeof(game.cellCount));
+    game.length = 0;
+    PushBack(game, {(uint8_t)col, (uint8_t)row});
+    for (int i = 1; i < snakeLength; i++) {
+        int segCol = std::min(std::max(col - game.dx * i, 0), GameConstants::GRID_WIDTH - 1);
+        int segRow = std::min(std::max(row - game.dy * i, 0), GameConstants::GRID_HEIGHT - 1);
+        PushBack(game, {(uint8_t)segCol, (uint8_t)segRow});
+    }
+
+    game.queueCount = 0;
+    game.dx = 0;
+    game.dy = 0;
+    game.moveTimer = 0.0f;
+}
+
+bool SnekEngine::IsValidPosition(const SnekGame& game, int col, int row) {
+    if (game.cellCount[SnekGame::CellIndex(col, row)] > 0) {
+        return false;
+    }
+    for (int i = 0; i < game.appleCount; i++) {
+        if (game.apples[i].col == col && game.apples[i].row == row) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Rules>
+FoodType SnekEngine::GetRandomFoodType(SnekGame& game, const Rules& rules) {
+    return rules.foods.Sample(game.rng);
+}
+
+template <class Rules>
+bool SnekEngine::SpawnApple(SnekGame& game, const Rules& rules, float currentTime) {
+    if (game.appleCount >= rules.maxApples) {
+        return false;
+    }
+
+    // Same attempt accounting as GameState::SpawnApple: a hit on the 100th
+    // attempt still counts as a failure
+    int attempts = 0;
+    int col, row;
+    do {
+        col = game.rng.GetValue(0, GameConstants::GRID_WIDTH - 1);
+        row = game.rng.GetValue(0, GameConstants::GRID_HEIGHT - 1);
+        attempts++;
+    } while (!IsValidPosition(game, col, row) && attempts < 100);
+    if (attempts > 1) {
+        Metrics::Add(METRIC_SPAWN_RETRIES, (uint64_t)(attempts - 1));
+    }
+    if (attempts >= 100) {
+        return false;
+    }
+
+    Apple& apple = game.apples[game.appleCount++];
+    apple.col = col;
+    apple.row = row;
+    apple.type = GetRandomFoodType(game, rules);
+    apple.spawnTime = currentTime;
+    apple.despawnTime = (float)game.rng.GetValue(rules.despawnMin, rules.despawnMax);
+    return true;
+}
+
+void SnekEngine::RemoveApple(SnekGame& game, int appleIndex) {
+    // Order-preserving, like the vector erase in GameState
+    for (int i = appleIndex + 1; i < game.appleCount; i++) {
+        game.apples[i - 1] = game.apples[i];
+    }
+    game.appleCount--;
+}
+
+void SnekEngine::PushFront(SnekGame& game, Cell cell) {
+    game.head = (uint16_t)((game.head - 1) & BODY_MASK);
+    game.body[game.head] = cell;
+    game.length++;
+    game.cellCount[SnekGame::CellIndex(cell.col, cell.row)]++;
+}
+
+void SnekEngine::PushBack(SnekGame& game, Cell cell) {
+    game.body[(game.head + game.length) & BODY_MASK] = cell;
+    game.length++;
+    game.cellCount[SnekGame::CellIndex(cell.col, cell.row)]++;
+}
+
+void SnekEngine::PopFront(SnekGame& game) {
+    Cell cell = game.body[game.head];
+    game.cellCount[SnekGame::CellIndex(cell.col, cell.row)]--;
+    game.head = (uint16_t)((game.head + 1) & BODY_MASK);
+    game.length--;
+}
+
+void SnekEngine::PopBack(SnekGame& game) {
+    Cell cell = game.Segment(game.length - 1);
+    game.cellCount[SnekGame::CellIndex(cell.col, cell.row)]--;
+    game.length--;
+}
+
+void SnekEngine::EndGame(SnekGame& game, MetricCounter cause) {
+    game.gameOver = true;
+    game.deathCause = (uint8_t)cause;
+    Metrics::Add(cause);
+    Metrics::Add(METRIC_EPISODES);
+}
+
+void SnekEngine::ToGameState(const SnekGame& game, GameState& out) {
+    out.gameMode = (GameMode)game.gameMode;
+    out.showModeSelection = false;
+    out.showInstructions = false;
+    out.gameOver = game.gameOver;
+    out.score = game.score;
+
+    out.snake.resize(game.length);
+    for (int i = 0; i < game.length; i++) {
+        Cell cell = game.Segment(i);
+        out.snake[i] = {cell.col, cell.row};
+    }
+    out.dx = game.dx;
+    out.dy = game.dy;
+    out.directionQueue.clear();
+    for (int i = 0; i < game.queueCount; i++) {
+        out.directionQueue.push_back(game.queue[(game.queueHead + i) % SnekEngineConstants::DIRECTION_QUEUE_CAPACITY]);
+    }
+    out.moveTimer = game.moveTimer;
+    out.moveCount = game.moveCount;
+
+    out.apples.assign(game.apples, game.apples + game.appleCount);
+    out.gameTime = game.gameTime;
+
+    out.canIntersectSelf = game.canIntersectSelf;
+    out.immunityTimer = game.immunityTimer;
+    out.canPassWalls = game.canPassWalls;
+    out.wallImmunityTimer = game.wallImmunityTimer;
+    out.cannotEatApples = game.cannotEatApples;
+    out.cannotEatTimer = game.cannotEatTimer;
+    out.poisonSoundTimer = game.poisonSoundTimer;
+    out.isPaused = game.isPaused;
+    out.pauseTimer = game.pauseTimer;
+    out.isUserPaused = false;
+    out.isResuming = false;
+    out.hash = Zobrist::Hash(out);
+}
+
+bool SnekEngine::FromGameState(const GameState& state, SnekGame& out) {
+    if (state.gameMode == MODE_CUSTOM || state.snake.empty() || state.snake.size() > (size_t)SnekEngineConstants::BODY_CAPACITY ||
+        state.apples.size() > (size_t)GameConstants::MAX_APPLES ||
+        state.directionQueue.size() > (size_t)SnekEngineConstants::DIRECTION_QUEUE_CAPACITY) {
+        return false;
+    }
+    auto onBoard = [](int col, int row) {
+        return col >= 0 && col < GameConstants::GRID_WIDTH && row >= 0 && row < GameConstants::GRID_HEIGHT;
+    };
+
+    std::memset((void*)&out, 0, sizeof(out));
+    out.rng = state.rng;
+    out.gameMode = state.gameMode;
+    out.gameOver = state.gameOver;
+    out.score = state.score;
+    for (const auto& segment : state.snake) {
+        if (!onBoard(segment.col, segment.row)) {
+            return false;
+        }
+        PushBack(out, {(uint8_t)segment.col, (uint8_t)segment.row});
+    }
+    for (const auto& apple : state.apples) {
+        if (!onBoard(apple.col, apple.row)) {
+            return false;
+        }
+        out.apples[out.appleCount++] = apple;
+    }
+    for (const auto& dir : state.directionQueue) {
+        out.queue[out.queueCount++] = dir;
+    }
+    out.dx = state.dx;
+    out.dy = state.dy;
+    out.moveTimer = state.moveTimer;
+    out.moveCount = state.moveCount;
+    out.gameTime = state.gameTime;
+
+    out.canIntersectSelf = state.canIntersectSelf;
+    out.immunityTimer = state.immunityTimer;
+    out.canPassWalls = state.canPassWalls;
+    out.wallImmunityTimer = state.wallImmunityTimer;
+    out.cannotEatApples = state.cannotEatApples;
+    out.cannotEatTimer = state.cannotEatTimer;
+    out.poisonSoundTimer = state.poisonSoundTimer;
+    out.isPaused = state.isPaused;
+    out.pauseTimer = state.pauseTimer;
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "game_types.h"
+#include "metrics.h"
+#include "rng.h"
+#include <cstdint>
+
+class GameState;
+
+namespace SnekEngineConstants {
+    const int CELLS = GameConstants::GRID_WIDTH * GameConstants::GRID_HEIGHT;
+    // Ring capacity for the body (power of two), the same limit as
+    // GameState's body: a game that fills it ends
+    const int BODY_CAPACITY = GameConstants::MAX_SNAKE_LENGTH;
+    // Keys past this are dropped, as in GameState's queue
+    const int DIRECTION_QUEUE_CAPACITY = GameConstants::DIRECTION_QUEUE_CAPACITY;
+    // GameLogic retries a teleport until it lands; we give up and end the game
+    const int MAX_TELEPORT_ATTEMPTS = 1 << 16;
+}
+
+struct Cell {
+    uint8_t col;
+    uint8_t row;
+};
+
+// Single-player game with the GameState/GameLogic rules in one fixed-size,
+// trivially copyable block: ring-buffer body, per-cell segment counts instead
+// of body scans, and a per-game Rng in place of raylib's global one.
+// Timers are the same floats updated in the same order, so a game driven by
+// the same frames and random draws matches GameLogic exactly.
+struct SnekGame {
+    // Body: segment i lives at body[(head + i) & (BODY_CAPACITY - 1)]
+    uint16_t head;
+    uint16_t length;
+    Cell body[SnekEngineConstants::BODY_CAPACITY];
+    uint16_t cellCount[SnekEngineConstants::CELLS];   // teleports can stack a whole body on one cell
+
+    Apple apples[GameConstants::MAX_APPLES];
+    int32_t appleCount;
+
+    Direction queue[SnekEngineConstants::DIRECTION_QUEUE_CAPACITY];
+    int32_t queueHead;
+    int32_t queueCount;
+
+    int32_t dx;
+    int32_t dy;
+    int32_t score;
+    uint32_t moveCount;
+    uint32_t frame;
+    int32_t gameMode;
+    bool gameOver;
+
+    float moveTimer;
+    float gameTime;
+
+    bool canIntersectSelf;
+    float immunityTimer;
+    bool canPassWalls;
+    float wallImmunityTimer;
+    bool cannotEatApples;
+    float cannotEatTimer;
+    float poisonSoundTimer;
+    bool isPaused;
+    float pauseTimer;
+
+    // What the last frame did, for trajectory recording: the food eaten
+    // (FoodType + 1, 0 for none) and, once over, why (a METRIC_DEATHS_* counter)
+    uint8_t eaten;
+    uint8_t deathCause;
+
+    Rng rng;
+
+    Cell Segment(int i) const {
+        return body[(head + i) & (SnekEngineConstants::BODY_CAPACITY - 1)];
+    }
+    static int CellIndex(int col, int row) { return row * GameConstants::GRID_WIDTH + col; }
+};
+
+class SnekEngine {
+public:
+    // Seeds the game's Rng, then starts a game like GameState::Reset
+    static void Reset(SnekGame& game, GameMode mode, uint64_t seed);
+    // New game continuing the current Rng stream (auto-reset after game over)
+    static void Restart(SnekGame& game, GameMode mode);
+
+    // One frame of main.cpp's loop: timers, then the key press (if any), then movement
+    static void Frame(SnekGame& game, float deltaTime, const Direction* input);
+    // One frame of a full move interval: always a move unless paused
+    static void Step(SnekGame& game, const Direction* input);
+
+    static float GetMoveInterval(const SnekGame& game);
+    // Expands into the legacy representation (rendering and comparisons)
+    static void ToGameState(const SnekGame& game, GameState& out);
+    // Packs a legacy state, RNG included; false if it doesn't fit the fixed
+    // layout (too long, too many apples or queued keys, cells off the board)
+    // or plays MODE_CUSTOM, which the engine has no rules for
+    static bool FromGameState(const GameState& state, SnekGame& out);
+
+private:
+    // Built-in modes only (MODE_CUSTOM is a GameState feature); the public
+    // entry points dispatch on gameMode once and run one of these
+    template <class Rules> static void Restart(SnekGame& game, const Rules& rules);
+    template <class Rules> static void Frame(SnekGame& game, const Rules& rules, float deltaTime, const Direction* input);
+    template <class Rules> static void UpdateAppleDespawn(SnekGame& game, const Rules& rules);
+    template <class Rules> static void ProcessMovement(SnekGame& game, const Rules& rules, float deltaTime);
+    template <class Rules> static void Move(SnekGame& game, const Rules& rules);
+    template <class Rules> static void CheckCollisions(SnekGame& game, const Rules& rules, Cell newHead);
+    template <class Rules> static void HandleAppleConsumption(SnekGame& game, const Rules& rules, int eatenAppleIndex);
+    template <class Rules> static FoodType GetRandomFoodType(SnekGame& game, const Rules& rules);
+    template <class Rules> static bool SpawnApple(SnekGame& game, const Rules& rules, float currentTime);
+
+    static void UpdateStatusEffects(SnekGame& game, float deltaTime);
+    static void QueueDirection(SnekGame& game, Direction dir);
+    static void Teleport(SnekGame& game);
+
+    static bool IsValidPosition(const SnekGame& game, int col, int row);
+    static void RemoveApple(SnekGame& game, int appleIndex);
+
+    static void PushFront(SnekGame& game, Cell cell);
+    static void PushBack(SnekGame& game, Cell cell);
+    static void PopFront(SnekGame& game);
+    static void PopBack(SnekGame& game);
+    // Counts the game and its cause in Metrics
+    static void EndGame(SnekGame& game, MetricCounter cause);
+};
@@ -0,0 +1,257 @@
+#include "soft_renderer.h"
+#include "renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SNEK_SOFT_AVX2 1
+#include <immintrin.h>
+#endif
+
+using GameConstants::BOARD_START_Y;
+using GameConstants::BORDER_OFFSET;
+using GameConstants::CELL_SIZE;
+using GameConstants::GRID_HEIGHT;
+using GameConstants::GRID_WIDTH;
+using GameConstants::TOTAL_GRID_HEIGHT;
+using GameConstants::TOTAL_GRID_WIDTH;
+
+namespace {
+    // Pixels [x0, x1) x [y0, y1)
+    struct PixelRect {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+        Color color;
+    };
+
+    // Screen coordinates to pixel edges at one frame size. A pixel is
+    // covered when its centre is inside, left and top edges included.
+    struct Raster {
+        int width;
+        int height;
+        float scaleX;
+        float scaleY;
+
+        int EdgeX(float x) const {
+            return std::min(std::max((int)std::ceil(x * scaleX - 0.5f), 0), width);
+        }
+        int EdgeY(float y) const {
+            return std::min(std::max((int)std::ceil(y * scaleY - 0.5f), 0), height);
+        }
+        void Add(std::vector<PixelRect>& rects, float x, float y, float w, float h, Color color) const {
+            PixelRect rect = {EdgeX(x), EdgeY(y), EdgeX(x + w), EdgeY(y + h), color};
+            if (rect.x1 > rect.x0 && rect.y1 > rect.y0) {
+                rects.push_back(rect);
+            }
+        }
+    };
+
+    // Everything one frame needs: template rows for the board, the pixel
+    // rows where each grid row starts, and the rectangles drawn over them
+    struct Frame {
+        std::vector<uint8_t> scoreRow;
+        std::vector<uint8_t> borderRow;
+        std::vector<uint8_t> boardRows[2];     // by board row parity
+        int rowEdges[TOTAL_GRID_HEIGHT + 1];
+        std::vector<PixelRect> rects;
+    };
+}
+
+// The board cell rectangle DrawBoardRect draws, clipped to the board the same way
+static void AddBoardRect(const Raster& raster, std::vector<PixelRect>& rects, float col, float row, float width,
+                         float height, Color color) {
+    float left = std::max(col, 0.0f);
+    float top = std::max(row, 0.0f);
+    float right = std::min(col + width, (float)GRID_WIDTH);
+    float bottom = std::min(row + height, (float)GRID_HEIGHT);
+    if (right <= left || bottom <= top) {
+        return;
+    }
+    const float cellSize = (float)CELL_SIZE;
+    raster.Add(rects, (left + BORDER_OFFSET) * cellSize, BOARD_START_Y + (top + BORDER_OFFSET) * cellSize,
+               (right - left) * cellSize, (bottom - top) * cellSize, color);
+}
+
+static void AddSlidingCell(const Raster& raster, std::vector<PixelRect>& rects, Position cell, int dx, int dy,
+                           float offset, bool wrap, Color color) {
+    float col = cell.col + dx * offset;
+    float row = cell.row + dy * offset;
+    AddBoardRect(raster, rects, col, row, 1.0f, 1.0f, color);
+    if (wrap && (dx != 0 || dy != 0)) {
+        AddBoardRect(raster, rects, col - dx * GRID_WIDTH, row - dy * GRID_HEIGHT, 1.0f, 1.0f, color);
+    }
+}
+
+static void AddCell(const Raster& raster, std::vector<PixelRect>& rects, Position cell, Color color) {
+    raster.Add(rects, (float)((cell.col + BORDER_OFFSET) * CELL_SIZE),
+               (float)(BOARD_START_Y + (cell.row + BORDER_OFFSET) * CELL_SIZE), (float)CELL_SIZE,
+               (float)CELL_SIZE, color);
+}
+
+// Lays out a frame in DrawGame's order
+static void BuildFrame(const GameState& state, const Raster& raster, Frame& frame) {
+    size_t rowBytes = (size_t)raster.width * 3;
+    frame.scoreRow.assign(rowBytes, 0);
+    frame.borderRow.assign(rowBytes, 0);
+    int colEdges[TOTAL_GRID_WIDTH + 1];
+    for (int col = 0; col <= TOTAL_GRID_WIDTH; col++) {
+        colEdges[col] = raster.EdgeX((float)(col * CELL_SIZE));
+    }
+    for (int row = 0; row <= TOTAL_GRID_HEIGHT; row++) {
+        frame.rowEdges[row] = raster.EdgeY((float)(BOARD_START_Y + row * CELL_SIZE));
+    }
+    SoftRenderer::FillSpan(&frame.borderRow[colEdges[0] * 3], colEdges[TOTAL_GRID_WIDTH] - colEdges[0], WHITE);
+    for (int parity = 0; parity < 2; parity++) {
+        std::vector<uint8_t>& line = frame.boardRows[parity];
+        line.assign(rowBytes, 0);
+        SoftRenderer::FillSpan(&line[colEdges[0] * 3], colEdges[1] - colEdges[0], WHITE);
+        int last = TOTAL_GRID_WIDTH - 1;
+        SoftRenderer::FillSpan(&line[colEdges[last] * 3], colEdges[last + 1] - colEdges[last], WHITE);
+        for (int col = 0; col < GRID_WIDTH; col++) {
+            int left = colEdges[col + BORDER_OFFSET];
+            Color color = ((parity + col) % 2 == 0) ? BLACK : GameConstants::GRAY_COLOR;
+            SoftRenderer::FillSpan(&line[left * 3], colEdges[col + BORDER_OFFSET + 1] - left, color);
+        }
+    }
+
+    frame.rects.clear();
+    for (const auto& apple : state.apples) {
+        AddCell(raster, frame.rects, {apple.col, apple.row}, Renderer::GetFoodColor(apple.type));
+    }
+    if (state.snake.empty()) {
+        return;
+    }
+    SnakeMotion motion = Renderer::GetSnakeMotion(state);
+    bool wrap = state.canPassWalls;
+    size_t length = state.snake.size();
+    for (size_t i = 1; i + 1 < length; i++) {
+        AddCell(raster, frame.rects, state.snake[i], GameConstants::SNAKE_COLOR);
+    }
+    AddSlidingCell(raster, frame.rects, state.snake[length - 1], motion.tailDx, motion.tailDy, motion.fraction, wrap,
+                   GameConstants::SNAKE_COLOR);
+    if (length > 1) {
+        AddCell(raster, frame.rects, state.snake[0], GameConstants::SNAKE_COLOR);
+    }
+    AddSlidingCell(raster, frame.rects, state.snake[0], motion.headDx, motion.headDy, motion.fraction, wrap,
+                   GameConstants::SNAKE_HEAD_COLOR);
+}
+
+// Rows [y0, y1) of a frame laid out by BuildFrame
+static void FillRows(const Frame& frame, const Raster& raster, int y0, int y1, uint8_t* rgb) {
+    size_t rowBytes = (size_t)raster.width * 3;
+    int gridRow = 0;
+    for (int y = y0; y < y1; y++) {
+        const std::vector<uint8_t>* line = &frame.scoreRow;
+        if (y >= frame.rowEdges[0] && y < frame.rowEdges[TOTAL_GRID_HEIGHT]) {
+            while (y >= frame.rowEdges[gridRow + 1]) {
+                gridRow++;
+            }
+            if (gridRow == 0 || gridRow == TOTAL_GRID_HEIGHT - 1) {
+                line = &frame.borderRow;
+            } else {
+                line = &frame.boardRows[(gridRow - BORDER_OFFSET) % 2];
+            }
+        }
+        std::memcpy(rgb + (size_t)y * rowBytes, line->data(), rowBytes);
+    }
+    for (const PixelRect& rect : frame.rects) {
+        int top = std::max(rect.y0, y0);
+        int bottom = std::min(rect.y1, y1);
+        for (int y = top; y < bottom; y++) {
+            SoftRenderer::FillSpan(rgb + (size_t)y * rowBytes + (size_t)rect.x0 * 3, rect.x1 - rect.x0, rect.color);
+        }
+    }
+}
+
+static Raster MakeRaster(int width, int height) {
+    return {width, height, (float)width / GameConstants::SCREEN_WIDTH, (float)height / GameConstants::SCREEN_HEIGHT};
+}
+
+void SoftRenderer::Render(const GameState& state, int width, int height, uint8_t* rgb) {
+    Raster raster = MakeRaster(width, height);
+    Frame frame;
+    BuildFrame(state, raster, frame);
+    FillRows(frame, raster, 0, height, rgb);
+}
+
+void SoftRenderer::RenderBatch(const GameState* states, int count, int width, int height, uint8_t* rgb,
+                               int threads) {
+    Raster raster = MakeRaster(width, height);
+    int64_t totalRows = (int64_t)count * height;
+    threads = (int)std::max<int64_t>(1, std::min<int64_t>(threads, totalRows));
+    size_t frameBytes = (size_t)width * height * 3;
+    // Each band lays out only the frames it has rows in
+    auto band = [&](int index) {
+        int64_t start = totalRows * index / threads;
+        int64_t end = totalRows * (index + 1) / threads;
+        Frame frame;
+        for (int64_t f = start / height; f < count && f * height < end; f++) {
+            int y0 = (int)(std::max(start, f * height) - f * height);
+            int y1 = (int)(std::min(end, (f + 1) * height) - f * height);
+            BuildFrame(states[f], raster, frame);
+            FillRows(frame, raster, y0, y1, rgb + (size_t)f * frameBytes);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; i++) {
+        helpers.emplace_back(band, i);
+    }
+    band(0);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+}
+
+void SoftRenderer::FillSpanScalar(uint8_t* rgb, int count, Color color) {
+    for (int i = 0; i < count; i++) {
+        rgb[0] = color.r;
+        rgb[1] = color.g;
+        rgb[2] = color.b;
+        rgb += 3;
+    }
+}
+
+#ifdef SNEK_SOFT_AVX2
+// 32 pixels are 96 bytes, three whole vectors of the repeating color
+__attribute__((target("avx2")))
+static void FillSpanAvx2(uint8_t* rgb, int count, Color color) {
+    alignas(32) uint8_t pattern[96];
+    SoftRenderer::FillSpanScalar(pattern, 32, color);
+    const __m256i first = _mm256_load_si256((const __m256i*)pattern);
+    const __m256i second = _mm256_load_si256((const __m256i*)(pattern + 32));
+    const __m256i third = _mm256_load_si256((const __m256i*)(pattern + 64));
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        _mm256_storeu_si256((__m256i*)rgb, first);
+        _mm256_storeu_si256((__m256i*)(rgb + 32), second);
+        _mm256_storeu_si256((__m256i*)(rgb + 64), third);
+        rgb += 96;
+    }
+    SoftRenderer::FillSpanScalar(rgb, count - i, color);
+}
+#endif
+
+bool SoftRenderer::HasAvx2() {
+#ifdef SNEK_SOFT_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void SoftRenderer::FillSpan(uint8_t* rgb, int count, Color color) {
+#ifdef SNEK_SOFT_AVX2
+    // Short spans (downscaled cells) aren't worth building the vectors for
+    if (count >= 32 && HasAvx2()) {
+        FillSpanAvx2(rgb, count, color);
+        return;
+    }
+#endif
+    FillSpanScalar(rgb, count, color);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "game_state.h"
+#include "raylib.h"
+#include <cstdint>
+
+// Renderer::DrawGame on the CPU, for agents and video checks on machines
+// without a GL context. Frames are RGB, 3 bytes a pixel, top row first,
+// width * height * 3 bytes, into the caller's buffer. At the window's size
+// (SCREEN_WIDTH x SCREEN_HEIGHT) every pixel matches DrawGame except the
+// score area's text, which is left black: glyphs come from raylib's font
+// texture. Smaller sizes are the same scene rasterized at that size, each
+// rectangle covering the pixels whose centres it covers, as the GPU does.
+//
+// The border and checkerboard are built once per frame as three template
+// rows and copied down; apples and the snake are then filled as spans. On
+// x86 CPUs with AVX2 spans are filled 32 pixels at a time; elsewhere the
+// scalar version runs, with the same output.
+class SoftRenderer {
+public:
+    static void Render(const GameState& state, int width, int height, uint8_t* rgb);
+    // `count` frames back to back, [count][height][width][3]. All rows are
+    // split into one band per thread, across frame boundaries.
+    static void RenderBatch(const GameState* states, int count, int width, int height, uint8_t* rgb,
+                            int threads);
+
+    // `count` pixels of one color from `rgb` on
+    static void FillSpan(uint8_t* rgb, int count, Color color);
+    // The reference version, and what FillSpan runs without AVX2
+    static void FillSpanScalar(uint8_t* rgb, int count, Color color);
+    static bool HasAvx2();
+};
@@ -0,0 +1,145 @@
+#include "sound_loader.h"
+#include "game_state.h"
+#include <cstdio>
+#include <functional>
+
+namespace {
+    struct SoundFile {
+        const char* name;
+        Sound GameState::*sound;
+    };
+    const SoundFile SOUND_FILES[SoundLoaderConstants::SOUND_COUNT] = {
+        {"apple.mp3", &GameState::appleSound},
+        {"poison.mp3", &GameState::poisonSound},
+        {"golden.mp3", &GameState::goldenSound},
+        {"purple.mp3", &GameState::purpleSound},
+        {"gameover.mp3", &GameState::gameOverSound},
+        {"pause.mp3", &GameState::pauseSound},
+    };
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+SoundLoader::~SoundLoader() {
+    Wait();
+}
+
+std::string SoundLoader::FindSoundsPath() {
+    #ifdef PLATFORM_WEB
+    // On web, preloaded files are at /sounds/
+    return "/sounds/";
+    #else
+    // Try different paths (handles different deployment scenarios)
+    const char* testPaths[] = {
+        "sounds/apple.mp3",           // Same directory as executable
+        "../sounds/apple.mp3",        // Parent directory
+        "../Resources/sounds/apple.mp3", // macOS app bundle
+        "./sounds/apple.mp3",         // Current directory
+    };
+    for (const char* testPath : testPaths) {
+        FILE* file = std::fopen(testPath, "r");
+        if (file) {
+            std::fclose(file);
+            // Extract directory path
+            std::string path = testPath;
+            return path.substr(0, path.find_last_of("/\\") + 1);
+        }
+    }
+    return "sounds/";
+    #endif
+}
+
+void SoundLoader::InitAudio() {
+    auto start = std::chrono::steady_clock::now();
+    InitAudioDevice();
+    stats.audioSeconds = SecondsSince(start);
+    audioReady.store(true, std::memory_order_release);
+}
+
+void SoundLoader::Decode(Slot& slot) {
+    auto start = std::chrono::steady_clock::now();
+    slot.wave = LoadWave(slot.path.c_str());
+    slot.seconds = SecondsSince(start);
+    slot.decoded.store(true, std::memory_order_release);
+}
+
+void SoundLoader::Start() {
+    started = std::chrono::steady_clock::now();
+    std::string soundsPath = FindSoundsPath();
+    for (int i = 0; i < SoundLoaderConstants::SOUND_COUNT; i++) {
+        slots[i].path = soundsPath + SOUND_FILES[i].name;
+    }
+    #ifdef PLATFORM_WEB
+    InitAudio();
+    for (Slot& slot : slots) {
+        Decode(slot);
+    }
+    #else
+    audioThread = std::thread(&SoundLoader::InitAudio, this);
+    for (Slot& slot : slots) {
+        slot.thread = std::thread(&SoundLoader::Decode, std::ref(slot));
+    }
+    #endif
+}
+
+bool SoundLoader::Upload(GameState& state) {
+    if (done.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (!audioReady.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (audioThread.joinable()) {
+        audioThread.join();
+    }
+    // Without a device there is nothing to upload to; the game plays silent
+    bool device = IsAudioDeviceReady();
+    int pending = 0;
+    for (int i = 0; i < SoundLoaderConstants::SOUND_COUNT; i++) {
+        Slot& slot = slots[i];
+        if (slot.uploaded) {
+            continue;
+        }
+        if (!slot.decoded.load(std::memory_order_acquire)) {
+            pending++;
+            continue;
+        }
+        if (slot.thread.joinable()) {
+            slot.thread.join();
+        }
+        stats.decodeSeconds += slot.seconds;
+        if (device && slot.wave.frameCount > 0) {
+            state.*SOUND_FILES[i].sound = LoadSoundFromWave(slot.wave);
+            stats.loaded++;
+        } else {
+            stats.failed++;
+        }
+        UnloadWave(slot.wave);
+        slot.wave = {};
+        slot.uploaded = true;
+    }
+    if (pending > 0) {
+        return false;
+    }
+    stats.readySeconds = SecondsSince(started);
+    done.store(true, std::memory_order_release);
+    return true;
+}
+
+void SoundLoader::Wait() {
+    if (audioThread.joinable()) {
+        audioThread.join();
+    }
+    for (Slot& slot : slots) {
+        if (slot.thread.joinable()) {
+            slot.thread.join();
+        }
+        if (!slot.uploaded && slot.decoded.load(std::memory_order_acquire)) {
+            UnloadWave(slot.wave);
+            slot.wave = {};
+            slot.uploaded = true;
+        }
+    }
+}
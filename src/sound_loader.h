@@ -0,0 +1,68 @@
+#pragma once
+
+#include "raylib.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+class GameState;
+
+namespace SoundLoaderConstants {
+    const int SOUND_COUNT = 6;
+}
+
+struct SoundLoadStats {
+    double audioSeconds = 0.0;      // InitAudioDevice
+    double decodeSeconds = 0.0;     // every file's decode, added up
+    double readySeconds = 0.0;      // Start until the last sound was uploaded
+    int loaded = 0;
+    int failed = 0;                 // missing or undecodable files, left silent
+};
+
+// Gets the game's sounds ready without holding up the first frame. Start
+// opens the audio device and decodes each file (LoadWave, CPU only) on its
+// own thread, so it can run alongside InitWindow; the simulation then calls
+// Upload once per tick, which turns each decoded wave into a Sound as soon
+// as it and the device are ready. Until then the GameState's sound is
+// still zeroed, and PlaySound on it does nothing. The caller closes the
+// audio device, after Wait.
+class SoundLoader {
+public:
+    ~SoundLoader();
+
+    // On web there are no threads: everything is done before Start returns
+    void Start();
+    // From the thread that plays the sounds. True once every sound is in
+    // `state`.
+    bool Upload(GameState& state);
+    // Joins the threads; waves never uploaded are freed
+    void Wait();
+    // From any thread; the stats are final once this is true
+    bool IsDone() const { return done.load(std::memory_order_acquire); }
+    SoundLoadStats GetStats() const { return stats; }
+
+    // The sounds directory next to the executable, the app bundle or the
+    // working directory, with a trailing slash
+    static std::string FindSoundsPath();
+
+private:
+    struct Slot {
+        std::string path;
+        Wave wave = {};
+        double seconds = 0.0;
+        std::atomic<bool> decoded{false};
+        bool uploaded = false;
+        std::thread thread;
+    };
+
+    void InitAudio();
+    static void Decode(Slot& slot);
+
+    Slot slots[SoundLoaderConstants::SOUND_COUNT];
+    std::thread audioThread;
+    std::atomic<bool> audioReady{false};
+    std::chrono::steady_clock::time_point started;
+    std::atomic<bool> done{false};
+    SoundLoadStats stats;
+};
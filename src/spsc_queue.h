@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded queue between exactly one producer thread and one consumer
+// thread. Each index is written by one side only, so Push and Pop are a
+// load, a copy and a release store; neither side ever waits. Capacity must
+// be a power of two; one slot is kept empty to tell full from empty.
+template <class T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer. False when full; the item is not queued.
+    bool Push(const T& item) {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) & (Capacity - 1);
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        items[tail] = item;
+        this->tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. False when empty.
+    bool Pop(T& item) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[head];
+        this->head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[Capacity];
+    // On their own cache lines so the two sides don't share one
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
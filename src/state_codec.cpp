@@ -0,0 +1,225 @@
+#include "state_codec.h"
+#include <algorithm>
+
+namespace {
+    const uint16_t GAME_OVER = 1 << 0;
+    const uint16_t CAN_INTERSECT_SELF = 1 << 1;
+    const uint16_t CAN_PASS_WALLS = 1 << 2;
+    const uint16_t CANNOT_EAT_APPLES = 1 << 3;
+    const uint16_t IS_PAUSED = 1 << 4;
+    const uint16_t IS_USER_PAUSED = 1 << 5;
+    const uint16_t IS_RESUMING = 1 << 6;
+    const uint16_t GAME_OVER_SOUND_PLAYED = 1 << 7;
+    const size_t MAX_RULES_NAME = 64;
+    const uint8_t BODY_PACKED = 0;
+    const uint8_t BODY_CELLS = 1;
+}
+
+void StateCodec::WriteRules(ByteWriter& writer, const GameRules& rules) {
+    size_t nameSize = std::min(rules.name.size(), MAX_RULES_NAME);
+    writer.VarU32((uint32_t)nameSize);
+    writer.Bytes(rules.name.data(), nameSize);
+    writer.F32(rules.moveInterval);
+    writer.F32(rules.speedRamp);
+    writer.F32(rules.minMoveInterval);
+    writer.VarI32(rules.startApples);
+    writer.VarI32(rules.applesPerEat);
+    writer.VarI32(rules.minApples);
+    writer.VarI32(rules.maxApples);
+    writer.U8(rules.despawns ? 1 : 0);
+    writer.VarI32(rules.despawnMin);
+    writer.VarI32(rules.despawnMax);
+    writer.F32(rules.immunityDuration);
+    writer.F32(rules.wallImmunityDuration);
+    writer.F32(rules.cannotEatDuration);
+    writer.F32(rules.poisonPauseDuration);
+    for (int weight : rules.foodWeights) {
+        writer.VarI32(weight);
+    }
+}
+
+bool StateCodec::ReadRules(ByteReader& reader, GameRules& rules) {
+    uint32_t nameSize = reader.VarU32();
+    if (!reader.Ok() || nameSize > MAX_RULES_NAME) {
+        return false;
+    }
+    char name[MAX_RULES_NAME];
+    if (!reader.Bytes(name, nameSize)) {
+        return false;
+    }
+    rules.name.assign(name, nameSize);
+    rules.moveInterval = reader.F32();
+    rules.speedRamp = reader.F32();
+    rules.minMoveInterval = reader.F32();
+    rules.startApples = reader.VarI32();
+    rules.applesPerEat = reader.VarI32();
+    rules.minApples = reader.VarI32();
+    rules.maxApples = reader.VarI32();
+    rules.despawns = reader.U8() != 0;
+    rules.despawnMin = reader.VarI32();
+    rules.despawnMax = reader.VarI32();
+    rules.immunityDuration = reader.F32();
+    rules.wallImmunityDuration = reader.F32();
+    rules.cannotEatDuration = reader.F32();
+    rules.poisonPauseDuration = reader.F32();
+    for (int& weight : rules.foodWeights) {
+        weight = reader.VarI32();
+    }
+    std::string error;
+    return reader.Ok() && rules.Finalize(error);
+}
+
+void StateCodec::Write(ByteWriter& writer, const GameState& state) {
+    uint16_t flags = (state.gameOver ? GAME_OVER : 0) |
+                     (state.canIntersectSelf ? CAN_INTERSECT_SELF : 0) |
+                     (state.canPassWalls ? CAN_PASS_WALLS : 0) |
+                     (state.cannotEatApples ? CANNOT_EAT_APPLES : 0) |
+                     (state.isPaused ? IS_PAUSED : 0) |
+                     (state.isUserPaused ? IS_USER_PAUSED : 0) |
+                     (state.isResuming ? IS_RESUMING : 0) |
+                     (state.gameOverSoundPlayed ? GAME_OVER_SOUND_PLAYED : 0);
+    writer.U8((uint8_t)state.gameMode);
+    writer.U16(flags);
+    writer.VarI32(state.score);
+    writer.VarI32(state.highScoreRegular);
+    writer.VarI32(state.highScoreAccelerated);
+    writer.VarI32(state.highScoreCustom);
+    if (state.gameMode == MODE_CUSTOM) {
+        WriteRules(writer, state.customRules);
+    }
+    writer.I8((int8_t)state.dx);
+    writer.I8((int8_t)state.dy);
+    writer.VarU32(state.moveCount);
+    writer.U64(state.rng.state);
+
+    writer.F32(state.moveTimer);
+    writer.F32(state.gameTime);
+    writer.F32(state.immunityTimer);
+    writer.F32(state.wallImmunityTimer);
+    writer.F32(state.cannotEatTimer);
+    writer.F32(state.pauseTimer);
+    writer.F32(state.resumeDelayTimer);
+    writer.F32(state.poisonSoundTimer);
+    writer.F32(state.pauseSoundTimer);
+
+    writer.VarU32((uint32_t)state.directionQueue.size());
+    for (const auto& dir : state.directionQueue) {
+        writer.I8((int8_t)dir.dx);
+        writer.I8((int8_t)dir.dy);
+    }
+    PackedBody packed;
+    WriteBody(writer, state.snake, packed);
+    writer.VarU32((uint32_t)state.apples.size());
+    for (const auto& apple : state.apples) {
+        writer.VarU32((uint32_t)apple.col);
+        writer.VarU32((uint32_t)apple.row);
+        writer.U8((uint8_t)apple.type);
+        writer.F32(apple.spawnTime);
+        writer.F32(apple.despawnTime);
+    }
+}
+
+bool StateCodec::Read(ByteReader& reader, GameState& state) {
+    state.gameMode = (GameMode)reader.U8();
+    uint16_t flags = reader.U16();
+    state.gameOver = (flags & GAME_OVER) != 0;
+    state.canIntersectSelf = (flags & CAN_INTERSECT_SELF) != 0;
+    state.canPassWalls = (flags & CAN_PASS_WALLS) != 0;
+    state.cannotEatApples = (flags & CANNOT_EAT_APPLES) != 0;
+    state.isPaused = (flags & IS_PAUSED) != 0;
+    state.isUserPaused = (flags & IS_USER_PAUSED) != 0;
+    state.isResuming = (flags & IS_RESUMING) != 0;
+    state.gameOverSoundPlayed = (flags & GAME_OVER_SOUND_PLAYED) != 0;
+    state.showModeSelection = false;
+    state.showInstructions = false;
+
+    state.score = reader.VarI32();
+    state.highScoreRegular = reader.VarI32();
+    state.highScoreAccelerated = reader.VarI32();
+    state.highScoreCustom = reader.VarI32();
+    if (state.gameMode == MODE_CUSTOM && !ReadRules(reader, state.customRules)) {
+        return false;
+    }
+    state.dx = reader.I8();
+    state.dy = reader.I8();
+    state.moveCount = reader.VarU32();
+    state.rng.state = reader.U64();
+
+    state.moveTimer = reader.F32();
+    state.gameTime = reader.F32();
+    state.immunityTimer = reader.F32();
+    state.wallImmunityTimer = reader.F32();
+    state.cannotEatTimer = reader.F32();
+    state.pauseTimer = reader.F32();
+    state.resumeDelayTimer = reader.F32();
+    state.poisonSoundTimer = reader.F32();
+    state.pauseSoundTimer = reader.F32();
+
+    // Counts are checked against what's left and what the containers hold
+    uint32_t queueSize = reader.VarU32();
+    if (!reader.Ok() || queueSize > reader.Remaining() / 2 || queueSize > state.directionQueue.capacity()) {
+        return false;
+    }
+    state.directionQueue.clear();
+    for (uint32_t i = 0; i < queueSize; i++) {
+        Direction dir;
+        dir.dx = reader.I8();
+        dir.dy = reader.I8();
+        state.directionQueue.push_back(dir);
+    }
+
+    PackedBody packed;
+    if (!ReadBody(reader, state.snake, packed)) {
+        return false;
+    }
+
+    uint32_t appleCount = reader.VarU32();
+    if (!reader.Ok() || appleCount > reader.Remaining() / 11 || appleCount > state.apples.capacity()) {
+        return false;
+    }
+    state.apples.resize(appleCount);
+    for (auto& apple : state.apples) {
+        apple.col = (int)reader.VarU32();
+        apple.row = (int)reader.VarU32();
+        apple.type = (FoodType)reader.U8();
+        apple.spawnTime = reader.F32();
+        apple.despawnTime = reader.F32();
+    }
+    state.hash = state.ComputeHash();
+    return reader.Ok();
+}
+
+void StateCodec::WriteBody(ByteWriter& writer, const SnakeBody& body, PackedBody& scratch) {
+    if (scratch.Encode(body)) {
+        writer.U8(BODY_PACKED);
+        scratch.Write(writer);
+        return;
+    }
+    writer.U8(BODY_CELLS);
+    writer.VarU32((uint32_t)body.size());
+    for (const auto& segment : body) {
+        writer.VarI32(segment.col);
+        writer.VarI32(segment.row);
+    }
+}
+
+bool StateCodec::ReadBody(ByteReader& reader, SnakeBody& body, PackedBody& scratch) {
+    uint8_t format = reader.U8();
+    if (format == BODY_PACKED) {
+        if (!scratch.Read(reader)) {
+            return false;
+        }
+        return scratch.Decode(body);
+    }
+
+    uint32_t length = reader.VarU32();
+    if (format != BODY_CELLS || !reader.Ok() || length > reader.Remaining() / 2 || length > body.capacity()) {
+        return false;
+    }
+    body.resize(length);
+    for (auto& segment : body) {
+        segment.col = reader.VarI32();
+        segment.row = reader.VarI32();
+    }
+    return reader.Ok();
+}
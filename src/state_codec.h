@@ -0,0 +1,29 @@
+#pragma once
+
+#include "byte_buffer.h"
+#include "game_state.h"
+#include "packed_body.h"
+
+// Compact, exact encoding of everything in a GameState that affects play:
+// body, apples, queue, flags, every timer and the RNG (no sounds or screens),
+// plus the loaded rules when the mode is MODE_CUSTOM.
+// The body is packed to 2 bits a segment, counts are varints, and floats are
+// raw so timers round-trip bit for bit.
+class StateCodec {
+public:
+    static void Write(ByteWriter& writer, const GameState& state);
+    // Overwrites the play fields of `state`; false on malformed input
+    static bool Read(ByteReader& reader, GameState& state);
+
+    // A snake body as a PackedBody, or as plain cells if it doesn't fit one
+    // (off the board). `scratch` is reused between calls. ReadBody fails on
+    // bodies longer than SnakeBody holds.
+    static void WriteBody(ByteWriter& writer, const SnakeBody& body, PackedBody& scratch);
+    static bool ReadBody(ByteReader& reader, SnakeBody& body, PackedBody& scratch);
+
+    // Loaded rules travel with a MODE_CUSTOM state (and a custom multi-snake
+    // match) so the other end plays the same game without the config file.
+    // ReadRules fails on rules Finalize rejects.
+    static void WriteRules(ByteWriter& writer, const GameRules& rules);
+    static bool ReadRules(ByteReader& reader, GameRules& rules);
+};
@@ -0,0 +1,343 @@
+#include "state_stream.h"
+#include <cstring>
+#include <utility>
+
+static const Direction HEAD_DIRECTIONS[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static uint8_t DirectionCode(int dx, int dy) {
+    return (uint8_t)((dx + 1) | ((dy + 1) << 2));
+}
+
+static bool SamePositions(const Position* a, const Position* b, size_t count) {
+    return count == 0 || std::memcmp(a, b, count * sizeof(Position)) == 0;
+}
+
+static bool SameApple(const Apple& a, const Apple& b) {
+    return a.col == b.col && a.row == b.row && a.type == b.type &&
+           a.spawnTime == b.spawnTime && a.despawnTime == b.despawnTime;
+}
+
+// The head one step from `from` in `dir`, wrapping like wall immunity does
+static Position StepHead(Position from, Direction dir) {
+    Position p = {from.col + dir.dx, from.row + dir.dy};
+    if (p.col < 0) p.col = GameConstants::GRID_WIDTH - 1;
+    if (p.col >= GameConstants::GRID_WIDTH) p.col = 0;
+    if (p.row < 0) p.row = GameConstants::GRID_HEIGHT - 1;
+    if (p.row >= GameConstants::GRID_HEIGHT) p.row = 0;
+    return p;
+}
+
+static void WriteApple(ByteWriter& writer, const Apple& apple) {
+    writer.VarU32((uint32_t)apple.col);
+    writer.VarU32((uint32_t)apple.row);
+    writer.U8((uint8_t)apple.type);
+    writer.F32(apple.spawnTime);
+    writer.F32(apple.despawnTime);
+}
+
+static void ReadApple(ByteReader& reader, Apple& apple) {
+    apple.col = (int)reader.VarU32();
+    apple.row = (int)reader.VarU32();
+    apple.type = (FoodType)reader.U8();
+    apple.spawnTime = reader.F32();
+    apple.despawnTime = reader.F32();
+}
+
+bool StreamState::operator==(const StreamState& other) const {
+    if (tick != other.tick || score != other.score || dx != other.dx || dy != other.dy ||
+        flags != other.flags || snake.size() != other.snake.size() ||
+        apples.size() != other.apples.size()) {
+        return false;
+    }
+    if (!SamePositions(snake.data(), other.snake.data(), snake.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < apples.size(); i++) {
+        if (!SameApple(apples[i], other.apples[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StateDeltaEncoder::Capture(const GameState& game, uint32_t tick, StreamState& out) {
+    out.tick = tick;
+    out.score = game.score;
+    out.dx = game.dx;
+    out.dy = game.dy;
+    out.flags = (game.canIntersectSelf ? StreamFlags::CAN_INTERSECT_SELF : 0) |
+                (game.canPassWalls ? StreamFlags::CAN_PASS_WALLS : 0) |
+                (game.cannotEatApples ? StreamFlags::CANNOT_EAT_APPLES : 0) |
+                (game.isPaused ? StreamFlags::IS_PAUSED : 0) |
+                (game.isUserPaused ? StreamFlags::IS_USER_PAUSED : 0) |
+                (game.isResuming ? StreamFlags::IS_RESUMING : 0) |
+                (game.gameOver ? StreamFlags::GAME_OVER : 0);
+    out.snake.assign(game.snake.begin(), game.snake.end());
+    out.apples.assign(game.apples.begin(), game.apples.end());
+}
+
+bool StateDeltaEncoder::Encode(const GameState& game, std::vector<uint8_t>& out) {
+    uint32_t tick = hasPrevious ? previous.tick + 1 : 0;
+    Capture(game, tick, current);
+
+    ByteWriter writer(out);
+    bool keyframe = !hasPrevious || forceKeyframe ||
+                    (keyframeInterval > 0 && ticksSinceKeyframe + 1 >= keyframeInterval);
+    if (!keyframe) {
+        size_t mark = out.size();
+        if (!EncodeDelta(previous, current, writer)) {
+            out.resize(mark);
+            keyframe = true;
+        }
+    }
+    if (keyframe) {
+        EncodeKeyframe(current, writer);
+        ticksSinceKeyframe = 0;
+        forceKeyframe = false;
+    } else {
+        ticksSinceKeyframe++;
+    }
+
+    std::swap(previous, current);
+    hasPrevious = true;
+    return keyframe;
+}
+
+bool StateDeltaEncoder::EncodeDelta(const StreamState& prev, const StreamState& next, ByteWriter& writer) {
+    uint8_t op = 0;
+    size_t n = prev.snake.size();
+    size_t m = next.snake.size();
+
+    // Body: unchanged, or a new head in front of the old body with the tail
+    // popped, kept, or duplicated (growth)
+    if (m != n || !SamePositions(prev.snake.data(), next.snake.data(), n)) {
+        if (n == 0 || m == 0) {
+            return false;
+        }
+        int headCode = -1;
+        for (int d = 0; d < 4; d++) {
+            Position p = StepHead(prev.snake[0], HEAD_DIRECTIONS[d]);
+            if (p.col == next.snake[0].col && p.row == next.snake[0].row) {
+                headCode = d;
+                break;
+            }
+        }
+        if (headCode < 0) {
+            return false;
+        }
+        op |= StreamOps::HEAD_PUSHED | (uint8_t)(headCode << 2);
+
+        const Position* rest = next.snake.data() + 1;
+        if (m == n && SamePositions(rest, prev.snake.data(), n - 1)) {
+            op |= StreamOps::TAIL_POPPED;
+        } else if (m == n + 1 && SamePositions(rest, prev.snake.data(), n)) {
+            // head only
+        } else if (m == n + 2 && SamePositions(rest, prev.snake.data(), n) &&
+                   next.snake[m - 1].col == prev.snake[n - 1].col &&
+                   next.snake[m - 1].row == prev.snake[n - 1].row) {
+            op |= StreamOps::TAIL_DUPLICATED;
+        } else {
+            return false;
+        }
+    }
+
+    // Apples: survivors keep their order and new ones are appended
+    removedApples.clear();
+    size_t j = 0;
+    for (size_t i = 0; i < prev.apples.size(); i++) {
+        if (j < next.apples.size() && SameApple(prev.apples[i], next.apples[j])) {
+            j++;
+        } else {
+            removedApples.push_back((uint32_t)i);
+        }
+    }
+    size_t firstAdded = j;
+
+    uint8_t extra = 0;
+    if (next.score != prev.score) extra |= StreamOps::EXTRA_SCORE;
+    if (next.flags != prev.flags) extra |= StreamOps::EXTRA_FLAGS;
+    if (next.dx != prev.dx || next.dy != prev.dy) extra |= StreamOps::EXTRA_DIRECTION;
+    if (!removedApples.empty()) extra |= StreamOps::EXTRA_APPLES_REMOVED;
+    if (firstAdded < next.apples.size()) extra |= StreamOps::EXTRA_APPLES_ADDED;
+    if (extra) {
+        op |= StreamOps::HAS_EXTRA;
+    }
+
+    writer.U8(op);
+    if (!extra) {
+        return true;
+    }
+    writer.U8(extra);
+    if (extra & StreamOps::EXTRA_SCORE) {
+        writer.VarI32(next.score - prev.score);
+    }
+    if (extra & StreamOps::EXTRA_FLAGS) {
+        writer.U8(next.flags);
+    }
+    if (extra & StreamOps::EXTRA_DIRECTION) {
+        writer.U8(DirectionCode(next.dx, next.dy));
+    }
+    if (extra & StreamOps::EXTRA_APPLES_REMOVED) {
+        // Ascending indices into the previous list, delta coded
+        writer.VarU32((uint32_t)removedApples.size());
+        uint32_t last = 0;
+        for (uint32_t index : removedApples) {
+            writer.VarU32(index - last);
+            last = index;
+        }
+    }
+    if (extra & StreamOps::EXTRA_APPLES_ADDED) {
+        writer.VarU32((uint32_t)(next.apples.size() - firstAdded));
+        for (size_t i = firstAdded; i < next.apples.size(); i++) {
+            WriteApple(writer, next.apples[i]);
+        }
+    }
+    return true;
+}
+
+void StateDeltaEncoder::EncodeKeyframe(const StreamState& state, ByteWriter& writer) {
+    writer.U8(StreamOps::KEYFRAME);
+    writer.VarU32(state.tick);
+    writer.VarI32(state.score);
+    writer.U8(DirectionCode(state.dx, state.dy));
+    writer.U8(state.flags);
+    writer.VarU32((uint32_t)state.snake.size());
+    for (const auto& segment : state.snake) {
+        writer.VarU32((uint32_t)segment.col);
+        writer.VarU32((uint32_t)segment.row);
+    }
+    writer.VarU32((uint32_t)state.apples.size());
+    for (const auto& apple : state.apples) {
+        WriteApple(writer, apple);
+    }
+}
+
+bool StateDeltaDecoder::Decode(ByteReader& reader) {
+    uint8_t op = reader.U8();
+    if (!reader.Ok()) {
+        return false;
+    }
+    if (op & StreamOps::KEYFRAME) {
+        synced = DecodeKeyframe(reader);
+        return synced;
+    }
+    return DecodeDelta(op, reader, synced);
+}
+
+bool StateDeltaDecoder::DecodeKeyframe(ByteReader& reader) {
+    state.tick = reader.VarU32();
+    state.score = reader.VarI32();
+    uint8_t dir = reader.U8();
+    state.dx = (dir & 3) - 1;
+    state.dy = ((dir >> 2) & 3) - 1;
+    state.flags = reader.U8();
+
+    uint32_t length = reader.VarU32();
+    if (!reader.Ok() || length > reader.Remaining() / 2) {
+        return false;
+    }
+    state.snake.resize(length);
+    for (auto& segment : state.snake) {
+        segment.col = (int)reader.VarU32();
+        segment.row = (int)reader.VarU32();
+    }
+
+    uint32_t appleCount = reader.VarU32();
+    if (!reader.Ok() || appleCount > reader.Remaining() / 11) {
+        return false;
+    }
+    state.apples.resize(appleCount);
+    for (auto& apple : state.apples) {
+        ReadApple(reader, apple);
+    }
+    return reader.Ok();
+}
+
+bool StateDeltaDecoder::DecodeDelta(uint8_t op, ByteReader& reader, bool apply) {
+    if (apply) {
+        state.tick++;
+        if (op & StreamOps::HEAD_PUSHED) {
+            if (state.snake.empty()) {
+                return false;
+            }
+            Position oldTail = state.snake.back();
+            Position head = StepHead(state.snake[0], HEAD_DIRECTIONS[(op >> 2) & 3]);
+            state.snake.insert(state.snake.begin(), head);
+            uint8_t tailOp = op & (3 << 4);
+            if (tailOp == StreamOps::TAIL_POPPED) {
+                state.snake.pop_back();
+            } else if (tailOp == StreamOps::TAIL_DUPLICATED) {
+                state.snake.push_back(oldTail);
+            }
+        }
+    }
+
+    if (!(op & StreamOps::HAS_EXTRA)) {
+        return true;
+    }
+    uint8_t extra = reader.U8();
+    if (extra & StreamOps::EXTRA_SCORE) {
+        int delta = reader.VarI32();
+        if (apply) state.score += delta;
+    }
+    if (extra & StreamOps::EXTRA_FLAGS) {
+        uint8_t flags = reader.U8();
+        if (apply) state.flags = flags;
+    }
+    if (extra & StreamOps::EXTRA_DIRECTION) {
+        uint8_t dir = reader.U8();
+        if (apply) {
+            state.dx = (dir & 3) - 1;
+            state.dy = ((dir >> 2) & 3) - 1;
+        }
+    }
+    if (extra & StreamOps::EXTRA_APPLES_REMOVED) {
+        uint32_t count = reader.VarU32();
+        // Compact in place: indices are ascending into the pre-tick list
+        size_t write = 0;
+        size_t read = 0;
+        uint32_t index = 0;
+        for (uint32_t k = 0; k < count && reader.Ok(); k++) {
+            index += reader.VarU32();
+            if (!apply) {
+                continue;
+            }
+            if (index >= state.apples.size() || index < read) {
+                return false;
+            }
+            while (read < index) {
+                state.apples[write++] = state.apples[read++];
+            }
+            read++;
+        }
+        if (apply) {
+            while (read < state.apples.size()) {
+                state.apples[write++] = state.apples[read++];
+            }
+            state.apples.resize(write);
+        }
+    }
+    if (extra & StreamOps::EXTRA_APPLES_ADDED) {
+        uint32_t count = reader.VarU32();
+        for (uint32_t k = 0; k < count && reader.Ok(); k++) {
+            Apple apple;
+            ReadApple(reader, apple);
+            if (apply) {
+                state.apples.push_back(apple);
+            }
+        }
+    }
+    return reader.Ok();
+}
+
+void StateStreamLog::Append(const GameState& game) {
+    size_t offset = bytes.size();
+    if (encoder.Encode(game, bytes)) {
+        keyframeOffsets.push_back(offset);
+    }
+    tickCount++;
+}
+
+size_t StateStreamLog::GetLatestKeyframeOffset() const {
+    return keyframeOffsets.empty() ? bytes.size() : keyframeOffsets.back();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "byte_buffer.h"
+#include "game_state.h"
+#include <cstdint>
+#include <vector>
+
+// Everything a spectator or log reader sees of a single-player game
+struct StreamState {
+    uint32_t tick = 0;
+    int score = 0;
+    int dx = 0;
+    int dy = 0;
+    uint8_t flags = 0;
+    std::vector<Position> snake;
+    std::vector<Apple> apples;
+
+    bool operator==(const StreamState& other) const;
+    bool operator!=(const StreamState& other) const { return !(*this == other); }
+};
+
+namespace StreamFlags {
+    const uint8_t CAN_INTERSECT_SELF = 1 << 0;
+    const uint8_t CAN_PASS_WALLS = 1 << 1;
+    const uint8_t CANNOT_EAT_APPLES = 1 << 2;
+    const uint8_t IS_PAUSED = 1 << 3;
+    const uint8_t IS_USER_PAUSED = 1 << 4;
+    const uint8_t IS_RESUMING = 1 << 5;
+    const uint8_t GAME_OVER = 1 << 6;
+}
+
+// Per-tick records, each self-delimiting. A record starts with an op byte:
+//   bits 0-1  head: 0 unchanged, 1 pushed one step (direction in bits 2-3)
+//   bits 4-5  tail: 0 unchanged, 1 popped, 2 duplicated (growth)
+//   bit  6    an extra byte follows with score/flags/direction/apple changes
+//   bit  7    keyframe: the full state follows instead
+// A quiet tick is 1 byte, a plain move 1 byte, eating an apple about 10.
+// Anything that isn't a head push plus tail pop/grow (poison reversal,
+// teleport, restart) becomes a keyframe.
+namespace StreamOps {
+    const uint8_t HEAD_PUSHED = 1;
+    const uint8_t TAIL_POPPED = 1 << 4;
+    const uint8_t TAIL_DUPLICATED = 2 << 4;
+    const uint8_t HAS_EXTRA = 1 << 6;
+    const uint8_t KEYFRAME = 1 << 7;
+
+    const uint8_t EXTRA_SCORE = 1 << 0;
+    const uint8_t EXTRA_FLAGS = 1 << 1;
+    const uint8_t EXTRA_DIRECTION = 1 << 2;
+    const uint8_t EXTRA_APPLES_REMOVED = 1 << 3;
+    const uint8_t EXTRA_APPLES_ADDED = 1 << 4;
+}
+
+class StateDeltaEncoder {
+public:
+    // keyframeInterval: also emit a keyframe every N ticks so late joiners
+    // never wait long (0 = only when forced)
+    explicit StateDeltaEncoder(uint32_t keyframeInterval = 256) : keyframeInterval(keyframeInterval) {}
+
+    static void Capture(const GameState& game, uint32_t tick, StreamState& out);
+
+    // Appends one record describing the change since the previous call.
+    // Returns true if it was a keyframe.
+    bool Encode(const GameState& game, std::vector<uint8_t>& out);
+    void ForceKeyframe() { forceKeyframe = true; }
+    const StreamState& GetState() const { return previous; }
+
+private:
+    bool EncodeDelta(const StreamState& prev, const StreamState& next, ByteWriter& writer);
+    static void EncodeKeyframe(const StreamState& state, ByteWriter& writer);
+
+    uint32_t keyframeInterval;
+    uint32_t ticksSinceKeyframe = 0;
+    bool hasPrevious = false;
+    bool forceKeyframe = true;
+    StreamState previous;
+    StreamState current;
+    std::vector<uint32_t> removedApples;
+};
+
+class StateDeltaDecoder {
+public:
+    // Applies one record. Deltas before the first keyframe are skipped
+    // (a spectator joining mid-stream); returns false on corrupt input.
+    bool Decode(ByteReader& reader);
+    bool HasState() const { return synced; }
+    const StreamState& GetState() const { return state; }
+
+private:
+    bool DecodeKeyframe(ByteReader& reader);
+    // apply = false just steps over the record (not synced yet)
+    bool DecodeDelta(uint8_t op, ByteReader& reader, bool apply);
+
+    bool synced = false;
+    StreamState state;
+};
+
+// Append-only log of records with the byte offset of every keyframe, so a
+// spectator can start decoding at the latest one instead of tick 0
+class StateStreamLog {
+public:
+    explicit StateStreamLog(uint32_t keyframeInterval = 256) : encoder(keyframeInterval) {}
+
+    void Append(const GameState& game);
+    void ForceKeyframe() { encoder.ForceKeyframe(); }
+
+    const std::vector<uint8_t>& GetBytes() const { return bytes; }
+    uint32_t GetTickCount() const { return tickCount; }
+    // Offset of the latest keyframe, or bytes.size() if there is none yet
+    size_t GetLatestKeyframeOffset() const;
+    size_t GetKeyframeCount() const { return keyframeOffsets.size(); }
+
+private:
+    StateDeltaEncoder encoder;
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> keyframeOffsets;
+    uint32_t tickCount = 0;
+};
@@ -0,0 +1,359 @@
+#include "trajectory.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char TRAJECTORY_MAGIC[4] = {'S', 'N', 'K', 'T'};
+
+namespace {
+    const uint32_t COLUMN_WIDTHS[COLUMN_COUNT] = {0, 1, 4, 1, 1, 1, 1, 4, 4, 4};
+
+    uint64_t AlignColumn(uint64_t offset) {
+        uint64_t alignment = TrajectoryConstants::COLUMN_ALIGNMENT;
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    template <typename T>
+    void Put(uint8_t* base, const TrajectoryHeader& layout, int column, uint32_t row, T value) {
+        std::memcpy(base + layout.columnOffsets[column] + (uint64_t)row * sizeof(T), &value, sizeof(T));
+    }
+
+    template <typename T>
+    T Get(const uint8_t* base, const TrajectoryHeader& header, int column, uint32_t row) {
+        T value;
+        std::memcpy(&value, base + header.columnOffsets[column] + (uint64_t)row * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    bool EndsWith(const std::string& name, const char* suffix) {
+        size_t length = std::strlen(suffix);
+        return name.size() > length && name.compare(name.size() - length, length, suffix) == 0;
+    }
+
+    // Header fields a chunk has to have for its columns to be read in place
+    bool IsValidHeader(const TrajectoryHeader& header, size_t fileSize) {
+        if (std::memcmp(header.magic, TRAJECTORY_MAGIC, 4) != 0 ||
+            header.version != TrajectoryConstants::VERSION || header.columnCount != COLUMN_COUNT ||
+            header.rows > header.chunkRows || header.observationSize == 0 || header.fileSize != fileSize) {
+            return false;
+        }
+        for (int column = 0; column < COLUMN_COUNT; column++) {
+            uint32_t width = (column == COLUMN_OBSERVATION) ? header.observationSize : COLUMN_WIDTHS[column];
+            if (header.columnWidths[column] != width ||
+                header.columnOffsets[column] < sizeof(TrajectoryHeader) ||
+                header.columnOffsets[column] + (uint64_t)width * header.chunkRows > fileSize) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    Close();
+}
+
+bool TrajectoryWriter::Open(const std::string& path, uint32_t observations, uint32_t rowsPerChunk) {
+    Close();
+    if (observations == 0 || rowsPerChunk == 0) {
+        return false;
+    }
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    directory = path;
+    runId = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    chunkRows = rowsPerChunk;
+    observationSize = observations;
+
+    std::memset(&layout, 0, sizeof(layout));
+    std::memcpy(layout.magic, TRAJECTORY_MAGIC, 4);
+    layout.version = TrajectoryConstants::VERSION;
+    layout.chunkRows = chunkRows;
+    layout.observationSize = observationSize;
+    layout.columnCount = COLUMN_COUNT;
+    uint64_t offset = AlignColumn(sizeof(TrajectoryHeader));
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        layout.columnWidths[column] = (column == COLUMN_OBSERVATION) ? observationSize : COLUMN_WIDTHS[column];
+        layout.columnOffsets[column] = offset;
+        offset = AlignColumn(offset + (uint64_t)layout.columnWidths[column] * chunkRows);
+    }
+    layout.fileSize = offset;
+
+    stats = TrajectoryStats();
+    active = 0;
+    if (!Prepare(chunks[0], 0)) {
+        return false;
+    }
+    // The thread makes chunk 1 while chunk 0 fills
+    nextIndex = 1;
+    busy = true;
+    stopping = false;
+    open = true;
+    thread = std::thread(&TrajectoryWriter::Run, this);
+    return true;
+}
+
+std::string TrajectoryWriter::ChunkPath(uint64_t index, bool temporary) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%llu-%06llu%s%s", (unsigned long long)runId, (unsigned long long)index,
+                  TrajectoryConstants::EXTENSION, temporary ? ".tmp" : "");
+    return directory + name;
+}
+
+bool TrajectoryWriter::Prepare(Chunk& chunk, uint64_t index) {
+    chunk = Chunk();
+    std::string path = ChunkPath(index, true);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // Sized for every row up front
+    void* map = (ftruncate(fd, (off_t)layout.fileSize) == 0)
+        ? mmap(nullptr, layout.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+#ifdef MADV_POPULATE_WRITE
+    // Fault every page in writable here, off the appending thread
+    madvise(map, layout.fileSize, MADV_POPULATE_WRITE);
+#endif
+    std::memcpy(map, &layout, sizeof(layout));
+    chunk.fd = fd;
+    chunk.map = (uint8_t*)map;
+    chunk.size = layout.fileSize;
+    chunk.index = index;
+    chunk.ready = true;
+    return true;
+}
+
+bool TrajectoryWriter::Finish(Chunk& chunk) {
+    TrajectoryHeader* header = (TrajectoryHeader*)chunk.map;
+    header->rows = chunk.rows;
+    bool ok = munmap(chunk.map, chunk.size) == 0;
+    ok = (close(chunk.fd) == 0) && ok;
+    std::string path = ChunkPath(chunk.index, true);
+    if (!ok || rename(path.c_str(), ChunkPath(chunk.index, false).c_str()) != 0) {
+        unlink(path.c_str());
+        ok = false;
+    }
+    chunk = Chunk();
+    return ok;
+}
+
+void TrajectoryWriter::Discard(Chunk& chunk) {
+    if (chunk.ready) {
+        munmap(chunk.map, chunk.size);
+        close(chunk.fd);
+        unlink(ChunkPath(chunk.index, true).c_str());
+    }
+    chunk = Chunk();
+}
+
+void TrajectoryWriter::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return busy || stopping; });
+        if (!busy) {
+            return;
+        }
+        // The chunk Append isn't filling: finish it if it has rows, then
+        // make it the next one
+        Chunk& chunk = chunks[1 - active];
+        uint64_t index = nextIndex++;
+        lock.unlock();
+        bool full = chunk.ready;
+        bool finished = !full || Finish(chunk);
+        bool prepared = Prepare(chunk, index);
+        lock.lock();
+        stats.chunks += (full && finished) ? 1 : 0;
+        stats.failed = stats.failed || !finished || !prepared;
+        busy = false;
+        done.notify_all();
+    }
+}
+
+bool TrajectoryWriter::Append(const Transition& row) {
+    if (!open) {
+        return false;
+    }
+    Chunk* chunk = &chunks[active];
+    if (chunk->rows == chunkRows) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (busy) {
+            stats.stalls++;
+            done.wait(lock, [this] { return !busy; });
+        }
+        if (stats.failed) {
+            return false;
+        }
+        active = 1 - active;
+        busy = true;
+        lock.unlock();
+        wake.notify_one();
+        chunk = &chunks[active];
+    }
+
+    uint32_t r = chunk->rows;
+    uint8_t* base = chunk->map;
+    std::memcpy(base + layout.columnOffsets[COLUMN_OBSERVATION] + (uint64_t)r * observationSize,
+                row.observation, observationSize);
+    Put(base, layout, COLUMN_ACTION, r, row.action);
+    Put(base, layout, COLUMN_REWARD, r, row.reward);
+    Put(base, layout, COLUMN_DONE, r, row.done);
+    Put(base, layout, COLUMN_FOOD, r, row.food);
+    Put(base, layout, COLUMN_DEATH, r, row.death);
+    Put(base, layout, COLUMN_EFFECTS, r, row.effects);
+    Put(base, layout, COLUMN_SCORE, r, row.score);
+    Put(base, layout, COLUMN_ENV, r, row.env);
+    Put(base, layout, COLUMN_TICK, r, row.tick);
+    chunk->rows++;
+    stats.rows++;
+    return true;
+}
+
+bool TrajectoryWriter::Close() {
+    if (!open) {
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return !busy; });
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+
+    Chunk& filling = chunks[active];
+    if (filling.ready && filling.rows > 0) {
+        if (Finish(filling)) {
+            stats.chunks++;
+        } else {
+            stats.failed = true;
+        }
+    }
+    Discard(filling);
+    Discard(chunks[1 - active]);
+    open = false;
+    return !stats.failed;
+}
+
+TrajectoryStats TrajectoryWriter::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    Close();
+}
+
+void TrajectoryReader::Close() {
+    for (const MappedChunk& chunk : chunks) {
+        munmap((void*)chunk.base, chunk.size);
+    }
+    chunks.clear();
+    rowCount = 0;
+    maxRows = 0;
+    observationSize = 0;
+}
+
+bool TrajectoryReader::Open(const std::string& directory, std::string& error) {
+    Close();
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        error = "can't open " + directory;
+        return false;
+    }
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (EndsWith(name, TrajectoryConstants::EXTENSION)) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string& name : names) {
+        std::string path = directory + "/" + name;
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TrajectoryHeader)) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            error = name + " is unreadable or truncated";
+            Close();
+            return false;
+        }
+        size_t size = (size_t)info.st_size;
+        void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            error = "can't map " + name;
+            Close();
+            return false;
+        }
+        MappedChunk chunk;
+        chunk.base = (const uint8_t*)map;
+        chunk.size = size;
+        std::memcpy(&chunk.header, map, sizeof(chunk.header));
+        if (!IsValidHeader(chunk.header, size) ||
+            (observationSize != 0 && chunk.header.observationSize != observationSize)) {
+            munmap(map, size);
+            error = name + " is not a trajectory chunk of this layout";
+            Close();
+            return false;
+        }
+        if (chunk.header.rows == 0) {
+            munmap(map, size);
+            continue;
+        }
+        // Samples hit rows all over the file; don't read ahead around them
+        madvise(map, size, MADV_RANDOM);
+        observationSize = chunk.header.observationSize;
+        rowCount += chunk.header.rows;
+        maxRows = std::max(maxRows, chunk.header.rows);
+        chunks.push_back(chunk);
+    }
+    return true;
+}
+
+bool TrajectoryReader::Read(size_t chunkIndex, uint32_t row, Transition& out) const {
+    if (chunkIndex >= chunks.size() || row >= chunks[chunkIndex].header.rows) {
+        return false;
+    }
+    const MappedChunk& chunk = chunks[chunkIndex];
+    const TrajectoryHeader& header = chunk.header;
+    out.observation = chunk.base + header.columnOffsets[COLUMN_OBSERVATION] + (uint64_t)row * observationSize;
+    out.action = Get<uint8_t>(chunk.base, header, COLUMN_ACTION, row);
+    out.reward = Get<float>(chunk.base, header, COLUMN_REWARD, row);
+    out.done = Get<uint8_t>(chunk.base, header, COLUMN_DONE, row);
+    out.food = Get<uint8_t>(chunk.base, header, COLUMN_FOOD, row);
+    out.death = Get<uint8_t>(chunk.base, header, COLUMN_DEATH, row);
+    out.effects = Get<uint8_t>(chunk.base, header, COLUMN_EFFECTS, row);
+    out.score = Get<int32_t>(chunk.base, header, COLUMN_SCORE, row);
+    out.env = Get<uint32_t>(chunk.base, header, COLUMN_ENV, row);
+    out.tick = Get<uint32_t>(chunk.base, header, COLUMN_TICK, row);
+    return true;
+}
+
+void TrajectoryReader::Sample(Rng& rng, Transition& out) const {
+    for (;;) {
+        size_t chunk = (size_t)(((uint64_t)rng.NextU32() * chunks.size()) >> 32);
+        uint32_t slot = (uint32_t)(((uint64_t)rng.NextU32() * maxRows) >> 32);
+        if (Read(chunk, slot, out)) {
+            return;
+        }
+    }
+}
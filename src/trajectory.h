@@ -0,0 +1,154 @@
+#pragma once
+
+#include "rng.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TrajectoryConstants {
+    const uint32_t VERSION = 1;
+    const uint32_t DEFAULT_CHUNK_ROWS = 1 << 16;
+    // Columns start on page boundaries so each one maps and pages on its own
+    const size_t COLUMN_ALIGNMENT = 4096;
+    const char* const EXTENSION = ".snkt";
+}
+
+enum TrajectoryColumn {
+    COLUMN_OBSERVATION,     // observationSize bytes per row, the state acted on
+    COLUMN_ACTION,          // u8 SnekAction
+    COLUMN_REWARD,          // f32
+    COLUMN_DONE,            // u8
+    COLUMN_FOOD,            // u8 SnekCell of the food eaten, 0 for none
+    COLUMN_DEATH,           // u8 SnekDeath
+    COLUMN_EFFECTS,         // u8 effect bits after the step (see GameState::GetEffectMask)
+    COLUMN_SCORE,           // i32 after the step
+    COLUMN_ENV,             // u32 env in the batch
+    COLUMN_TICK,            // u32 step into the episode, from 0
+    COLUMN_COUNT
+};
+
+// Fixed header at offset 0 of a chunk file. Each column is a plain array of
+// chunkRows values at its offset, so any reader (numpy.memmap included) can
+// map one without parsing the others. Only the first `rows` are written.
+struct TrajectoryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t chunkRows;
+    uint32_t rows;
+    uint32_t observationSize;
+    uint32_t columnCount;
+    uint32_t columnWidths[COLUMN_COUNT];
+    uint64_t columnOffsets[COLUMN_COUNT];
+    uint64_t fileSize;
+};
+
+// One row. observation points at observationSize bytes.
+struct Transition {
+    const uint8_t* observation = nullptr;
+    uint8_t action = 0;
+    float reward = 0.0f;
+    uint8_t done = 0;
+    uint8_t food = 0;
+    uint8_t death = 0;
+    uint8_t effects = 0;
+    int32_t score = 0;
+    uint32_t env = 0;
+    uint32_t tick = 0;
+};
+
+struct TrajectoryStats {
+    uint64_t rows = 0;
+    uint64_t chunks = 0;        // finished and renamed into place
+    uint64_t stalls = 0;        // appends that waited for the next chunk
+    bool failed = false;
+};
+
+// Appends rows to chunk files of chunkRows rows in a directory. Two chunks
+// are mapped at a time: rows are copied straight into the one filling up,
+// while a background thread finishes the last full one (header, unmap,
+// rename from .tmp) and creates, sizes and maps the next, so Append never
+// touches the file system or allocates unless the disk falls behind.
+// Chunks of one writer are named <started ms>-<index>.snkt, so several runs
+// can share a directory.
+class TrajectoryWriter {
+public:
+    ~TrajectoryWriter();
+    bool Open(const std::string& directory, uint32_t observationSize,
+              uint32_t chunkRows = TrajectoryConstants::DEFAULT_CHUNK_ROWS);
+    // False once a chunk couldn't be made; every later append is dropped
+    bool Append(const Transition& row);
+    // Finishes the partial chunk and waits for the thread. False if any
+    // chunk failed.
+    bool Close();
+    bool IsOpen() const { return open; }
+    // From the appending thread
+    TrajectoryStats GetStats();
+
+private:
+    struct Chunk {
+        int fd = -1;
+        uint8_t* map = nullptr;
+        size_t size = 0;
+        uint32_t rows = 0;
+        uint64_t index = 0;
+        bool ready = false;
+    };
+
+    std::string ChunkPath(uint64_t index, bool temporary) const;
+    bool Prepare(Chunk& chunk, uint64_t index);
+    bool Finish(Chunk& chunk);
+    void Discard(Chunk& chunk);
+    void Run();
+
+    std::string directory;
+    uint64_t runId = 0;
+    uint32_t chunkRows = 0;
+    uint32_t observationSize = 0;
+    TrajectoryHeader layout = {};
+    bool open = false;
+
+    Chunk chunks[2];
+    int active = 0;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool busy = false;          // the thread owns the other chunk
+    bool stopping = false;
+    uint64_t nextIndex = 0;     // of the chunk the thread prepares next
+    TrajectoryStats stats;
+};
+
+// Maps every finished chunk in a directory read-only. Rows are read in
+// place from the page cache; nothing is loaded up front.
+class TrajectoryReader {
+public:
+    ~TrajectoryReader();
+    bool Open(const std::string& directory, std::string& error);
+    void Close();
+    uint64_t GetRowCount() const { return rowCount; }
+    size_t GetChunkCount() const { return chunks.size(); }
+    uint32_t GetObservationSize() const { return observationSize; }
+    // Row `row` of chunk `chunk`, in file name order
+    bool Read(size_t chunk, uint32_t row, Transition& out) const;
+    // A row drawn uniformly from all of them. Picks a chunk uniformly, then a
+    // slot below the largest chunk's capacity, and draws again if the slot is
+    // past that chunk's rows, so short chunks aren't oversampled and a
+    // draw is O(1) expected. Needs at least one row.
+    void Sample(Rng& rng, Transition& out) const;
+
+private:
+    struct MappedChunk {
+        const uint8_t* base;
+        size_t size;
+        TrajectoryHeader header;
+    };
+
+    std::vector<MappedChunk> chunks;
+    uint64_t rowCount = 0;
+    uint32_t maxRows = 0;
+    uint32_t observationSize = 0;
+};
@@ -0,0 +1,60 @@
+#include "transposition_table.h"
+#include <cstring>
+
+TranspositionTable::TranspositionTable(size_t slotCount) {
+    size_t buckets = 1;
+    while (buckets * 4 <= slotCount) {
+        buckets *= 2;
+    }
+    bucketMask = buckets - 1;
+    slots.reset(new Slot[buckets * 2]);
+    Clear();
+}
+
+uint64_t TranspositionTable::Pack(const TTData& data) {
+    uint64_t word;
+    std::memcpy(&word, &data, sizeof(word));
+    return word;
+}
+
+TTData TranspositionTable::Unpack(uint64_t word) {
+    TTData data;
+    std::memcpy(&data, &word, sizeof(word));
+    return data;
+}
+
+bool TranspositionTable::Probe(uint64_t hash, TTData& out) const {
+    const Slot* bucket = &slots[(hash & bucketMask) * 2];
+    for (int i = 0; i < 2; i++) {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if ((check ^ data) == hash && (data | check) != 0) {
+            out = Unpack(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::Store(uint64_t hash, const TTData& data) {
+    Slot* bucket = &slots[(hash & bucketMask) * 2];
+    uint64_t word = Pack(data);
+
+    // The depth slot takes the entry if it's the same position, empty or
+    // shallower; the always slot gets it otherwise
+    uint64_t oldData = bucket[0].data.load(std::memory_order_relaxed);
+    uint64_t oldCheck = bucket[0].check.load(std::memory_order_relaxed);
+    bool empty = (oldData | oldCheck) == 0;
+    bool samePosition = (oldData ^ oldCheck) == hash;
+    Slot& slot = (empty || samePosition || Unpack(oldData).depth <= data.depth) ? bucket[0] : bucket[1];
+
+    slot.data.store(word, std::memory_order_relaxed);
+    slot.check.store(hash ^ word, std::memory_order_relaxed);
+}
+
+void TranspositionTable::Clear() {
+    for (size_t i = 0; i < GetSlotCount(); i++) {
+        slots[i].data.store(0, std::memory_order_relaxed);
+        slots[i].check.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// What a search remembers about a position; packs into one 64-bit word.
+// Plain data with no initializers, so it is copied into and out of the
+// word with memcpy; `TTData data = {}` zeroes it.
+struct TTData {
+    int32_t value;
+    uint16_t depth;
+    uint8_t move;           // FrameInput direction bit, 0 for none
+    uint8_t flags;          // caller's bound type and the like
+};
+static_assert(sizeof(TTData) == 8, "TTData must pack into a word");
+static_assert(std::is_trivial<TTData>::value, "TTData is copied as raw bytes");
+
+// Fixed-size hash table from GameState::hash to TTData, shared by any number
+// of threads without locks. Each slot is two relaxed atomic words, the data
+// and the key XORed with it; a probe only accepts a slot whose words XOR back
+// to the key, so a read that races a write (half old, half new) is a miss
+// rather than another position's data. Buckets hold two slots: one keeps the
+// deepest entry, the other always takes the newest.
+class TranspositionTable {
+public:
+    // Rounded down to a power of two, at least one bucket
+    explicit TranspositionTable(size_t slotCount);
+
+    bool Probe(uint64_t hash, TTData& out) const;
+    void Store(uint64_t hash, const TTData& data);
+    void Clear();
+
+    size_t GetSlotCount() const { return bucketMask * 2 + 2; }
+    size_t GetBytes() const { return GetSlotCount() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;    // hash ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    static uint64_t Pack(const TTData& data);
+    static TTData Unpack(uint64_t word);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t bucketMask = 0;
+};
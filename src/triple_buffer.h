@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Latest-value channel from one writer thread to one reader thread. The
+// writer fills its back slot and publishes it by swapping it with the
+// middle one; the reader swaps the middle slot for its front one when
+// something new was published. Neither side waits or copies on the other's
+// behalf, the reader's slot never changes under it, and values the reader
+// was too slow to see are simply overwritten.
+template <class T>
+class TripleBuffer {
+public:
+    // Writer: the slot to fill next
+    T& Back() { return slots[back]; }
+    void Publish() {
+        uint8_t old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = old & INDEX;
+    }
+
+    // Reader: swaps in the newest published slot. False if nothing new.
+    bool Update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        uint8_t old = middle.exchange(front, std::memory_order_acq_rel);
+        front = old & INDEX;
+        return true;
+    }
+    // Reader: the slot from the last Update, stable until the next one
+    const T& Front() const { return slots[front]; }
+
+private:
+    static const uint8_t INDEX = 3;
+    static const uint8_t FRESH = 4;     // set by Publish, cleared by Update
+
+    T slots[3];
+    uint8_t back = 0;                   // writer only
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t front = 2;      // reader only
+};
@@ -0,0 +1,94 @@
+#include "udp_socket.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool UdpSocket::Open(uint16_t port, bool loopbackOnly) {
+    Close();
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    // Snapshots for many matches go out in bursts; give the kernel room
+    int bufferSize = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        Close();
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    localPort = ntohs(addr.sin_port);
+    return true;
+}
+
+void UdpSocket::Close() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    localPort = 0;
+}
+
+bool UdpSocket::Send(const NetAddress& to, const uint8_t* data, size_t size) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(to.port);
+    addr.sin_addr.s_addr = htonl(to.ip);
+    ssize_t sent = sendto(fd, data, size, 0, (sockaddr*)&addr, sizeof(addr));
+    return sent == (ssize_t)size;
+}
+
+int UdpSocket::Receive(NetAddress& from, uint8_t* data, size_t capacity) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    ssize_t received = recvfrom(fd, data, capacity, 0, (sockaddr*)&addr, &len);
+    if (received < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    from.ip = ntohl(addr.sin_addr.s_addr);
+    from.port = ntohs(addr.sin_port);
+    return (int)received;
+}
+
+bool UdpSocket::WaitReadable(int timeoutMs) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeoutMs) > 0;
+}
+
+bool UdpSocket::Resolve(const char* host, uint16_t port, NetAddress& out) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    out.ip = ntohl(((sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+    out.port = port;
+    freeaddrinfo(result);
+    return true;
+}
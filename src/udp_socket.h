@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// IPv4 endpoint in host byte order
+struct NetAddress {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+// Non-blocking UDP socket (POSIX)
+class UdpSocket {
+public:
+    ~UdpSocket() { Close(); }
+
+    // port 0 picks an ephemeral port; LocalPort() reports it
+    bool Open(uint16_t port, bool loopbackOnly);
+    void Close();
+    bool IsOpen() const { return fd >= 0; }
+    uint16_t LocalPort() const { return localPort; }
+
+    bool Send(const NetAddress& to, const uint8_t* data, size_t size);
+    // Returns bytes received, 0 if nothing is pending, -1 on error
+    int Receive(NetAddress& from, uint8_t* data, size_t capacity);
+    // Blocks until readable or timeout; false on timeout
+    bool WaitReadable(int timeoutMs);
+
+    static bool Resolve(const char* host, uint16_t port, NetAddress& out);
+
+private:
+    int fd = -1;
+    uint16_t localPort = 0;
+};
@@ -0,0 +1,219 @@
+#include "video_capture.h"
+#include "raylib.h"
+#include "rlgl.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <system_error>
+
+using CaptureConstants::QUEUE_DEPTH;
+
+namespace {
+    // Full-range BT.601, as the C420jpeg tag promises
+    inline uint8_t LumaOf(const unsigned char* p) {
+        return (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+    }
+
+    bool EndsWith(const std::string& text, const char* suffix) {
+        size_t n = std::char_traits<char>::length(suffix);
+        return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+    }
+}
+
+VideoCapture::~VideoCapture() {
+    Stop();
+}
+
+bool VideoCapture::Start(const std::string& newPath, int newFps, int workerCount) {
+    Stop();
+    path = newPath;
+    video = EndsWith(path, ".y4m");
+    fps = std::max(newFps, 1);
+    if (video) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+    } else {
+        mkdir(path.c_str(), 0755);
+    }
+    videoWidth = 0;
+    videoHeight = 0;
+    queueHead = 0;
+    queueCount = 0;
+    nextSequence = 0;
+    nextToWrite = 0;
+    stats = CaptureStats();
+    stopping = false;
+    running = true;
+
+    // Fewer workers than asked for is fine; none is not
+    for (int i = 0; i < std::max(workerCount, 1); i++) {
+        try {
+            workers.emplace_back(&VideoCapture::Work, this);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    if (workers.empty()) {
+        running = false;
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool VideoCapture::Capture() {
+    if (!running) {
+        return false;
+    }
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    return Submit(rlReadScreenPixels(width, height), width, height);
+}
+
+bool VideoCapture::Submit(unsigned char* rgba, int width, int height) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running && rgba) {
+            stats.captured++;
+            if (queueCount < QUEUE_DEPTH) {
+                if (video && videoWidth == 0) {
+                    videoWidth = width;
+                    videoHeight = height;
+                }
+                queue[(queueHead + queueCount) % QUEUE_DEPTH] = {rgba, width, height, nextSequence++};
+                queueCount++;
+                wake.notify_one();
+                return true;
+            }
+            stats.dropped++;
+        }
+    }
+    std::free(rgba);
+    return false;
+}
+
+void VideoCapture::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    if (file) {
+        if (std::fclose(file) != 0) {
+            stats.failed++;
+        }
+        file = nullptr;
+    }
+    running = false;
+}
+
+CaptureStats VideoCapture::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void VideoCapture::Work() {
+    std::vector<uint8_t> yuv;
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return queueCount > 0 || stopping; });
+            if (queueCount == 0) {
+                return;
+            }
+            frame = queue[queueHead];
+            queueHead = (queueHead + 1) % QUEUE_DEPTH;
+            queueCount--;
+        }
+        bool ok = Encode(frame, yuv);
+        if (video) {
+            ok = WriteVideoFrame(frame, ok ? yuv : std::vector<uint8_t>()) && ok;
+        }
+        std::free(frame.rgba);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok) {
+            stats.written++;
+        } else {
+            stats.failed++;
+        }
+    }
+}
+
+bool VideoCapture::Encode(const Frame& frame, std::vector<uint8_t>& yuv) {
+    if (!video) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "/frame-%06llu.png", (unsigned long long)frame.sequence);
+        Image image = {frame.rgba, frame.width, frame.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        return ExportImage(image, (path + name).c_str());
+    }
+    if (frame.width != videoWidth || frame.height != videoHeight) {
+        return false;
+    }
+
+    // 4:2:0: full-size luma, then each chroma plane averaged over 2x2 blocks
+    int width = frame.width;
+    int height = frame.height;
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    yuv.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    uint8_t* luma = yuv.data();
+    uint8_t* cb = luma + (size_t)width * height;
+    uint8_t* cr = cb + (size_t)chromaWidth * chromaHeight;
+    const unsigned char* rgba = frame.rgba;
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            luma[(size_t)y * width + x] = LumaOf(row + 4 * x);
+        }
+    }
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int y = 2 * cy; y < std::min(2 * cy + 2, height); y++) {
+                for (int x = 2 * cx; x < std::min(2 * cx + 2, width); x++) {
+                    const unsigned char* p = rgba + ((size_t)y * width + x) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    n++;
+                }
+            }
+            r /= n;
+            g /= n;
+            b /= n;
+            cb[(size_t)cy * chromaWidth + cx] = (uint8_t)(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+            cr[(size_t)cy * chromaWidth + cx] = (uint8_t)(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+        }
+    }
+    return true;
+}
+
+bool VideoCapture::WriteVideoFrame(const Frame& frame, const std::vector<uint8_t>& yuv) {
+    std::unique_lock<std::mutex> lock(writeMutex);
+    turn.wait(lock, [this, &frame]() { return nextToWrite == frame.sequence; });
+    bool ok = true;
+    if (frame.sequence == 0) {
+        ok = std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", videoWidth, videoHeight, fps) > 0;
+    }
+    // A frame that failed to encode leaves no gap in the file
+    if (!yuv.empty()) {
+        ok = std::fputs("FRAME\n", file) >= 0 && ok;
+        ok = std::fwrite(yuv.data(), 1, yuv.size(), file) == yuv.size() && ok;
+    }
+    nextToWrite++;
+    turn.notify_all();
+    return ok;
+}
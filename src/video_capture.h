@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CaptureConstants {
+    const int DEFAULT_WORKERS = 2;
+    // Frames waiting for a worker; one more captured while all are taken is dropped
+    const int QUEUE_DEPTH = 8;
+}
+
+struct CaptureStats {
+    uint64_t captured = 0;      // handed to Submit
+    uint64_t written = 0;
+    uint64_t dropped = 0;       // queue full
+    uint64_t failed = 0;        // encode or write errors
+};
+
+// Gameplay recording off the render thread. The game loop reads the frame
+// back once per tick and queues it; worker threads encode it, either into
+// an uncompressed YUV4MPEG2 video (path ending in .y4m, frames in order) or
+// as numbered PNGs in a directory. Nothing on the game loop's side waits for
+// encoding: when the workers fall behind and the bounded queue is full, the
+// new frame is dropped and counted.
+class VideoCapture {
+public:
+    ~VideoCapture();
+
+    // `fps` is the playback rate written into a video (ticks per second).
+    // False if the file can't be created or no worker thread starts.
+    bool Start(const std::string& path, int fps, int workers = CaptureConstants::DEFAULT_WORKERS);
+    // Reads back the framebuffer (call before EndDrawing) and submits it
+    bool Capture();
+    // Queues an RGBA frame, top row first, and takes ownership of `rgba`
+    // (freed with std::free). False if it was dropped.
+    bool Submit(unsigned char* rgba, int width, int height);
+    // Encodes what is still queued, then stops the workers and closes the video
+    void Stop();
+
+    bool IsRecording() const { return running; }
+    CaptureStats GetStats();
+
+private:
+    struct Frame {
+        unsigned char* rgba;
+        int width;
+        int height;
+        uint64_t sequence;
+    };
+
+    void Work();
+    bool Encode(const Frame& frame, std::vector<uint8_t>& yuv);
+    bool WriteVideoFrame(const Frame& frame, const std::vector<uint8_t>& yuv);
+
+    std::string path;
+    bool video = false;
+    int fps = 0;
+    FILE* file = nullptr;
+    int videoWidth = 0;         // from the first frame; later sizes are skipped
+    int videoHeight = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;       // a frame was queued, or stopping
+    Frame queue[CaptureConstants::QUEUE_DEPTH];
+    int queueHead = 0;
+    int queueCount = 0;
+    uint64_t nextSequence = 0;
+    // Separate from `mutex` so a slow write never holds up Submit
+    std::mutex writeMutex;
+    std::condition_variable turn;       // the next frame in order was written
+    uint64_t nextToWrite = 0;           // video frames go out in sequence order
+    bool running = false;
+    bool stopping = false;
+    CaptureStats stats;
+};
@@ -0,0 +1,56 @@
+#include "zobrist.h"
+#include "game_state.h"
+
+// splitmix64 from a fixed seed, so hashes are the same in every build and run
+static constexpr Zobrist::Keys BuildKeys() {
+    Zobrist::Keys keys = {};
+    uint64_t state = 0x5A0B215EEDull;
+    auto next = [&state]() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+    for (auto& cell : keys.segment) {
+        for (auto& key : cell) {
+            key = next();
+        }
+    }
+    for (auto& key : keys.head) {
+        key = next();
+    }
+    for (auto& cell : keys.apple) {
+        for (auto& key : cell) {
+            key = next();
+        }
+    }
+    for (auto& row : keys.direction) {
+        for (auto& key : row) {
+            key = next();
+        }
+    }
+    // No effects hashes to nothing, like an empty board
+    for (int i = 1; i < Zobrist::EFFECT_COUNT; i++) {
+        keys.effects[i] = next();
+    }
+    return keys;
+}
+
+constexpr Zobrist::Keys Zobrist::KEYS = BuildKeys();
+
+uint64_t Zobrist::Hash(const GameState& state) {
+    const auto& snake = state.snake;
+    uint64_t h = LengthKey((uint32_t)snake.size()) ^ DirectionKey(state.dx, state.dy) ^
+                 EffectsKey(state.GetEffectMask());
+    if (!snake.empty()) {
+        h ^= HeadKey(snake[0]);
+        for (size_t i = 0; i + 1 < snake.size(); i++) {
+            h ^= SegmentKey(snake[i], Link(snake[i], snake[i + 1]));
+        }
+        h ^= SegmentKey(snake.back(), LINK_TAIL);
+    }
+    for (const auto& apple : state.apples) {
+        h ^= AppleKey(apple);
+    }
+    return h;
+}
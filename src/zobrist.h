@@ -0,0 +1,81 @@
+#pragma once
+
+#include "game_types.h"
+#include <cstdint>
+
+class GameState;
+
+// Zobrist keys for GameState::hash. The hash is the XOR of:
+//   one key per body segment, for its cell and its link to the next segment
+//   (a step, stacked on it, a jump, or none for the tail)
+//   a key for the head cell and one for the length
+//   one key per apple, for its cell and type
+//   a key for the direction and one for the set of active effects
+// Linking each segment to the next pins down the body's order, and every
+// move changes a fixed number of terms, so GameLogic keeps the hash up to
+// date in O(1) per push, pop, apple and effect change.
+namespace Zobrist {
+    const int CELLS = GameConstants::GRID_WIDTH * GameConstants::GRID_HEIGHT;
+    // Links 0-3 are steps up, down, left, right (wrapping at the walls)
+    const int LINK_STACKED = 4;
+    const int LINK_JUMP = 5;
+    const int LINK_TAIL = 6;
+    const int LINK_COUNT = 7;
+    const int EFFECT_COUNT = 1 << 4;
+
+    struct Keys {
+        uint64_t segment[CELLS][LINK_COUNT];
+        uint64_t head[CELLS];
+        uint64_t apple[CELLS][TELEPORT + 1];
+        uint64_t direction[3][3];           // [dx + 1][dy + 1]
+        uint64_t effects[EFFECT_COUNT];     // by GameState::GetEffectMask
+    };
+    extern const Keys KEYS;
+
+    inline int Cell(Position p) { return p.row * GameConstants::GRID_WIDTH + p.col; }
+
+    inline int Link(Position from, Position to) {
+        int dc = to.col - from.col;
+        int dr = to.row - from.row;
+        if (dc == GameConstants::GRID_WIDTH - 1) {
+            dc = -1;
+        } else if (dc == 1 - GameConstants::GRID_WIDTH) {
+            dc = 1;
+        }
+        if (dr == GameConstants::GRID_HEIGHT - 1) {
+            dr = -1;
+        } else if (dr == 1 - GameConstants::GRID_HEIGHT) {
+            dr = 1;
+        }
+        if (dc == 0 && dr == 0) {
+            return LINK_STACKED;
+        } else if (dc == 0 && dr == -1) {
+            return 0;
+        } else if (dc == 0 && dr == 1) {
+            return 1;
+        } else if (dr == 0 && dc == -1) {
+            return 2;
+        } else if (dr == 0 && dc == 1) {
+            return 3;
+        }
+        return LINK_JUMP;
+    }
+
+    inline uint64_t SegmentKey(Position p, int link) { return KEYS.segment[Cell(p)][link]; }
+    inline uint64_t HeadKey(Position p) { return KEYS.head[Cell(p)]; }
+    inline uint64_t AppleKey(const Apple& apple) { return KEYS.apple[Cell({apple.col, apple.row})][apple.type]; }
+    inline uint64_t DirectionKey(int dx, int dy) { return KEYS.direction[dx + 1][dy + 1]; }
+    inline uint64_t EffectsKey(int mask) { return KEYS.effects[mask]; }
+
+    // Lengths aren't bounded by the board (immunity overlaps), so they're
+    // mixed rather than looked up
+    inline uint64_t LengthKey(uint32_t length) {
+        uint64_t z = length * 0x9E3779B97F4A7C15ull + 0xD1B54A32D192ED03ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // From scratch, O(length); GameState::hash is this kept up to date
+    uint64_t Hash(const GameState& state);
+}